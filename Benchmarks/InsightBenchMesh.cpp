@@ -0,0 +1,203 @@
+#include "InsightBenchMesh.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <random>
+#include <sstream>
+
+namespace InsightBench
+{
+	InsightVoxel::FBounds3 FBenchMesh::ComputeBounds() const
+	{
+		InsightVoxel::FBounds3 Bounds;
+		if (Verts.empty())
+		{
+			return Bounds;
+		}
+
+		Bounds.Min = {Verts[0], Verts[1], Verts[2]};
+		Bounds.Max = Bounds.Min;
+		for (size_t i = 0; i < Verts.size(); i += 3)
+		{
+			for (int Axis = 0; Axis < 3; ++Axis)
+			{
+				Bounds.Min[Axis] = std::min(Bounds.Min[Axis], Verts[i + Axis]);
+				Bounds.Max[Axis] = std::max(Bounds.Max[Axis], Verts[i + Axis]);
+			}
+		}
+		return Bounds;
+	}
+
+	bool LoadObj(const std::string& Path, FBenchMesh& OutMesh, bool bYUp)
+	{
+		std::ifstream File(Path);
+		if (!File)
+		{
+			return false;
+		}
+
+		OutMesh.Verts.clear();
+		OutMesh.Indices.clear();
+
+		std::string Line;
+		std::vector<int32_t> Face;
+		while (std::getline(File, Line))
+		{
+			if (Line.size() < 2)
+			{
+				continue;
+			}
+
+			std::istringstream Stream(Line);
+			std::string Tag;
+			Stream >> Tag;
+
+			if (Tag == "v")
+			{
+				float X = 0.0f, Y = 0.0f, Z = 0.0f;
+				Stream >> X >> Y >> Z;
+				if (bYUp)
+				{
+					std::swap(Y, Z);
+				}
+				OutMesh.Verts.push_back(X);
+				OutMesh.Verts.push_back(Y);
+				OutMesh.Verts.push_back(Z);
+			}
+			else if (Tag == "f")
+			{
+				Face.clear();
+				std::string Token;
+				while (Stream >> Token)
+				{
+					// "v", "v/vt", "v//vn" or "v/vt/vn"; negative indices are relative to the end
+					int Index = std::atoi(Token.c_str());
+					if (Index < 0)
+					{
+						Index += OutMesh.NumVerts() + 1;
+					}
+					Face.push_back(Index - 1);
+				}
+				for (size_t i = 2; i < Face.size(); ++i)
+				{
+					OutMesh.Indices.push_back(Face[0]);
+					OutMesh.Indices.push_back(Face[i - 1]);
+					OutMesh.Indices.push_back(Face[i]);
+				}
+			}
+		}
+
+		return !OutMesh.Indices.empty();
+	}
+
+	bool LoadRaw(const std::string& Path, FBenchMesh& OutMesh)
+	{
+		FILE* File = std::fopen(Path.c_str(), "rb");
+		if (!File)
+		{
+			return false;
+		}
+
+		int32_t Header[2] = {0, 0};
+		bool bOk = std::fread(Header, sizeof(Header), 1, File) == 1 && Header[0] >= 0 && Header[1] >= 0;
+		if (bOk)
+		{
+			OutMesh.Verts.resize(static_cast<size_t>(Header[0]) * 3);
+			OutMesh.Indices.resize(static_cast<size_t>(Header[1]) * 3);
+			bOk = std::fread(OutMesh.Verts.data(), sizeof(float), OutMesh.Verts.size(), File) == OutMesh.Verts.size()
+				&& std::fread(OutMesh.Indices.data(), sizeof(int32_t), OutMesh.Indices.size(), File) == OutMesh.Indices.size();
+		}
+
+		std::fclose(File);
+		return bOk;
+	}
+
+	bool SaveRaw(const std::string& Path, const FBenchMesh& Mesh)
+	{
+		FILE* File = std::fopen(Path.c_str(), "wb");
+		if (!File)
+		{
+			return false;
+		}
+
+		const int32_t Header[2] = {Mesh.NumVerts(), Mesh.NumTris()};
+		bool bOk = std::fwrite(Header, sizeof(Header), 1, File) == 1;
+		bOk = bOk && std::fwrite(Mesh.Verts.data(), sizeof(float), Mesh.Verts.size(), File) == Mesh.Verts.size();
+		bOk = bOk && std::fwrite(Mesh.Indices.data(), sizeof(int32_t), Mesh.Indices.size(), File) == Mesh.Indices.size();
+
+		std::fclose(File);
+		return bOk;
+	}
+
+	static void AddBox(FBenchMesh& Mesh, const InsightVoxel::FVec3& Min, const InsightVoxel::FVec3& Max)
+	{
+		const int32_t Base = Mesh.NumVerts();
+		for (int Corner = 0; Corner < 8; ++Corner)
+		{
+			Mesh.Verts.push_back((Corner & 1) ? Max.X : Min.X);
+			Mesh.Verts.push_back((Corner & 2) ? Max.Y : Min.Y);
+			Mesh.Verts.push_back((Corner & 4) ? Max.Z : Min.Z);
+		}
+
+		static const int32_t Faces[36] = {
+			0, 2, 1, 1, 2, 3, // bottom
+			4, 5, 6, 5, 7, 6, // top
+			0, 1, 4, 1, 5, 4, // front
+			2, 6, 3, 3, 6, 7, // back
+			0, 4, 2, 2, 4, 6, // left
+			1, 3, 5, 3, 7, 5  // right
+		};
+		for (int32_t Index : Faces)
+		{
+			Mesh.Indices.push_back(Base + Index);
+		}
+	}
+
+	void GenerateTerrain(int Resolution, float Extent, uint32_t Seed, FBenchMesh& OutMesh)
+	{
+		OutMesh.Verts.clear();
+		OutMesh.Indices.clear();
+
+		const float Step = Extent / Resolution;
+		const float Amplitude = Extent * 0.05f;
+
+		for (int Y = 0; Y <= Resolution; ++Y)
+		{
+			for (int X = 0; X <= Resolution; ++X)
+			{
+				const float PX = X * Step;
+				const float PY = Y * Step;
+				const float PZ = Amplitude * (std::sin(PX * 6.0f / Extent) + std::cos(PY * 4.0f / Extent));
+				OutMesh.Verts.push_back(PX);
+				OutMesh.Verts.push_back(PY);
+				OutMesh.Verts.push_back(PZ);
+			}
+		}
+
+		for (int Y = 0; Y < Resolution; ++Y)
+		{
+			for (int X = 0; X < Resolution; ++X)
+			{
+				const int32_t I0 = Y * (Resolution + 1) + X;
+				const int32_t I1 = I0 + 1;
+				const int32_t I2 = I0 + Resolution + 1;
+				const int32_t I3 = I2 + 1;
+				OutMesh.Indices.insert(OutMesh.Indices.end(), {I0, I1, I2, I1, I3, I2});
+			}
+		}
+
+		std::mt19937 Rng(Seed);
+		std::uniform_real_distribution<float> Pos(0.0f, Extent);
+		std::uniform_real_distribution<float> Size(Extent * 0.005f, Extent * 0.03f);
+		const int BoxNum = Resolution;
+		for (int i = 0; i < BoxNum; ++i)
+		{
+			const InsightVoxel::FVec3 Min(Pos(Rng), Pos(Rng), -Amplitude);
+			const float Half = Size(Rng);
+			AddBox(OutMesh, Min, {Min.X + Half * 2.0f, Min.Y + Half * 2.0f, Amplitude * 2.0f + Half * 4.0f});
+		}
+	}
+}
@@ -0,0 +1,34 @@
+// Triangle soup loading / generation for the headless benchmarks.
+
+#pragma once
+
+#include "VoxelCore/InsightVoxelTypes.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace InsightBench
+{
+	struct FBenchMesh
+	{
+		// xyz triples, Unreal convention (Z up)
+		std::vector<float> Verts;
+		std::vector<int32_t> Indices;
+
+		int NumVerts() const { return static_cast<int>(Verts.size() / 3); }
+		int NumTris() const { return static_cast<int>(Indices.size() / 3); }
+
+		InsightVoxel::FBounds3 ComputeBounds() const;
+	};
+
+	// Wavefront OBJ (only "v" and "f" records; polygons are fan-triangulated, Y-up files can be swapped to Z-up)
+	bool LoadObj(const std::string& Path, FBenchMesh& OutMesh, bool bYUp);
+
+	// Raw dump: int32 NumVerts, int32 NumTris, float Verts[NumVerts * 3], int32 Indices[NumTris * 3]
+	bool LoadRaw(const std::string& Path, FBenchMesh& OutMesh);
+	bool SaveRaw(const std::string& Path, const FBenchMesh& Mesh);
+
+	// Procedural stress mesh: a Resolution x Resolution rolling terrain with a field of boxes on top
+	void GenerateTerrain(int Resolution, float Extent, uint32_t Seed, FBenchMesh& OutMesh);
+}
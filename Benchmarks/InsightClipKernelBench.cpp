@@ -0,0 +1,320 @@
+// Correctness harness and microbenchmark for ClipRowSpans.
+//
+// Compares every compiled kernel against the sequential DividePoly chain the rasterizer used before
+// (reference), over randomized triangles: free-floating ones, ones snapped to the cell grid, which
+// exercise corners lying exactly on cell boundaries, and ones reaching far outside the grid. Exits with 1
+// if a kernel's spans are not bit-identical to the reference, if the kernels disagree bit for bit with
+// each other, or if splitting a row into several calls (as the rasterizer does for long rows) changes them.
+//
+// Usage: InsightClipKernelBench [--tris N] [--seed S] [--iters N]
+
+#include "VoxelCore/InsightVoxelClipKernel.h"
+#include "VoxelCore/InsightVoxelRasterizer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <utility>
+#include <vector>
+
+using namespace InsightVoxel;
+
+namespace
+{
+	const float GridMinX = -1000.0f;
+	const float GridMinY = -1000.0f;
+	const float CellSize = 20.0f;
+	const float CellHeight = 50.0f;
+	const int GridCells = 100;
+
+	struct FRowJob
+	{
+		FVec3 Verts[7];
+		int Num = 0;
+		int X0 = 0;
+		int X1 = 0;
+	};
+
+	struct FCellSpan
+	{
+		float Min = 0.0f;
+		float Max = 0.0f;
+		uint8_t Valid = 0;
+	};
+
+	int FloorToCell(float Value) { return static_cast<int>(std::floor(Value)); }
+	int CeilToCell(float Value) { return static_cast<int>(std::ceil(Value)); }
+
+	// Cut triangles into row polygons exactly like RasterizeTriangle does
+	void BuildRows(const std::vector<FVec3>& Tris, std::vector<FRowJob>& OutRows)
+	{
+		for (size_t T = 0; T + 2 < Tris.size(); T += 3)
+		{
+			FVec3 Buf[7 * 3];
+			FVec3* In = Buf;
+			FVec3* InRow = In + 7;
+			FVec3* P1 = InRow + 7;
+			In[0] = Tris[T];
+			In[1] = Tris[T + 1];
+			In[2] = Tris[T + 2];
+			int NIn = 3, NRow = 3;
+
+			const float MinY = std::min(In[0].Y, std::min(In[1].Y, In[2].Y));
+			const float MaxY = std::max(In[0].Y, std::max(In[1].Y, In[2].Y));
+			const int Y0 = std::max(FloorToCell((MinY - GridMinY) / CellSize), 0);
+			const int Y1 = std::min(CeilToCell((MaxY - GridMinY) / CellSize), GridCells - 1);
+
+			for (int Y = Y0; Y <= Y1; ++Y)
+			{
+				DividePoly(In, NIn, InRow, NRow, P1, NIn, GridMinY + (Y + 1) * CellSize, 1);
+				std::swap(In, P1);
+				if (NRow < 3)
+				{
+					continue;
+				}
+
+				FRowJob Row;
+				Row.Num = NRow;
+				float MinX = InRow[0].X, MaxX = InRow[0].X;
+				for (int i = 0; i < NRow; ++i)
+				{
+					Row.Verts[i] = InRow[i];
+					MinX = std::min(MinX, InRow[i].X);
+					MaxX = std::max(MaxX, InRow[i].X);
+				}
+				Row.X0 = std::min(std::max(FloorToCell((MinX - GridMinX) / CellSize), 0), GridCells - 1);
+				Row.X1 = std::min(std::max(CeilToCell((MaxX - GridMinX) / CellSize), 0), GridCells - 1);
+				Row.X1 = std::min(Row.X1, Row.X0 + ClipKernelMaxCells - 1);
+				OutRows.push_back(Row);
+			}
+		}
+	}
+
+	// The column loop of the rasterizer before ClipRowSpans
+	void ReferenceRow(const FRowJob& Row, FCellSpan* Out)
+	{
+		FVec3 Buf[7 * 3];
+		FVec3* InRow = Buf;
+		FVec3* P1 = InRow + 7;
+		FVec3* P2 = P1 + 7;
+		std::copy(Row.Verts, Row.Verts + Row.Num, InRow);
+
+		int N, N2 = Row.Num;
+		for (int X = Row.X0; X <= Row.X1; ++X)
+		{
+			const float CX = GridMinX + X * CellSize;
+			DividePoly(InRow, N2, P1, N, P2, N2, CX + CellSize, 0);
+			std::swap(InRow, P2);
+
+			FCellSpan& Span = Out[X - Row.X0];
+			Span.Valid = N >= 3;
+			if (!Span.Valid)
+			{
+				continue;
+			}
+			Span.Min = Span.Max = P1[0].Z;
+			for (int i = 1; i < N; ++i)
+			{
+				Span.Min = std::min(Span.Min, P1[i].Z);
+				Span.Max = std::max(Span.Max, P1[i].Z);
+			}
+		}
+	}
+
+	// Cells of the row in calls of at most ChunkCells cells, each resuming the previous one or starting over
+	void KernelRow(EClipKernel Kernel, const FRowJob& Row, FCellSpan* Out, int ChunkCells = ClipKernelMaxCells, bool bResume = true)
+	{
+		FRowPolySoA Poly;
+		Poly.Num = Row.Num;
+		for (int i = 0; i < Row.Num; ++i)
+		{
+			Poly.X[i] = Row.Verts[i].X;
+			Poly.Z[i] = Row.Verts[i].Z;
+		}
+
+		float Min[ClipKernelMaxCells], Max[ClipKernelMaxCells];
+		uint8_t Valid[ClipKernelMaxCells];
+		FClipRowState State;
+		for (int X0 = Row.X0; X0 <= Row.X1; X0 += ChunkCells)
+		{
+			const int X1 = std::min(X0 + ChunkCells - 1, Row.X1);
+			ClipRowSpansWith(Kernel, Poly, GridMinX, CellSize, Row.X0, X0, X1, Min + (X0 - Row.X0), Max + (X0 - Row.X0),
+							 Valid + (X0 - Row.X0), bResume ? &State : nullptr);
+		}
+
+		for (int i = 0; i <= Row.X1 - Row.X0; ++i)
+		{
+			Out[i].Valid = Valid[i];
+			Out[i].Min = Valid[i] ? Min[i] : 0.0f;
+			Out[i].Max = Valid[i] ? Max[i] : 0.0f;
+		}
+	}
+
+	void GenerateTriangles(int Num, uint32_t Seed, std::vector<FVec3>& OutTris)
+	{
+		std::mt19937 Rng(Seed);
+		std::uniform_real_distribution<float> Center(GridMinX + 100.0f, GridMinX + GridCells * CellSize - 100.0f);
+		std::uniform_real_distribution<float> Offset(-1.0f, 1.0f);
+		std::uniform_real_distribution<float> Height(-500.0f, 500.0f);
+		std::uniform_real_distribution<float> Scale(1.0f, 400.0f);
+		std::uniform_int_distribution<int> SnapCell(0, GridCells - 1);
+
+		for (int T = 0; T < Num; ++T)
+		{
+			const bool bSnapped = (T & 3) == 0;
+			const float CX = Center(Rng), CY = Center(Rng), S = Scale(Rng);
+			for (int V = 0; V < 3; ++V)
+			{
+				FVec3 P(CX + Offset(Rng) * S, CY + Offset(Rng) * S, Height(Rng));
+				if (bSnapped)
+				{
+					// Corners on cell boundaries, computed the way the rasterizer computes them
+					const int SX = SnapCell(Rng) / 4 + static_cast<int>((CX - GridMinX) / CellSize) - 12;
+					const float CellX = GridMinX + SX * CellSize;
+					P.X = CellX + CellSize;
+				}
+				if ((T & 15) == 1 && V == 0)
+				{
+					// Corner far outside the grid, so the row's corners lie past both ends of the clamped cell range
+					P.X = (T & 16) ? 100000.0f : -100000.0f;
+				}
+				OutTris.push_back(P);
+			}
+		}
+	}
+
+	double SecondsSince(std::chrono::steady_clock::time_point Start)
+	{
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - Start).count();
+	}
+}
+
+int main(int Argc, char** Argv)
+{
+	int TriNum = 200000;
+	uint32_t Seed = 42;
+	int Iters = 5;
+	for (int i = 1; i < Argc; ++i)
+	{
+		const bool bHasValue = i + 1 < Argc;
+		if (!std::strcmp(Argv[i], "--tris") && bHasValue) TriNum = std::atoi(Argv[++i]);
+		else if (!std::strcmp(Argv[i], "--seed") && bHasValue) Seed = static_cast<uint32_t>(std::atoi(Argv[++i]));
+		else if (!std::strcmp(Argv[i], "--iters") && bHasValue) Iters = std::atoi(Argv[++i]);
+		else
+		{
+			std::fprintf(stderr, "Usage: %s [--tris N] [--seed S] [--iters N]\n", Argv[0]);
+			return 1;
+		}
+	}
+
+	std::vector<FVec3> Tris;
+	GenerateTriangles(TriNum, Seed, Tris);
+
+	std::vector<FRowJob> Rows;
+	BuildRows(Tris, Rows);
+
+	size_t CellNum = 0;
+	for (const FRowJob& Row : Rows)
+	{
+		CellNum += Row.X1 - Row.X0 + 1;
+	}
+	std::printf("%d triangles, %zu rows, %zu cells\n", TriNum, Rows.size(), CellNum);
+
+	const EClipKernel Kernels[] = {EClipKernel::Scalar, EClipKernel::SSE, EClipKernel::AVX};
+	std::vector<EClipKernel> Available;
+	for (EClipKernel Kernel : Kernels)
+	{
+		FRowPolySoA Probe;
+		float Min, Max;
+		uint8_t Valid;
+		if (ClipRowSpansWith(Kernel, Probe, 0.0f, 1.0f, 0, 0, 0, &Min, &Max, &Valid))
+		{
+			Available.push_back(Kernel);
+		}
+	}
+
+	// Correctness
+	bool bFailed = false;
+	FCellSpan Ref[ClipKernelMaxCells], Scalar[ClipKernelMaxCells], Test[ClipKernelMaxCells], Chunked[ClipKernelMaxCells],
+		Restarted[ClipKernelMaxCells];
+	for (EClipKernel Kernel : Available)
+	{
+		size_t ValidMismatch = 0, QuantMismatch = 0, BitMismatch = 0, ChunkMismatch = 0;
+		double MaxError = 0.0;
+
+		for (const FRowJob& Row : Rows)
+		{
+			ReferenceRow(Row, Ref);
+			KernelRow(EClipKernel::Scalar, Row, Scalar);
+			KernelRow(Kernel, Row, Test);
+			KernelRow(Kernel, Row, Chunked, 3);
+			KernelRow(Kernel, Row, Restarted, 3, false);
+
+			for (int i = 0; i <= Row.X1 - Row.X0; ++i)
+			{
+				if (std::memcmp(&Scalar[i], &Test[i], sizeof(FCellSpan)) != 0)
+				{
+					++BitMismatch;
+				}
+				if (std::memcmp(&Chunked[i], &Test[i], sizeof(FCellSpan)) != 0 || std::memcmp(&Restarted[i], &Test[i], sizeof(FCellSpan)) != 0)
+				{
+					++ChunkMismatch;
+				}
+				if (Ref[i].Valid != Test[i].Valid)
+				{
+					++ValidMismatch;
+					continue;
+				}
+				if (!Ref[i].Valid)
+				{
+					continue;
+				}
+				MaxError = std::max(MaxError, static_cast<double>(std::fabs(Ref[i].Min - Test[i].Min)));
+				MaxError = std::max(MaxError, static_cast<double>(std::fabs(Ref[i].Max - Test[i].Max)));
+				if (FloorToCell(Ref[i].Min / CellHeight) != FloorToCell(Test[i].Min / CellHeight)
+					|| CeilToCell(Ref[i].Max / CellHeight) != CeilToCell(Test[i].Max / CellHeight))
+				{
+					++QuantMismatch;
+				}
+			}
+		}
+
+		std::printf("%-6s vs reference: %zu validity / %zu voxel span mismatches, max |dz| %.3g; vs scalar kernel: %zu bit mismatches; "
+			"split rows: %zu mismatches\n", GetClipKernelName(Kernel), ValidMismatch, QuantMismatch, MaxError, BitMismatch, ChunkMismatch);
+		// Any difference from the chain can move a span end across a voxel boundary, so none is tolerated
+		bFailed |= ValidMismatch != 0 || QuantMismatch != 0 || MaxError != 0.0 || BitMismatch != 0 || ChunkMismatch != 0;
+	}
+
+	// Microbenchmark
+	volatile float Sink = 0.0f;
+	auto TimeRows = [&](auto&& RowFn) {
+		double Best = 1e30;
+		for (int Iter = 0; Iter < Iters; ++Iter)
+		{
+			const auto Start = std::chrono::steady_clock::now();
+			float Acc = 0.0f;
+			for (const FRowJob& Row : Rows)
+			{
+				RowFn(Row, Test);
+				Acc += Test[0].Min;
+			}
+			Best = std::min(Best, SecondsSince(Start));
+			Sink = Sink + Acc;
+		}
+		return Best;
+	};
+
+	const double RefTime = TimeRows([](const FRowJob& Row, FCellSpan* Out) { ReferenceRow(Row, Out); });
+	std::printf("%-10s %8.3f ms, %7.2f Mcells/s\n", "reference", RefTime * 1e3, CellNum / RefTime * 1e-6);
+	for (EClipKernel Kernel : Available)
+	{
+		const double Time = TimeRows([Kernel](const FRowJob& Row, FCellSpan* Out) { KernelRow(Kernel, Row, Out); });
+		std::printf("%-10s %8.3f ms, %7.2f Mcells/s, %.2fx\n", GetClipKernelName(Kernel), Time * 1e3, CellNum / Time * 1e-6, RefTime / Time);
+	}
+
+	return bFailed ? 1 : 0;
+}
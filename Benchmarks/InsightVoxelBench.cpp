@@ -0,0 +1,1313 @@
+// Headless benchmark for the voxelization core.
+//
+// Usage: InsightVoxelBench [--obj File.obj [--yup]] [--raw File.bin] [--proc Resolution]
+//                          [--cs CellSize] [--ch CellHeight] [--iters N] [--save-raw File.bin]
+//                          [--threads N] [--band Rows]
+
+#include "InsightBenchMesh.h"
+
+#include "VoxelCore/InsightVoxelBits.h"
+#include "VoxelCore/InsightVoxelBvh.h"
+#include "VoxelCore/InsightVoxelCache.h"
+#include "VoxelCore/InsightVoxelClearance.h"
+#include "VoxelCore/InsightVoxelComponents.h"
+#include "VoxelCore/InsightVoxelGrid.h"
+#include "VoxelCore/InsightVoxelHierarchy.h"
+#include "VoxelCore/InsightVoxelMesher.h"
+#include "VoxelCore/InsightVoxelPathBatch.h"
+#include "VoxelCore/InsightVoxelPathFinder.h"
+#include "VoxelCore/InsightVoxelPipeline.h"
+#include "VoxelCore/InsightVoxelRasterizer.h"
+#include "VoxelCore/InsightVoxelSmoothing.h"
+#include "VoxelCore/InsightVoxelSparseGrid.h"
+#include "VoxelCore/InsightVoxelSpans.h"
+#include "VoxelCore/InsightVoxelSurface.h"
+#include "VoxelCore/InsightVoxelWalkable.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace InsightVoxel;
+using namespace InsightBench;
+
+namespace
+{
+	struct FBenchArgs
+	{
+		std::string ObjPath;
+		std::string RawPath;
+		std::string SaveRawPath;
+		bool bYUp = false;
+		int Resolution = 256;
+		float Extent = 20000.0f;
+		float CellSize = 20.0f;
+		float CellHeight = 50.0f;
+		int Iters = 5;
+		int Threads = 0;
+		int BandRows = 8;
+	};
+
+	bool ParseArgs(int Argc, char** Argv, FBenchArgs& Args)
+	{
+		for (int i = 1; i < Argc; ++i)
+		{
+			const bool bHasValue = i + 1 < Argc;
+			if (!std::strcmp(Argv[i], "--obj") && bHasValue) Args.ObjPath = Argv[++i];
+			else if (!std::strcmp(Argv[i], "--raw") && bHasValue) Args.RawPath = Argv[++i];
+			else if (!std::strcmp(Argv[i], "--save-raw") && bHasValue) Args.SaveRawPath = Argv[++i];
+			else if (!std::strcmp(Argv[i], "--yup")) Args.bYUp = true;
+			else if (!std::strcmp(Argv[i], "--proc") && bHasValue) Args.Resolution = std::atoi(Argv[++i]);
+			else if (!std::strcmp(Argv[i], "--extent") && bHasValue) Args.Extent = static_cast<float>(std::atof(Argv[++i]));
+			else if (!std::strcmp(Argv[i], "--cs") && bHasValue) Args.CellSize = static_cast<float>(std::atof(Argv[++i]));
+			else if (!std::strcmp(Argv[i], "--ch") && bHasValue) Args.CellHeight = static_cast<float>(std::atof(Argv[++i]));
+			else if (!std::strcmp(Argv[i], "--iters") && bHasValue) Args.Iters = std::atoi(Argv[++i]);
+			else if (!std::strcmp(Argv[i], "--threads") && bHasValue) Args.Threads = std::atoi(Argv[++i]);
+			else if (!std::strcmp(Argv[i], "--band") && bHasValue) Args.BandRows = std::atoi(Argv[++i]);
+			else
+			{
+				std::fprintf(stderr, "Unknown argument: %s\n", Argv[i]);
+				return false;
+			}
+		}
+		return Args.Iters > 0 && Args.CellSize > 0.0f && Args.CellHeight > 0.0f && Args.BandRows > 0;
+	}
+
+	double SecondsSince(std::chrono::steady_clock::time_point Start)
+	{
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - Start).count();
+	}
+
+	// First stayable voxel found walking the diagonal from the given corner towards the grid center
+	FIntVec3 FindStayableNear(const FVoxelGrid& Walkable, int X, int Y)
+	{
+		const int StepX = X < Walkable.GetXNum() / 2 ? 1 : -1;
+		const int StepY = Y < Walkable.GetYNum() / 2 ? 1 : -1;
+		for (; Walkable.IsVoxelInside(X, Y, 0); X += StepX, Y += StepY)
+		{
+			for (int Z = 0; Z < Walkable.GetZNum(); ++Z)
+			{
+				if (Walkable.GetVoxelOccupied(X, Y, Z))
+				{
+					return {X, Y, Z};
+				}
+			}
+		}
+		return FIntVec3::Invalid();
+	}
+
+	// Lowest stayable voxel of a random column in [X0, X0 + Size) x [Y0, Y0 + Size)
+	FIntVec3 RandomStayable(const FVoxelGrid& Walkable, int X0, int Y0, int Size, std::mt19937& Rng)
+	{
+		std::uniform_int_distribution<int> Offset(0, Size - 1);
+		for (int Attempt = 0; Attempt < 1000; ++Attempt)
+		{
+			const int X = std::min(X0 + Offset(Rng), Walkable.GetXNum() - 1);
+			const int Y = std::min(Y0 + Offset(Rng), Walkable.GetYNum() - 1);
+			const int Z = Walkable.FindHighestOccupied(X, Y, 0, Walkable.GetZNum());
+			if (Z >= 0)
+			{
+				return {X, Y, Z};
+			}
+		}
+		return FIntVec3::Invalid();
+	}
+
+	// Path from Start to Goal through adjacent voxels, stayable past the start
+	bool IsConnectedPath(const FVoxelGrid& Walkable, const std::vector<FIntVec3>& Path, const FIntVec3& Start, const FIntVec3& Goal)
+	{
+		if (Path.empty() || Path.front() != Start || Path.back() != Goal)
+		{
+			return false;
+		}
+		for (size_t i = 1; i < Path.size(); ++i)
+		{
+			const int Step = std::abs(Path[i].X - Path[i - 1].X) + std::abs(Path[i].Y - Path[i - 1].Y) + std::abs(Path[i].Z - Path[i - 1].Z);
+			if (Step != 1 || !Walkable.GetVoxelOccupied(Path[i].X, Path[i].Y, Path[i].Z))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// Waypoints from Start to Goal whose straight segments, sampled finely, only cross stayable voxels (and clear
+	// enough ones) past the start
+	bool IsSmoothPath(const FVoxelGrid& Walkable, const std::vector<FIntVec3>& Waypoints, const FIntVec3& Start, const FIntVec3& Goal,
+					  const FClearanceField* Clearance = nullptr, int MinClearance = 0)
+	{
+		if (Waypoints.empty() || Waypoints.front() != Start || Waypoints.back() != Goal)
+		{
+			return false;
+		}
+		for (size_t i = 1; i < Waypoints.size(); ++i)
+		{
+			const FIntVec3& A = Waypoints[i - 1];
+			const FIntVec3& B = Waypoints[i];
+			const int SampleNum = 16 * (std::max(std::abs(B.X - A.X), std::max(std::abs(B.Y - A.Y), std::abs(B.Z - A.Z))) + 1);
+			for (int Sample = 0; Sample <= SampleNum; ++Sample)
+			{
+				const double T = static_cast<double>(Sample) / SampleNum;
+				const FIntVec3 Voxel = {
+					static_cast<int>(std::floor(A.X + (B.X - A.X) * T + 0.5)),
+					static_cast<int>(std::floor(A.Y + (B.Y - A.Y) * T + 0.5)),
+					static_cast<int>(std::floor(A.Z + (B.Z - A.Z) * T + 0.5))
+				};
+				if (Voxel == Start)
+				{
+					continue;
+				}
+				if (!Walkable.IsVoxelInside(Voxel.X, Voxel.Y, Voxel.Z) || !Walkable.GetVoxelOccupied(Voxel.X, Voxel.Y, Voxel.Z)
+					|| (Clearance && Clearance->GetClearance(Walkable, Voxel.X, Voxel.Y, Voxel.Z) < MinClearance))
+				{
+					return false;
+				}
+			}
+		}
+		return true;
+	}
+
+	// FClearanceField's value by brute force: octagonal distance to the nearest column with a solid voxel in
+	// [Z + 1, Z + BodyLayers], n steps reaching offsets with max <= n and max + min <= n + ceil(n / 2)
+	int ReferenceClearance(const FVoxelGrid& Grid, int X, int Y, int Z, int BodyLayers, int MaxClearance)
+	{
+		int Best = MaxClearance;
+		for (int DX = -MaxClearance; DX <= MaxClearance; ++DX)
+		{
+			for (int DY = -MaxClearance; DY <= MaxClearance; ++DY)
+			{
+				if (!Grid.IsVoxelInside(X + DX, Y + DY, 0) || !Grid.IsAnyOccupied(X + DX, Y + DY, Z + 1, Z + 1 + BodyLayers))
+				{
+					continue;
+				}
+				const int A = std::max(std::abs(DX), std::abs(DY));
+				const int B = std::min(std::abs(DX), std::abs(DY));
+				int N = A;
+				while (A + B > N + (N + 1) / 2)
+				{
+					++N;
+				}
+				Best = std::min(Best, N);
+			}
+		}
+		return Best;
+	}
+
+	// Whether Quads, read back through GetQuadCorners, cover every exposed face of the voxels in Tile exactly once
+	// and nothing else, with the outward winding. OutExposed is the brute-force count of exposed faces.
+	bool CheckGreedyQuads(const FVoxelGrid& Grid, const FVoxelTile& Tile, const std::vector<FVoxelQuad>& Quads, int64_t& OutExposed)
+	{
+		static const int Step[6][3] = {{-1, 0, 0}, {1, 0, 0}, {0, -1, 0}, {0, 1, 0}, {0, 0, -1}, {0, 0, 1}};
+		auto IsExposed = [&Grid](int X, int Y, int Z, int Dir)
+		{
+			const int NX = X + Step[Dir][0], NY = Y + Step[Dir][1], NZ = Z + Step[Dir][2];
+			return !Grid.IsVoxelInside(NX, NY, NZ) || !Grid.GetVoxelOccupied(NX, NY, NZ);
+		};
+
+		const int TileYNum = Tile.Y1 - Tile.Y0;
+		const int ZNum = Grid.GetZNum();
+		std::vector<uint8_t> Covered(static_cast<size_t>(Tile.X1 - Tile.X0) * TileYNum * ZNum, 0);
+
+		const FVec3& Min = Grid.GetBounds().Min;
+		const float Extent[3] = {Grid.GetCellSize(), Grid.GetCellSize(), Grid.GetCellHeight()};
+		for (const FVoxelQuad& Quad : Quads)
+		{
+			FVec3 Corners[4];
+			GetQuadCorners(Grid, Quad, Corners);
+
+			int Lo[3], Hi[3], Axis = -1;
+			for (int A = 0; A < 3; ++A)
+			{
+				Lo[A] = Hi[A] = static_cast<int>(std::lround((Corners[0][A] - Min[A]) / Extent[A]));
+				for (int Corner = 1; Corner < 4; ++Corner)
+				{
+					const int Cell = static_cast<int>(std::lround((Corners[Corner][A] - Min[A]) / Extent[A]));
+					Lo[A] = std::min(Lo[A], Cell);
+					Hi[A] = std::max(Hi[A], Cell);
+				}
+				if (Lo[A] == Hi[A])
+				{
+					if (Axis >= 0)
+					{
+						return false;
+					}
+					Axis = A;
+				}
+			}
+			if (Axis < 0)
+			{
+				return false;
+			}
+
+			// Right hand normal of the first two edges
+			const FVec3 E0 = Corners[1] - Corners[0];
+			const FVec3 E1 = Corners[2] - Corners[1];
+			const float Normal[3] = {E0.Y * E1.Z - E0.Z * E1.Y, E0.Z * E1.X - E0.X * E1.Z, E0.X * E1.Y - E0.Y * E1.X};
+			const bool bPositive = Normal[Axis] > 0.0f;
+			if (Quad.Dir != Axis * 2 + (bPositive ? 1 : 0))
+			{
+				return false;
+			}
+
+			int Voxel[3];
+			Voxel[Axis] = bPositive ? Lo[Axis] - 1 : Lo[Axis];
+			const int AxisU = Axis == 0 ? 1 : 0;
+			const int AxisV = Axis == 2 ? 1 : 2;
+			for (Voxel[AxisU] = Lo[AxisU]; Voxel[AxisU] < Hi[AxisU]; ++Voxel[AxisU])
+			{
+				for (Voxel[AxisV] = Lo[AxisV]; Voxel[AxisV] < Hi[AxisV]; ++Voxel[AxisV])
+				{
+					const int X = Voxel[0], Y = Voxel[1], Z = Voxel[2];
+					if (!Tile.Contains(X, Y) || Z < 0 || Z >= ZNum || !Grid.GetVoxelOccupied(X, Y, Z) || !IsExposed(X, Y, Z, Quad.Dir))
+					{
+						return false;
+					}
+					uint8_t& Faces = Covered[(static_cast<size_t>(X - Tile.X0) * TileYNum + (Y - Tile.Y0)) * ZNum + Z];
+					if (Faces & (1 << Quad.Dir))
+					{
+						return false;
+					}
+					Faces |= 1 << Quad.Dir;
+				}
+			}
+		}
+
+		OutExposed = 0;
+		for (int X = Tile.X0; X < Tile.X1; ++X)
+		{
+			for (int Y = Tile.Y0; Y < Tile.Y1; ++Y)
+			{
+				const uint64_t* Column = Grid.GetColumn(X, Y);
+				for (int Word = 0; Word < Grid.GetColumnWords(); ++Word)
+				{
+					for (uint64_t Bits = Column[Word]; Bits; Bits &= Bits - 1)
+					{
+						const int Z = Word * 64 + LowestBit64(Bits);
+						const uint8_t Faces = Covered[(static_cast<size_t>(X - Tile.X0) * TileYNum + (Y - Tile.Y0)) * ZNum + Z];
+						for (int Dir = 0; Dir < 6; ++Dir)
+						{
+							if (IsExposed(X, Y, Z, Dir))
+							{
+								++OutExposed;
+								if (!(Faces & (1 << Dir)))
+								{
+									return false;
+								}
+							}
+						}
+					}
+				}
+			}
+		}
+		return true;
+	}
+}
+
+int main(int Argc, char** Argv)
+{
+	FBenchArgs Args;
+	if (!ParseArgs(Argc, Argv, Args))
+	{
+		std::fprintf(stderr, "Usage: %s [--obj File.obj [--yup]] [--raw File.bin] [--proc Resolution] [--extent Size] "
+			"[--cs CellSize] [--ch CellHeight] [--iters N] [--save-raw File.bin] [--threads N] [--band Rows]\n", Argv[0]);
+		return 1;
+	}
+
+	FBenchMesh Mesh;
+	if (!Args.ObjPath.empty())
+	{
+		if (!LoadObj(Args.ObjPath, Mesh, Args.bYUp))
+		{
+			std::fprintf(stderr, "Failed to load %s\n", Args.ObjPath.c_str());
+			return 1;
+		}
+	}
+	else if (!Args.RawPath.empty())
+	{
+		if (!LoadRaw(Args.RawPath, Mesh))
+		{
+			std::fprintf(stderr, "Failed to load %s\n", Args.RawPath.c_str());
+			return 1;
+		}
+	}
+	else
+	{
+		GenerateTerrain(Args.Resolution, Args.Extent, 1234u, Mesh);
+	}
+
+	if (!Args.SaveRawPath.empty() && !SaveRaw(Args.SaveRawPath, Mesh))
+	{
+		std::fprintf(stderr, "Failed to write %s\n", Args.SaveRawPath.c_str());
+		return 1;
+	}
+
+	FBounds3 Bounds = Mesh.ComputeBounds();
+	Bounds.Max.Z += Args.CellHeight * 4.0f; // head room above the highest surface
+
+	FVoxelGrid Grid;
+	Grid.Init(Bounds, Args.CellSize, Args.CellHeight);
+
+	std::printf("mesh: %d verts, %d tris\n", Mesh.NumVerts(), Mesh.NumTris());
+	std::printf("grid: %d x %d x %d (%lld voxels), cell %.1f x %.1f\n",
+		Grid.GetXNum(), Grid.GetYNum(), Grid.GetZNum(), static_cast<long long>(Grid.GetVoxelNum()),
+		Args.CellSize, Args.CellHeight);
+
+	double BestTime = 1e30;
+	for (int Iter = 0; Iter < Args.Iters; ++Iter)
+	{
+		Grid.Init(Bounds, Args.CellSize, Args.CellHeight);
+
+		const auto Start = std::chrono::steady_clock::now();
+		RasterizeTriangles(Grid, Mesh.Verts.data(), Mesh.NumVerts(), Mesh.Indices.data(), Mesh.NumTris());
+		const double Time = SecondsSince(Start);
+
+		BestTime = Time < BestTime ? Time : BestTime;
+	}
+
+	const int64_t Occupied = Grid.CountOccupied();
+	std::printf("rasterize: best %.3f ms over %d iters, %.3f Mtris/s, %.3f Mvoxels/s (%lld occupied)\n",
+		BestTime * 1e3, Args.Iters,
+		Mesh.NumTris() / BestTime * 1e-6, Occupied / BestTime * 1e-6, static_cast<long long>(Occupied));
+
+	// Counters of one more (untimed) pass, and of the tiled rasterizer, which must see the same triangles
+	FVoxelStats RasterStats;
+	{
+		FVoxelGrid Counted;
+		Counted.Init(Bounds, Args.CellSize, Args.CellHeight);
+		RasterizeTriangles(Counted, Mesh.Verts.data(), Mesh.NumVerts(), Mesh.Indices.data(), Mesh.NumTris(), &RasterStats);
+	}
+	std::printf("raster counters: %lld tris submitted, %lld culled, %lld rows clipped, %lld cells clipped, %lld spans, %lld voxels written\n",
+		static_cast<long long>(RasterStats.TrianglesSubmitted), static_cast<long long>(RasterStats.TrianglesCulled),
+		static_cast<long long>(RasterStats.RowsClipped), static_cast<long long>(RasterStats.CellsClipped),
+		static_cast<long long>(RasterStats.SpansWritten), static_cast<long long>(RasterStats.VoxelsWritten));
+
+	// Cache round trip: hash the soup, write the grid, map it back
+	{
+		const std::string CachePath = "InsightVoxelBench.voxcache";
+
+		auto Start = std::chrono::steady_clock::now();
+		const uint64_t Hash = HashGeometry(Mesh.Verts.data(), Mesh.NumVerts(), Mesh.Indices.data(), Mesh.NumTris());
+		const double HashTime = SecondsSince(Start);
+
+		Start = std::chrono::steady_clock::now();
+		const bool bSaved = SaveVoxelCache(CachePath, Grid, Hash);
+		const double SaveTime = SecondsSince(Start);
+
+		FVoxelGrid Cached;
+		Start = std::chrono::steady_clock::now();
+		const bool bLoaded = LoadVoxelCache(CachePath, Hash, Bounds, Args.CellSize, Args.CellHeight, Cached);
+		const double LoadTime = SecondsSince(Start);
+
+		FVoxelGrid Stale;
+		const bool bCacheMatches = bSaved && bLoaded && Cached.IsExternal() && Cached.HasSameOccupancy(Grid)
+			&& !LoadVoxelCache(CachePath, Hash + 1, Bounds, Args.CellSize, Args.CellHeight, Stale);
+		std::printf("voxel cache: hash %.3f ms, save %.3f ms, map %.3f ms, %s\n", HashTime * 1e3, SaveTime * 1e3, LoadTime * 1e3,
+			bCacheMatches ? "identical to build" : "MISMATCH");
+		std::remove(CachePath.c_str());
+		if (!bCacheMatches)
+		{
+			return 2;
+		}
+	}
+
+	// Row band tiling, same layout as AInsightVoxelSpace::VoxelizeInBox
+	SetThreadedForWorkerNum(Args.Threads);
+
+	FVoxelTiling Tiling;
+	Tiling.Init(Grid.GetXNum(), Grid.GetYNum(), Grid.GetXNum(), Args.BandRows);
+
+	FVoxelGrid TiledGrid;
+	double BestTiledTime = 1e30;
+	for (int Iter = 0; Iter < Args.Iters; ++Iter)
+	{
+		TiledGrid.Init(Bounds, Args.CellSize, Args.CellHeight);
+
+		const auto Start = std::chrono::steady_clock::now();
+		RasterizeTrianglesTiled(TiledGrid, Mesh.Verts.data(), Mesh.NumVerts(), Mesh.Indices.data(), Mesh.NumTris(), Tiling, ThreadedFor);
+		const double Time = SecondsSince(Start);
+
+		BestTiledTime = Time < BestTiledTime ? Time : BestTiledTime;
+	}
+
+	FVoxelStats TiledStats;
+	{
+		FVoxelGrid Counted;
+		Counted.Init(Bounds, Args.CellSize, Args.CellHeight);
+		RasterizeTrianglesTiled(Counted, Mesh.Verts.data(), Mesh.NumVerts(), Mesh.Indices.data(), Mesh.NumTris(), Tiling, ThreadedFor,
+			&TiledStats);
+	}
+
+	const bool bTiledMatches = TiledGrid.HasSameOccupancy(Grid) && TiledStats.TrianglesSubmitted == RasterStats.TrianglesSubmitted
+		&& TiledStats.TrianglesCulled == RasterStats.TrianglesCulled && TiledStats.RowsClipped >= RasterStats.RowsClipped;
+	std::printf("rasterize tiled (%d threads, %d tiles): best %.3f ms, %.3f Mtris/s, speedup %.2fx, %s\n",
+		GetThreadedForWorkerNum(), Tiling.GetTileNum(), BestTiledTime * 1e3,
+		Mesh.NumTris() / BestTiledTime * 1e-6, BestTime / BestTiledTime,
+		bTiledMatches ? "identical to serial" : "MISMATCH");
+	if (!bTiledMatches)
+	{
+		return 2;
+	}
+
+	// Pipelined build: every batch of 1024 triangles stands for one exported mesh, copied into its own soup by
+	// the parallel stage (like ExportRigidBodyGeometry) while the rasterizer thread consumes finished batches
+	{
+		const int BatchTris = 1024;
+		const int BatchNum = (Mesh.NumTris() + BatchTris - 1) / BatchTris;
+		std::vector<std::vector<float>> BatchVerts(BatchNum);
+		std::vector<std::vector<int32_t>> BatchIndices(BatchNum);
+
+		auto ExportBatch = [&](int Index, FTriangleBatch& OutBatch) {
+			const int TriBegin = Index * BatchTris;
+			const int TriEnd = std::min(TriBegin + BatchTris, Mesh.NumTris());
+			std::vector<float>& Verts = BatchVerts[Index];
+			std::vector<int32_t>& Indices = BatchIndices[Index];
+			Verts.clear();
+			Indices.clear();
+			for (int TIdx = TriBegin; TIdx < TriEnd; ++TIdx)
+			{
+				for (int Corner = 0; Corner < 3; ++Corner)
+				{
+					const float* Vert = &Mesh.Verts[Mesh.Indices[TIdx * 3 + Corner] * 3];
+					Indices.push_back(static_cast<int32_t>(Verts.size() / 3));
+					Verts.insert(Verts.end(), Vert, Vert + 3);
+				}
+			}
+
+			OutBatch.Verts = Verts.data();
+			OutBatch.NumVerts = static_cast<int>(Verts.size() / 3);
+			OutBatch.Indices = Indices.data();
+			OutBatch.NumTris = TriEnd - TriBegin;
+			return OutBatch.NumTris > 0;
+		};
+
+		FVoxelGrid PipelinedGrid;
+		double BestPipelinedTime = 1e30;
+		for (int Iter = 0; Iter < Args.Iters; ++Iter)
+		{
+			PipelinedGrid.Init(Bounds, Args.CellSize, Args.CellHeight);
+
+			const auto Start = std::chrono::steady_clock::now();
+			RasterizePipelined(PipelinedGrid, BatchNum, ExportBatch, ThreadedFor);
+			BestPipelinedTime = std::min(BestPipelinedTime, SecondsSince(Start));
+		}
+
+		const bool bPipelinedMatches = PipelinedGrid.HasSameOccupancy(Grid);
+		std::printf("rasterize pipelined (%d exporters, %d batches): best %.3f ms, %s\n", GetThreadedForWorkerNum(), BatchNum,
+			BestPipelinedTime * 1e3, bPipelinedMatches ? "identical to serial" : "MISMATCH");
+		if (!bPipelinedMatches)
+		{
+			return 2;
+		}
+	}
+
+	// Sparse bricks, in the grid bounds and in a 16x taller volume (empty air above the geometry)
+	FSparseVoxelGrid SparseGrid;
+	double BestSparseTime = 1e30;
+	for (int Iter = 0; Iter < Args.Iters; ++Iter)
+	{
+		SparseGrid.Init(Bounds, Args.CellSize, Args.CellHeight);
+
+		const auto Start = std::chrono::steady_clock::now();
+		RasterizeTriangles(SparseGrid, Mesh.Verts.data(), Mesh.NumVerts(), Mesh.Indices.data(), Mesh.NumTris());
+		BestSparseTime = std::min(BestSparseTime, SecondsSince(Start));
+	}
+	const int64_t Collapsed = SparseGrid.CollapseUniformBricks();
+	const bool bSparseMatches = SparseGrid.HasSameOccupancy(Grid) && SparseGrid.CountOccupied() == Occupied;
+
+	FBounds3 TallBounds = Bounds;
+	TallBounds.Max.Z += (Bounds.Max.Z - Bounds.Min.Z) * 15.0f;
+	FSparseVoxelGrid TallGrid;
+	TallGrid.Init(TallBounds, Args.CellSize, Args.CellHeight);
+	RasterizeTriangles(TallGrid, Mesh.Verts.data(), Mesh.NumVerts(), Mesh.Indices.data(), Mesh.NumTris());
+	TallGrid.CollapseUniformBricks();
+
+	const double DenseBytes = static_cast<double>(Grid.GetXNum()) * Grid.GetYNum() * Grid.GetColumnWords() * sizeof(uint64_t);
+	const double TallDenseBytes = static_cast<double>(TallGrid.GetXNum()) * TallGrid.GetYNum() * TallGrid.GetColumnWords() * sizeof(uint64_t);
+	std::printf("rasterize sparse: best %.3f ms, %zu bricks + %zu full (%lld collapsed), %.2f MB vs %.2f MB dense, %s\n",
+		BestSparseTime * 1e3, SparseGrid.GetBrickNum(), SparseGrid.GetFullBrickNum(), static_cast<long long>(Collapsed),
+		SparseGrid.GetAllocatedBytes() / 1048576.0, DenseBytes / 1048576.0, bSparseMatches ? "identical to dense" : "MISMATCH");
+	std::printf("sparse 16x taller volume: %d layers, %.2f MB vs %.2f MB dense\n",
+		TallGrid.GetZNum(), TallGrid.GetAllocatedBytes() / 1048576.0, TallDenseBytes / 1048576.0);
+	if (!bSparseMatches || TallGrid.CountOccupied() != Occupied)
+	{
+		return 2;
+	}
+
+	// Cell sweep: the same soup at coarser and finer cells, serial against tiled cell by cell. Level geometry captured
+	// in the editor comes in through --raw (AInsightRecastVoxel::CompareWithRecast dumps it with the Recast numbers).
+	{
+		const float SweepCells[][2] = {
+			{Args.CellSize * 2.0f, Args.CellHeight * 2.0f},
+			{Args.CellSize * 2.0f, Args.CellHeight},
+			{Args.CellSize, Args.CellHeight * 0.5f},
+		};
+		const int SweepIters = std::min(Args.Iters, 3);
+
+		for (const auto& Cell : SweepCells)
+		{
+			FBounds3 SweepBounds = Mesh.ComputeBounds();
+			SweepBounds.Max.Z += Cell[1] * 4.0f;
+
+			FVoxelGrid Serial;
+			double BestSweepTime = 1e30;
+			for (int Iter = 0; Iter < SweepIters; ++Iter)
+			{
+				Serial.Init(SweepBounds, Cell[0], Cell[1]);
+
+				const auto Start = std::chrono::steady_clock::now();
+				RasterizeTriangles(Serial, Mesh.Verts.data(), Mesh.NumVerts(), Mesh.Indices.data(), Mesh.NumTris());
+				BestSweepTime = std::min(BestSweepTime, SecondsSince(Start));
+			}
+
+			FVoxelTiling SweepTiling;
+			SweepTiling.Init(Serial.GetXNum(), Serial.GetYNum(), Serial.GetXNum(), Args.BandRows);
+			FVoxelGrid Tiled;
+			Tiled.Init(SweepBounds, Cell[0], Cell[1]);
+			RasterizeTrianglesTiled(Tiled, Mesh.Verts.data(), Mesh.NumVerts(), Mesh.Indices.data(), Mesh.NumTris(), SweepTiling, ThreadedFor);
+
+			FVoxelSpanGrid SweepSpans;
+			SweepSpans.BuildFromGrid(Serial);
+
+			FOccupancyDiff Diff;
+			const bool bSweepMatches = CompareOccupancy(Serial, Tiled, Diff) && Diff.IsIdentical();
+			std::printf("cell sweep %.1f x %.1f: %d x %d x %d, best %.3f ms, %.3f Mtris/s, %.2f MB dense, %.2f MB spans, %s\n",
+				Cell[0], Cell[1], Serial.GetXNum(), Serial.GetYNum(), Serial.GetZNum(), BestSweepTime * 1e3,
+				Mesh.NumTris() / BestSweepTime * 1e-6, Serial.GetWordNum() * sizeof(uint64_t) / 1048576.0,
+				SweepSpans.GetAllocatedBytes() / 1048576.0, bSweepMatches ? "tiled identical" : "MISMATCH");
+			if (!bSweepMatches)
+			{
+				std::fprintf(stderr, "cell sweep: %lld voxels serial only, %lld tiled only in %lld columns, first at (%d, %d)\n",
+					static_cast<long long>(Diff.OnlyANum), static_cast<long long>(Diff.OnlyBNum),
+					static_cast<long long>(Diff.DiffColumnNum), Diff.FirstDiffX, Diff.FirstDiffY);
+				return 2;
+			}
+		}
+	}
+
+	// Instances the editor renderer would build, in the same 32 x 32 column chunks
+	FVoxelTiling Chunks;
+	Chunks.Init(Grid.GetXNum(), Grid.GetYNum(), 32, 32);
+
+	std::vector<FIntVec3> SurfaceVoxels;
+	size_t SurfaceNum = 0;
+	double BestSurfaceTime = 1e30;
+	for (int Iter = 0; Iter < Args.Iters; ++Iter)
+	{
+		SurfaceNum = 0;
+		const auto Start = std::chrono::steady_clock::now();
+		for (int Chunk = 0; Chunk < Chunks.GetTileNum(); ++Chunk)
+		{
+			SurfaceVoxels.clear();
+			CollectSurfaceVoxels(Grid, Chunks.GetTile(Chunk), SurfaceVoxels);
+			SurfaceNum += SurfaceVoxels.size();
+		}
+		BestSurfaceTime = std::min(BestSurfaceTime, SecondsSince(Start));
+	}
+	std::printf("surface voxels: %zu of %lld occupied in %d chunks, best %.3f ms\n",
+		SurfaceNum, static_cast<long long>(Occupied), Chunks.GetTileNum(), BestSurfaceTime * 1e3);
+
+	std::vector<FVoxelQuad> Quads;
+	int64_t FaceNum = 0;
+	double BestMeshTime = 1e30;
+	for (int Iter = 0; Iter < Args.Iters; ++Iter)
+	{
+		FaceNum = 0;
+		const auto Start = std::chrono::steady_clock::now();
+		Quads.clear();
+		for (int Chunk = 0; Chunk < Chunks.GetTileNum(); ++Chunk)
+		{
+			FaceNum += BuildGreedyQuads(Grid, Chunks.GetTile(Chunk), Quads);
+		}
+		BestMeshTime = std::min(BestMeshTime, SecondsSince(Start));
+	}
+
+	// Tile by tile against a brute-force count, so the coverage map stays small
+	bool bQuadsMatch = true;
+	int64_t ExposedNum = 0;
+	std::vector<FVoxelQuad> TileQuads;
+	for (int Chunk = 0; Chunk < Chunks.GetTileNum() && bQuadsMatch; ++Chunk)
+	{
+		TileQuads.clear();
+		const int64_t TileFaceNum = BuildGreedyQuads(Grid, Chunks.GetTile(Chunk), TileQuads);
+		int64_t TileExposed = 0;
+		bQuadsMatch = CheckGreedyQuads(Grid, Chunks.GetTile(Chunk), TileQuads, TileExposed) && TileFaceNum == TileExposed;
+		ExposedNum += TileExposed;
+	}
+	bQuadsMatch = bQuadsMatch && ExposedNum == FaceNum;
+
+	std::printf("greedy mesh: %zu quads for %lld exposed faces, best %.3f ms, %s\n",
+		Quads.size(), static_cast<long long>(FaceNum), BestMeshTime * 1e3,
+		bQuadsMatch ? "covers every exposed face once" : "MISMATCH");
+	if (!bQuadsMatch)
+	{
+		return 2;
+	}
+
+	FVoxelGrid Walkable;
+	double BestMaskTime = 1e30, BestTiledMaskTime = 1e30;
+	FVoxelGrid TiledWalkable;
+	for (int Iter = 0; Iter < Args.Iters; ++Iter)
+	{
+		auto Start = std::chrono::steady_clock::now();
+		BuildWalkableMask(Grid, Walkable);
+		BestMaskTime = std::min(BestMaskTime, SecondsSince(Start));
+
+		Start = std::chrono::steady_clock::now();
+		BuildWalkableMask(Grid, TiledWalkable, ThreadedFor);
+		BestTiledMaskTime = std::min(BestTiledMaskTime, SecondsSince(Start));
+	}
+
+	// Spot check against the per-voxel definition on a spread of columns
+	bool bMaskMatches = TiledWalkable.HasSameOccupancy(Walkable);
+	for (int X = 0; X < Grid.GetXNum() && bMaskMatches; X += 7)
+	{
+		for (int Y = X % 5; Y < Grid.GetYNum() && bMaskMatches; Y += 5)
+		{
+			for (int Z = 0; Z < Grid.GetZNum(); ++Z)
+			{
+				bMaskMatches &= Walkable.GetVoxelOccupied(X, Y, Z) == IsStayableVoxel(Grid, X, Y, Z);
+			}
+		}
+	}
+
+	std::printf("walkable mask: best %.3f ms, %.3f ms on %d threads (%lld walkable), %s\n",
+		BestMaskTime * 1e3, BestTiledMaskTime * 1e3, GetThreadedForWorkerNum(),
+		static_cast<long long>(Walkable.CountOccupied()), bMaskMatches ? "matches IsStayableVoxel" : "MISMATCH");
+	if (!bMaskMatches)
+	{
+		return 2;
+	}
+
+	// Sparse build path: the mask read from the bricks, and the bricks written to a dense grid (both in the taller volume
+	// too, where most blocks are skipped)
+	{
+		FVoxelGrid SparseWalkable;
+		double SparseMaskTime = 1e30;
+		for (int Iter = 0; Iter < Args.Iters; ++Iter)
+		{
+			const auto Start = std::chrono::steady_clock::now();
+			BuildWalkableMask(SparseGrid, SparseWalkable, ThreadedFor);
+			SparseMaskTime = std::min(SparseMaskTime, SecondsSince(Start));
+		}
+
+		FVoxelGrid Densified;
+		Densified.Init(Bounds, Args.CellSize, Args.CellHeight);
+		SparseGrid.WriteToDense(Densified);
+
+		FVoxelGrid TallDense;
+		TallDense.Init(TallBounds, Args.CellSize, Args.CellHeight);
+		TallGrid.WriteToDense(TallDense);
+		FVoxelGrid TallWalkable, TallSparseWalkable;
+		auto Start = std::chrono::steady_clock::now();
+		BuildWalkableMask(TallDense, TallWalkable, ThreadedFor);
+		const double TallDenseTime = SecondsSince(Start);
+		Start = std::chrono::steady_clock::now();
+		BuildWalkableMask(TallGrid, TallSparseWalkable, ThreadedFor);
+		const double TallSparseTime = SecondsSince(Start);
+
+		const bool bSparseMaskMatches = SparseWalkable.HasSameOccupancy(Walkable) && Densified.HasSameOccupancy(Grid)
+			&& TallGrid.HasSameOccupancy(TallDense) && TallSparseWalkable.HasSameOccupancy(TallWalkable)
+			&& TallWalkable.CountOccupied() == Walkable.CountOccupied();
+		std::printf("walkable mask from sparse bricks: %.3f ms on %d threads, 16x taller volume %.3f ms vs %.3f ms dense, %s\n",
+			SparseMaskTime * 1e3, GetThreadedForWorkerNum(), TallSparseTime * 1e3, TallDenseTime * 1e3,
+			bSparseMaskMatches ? "identical to dense" : "MISMATCH");
+		if (!bSparseMaskMatches)
+		{
+			return 2;
+		}
+	}
+
+	// Incremental update of a 32 x 32 column block, as the editor does when an actor moves: clear it, rasterize
+	// the triangles again into it only, and redo the walkable mask one column further out
+	{
+		FVoxelGrid Patched = Grid;
+		FVoxelGrid PatchedWalkable = Walkable;
+		const FVoxelTile Region(Grid.GetXNum() / 2 - 16, Grid.GetYNum() / 2 - 16, Grid.GetXNum() / 2 + 16, Grid.GetYNum() / 2 + 16);
+		const FVoxelTile MaskRegion(Region.X0 - 1, Region.Y0 - 1, Region.X1 + 1, Region.Y1 + 1);
+
+		const auto Start = std::chrono::steady_clock::now();
+		Patched.ClearColumns(Region);
+		RasterizeTriangles(Patched, Mesh.Verts.data(), Mesh.NumVerts(), Mesh.Indices.data(), Mesh.NumTris(), Region);
+		UpdateWalkableMask(Patched, PatchedWalkable, MaskRegion);
+		const double Time = SecondsSince(Start);
+
+		const bool bPatchMatches = Patched.HasSameOccupancy(Grid) && PatchedWalkable.HasSameOccupancy(Walkable);
+		std::printf("incremental 32x32 columns: %.3f ms, %s\n", Time * 1e3, bPatchMatches ? "identical to full build" : "MISMATCH");
+		if (!bPatchMatches)
+		{
+			return 2;
+		}
+
+		// Same patch with the whole scene treated as one merged mesh behind a BVH
+		auto BvhStart = std::chrono::steady_clock::now();
+		FTriangleBvh Bvh;
+		Bvh.Build(Mesh.Verts.data(), Mesh.NumVerts(), Mesh.Indices.data(), Mesh.NumTris());
+		const double BvhBuildTime = SecondsSince(BvhStart);
+
+		FVoxelGrid BvhPatched = Grid;
+		BvhPatched.ClearColumns(Region);
+		BvhStart = std::chrono::steady_clock::now();
+		RasterizeTriangles(BvhPatched, Mesh.Verts.data(), Mesh.NumVerts(), Mesh.Indices.data(), Bvh, Region);
+		const double BvhPatchTime = SecondsSince(BvhStart);
+
+		FVoxelGrid BvhFull;
+		BvhFull.Init(Bounds, Args.CellSize, Args.CellHeight);
+		RasterizeTriangles(BvhFull, Mesh.Verts.data(), Mesh.NumVerts(), Mesh.Indices.data(), Bvh);
+
+		const bool bBvhMatches = BvhPatched.HasSameOccupancy(Grid) && BvhFull.HasSameOccupancy(Grid);
+		std::printf("triangle bvh: %d nodes (%.2f MB) built in %.3f ms, 32x32 columns rasterized in %.3f ms, %s\n",
+			Bvh.GetNodeNum(), Bvh.GetAllocatedBytes() / 1048576.0, BvhBuildTime * 1e3, BvhPatchTime * 1e3,
+			bBvhMatches ? "identical to full build" : "MISMATCH");
+		if (!bBvhMatches)
+		{
+			return 2;
+		}
+	}
+
+	// Compacted spans of the solid grid and of the walkable voxels computed on them directly
+	FVoxelSpanGrid SolidSpans, WalkableSpans;
+	double BestSpanTime = 1e30, BestSpanMaskTime = 1e30;
+	for (int Iter = 0; Iter < Args.Iters; ++Iter)
+	{
+		auto Start = std::chrono::steady_clock::now();
+		SolidSpans.BuildFromGrid(Grid);
+		BestSpanTime = std::min(BestSpanTime, SecondsSince(Start));
+
+		Start = std::chrono::steady_clock::now();
+		BuildWalkableSpans(SolidSpans, WalkableSpans);
+		BestSpanMaskTime = std::min(BestSpanMaskTime, SecondsSince(Start));
+	}
+
+	const bool bSpansMatch = SolidSpans.HasSameOccupancy(Grid) && WalkableSpans.HasSameOccupancy(Walkable);
+	std::printf("compact spans: %zu solid in %.3f ms (%.2f MB vs %.2f MB dense), %zu walkable in %.3f ms, %s\n",
+		SolidSpans.GetTotalSpanNum(), BestSpanTime * 1e3, SolidSpans.GetAllocatedBytes() / 1048576.0, DenseBytes / 1048576.0,
+		WalkableSpans.GetTotalSpanNum(), BestSpanMaskTime * 1e3, bSpansMatch ? "identical to bitsets" : "MISMATCH");
+	if (!bSpansMatch)
+	{
+		return 2;
+	}
+
+	// Spans of an edited 32 x 32 column block spliced in, then put back
+	{
+		const FVoxelTile Region(Grid.GetXNum() / 2 - 16, Grid.GetYNum() / 2 - 16, Grid.GetXNum() / 2 + 16, Grid.GetYNum() / 2 + 16);
+		const FVoxelTile MaskRegion(Region.X0 - 1, Region.Y0 - 1, Region.X1 + 1, Region.Y1 + 1);
+		FVoxelGrid Edited = Grid;
+		FVoxelGrid EditedWalkable = Walkable;
+		Edited.ClearColumns(Region);
+		UpdateWalkableMask(Edited, EditedWalkable, MaskRegion);
+
+		FVoxelSpanGrid PatchedSolid = SolidSpans;
+		FVoxelSpanGrid PatchedWalkable = WalkableSpans;
+		const auto Start = std::chrono::steady_clock::now();
+		PatchedSolid.UpdateFromGrid(Edited, MaskRegion);
+		PatchedWalkable.UpdateFromGrid(EditedWalkable, MaskRegion);
+		const double Time = SecondsSince(Start);
+		bool bPatchMatches = PatchedSolid.HasSameOccupancy(Edited) && PatchedWalkable.HasSameOccupancy(EditedWalkable);
+
+		PatchedSolid.UpdateFromGrid(Grid, MaskRegion);
+		PatchedWalkable.UpdateFromGrid(Walkable, MaskRegion);
+		bPatchMatches = bPatchMatches && PatchedSolid.HasSameOccupancy(Grid) && PatchedWalkable.HasSameOccupancy(Walkable)
+			&& PatchedSolid.GetTotalSpanNum() == SolidSpans.GetTotalSpanNum()
+			&& PatchedWalkable.GetTotalSpanNum() == WalkableSpans.GetTotalSpanNum();
+		std::printf("incremental spans 34x34 columns: %.3f ms, %s\n", Time * 1e3, bPatchMatches ? "identical to full build" : "MISMATCH");
+		if (!bPatchMatches)
+		{
+			return 2;
+		}
+	}
+
+	const FIntVec3 StartIdx = FindStayableNear(Walkable, 1, 1);
+	const FIntVec3 EndIdx = FindStayableNear(Walkable, Walkable.GetXNum() - 2, Walkable.GetYNum() - 2);
+	if (StartIdx.IsValid() && EndIdx.IsValid())
+	{
+		// Both algorithms return shortest paths, so their lengths must agree
+		FPathSearch Search;
+		size_t PathLength[2] = {0, 0};
+		const EPathAlgorithm Algorithms[] = {EPathAlgorithm::AStar, EPathAlgorithm::JumpPoint};
+		const char* AlgorithmNames[] = {"astar", "jps"};
+		for (int A = 0; A < 2; ++A)
+		{
+			std::vector<FIntVec3> Path;
+			const auto Start = std::chrono::steady_clock::now();
+			const bool bFound = Search.FindPath(Walkable, StartIdx, EndIdx, Algorithms[A], Path);
+			const double Time = SecondsSince(Start);
+			PathLength[A] = Path.size();
+
+			const FPathSearchStats PathStats = Search.GetStats();
+			std::printf("findpath %-5s: %s, %zu voxels, %lld expanded, %lld peak open, %.2f MB state, %.3f ms\n", AlgorithmNames[A],
+				bFound ? "found" : "not found", Path.size(), static_cast<long long>(PathStats.ExpandedNum),
+				static_cast<long long>(PathStats.PeakOpenNum), PathStats.AllocatedBytes / (1024.0 * 1024.0), Time * 1e3);
+		}
+
+		if (PathLength[0] != PathLength[1])
+		{
+			std::fprintf(stderr, "A* and jump point search path lengths differ\n");
+			return 2;
+		}
+
+		// Same query on the walkable spans must visit the same nodes
+		std::vector<FIntVec3> BitsetPath, SpanPath;
+		Search.FindPath(Walkable, StartIdx, EndIdx, EPathAlgorithm::AStar, BitsetPath);
+		const auto Start = std::chrono::steady_clock::now();
+		const bool bFound = Search.FindPath(WalkableSpans, StartIdx, EndIdx, EPathAlgorithm::AStar, SpanPath);
+		const double Time = SecondsSince(Start);
+		std::printf("findpath spans: %s, %zu voxels, %.3f ms, %s\n", bFound ? "found" : "not found", SpanPath.size(), Time * 1e3,
+			SpanPath == BitsetPath ? "same path as bitset" : "MISMATCH");
+		if (SpanPath != BitsetPath)
+		{
+			return 2;
+		}
+
+		// String pulling over the same path
+		if (bFound)
+		{
+			std::vector<FIntVec3> Waypoints;
+			double BestSmoothTime = 1e30;
+			for (int Iter = 0; Iter < Args.Iters; ++Iter)
+			{
+				const auto SmoothStart = std::chrono::steady_clock::now();
+				SmoothPath(Walkable, BitsetPath, Waypoints);
+				BestSmoothTime = std::min(BestSmoothTime, SecondsSince(SmoothStart));
+			}
+			const bool bSmoothValid = IsSmoothPath(Walkable, Waypoints, StartIdx, EndIdx);
+			std::printf("smoothpath: %zu voxels to %zu waypoints, best %.3f ms, %s\n", BitsetPath.size(), Waypoints.size(),
+				BestSmoothTime * 1e3, bSmoothValid ? "segments stay on stayable voxels" : "MISMATCH");
+			if (!bSmoothValid)
+			{
+				return 2;
+			}
+		}
+	}
+
+	// Agents spread over a 96x96 column window heading for targets in a 32x32 one, every start to every goal
+	{
+		const int Window = std::min(96, std::min(Walkable.GetXNum(), Walkable.GetYNum()));
+		const int X0 = (Walkable.GetXNum() - Window) / 2;
+		const int Y0 = (Walkable.GetYNum() - Window) / 2;
+		std::mt19937 Rng(42u);
+		std::vector<FIntVec3> Starts, Goals;
+		for (int i = 0; i < 8; ++i)
+		{
+			Starts.push_back(RandomStayable(Walkable, X0, Y0, Window, Rng));
+		}
+		for (int i = 0; i < 32; ++i)
+		{
+			Goals.push_back(RandomStayable(Walkable, X0, Y0, Window / 3, Rng));
+		}
+		const int QueryNum = static_cast<int>(Starts.size() * Goals.size());
+
+		// Reference: one A* per query on one search
+		FPathSearch Search;
+		std::vector<size_t> SingleLength(QueryNum, 0);
+		std::vector<FIntVec3> Path;
+		auto Start = std::chrono::steady_clock::now();
+		for (int Query = 0; Query < QueryNum; ++Query)
+		{
+			Search.FindPath(Walkable, Starts[Query / Goals.size()], Goals[Query % Goals.size()], EPathAlgorithm::AStar, Path);
+			SingleLength[Query] = Path.size();
+		}
+		const double SingleTime = SecondsSince(Start);
+
+		// The second run of each setting has the pool warm, as every batch after the first one
+		FPathSearchPool Pool;
+		FPathBatchSettings TreeSettings;
+		FPathBatchSettings AStarSettings;
+		AStarSettings.MinTreeGoals = QueryNum + 1;
+		FPathBatchResult TreeResult, AStarResult;
+		double TreeTime = 0.0, AStarTime = 0.0;
+		for (int Run = 0; Run < 2; ++Run)
+		{
+			Start = std::chrono::steady_clock::now();
+			FindPathsManyToMany(Walkable, Starts.data(), static_cast<int>(Starts.size()), Goals.data(), static_cast<int>(Goals.size()),
+				TreeSettings, Pool, ThreadedFor, TreeResult);
+			TreeTime = SecondsSince(Start);
+
+			Start = std::chrono::steady_clock::now();
+			FindPathsManyToMany(Walkable, Starts.data(), static_cast<int>(Starts.size()), Goals.data(), static_cast<int>(Goals.size()),
+				AStarSettings, Pool, ThreadedFor, AStarResult);
+			AStarTime = SecondsSince(Start);
+		}
+
+		// Shortest paths from start to goal, each of the reference length
+		bool bBatchMatches = TreeResult.GetPathNum() == QueryNum && AStarResult.GetPathNum() == QueryNum;
+		int FoundNum = 0;
+		for (int Query = 0; bBatchMatches && Query < QueryNum; ++Query)
+		{
+			for (const FPathBatchResult* Result : {&TreeResult, &AStarResult})
+			{
+				const int Length = Result->GetPathLength(Query);
+				bBatchMatches &= static_cast<size_t>(Length) == SingleLength[Query];
+				if (bBatchMatches && Length > 0)
+				{
+					const FIntVec3* Voxels = Result->GetPath(Query);
+					bBatchMatches &= Voxels[0] == Starts[Query / Goals.size()] && Voxels[Length - 1] == Goals[Query % Goals.size()];
+				}
+			}
+			FoundNum += SingleLength[Query] > 0 ? 1 : 0;
+		}
+
+		std::printf("path batch %dx%d (%d found): single %.3f ms, batch tree %.3f ms, batch astar %.3f ms on %d threads, %s\n",
+			static_cast<int>(Starts.size()), static_cast<int>(Goals.size()), FoundNum, SingleTime * 1e3, TreeTime * 1e3,
+			AStarTime * 1e3, GetThreadedForWorkerNum(), bBatchMatches ? "same lengths as single queries" : "MISMATCH");
+		if (!bBatchMatches)
+		{
+			return 2;
+		}
+	}
+
+	// Cluster hierarchy: random long range queries against A*, then a 32x32 column block made unwalkable and
+	// patched into it, which must give the graph a full build of the edited mask gives
+	{
+		const int ClusterColumns = 16;
+		FPathHierarchy Hierarchy;
+		auto Start = std::chrono::steady_clock::now();
+		Hierarchy.Build(Walkable, ClusterColumns, ThreadedFor);
+		const double BuildTime = SecondsSince(Start);
+
+		std::mt19937 Rng(7u);
+		std::vector<FPathQuery> Queries;
+		for (int i = 0; i < 16; ++i)
+		{
+			const int Size = std::max(Walkable.GetXNum(), Walkable.GetYNum());
+			Queries.push_back({RandomStayable(Walkable, 0, 0, Size, Rng), RandomStayable(Walkable, 0, 0, Size, Rng)});
+		}
+
+		FPathSearch Search;
+		FHierarchySearch HierarchySearch;
+		std::vector<FIntVec3> Path, HierarchyPath;
+		double AStarTime = 0.0, HierarchyTime = 0.0;
+		size_t AStarVoxels = 0, HierarchyVoxels = 0;
+		int FoundNum = 0;
+		bool bHierarchyMatches = true;
+		auto CheckQueries = [&](const FVoxelGrid& Mask, const FPathHierarchy& Graph)
+		{
+			for (const FPathQuery& Query : Queries)
+			{
+				Start = std::chrono::steady_clock::now();
+				const bool bFound = Search.FindPath(Mask, Query.Start, Query.Goal, EPathAlgorithm::AStar, Path);
+				AStarTime += SecondsSince(Start);
+
+				Start = std::chrono::steady_clock::now();
+				const bool bHierarchyFound = HierarchySearch.FindPath(Graph, Mask, Query.Start, Query.Goal, HierarchyPath);
+				HierarchyTime += SecondsSince(Start);
+
+				bHierarchyMatches &= bFound == bHierarchyFound;
+				if (bFound && bHierarchyFound)
+				{
+					bHierarchyMatches &= IsConnectedPath(Mask, HierarchyPath, Query.Start, Query.Goal) && HierarchyPath.size() >= Path.size();
+					AStarVoxels += Path.size();
+					HierarchyVoxels += HierarchyPath.size();
+					++FoundNum;
+				}
+			}
+		};
+		CheckQueries(Walkable, Hierarchy);
+
+		std::printf("path hierarchy %dx%d: %d clusters, %d nodes, %lld edges (%.2f MB) built in %.3f ms on %d threads\n",
+			ClusterColumns, ClusterColumns, Hierarchy.GetClusterNum(), Hierarchy.GetNodeNum(), static_cast<long long>(Hierarchy.GetIntraEdgeNum()),
+			Hierarchy.GetAllocatedBytes() / 1048576.0, BuildTime * 1e3, GetThreadedForWorkerNum());
+		std::printf("path hierarchy queries (%d found of %zu): astar %.3f ms, hierarchy %.3f ms, %.1f%% longer, %s\n",
+			FoundNum, Queries.size(), AStarTime * 1e3, HierarchyTime * 1e3,
+			AStarVoxels > 0 ? (static_cast<double>(HierarchyVoxels) / AStarVoxels - 1.0) * 100.0 : 0.0,
+			bHierarchyMatches ? "valid paths wherever astar finds one" : "MISMATCH");
+		if (!bHierarchyMatches)
+		{
+			return 2;
+		}
+
+		FVoxelGrid Edited = Walkable;
+		const FVoxelTile Region(Walkable.GetXNum() / 3 - 16, Walkable.GetYNum() / 3 - 16, Walkable.GetXNum() / 3 + 16, Walkable.GetYNum() / 3 + 16);
+		Edited.ClearColumns(Region);
+
+		FPathHierarchy Patched = Hierarchy;
+		Start = std::chrono::steady_clock::now();
+		Patched.Update(Edited, Region, ThreadedFor);
+		const double UpdateTime = SecondsSince(Start);
+		const int RebuiltNum = Patched.GetRebuiltClusterNum();
+
+		FPathHierarchy Fresh;
+		Fresh.Build(Edited, ClusterColumns, ThreadedFor);
+		bool bUpdateMatches = Patched.HasSameGraph(Fresh);
+		CheckQueries(Edited, Patched);
+
+		// And back again
+		Patched.Update(Walkable, Region, ThreadedFor);
+		bUpdateMatches &= Patched.HasSameGraph(Hierarchy);
+
+		std::printf("path hierarchy update 32x32 columns: %d clusters rebuilt in %.3f ms, %s\n", RebuiltNum, UpdateTime * 1e3,
+			bUpdateMatches && bHierarchyMatches ? "identical to full build" : "MISMATCH");
+		if (!bUpdateMatches || !bHierarchyMatches)
+		{
+			return 2;
+		}
+	}
+
+	// Component labels: serial and threaded builds, queries within and across components (the failed ones timed
+	// both ways) against what A* finds, and a 32x32 column block made unwalkable and patched in
+	{
+		const int BandColumns = 16;
+		FComponentLabels Components, TiledComponents;
+		double BestTime = 1e30, BestTiledTime = 1e30;
+		for (int Iter = 0; Iter < Args.Iters; ++Iter)
+		{
+			auto Start = std::chrono::steady_clock::now();
+			Components.Build(Walkable, BandColumns);
+			BestTime = std::min(BestTime, SecondsSince(Start));
+
+			Start = std::chrono::steady_clock::now();
+			TiledComponents.Build(Walkable, BandColumns, ThreadedFor);
+			BestTiledTime = std::min(BestTiledTime, SecondsSince(Start));
+		}
+
+		std::mt19937 Rng(5u);
+		FPathSearch Search;
+		std::vector<FIntVec3> Path;
+		double FailedSearchTime = 0.0, FailedLabelTime = 0.0;
+		int FailedNum = 0, ReachableNum = 0;
+		bool bComponentsMatch = TiledComponents.HasSameLabels(Components);
+		auto CheckQueries = [&](const FVoxelGrid& Mask, const FComponentLabels& Labels, int QueryNum)
+		{
+			const int Size = std::max(Mask.GetXNum(), Mask.GetYNum());
+			auto ComponentOf = [&](const FIntVec3& Idx) { return Labels.GetComponent(Idx.X, Idx.Y, Idx.Z); };
+
+			// Random pairs nearly always land in the main component, so the pairs are drawn by label: even queries
+			// inside the main component, odd ones from an island (so A* fails after flooding the island, not the
+			// whole level) to the main component.
+			std::vector<int> ComponentHits(Labels.GetComponentNum(), 0);
+			for (int i = 0; i < 64; ++i)
+			{
+				const uint32_t Component = ComponentOf(RandomStayable(Mask, 0, 0, Size, Rng));
+				if (Component != FComponentLabels::NoComponent)
+				{
+					++ComponentHits[Component];
+				}
+			}
+			const uint32_t MainComponent = static_cast<uint32_t>(std::max_element(ComponentHits.begin(), ComponentHits.end()) - ComponentHits.begin());
+
+			for (int i = 0; i < QueryNum; ++i)
+			{
+				FIntVec3 From = RandomStayable(Mask, 0, 0, Size, Rng);
+				FIntVec3 To = RandomStayable(Mask, 0, 0, Size, Rng);
+				const bool bFromIsland = (i & 1) && Labels.GetComponentNum() > 1;
+				for (int Attempt = 0; Attempt < 10000 && ((ComponentOf(From) == MainComponent) == bFromIsland ||
+					ComponentOf(To) != MainComponent); ++Attempt)
+				{
+					((ComponentOf(From) == MainComponent) == bFromIsland ? From : To) = RandomStayable(Mask, 0, 0, Size, Rng);
+				}
+
+				auto Start = std::chrono::steady_clock::now();
+				const bool bFound = Search.FindPath(Mask, From, To, EPathAlgorithm::AStar, Path);
+				const double SearchTime = SecondsSince(Start);
+
+				Start = std::chrono::steady_clock::now();
+				const bool bConnected = Labels.CanConnect(From, To);
+				const double LabelTime = SecondsSince(Start);
+
+				bComponentsMatch &= bFound == bConnected;
+				ReachableNum += bFound;
+				if (!bFound)
+				{
+					FailedSearchTime += SearchTime;
+					FailedLabelTime += LabelTime;
+					++FailedNum;
+				}
+			}
+		};
+		CheckQueries(Walkable, Components, 32);
+
+		std::printf("components: %d over %lld runs (%.2f MB), best %.3f ms, %.3f ms on %d threads\n",
+			Components.GetComponentNum(), static_cast<long long>(Components.GetRunNum()), Components.GetAllocatedBytes() / 1048576.0,
+			BestTime * 1e3, BestTiledTime * 1e3, GetThreadedForWorkerNum());
+		std::printf("components queries: %d of 32 unreachable, on those astar %.3f ms, labels %.6f ms, %s\n", FailedNum,
+			FailedSearchTime * 1e3, FailedLabelTime * 1e3, bComponentsMatch ? "same answer as astar" : "MISMATCH");
+		// Both answers must have come up, or the check above proved nothing
+		if (!bComponentsMatch || FailedNum == 0 || ReachableNum == 0)
+		{
+			return 2;
+		}
+
+		FVoxelGrid Edited = Walkable;
+		const FVoxelTile Region(Walkable.GetXNum() / 3 - 16, Walkable.GetYNum() / 3 - 16, Walkable.GetXNum() / 3 + 16, Walkable.GetYNum() / 3 + 16);
+		Edited.ClearColumns(Region);
+
+		FComponentLabels Patched = Components;
+		auto Start = std::chrono::steady_clock::now();
+		Patched.Update(Edited, Region, ThreadedFor);
+		const double UpdateTime = SecondsSince(Start);
+		const int RebuiltNum = Patched.GetRebuiltBandNum();
+
+		FComponentLabels Fresh;
+		Fresh.Build(Edited, BandColumns);
+		bool bUpdateMatches = Patched.HasSameLabels(Fresh);
+		CheckQueries(Edited, Patched, 8);
+
+		// And back again
+		Patched.Update(Walkable, Region, ThreadedFor);
+		bUpdateMatches &= Patched.HasSameLabels(Components);
+
+		std::printf("components update 32x32 columns: %d bands rebuilt in %.3f ms, %s\n", RebuiltNum, UpdateTime * 1e3,
+			bUpdateMatches && bComponentsMatch ? "identical to full build" : "MISMATCH");
+		if (!bUpdateMatches || !bComponentsMatch)
+		{
+			return 2;
+		}
+	}
+
+	// Clearance field: serial and threaded builds, sampled voxels against the brute force distance, a 32x32
+	// column block cleared and patched in, and paths for a 40 unit radius checked voxel by voxel
+	{
+		const int BodyLayers = 4;
+		const int MaxClearance = 16;
+		FClearanceField Clearance, TiledClearance;
+		double BestTime = 1e30, BestTiledTime = 1e30;
+		for (int Iter = 0; Iter < std::min(Args.Iters, 3); ++Iter)
+		{
+			auto Start = std::chrono::steady_clock::now();
+			Clearance.Build(Grid, Walkable, BodyLayers, MaxClearance);
+			BestTime = std::min(BestTime, SecondsSince(Start));
+
+			Start = std::chrono::steady_clock::now();
+			TiledClearance.Build(Grid, Walkable, BodyLayers, MaxClearance, ThreadedFor);
+			BestTiledTime = std::min(BestTiledTime, SecondsSince(Start));
+		}
+
+		bool bClearanceMatches = TiledClearance.HasSameValues(Clearance);
+		int64_t CheckedNum = 0;
+		for (int X = 0; X < Grid.GetXNum() && bClearanceMatches; X += 13)
+		{
+			for (int Y = X % 11; Y < Grid.GetYNum() && bClearanceMatches; Y += 11)
+			{
+				for (int Z = 0; Z < Grid.GetZNum(); ++Z)
+				{
+					if (Walkable.GetVoxelOccupied(X, Y, Z))
+					{
+						bClearanceMatches &= Clearance.GetClearance(Walkable, X, Y, Z) == ReferenceClearance(Grid, X, Y, Z, BodyLayers, MaxClearance);
+						++CheckedNum;
+					}
+				}
+			}
+		}
+
+		std::printf("clearance field (%d body layers, max %d): best %.3f ms, %.3f ms on %d threads (%.2f MB), %lld voxels checked, %s\n",
+			BodyLayers, MaxClearance, BestTime * 1e3, BestTiledTime * 1e3, GetThreadedForWorkerNum(), Clearance.GetAllocatedBytes() / 1048576.0,
+			static_cast<long long>(CheckedNum), bClearanceMatches ? "matches brute force" : "MISMATCH");
+		if (!bClearanceMatches)
+		{
+			return 2;
+		}
+
+		FVoxelGrid EditedGrid = Grid;
+		FVoxelGrid EditedWalkable = Walkable;
+		const FVoxelTile Region(Grid.GetXNum() / 3 - 16, Grid.GetYNum() / 3 - 16, Grid.GetXNum() / 3 + 16, Grid.GetYNum() / 3 + 16);
+		const FVoxelTile MaskRegion(Region.X0 - 1, Region.Y0 - 1, Region.X1 + 1, Region.Y1 + 1);
+		EditedGrid.ClearColumns(Region);
+		UpdateWalkableMask(EditedGrid, EditedWalkable, MaskRegion);
+
+		FClearanceField Patched = Clearance;
+		auto Start = std::chrono::steady_clock::now();
+		Patched.Update(EditedGrid, EditedWalkable, MaskRegion, ThreadedFor);
+		const double UpdateTime = SecondsSince(Start);
+
+		FClearanceField Fresh;
+		Fresh.Build(EditedGrid, EditedWalkable, BodyLayers, MaxClearance);
+		bool bUpdateMatches = Patched.HasSameValues(Fresh);
+
+		// And back again
+		Patched.Update(Grid, Walkable, MaskRegion, ThreadedFor);
+		bUpdateMatches &= Patched.HasSameValues(Clearance);
+
+		std::printf("clearance update 32x32 columns: %.3f ms, %s\n", UpdateTime * 1e3, bUpdateMatches ? "identical to full build" : "MISMATCH");
+		if (!bUpdateMatches)
+		{
+			return 2;
+		}
+
+		const float Radius = 40.0f;
+		const int MinClearance = FClearanceField::GetRequiredClearance(Radius, Args.CellSize);
+		std::mt19937 Rng(11u);
+		FPathSearch Search;
+		std::vector<FIntVec3> Path, ClearPath, Waypoints;
+		double PlainTime = 0.0, ClearTime = 0.0;
+		int PlainFound = 0, ClearFound = 0;
+		bool bPathsClear = true;
+		std::vector<FPathQuery> Queries;
+		std::vector<std::vector<FIntVec3>> ClearPaths;
+		for (int i = 0; i < 16; ++i)
+		{
+			const int Size = std::max(Walkable.GetXNum(), Walkable.GetYNum());
+			const FIntVec3 From = RandomStayable(Walkable, 0, 0, Size, Rng);
+			const FIntVec3 To = RandomStayable(Walkable, 0, 0, Size, Rng);
+
+			Start = std::chrono::steady_clock::now();
+			const bool bFound = Search.FindPath(Walkable, From, To, EPathAlgorithm::AStar, Path);
+			PlainTime += SecondsSince(Start);
+
+			Start = std::chrono::steady_clock::now();
+			const bool bClearFound = Search.FindPath(Walkable, Clearance, MinClearance, From, To, EPathAlgorithm::AStar, ClearPath);
+			ClearTime += SecondsSince(Start);
+
+			PlainFound += bFound ? 1 : 0;
+			ClearFound += bClearFound ? 1 : 0;
+			Queries.push_back({From, To});
+			ClearPaths.push_back(bClearFound ? ClearPath : std::vector<FIntVec3>());
+			if (bClearFound)
+			{
+				// A narrower agent gets through wherever a wider one does, never on a shorter path
+				bPathsClear &= bFound && IsConnectedPath(Walkable, ClearPath, From, To) && ClearPath.size() >= Path.size();
+				for (size_t Step = 1; Step < ClearPath.size(); ++Step)
+				{
+					bPathsClear &= Clearance.GetClearance(Walkable, ClearPath[Step].X, ClearPath[Step].Y, ClearPath[Step].Z) >= MinClearance;
+				}
+
+				// Smoothing keeps the same clearance along its segments
+				SmoothPath(Walkable, ClearPath, Waypoints, &Clearance, MinClearance);
+				bPathsClear &= IsSmoothPath(Walkable, Waypoints, From, To, &Clearance, MinClearance);
+			}
+		}
+
+		std::printf("clearance paths radius %.0f (clearance %d): %d of 16 found (%d without), astar %.3f ms, filtered %.3f ms, %s\n",
+			Radius, MinClearance, ClearFound, PlainFound, PlainTime * 1e3, ClearTime * 1e3,
+			bPathsClear ? "every voxel clear" : "MISMATCH");
+		if (!bPathsClear)
+		{
+			return 2;
+		}
+
+		// The same queries as one batch, plus a few more goals for the first start so it makes a group the
+		// tree would take without the filter: every path as the filtered FindPath finds it
+		for (int i = 1; i < 4; ++i)
+		{
+			Queries.push_back({Queries[0].Start, Queries[i].Goal});
+			const bool bClearFound = Search.FindPath(Walkable, Clearance, MinClearance, Queries[0].Start, Queries[i].Goal,
+				EPathAlgorithm::AStar, ClearPath);
+			ClearPaths.push_back(bClearFound ? ClearPath : std::vector<FIntVec3>());
+		}
+		FPathSearchPool Pool;
+		FPathBatchSettings BatchSettings;
+		BatchSettings.Clearance = &Clearance;
+		BatchSettings.MinClearance = MinClearance;
+		FPathBatchResult BatchResult;
+		FindPathBatch(Walkable, Queries.data(), static_cast<int>(Queries.size()), BatchSettings, Pool, ThreadedFor, BatchResult);
+
+		bool bBatchMatches = BatchResult.GetPathNum() == static_cast<int>(Queries.size());
+		for (int Query = 0; bBatchMatches && Query < BatchResult.GetPathNum(); ++Query)
+		{
+			const FIntVec3* Voxels = BatchResult.GetPath(Query);
+			bBatchMatches &= std::vector<FIntVec3>(Voxels, Voxels + BatchResult.GetPathLength(Query)) == ClearPaths[Query];
+		}
+		std::printf("clearance path batch: %d queries, %s\n", static_cast<int>(Queries.size()),
+			bBatchMatches ? "same paths as filtered astar" : "MISMATCH");
+		if (!bBatchMatches)
+		{
+			return 2;
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,304 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "InsightGeometryCache.h"
+#include "Components/PrimitiveComponent.h"
+#include "Hash/CityHash.h"
+#include "NavMesh/RecastNavMeshGenerator.h"
+#include "PhysicsEngine/BodySetup.h"
+
+const FInsightGeometryCache::FLocalGeo& FInsightGeometryCache::FindOrExportLocal(UBodySetup& BodySetup)
+{
+	const FLocalGeo* Local = LocalGeos.Find(&BodySetup);
+	if (Local && Local->BodySetupGuid == BodySetup.BodySetupGuid)
+	{
+		return *Local;
+	}
+
+	// Export in the body's own space; every instance transforms the same buffers
+	TNavStatArray<FVector> Vertices;
+	TNavStatArray<int32> Indices;
+	FRecastNavMeshGenerator::ExportRigidBodyGeometry(BodySetup, Vertices, Indices, FTransform::Identity);
+
+	FLocalGeo& NewLocal = LocalGeos.Add(&BodySetup);
+	NewLocal.BodySetupGuid = BodySetup.BodySetupGuid;
+	NewLocal.Vertices.Append(Vertices.GetData(), Vertices.Num());
+	NewLocal.Indices.Append(Indices.GetData(), Indices.Num());
+	return NewLocal;
+}
+
+void FInsightGeometryCache::BuildWorldGeo(const FTransform& Transform, const FLocalGeo& Local, FWorldGeo& World)
+{
+	World.Vertices.SetNumUninitialized(Local.Vertices.Num());
+	for (int32 i = 0; i < Local.Vertices.Num(); ++i)
+	{
+		World.Vertices[i] = Transform.TransformPosition(Local.Vertices[i]);
+	}
+
+	const int32 TriangleNum = Local.Indices.Num() / 3;
+	if (TriangleNum >= BvhMinTriangles)
+	{
+		if (!World.Bvh)
+		{
+			World.Bvh = MakeUnique<InsightVoxel::FTriangleBvh>();
+		}
+		World.Bvh->Build(reinterpret_cast<const float*>(World.Vertices.GetData()), World.Vertices.Num(), Local.Indices.GetData(), TriangleNum);
+	}
+	else
+	{
+		World.Bvh.Reset();
+	}
+	World.BodySetupGuid = Local.BodySetupGuid;
+}
+
+FInsightGeometryView FInsightGeometryCache::MakeView(const FLocalGeo& Local, const FWorldGeo& World)
+{
+	FInsightGeometryView View;
+	if (World.Vertices.Num() > 0)
+	{
+		View.Vertices = World.Vertices.GetData();
+		View.VertexNum = World.Vertices.Num();
+		View.Indices = Local.Indices.GetData();
+		View.IndexNum = Local.Indices.Num();
+		View.Bvh = World.Bvh.Get();
+	}
+	return View;
+}
+
+void FInsightGeometryCache::SetComponentKey(UPrimitiveComponent* Component, const FWorldKey* Key)
+{
+	const FWorldKey* OldKey = ComponentKeys.Find(Component);
+	if (OldKey && Key && *OldKey == *Key)
+	{
+		return;
+	}
+
+	// Removing from the map leaves the other elements in place, views into them stay valid
+	if (OldKey)
+	{
+		FWorldGeo* OldWorld = WorldGeos.Find(*OldKey);
+		if (OldWorld && --OldWorld->ComponentNum <= 0)
+		{
+			WorldGeos.Remove(*OldKey);
+		}
+	}
+
+	if (Key)
+	{
+		ComponentKeys.Add(Component, *Key);
+		++WorldGeos.FindChecked(*Key).ComponentNum;
+	}
+	else
+	{
+		ComponentKeys.Remove(Component);
+	}
+}
+
+FInsightGeometryView FInsightGeometryCache::GetComponentGeo(UPrimitiveComponent* Component)
+{
+	if (!Component)
+	{
+		return {};
+	}
+
+	UBodySetup* BodySetup = Component->IsNavigationRelevant() ? Component->GetBodySetup() : nullptr;
+	const FLocalGeo* Local = BodySetup ? &FindOrExportLocal(*BodySetup) : nullptr;
+	if (!Local || Local->Vertices.Num() == 0)
+	{
+		SetComponentKey(Component, nullptr);
+		return {};
+	}
+
+	const FWorldKey Key = {BodySetup, Component->GetComponentTransform()};
+	FWorldGeo* World = WorldGeos.Find(Key);
+	if (World && World->BodySetupGuid == Local->BodySetupGuid)
+	{
+		++HitNum;
+	}
+	else
+	{
+		++MissNum;
+		if (!World)
+		{
+			World = &WorldGeos.Add(Key);
+		}
+		BuildWorldGeo(Key.Transform, *Local, *World);
+	}
+	World->LastUsedBuild = BuildIndex;
+
+	SetComponentKey(Component, &Key);
+	return MakeView(*Local, *WorldGeos.Find(Key));
+}
+
+void FInsightGeometryCache::AddBuildComponent(UPrimitiveComponent* Component)
+{
+	if (!Component || !Component->IsNavigationRelevant())
+	{
+		return;
+	}
+
+	UBodySetup* BodySetup = Component->GetBodySetup();
+	if (!BodySetup)
+	{
+		return;
+	}
+
+	// Overlapping copies of a mesh rasterize to the same voxels, one entry covers them all
+	const FWorldKey Key = {BodySetup, Component->GetComponentTransform()};
+	ComponentKeys.Add(Component, Key);
+	if (BuildEntryIndices.Contains(Key))
+	{
+		return;
+	}
+
+	BuildEntryIndices.Add(Key, BuildEntries.Num());
+	FBuildEntry& Entry = BuildEntries.AddDefaulted_GetRef();
+	Entry.Key = Key;
+	Entry.BodySetup = BodySetup;
+	Entry.BodySetupGuid = BodySetup->BodySetupGuid;
+}
+
+void FInsightGeometryCache::PrepareBuild(const InsightVoxel::FParallelForFn& ParallelFor)
+{
+	// Body setups without a current local soup, each exported once however many entries use it
+	TArray<UBodySetup*> PendingBodySetups;
+	TSet<UBodySetup*> PendingSet;
+	for (const FBuildEntry& Entry : BuildEntries)
+	{
+		UBodySetup* BodySetup = Entry.BodySetup;
+		const FLocalGeo* Local = LocalGeos.Find(BodySetup);
+		if ((!Local || Local->BodySetupGuid != Entry.BodySetupGuid) && !PendingSet.Contains(BodySetup))
+		{
+			PendingSet.Add(BodySetup);
+			PendingBodySetups.Add(BodySetup);
+		}
+	}
+
+	// ExportRigidBodyGeometry only reads the body setup, so distinct ones export concurrently
+	TArray<TNavStatArray<FVector>> PendingVertices;
+	TArray<TNavStatArray<int32>> PendingIndices;
+	PendingVertices.SetNum(PendingBodySetups.Num());
+	PendingIndices.SetNum(PendingBodySetups.Num());
+	ParallelFor(PendingBodySetups.Num(), [&](int Index) {
+		FRecastNavMeshGenerator::ExportRigidBodyGeometry(*PendingBodySetups[Index], PendingVertices[Index], PendingIndices[Index],
+			FTransform::Identity);
+	});
+
+	for (int32 i = 0; i < PendingBodySetups.Num(); ++i)
+	{
+		FLocalGeo& Local = LocalGeos.Add(PendingBodySetups[i]);
+		Local.BodySetupGuid = PendingBodySetups[i]->BodySetupGuid;
+		Local.Vertices.Append(PendingVertices[i].GetData(), PendingVertices[i].Num());
+		Local.Indices.Append(PendingIndices[i].GetData(), PendingIndices[i].Num());
+	}
+
+	// Add the missing world entries first: adding to a map moves its elements, so pointers are taken after
+	for (FBuildEntry& Entry : BuildEntries)
+	{
+		FWorldGeo* World = WorldGeos.Find(Entry.Key);
+		Entry.bTransform = !World || World->BodySetupGuid != Entry.BodySetupGuid;
+		if (Entry.bTransform)
+		{
+			++MissNum;
+			// The GUID is only stamped once the vertices are transformed, so an entry the build never reaches misses again
+			WorldGeos.Add(Entry.Key).BodySetupGuid.Invalidate();
+		}
+		else
+		{
+			++HitNum;
+		}
+	}
+
+	for (FBuildEntry& Entry : BuildEntries)
+	{
+		Entry.Local = LocalGeos.Find(Entry.BodySetup);
+		Entry.World = WorldGeos.Find(Entry.Key);
+		Entry.World->LastUsedBuild = BuildIndex;
+	}
+}
+
+FInsightGeometryView FInsightGeometryCache::GetBuildEntry(int32 Index)
+{
+	FBuildEntry& Entry = BuildEntries[Index];
+	if (Entry.bTransform)
+	{
+		BuildWorldGeo(Entry.Key.Transform, *Entry.Local, *Entry.World);
+		Entry.bTransform = false;
+	}
+	return MakeView(*Entry.Local, *Entry.World);
+}
+
+uint64 FInsightGeometryCache::GetBuildHash() const
+{
+	uint64 Hash = 0;
+	for (const FBuildEntry& Entry : BuildEntries)
+	{
+		const FVector Translation = Entry.Key.Transform.GetTranslation();
+		const FQuat Rotation = Entry.Key.Transform.GetRotation();
+		const FVector Scale = Entry.Key.Transform.GetScale3D();
+
+		Hash = CityHash64WithSeed(reinterpret_cast<const char*>(&Entry.BodySetupGuid), sizeof(FGuid), Hash);
+		Hash = CityHash64WithSeed(reinterpret_cast<const char*>(&Translation), sizeof(Translation), Hash);
+		Hash = CityHash64WithSeed(reinterpret_cast<const char*>(&Rotation), sizeof(Rotation), Hash);
+		Hash = CityHash64WithSeed(reinterpret_cast<const char*>(&Scale), sizeof(Scale), Hash);
+	}
+	return Hash;
+}
+
+void FInsightGeometryCache::BeginBuild()
+{
+	++BuildIndex;
+	HitNum = 0;
+	MissNum = 0;
+
+	// AddBuildComponent records the gathered components again
+	ComponentKeys.Reset();
+}
+
+void FInsightGeometryCache::EndBuild()
+{
+	BuildEntries.Reset();
+	BuildEntryIndices.Reset();
+
+	for (auto It = WorldGeos.CreateIterator(); It; ++It)
+	{
+		if (It.Value().LastUsedBuild != BuildIndex)
+		{
+			It.RemoveCurrent();
+		}
+	}
+
+	for (auto It = LocalGeos.CreateIterator(); It; ++It)
+	{
+		if (!It.Key().IsValid())
+		{
+			It.RemoveCurrent();
+		}
+	}
+
+	// Count the users of the surviving entries for GetComponentGeo's eviction
+	for (TPair<FWorldKey, FWorldGeo>& Pair : WorldGeos)
+	{
+		Pair.Value.ComponentNum = 0;
+	}
+	for (auto It = ComponentKeys.CreateIterator(); It; ++It)
+	{
+		FWorldGeo* World = It.Key().IsValid() ? WorldGeos.Find(It.Value()) : nullptr;
+		if (World)
+		{
+			++World->ComponentNum;
+		}
+		else
+		{
+			It.RemoveCurrent();
+		}
+	}
+}
+
+void FInsightGeometryCache::Reset()
+{
+	LocalGeos.Reset();
+	WorldGeos.Reset();
+	ComponentKeys.Reset();
+	BuildEntries.Reset();
+	BuildEntryIndices.Reset();
+}
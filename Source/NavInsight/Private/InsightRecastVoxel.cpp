@@ -5,10 +5,21 @@
 #include "Engine/StaticMesh.h"
 #include "NavMesh/RecastNavMeshGenerator.h"
 #include "Navmesh/Public/Recast/Recast.h"
+#include "Navmesh/Public/Recast/RecastAlloc.h"
 #include "NavMesh/RecastHelpers.h"
 #include "DrawDebugHelpers.h"
 #include "NavigationSystem.h"
 #include "NavMesh/RecastNavMesh.h"
+#include "Async/ParallelFor.h"
+#include "HAL/FileManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/MemoryWriter.h"
+#include "VoxelCore/InsightVoxelGrid.h"
+#include "VoxelCore/InsightVoxelMesher.h"
+#include "VoxelCore/InsightVoxelRasterizer.h"
+#include "VoxelCore/InsightVoxelSpans.h"
+#include "VoxelCore/InsightVoxelTiling.h"
 
 namespace InsightRecast
 {
@@ -43,22 +54,183 @@ namespace InsightRecast
 		Verts = (float*)(Memory + sizeof(FRecastGeometry));
 		Indices = (int32*)(Memory + sizeof(FRecastGeometry) + (sizeof(float) * Header.NumVerts * 3));
 	}
+
+	// Empty every column and put all spans of the existing pools back on the free list
+	static void ResetHeightField(rcHeightfield& HeightField, const float* BMin, const float* BMax)
+	{
+		FMemory::Memzero(HeightField.spans, sizeof(rcSpan*) * HeightField.width * HeightField.height);
+
+		HeightField.freelist = nullptr;
+		for (rcSpanPool* Pool = HeightField.pools; Pool; Pool = Pool->next)
+		{
+			for (int i = RC_SPANS_PER_POOL - 1; i >= 0; --i)
+			{
+				Pool->items[i].next = HeightField.freelist;
+				HeightField.freelist = &Pool->items[i];
+			}
+		}
+
+		rcVcopy(HeightField.bmin, BMin);
+		rcVcopy(HeightField.bmax, BMax);
+	}
+
+	// Grow the span pools (the same way Recast does when it runs out) until they hold SpanNum spans
+	static void ReserveSpans(rcHeightfield& HeightField, int SpanNum)
+	{
+		int Capacity = 0;
+		for (const rcSpanPool* Pool = HeightField.pools; Pool; Pool = Pool->next)
+		{
+			Capacity += RC_SPANS_PER_POOL;
+		}
+
+		for (; Capacity < SpanNum; Capacity += RC_SPANS_PER_POOL)
+		{
+			rcSpanPool* Pool = static_cast<rcSpanPool*>(rcAlloc(sizeof(rcSpanPool), RC_ALLOC_PERM));
+			if (!Pool)
+			{
+				return;
+			}
+			Pool->next = HeightField.pools;
+			HeightField.pools = Pool;
+
+			for (int i = RC_SPANS_PER_POOL - 1; i >= 0; --i)
+			{
+				Pool->items[i].next = HeightField.freelist;
+				HeightField.freelist = &Pool->items[i];
+			}
+		}
+	}
+
+	static int CountSpans(const rcHeightfield& HeightField)
+	{
+		int SpanNum = 0;
+		for (int i = 0; i < HeightField.width * HeightField.height; ++i)
+		{
+			for (const rcSpan* Span = HeightField.spans[i]; Span; Span = Span->next)
+			{
+				++SpanNum;
+			}
+		}
+		return SpanNum;
+	}
+
+	// Column heads, span pools and the struct itself
+	static int64 GetHeightFieldBytes(const rcHeightfield& HeightField)
+	{
+		int64 Bytes = sizeof(rcHeightfield) + static_cast<int64>(HeightField.width) * HeightField.height * sizeof(rcSpan*);
+		for (const rcSpanPool* Pool = HeightField.pools; Pool; Pool = Pool->next)
+		{
+			Bytes += sizeof(rcSpanPool);
+		}
+		return Bytes;
+	}
+
+	// Collision of the static mesh component of Target in recast coordinates, copied out of the export
+	static bool ExportTargetCollision(AActor* Target, TArray<float>& OutVerts, TArray<int32>& OutIndices, FBox& OutBounds)
+	{
+		UStaticMeshComponent* Comp = Target
+			? Cast<UStaticMeshComponent>(Target->GetComponentByClass(UStaticMeshComponent::StaticClass()))
+			: nullptr;
+		if (!Comp)
+		{
+			return false;
+		}
+
+		FNavigationRelevantData Data(*Target);
+		FRecastNavMeshGenerator::ExportComponentGeometry(Comp, Data);
+		if (Data.CollisionData.Num() == 0)
+		{
+			return false;
+		}
+
+		const FRecastGeometry Geometry(Data.CollisionData.GetData());
+		OutVerts = TArray<float>(Geometry.Verts, Geometry.Header.NumVerts * 3);
+		OutIndices = TArray<int32>(Geometry.Indices, Geometry.Header.NumFaces * 3);
+		OutBounds = Unreal2RecastBox(Comp->GetNavigationBounds());
+		return true;
+	}
+
+	// Triangles in the raw layout InsightVoxelBench --raw loads (Benchmarks/InsightBenchMesh.h), back in Unreal coordinates
+	static bool SaveRawMesh(const FString& Path, const TArray<float>& Verts, const TArray<int32>& Indices)
+	{
+		TArray<uint8> Bytes;
+		FMemoryWriter Writer(Bytes);
+
+		int32 NumVerts = Verts.Num() / 3;
+		int32 NumTris = Indices.Num() / 3;
+		Writer << NumVerts << NumTris;
+		for (int32 i = 0; i < NumVerts; ++i)
+		{
+			FVector Vert = Recast2UnrealPoint(&Verts[i * 3]);
+			Writer << Vert.X << Vert.Y << Vert.Z;
+		}
+		for (int32 Index : Indices)
+		{
+			Writer << Index;
+		}
+
+		IFileManager::Get().MakeDirectory(*FPaths::GetPath(Path), true);
+		return FFileHelper::SaveArrayToFile(Bytes, *Path);
+	}
+
+	// Reset HeightField in place if it has the requested layout, otherwise (re)create it
+	static void PrepareHeightField(rcHeightfield*& HeightField, bool bReuse, int Width, int Height, const float* BMin, const float* BMax,
+								   float CellSize, float CellHeight)
+	{
+		if (HeightField && bReuse && HeightField->width == Width && HeightField->height == Height
+			&& HeightField->cs == CellSize && HeightField->ch == CellHeight)
+		{
+			ResetHeightField(*HeightField, BMin, BMax);
+			return;
+		}
+
+		if (HeightField)
+		{
+			rcFreeHeightField(HeightField);
+		}
+		HeightField = rcAllocHeightfield();
+		rcCreateHeightfield(nullptr, *HeightField, Width, Height, BMin, BMax, CellSize, CellHeight);
+	}
 }
 
 void AInsightRecastVoxel::CreateNewHeightField(FBox& BBox)
+{
+	int HFWidth = 0;
+	int HFHeight = 0;
+
+	rcCalcGridSize(&BBox.Min.X, &BBox.Max.X, CellSize, &HFWidth, &HFHeight);
+
+	InsightRecast::PrepareHeightField(HeightField, bReuseHeightField, HFWidth, HFHeight, &BBox.Min.X, &BBox.Max.X, CellSize, CellHeight);
+
+	if (SpanReserveScale > 0.0f)
+	{
+		InsightRecast::ReserveSpans(*HeightField, FMath::CeilToInt(SpanCount * SpanReserveScale));
+	}
+}
+
+void AInsightRecastVoxel::FreeHeightFields()
 {
 	if (HeightField)
 	{
 		rcFreeHeightField(HeightField);
+		HeightField = nullptr;
 	}
 
-	int HFWidth = 0;
-	int HFHeight = 0;
+	for (rcHeightfield* TileField : TileHeightFields)
+	{
+		if (TileField)
+		{
+			rcFreeHeightField(TileField);
+		}
+	}
+	TileHeightFields.Reset();
+}
 
-	rcCalcGridSize(&BBox.Min.X, &BBox.Max.X, CellSize, &HFWidth, &HFHeight);
+void AInsightRecastVoxel::BeginDestroy()
+{
+	FreeHeightFields();
 
-	HeightField = rcAllocHeightfield();
-	rcCreateHeightfield(nullptr, *HeightField, HFWidth, HFHeight, &BBox.Min.X, &BBox.Max.X, CellSize, CellHeight);
+	Super::BeginDestroy();
 }
 
 void AInsightRecastVoxel::RasterizeMeshToHeightField()
@@ -80,6 +252,8 @@ void AInsightRecastVoxel::RasterizeMeshToHeightField()
 		return;
 	}
 
+	double PhaseStart = FPlatformTime::Seconds();
+
 	FNavigationRelevantData Data(*TargetMesh);
 
 	FRecastNavMeshGenerator::ExportComponentGeometry(Comp, Data);
@@ -91,8 +265,11 @@ void AInsightRecastVoxel::RasterizeMeshToHeightField()
 
 	InsightRecast::FRecastGeometry CollisionCache(RawCollisionCache.GetData());
 
-	const int32 NumCoords = CollisionCache.Header.NumVerts * 3;
-	const int32 NumIndices = CollisionCache.Header.NumFaces * 3;
+	const int32 NumVerts = CollisionCache.Header.NumVerts;
+	const int32 NumTris = CollisionCache.Header.NumFaces;
+	const int32 NumIndices = NumTris * 3;
+
+	ExportTime = FPlatformTime::Seconds() - PhaseStart;
 
 	FBox BBox = Comp->GetNavigationBounds();
 	BBox = Unreal2RecastBox(BBox);
@@ -104,26 +281,169 @@ void AInsightRecastVoxel::RasterizeMeshToHeightField()
 
 	rcContext Context;
 
-	double TimeStart = FPlatformTime::Seconds();
+	BinTime = 0.0;
+	MergeTime = 0.0;
+	PhaseStart = FPlatformTime::Seconds();
 
 	CreateNewHeightField(BBox);
 
-	for (int i = 0; i < NumIndices; i += 3)
+	switch (RasterMode)
 	{
-		int32 ia = CollisionCache.Indices[i];
-		int32 ib = CollisionCache.Indices[i + 1];
-		int32 ic = CollisionCache.Indices[i + 2];
+	case EInsightRecastRasterMode::PerTriangle:
+		for (int i = 0; i < NumIndices; i += 3)
+		{
+			int32 ia = CollisionCache.Indices[i];
+			int32 ib = CollisionCache.Indices[i + 1];
+			int32 ic = CollisionCache.Indices[i + 2];
 
-		FVector PosA(CollisionCache.Verts[ia * 3 + 0], CollisionCache.Verts[ia * 3 + 1], CollisionCache.Verts[ia * 3 + 2]);
-		FVector PosB(CollisionCache.Verts[ib * 3 + 0], CollisionCache.Verts[ib * 3 + 1], CollisionCache.Verts[ib * 3 + 2]);
-		FVector PosC(CollisionCache.Verts[ic * 3 + 0], CollisionCache.Verts[ic * 3 + 1], CollisionCache.Verts[ic * 3 + 2]);
+			FVector PosA(CollisionCache.Verts[ia * 3 + 0], CollisionCache.Verts[ia * 3 + 1], CollisionCache.Verts[ia * 3 + 2]);
+			FVector PosB(CollisionCache.Verts[ib * 3 + 0], CollisionCache.Verts[ib * 3 + 1], CollisionCache.Verts[ib * 3 + 2]);
+			FVector PosC(CollisionCache.Verts[ic * 3 + 0], CollisionCache.Verts[ic * 3 + 1], CollisionCache.Verts[ic * 3 + 2]);
 
-		rcRasterizeTriangle(&Context, &PosA.X, &PosB.X, &PosC.X, 0, *HeightField);
+			rcRasterizeTriangle(&Context, &PosA.X, &PosB.X, &PosC.X, 0, *HeightField);
+		}
+		break;
+	case EInsightRecastRasterMode::Batched:
+	{
+		// Area 0 for every triangle, like the per-triangle path
+		TArray<uint8> Areas;
+		Areas.SetNumZeroed(NumTris);
+		rcRasterizeTriangles(&Context, CollisionCache.Verts, NumVerts, CollisionCache.Indices, Areas.GetData(), NumTris, *HeightField);
+		break;
 	}
+	case EInsightRecastRasterMode::Parallel:
+		RasterizeParallel(CollisionCache.Verts, NumVerts, CollisionCache.Indices, NumTris);
+		break;
+	}
+
+	RasterizeTime = FPlatformTime::Seconds() - PhaseStart - BinTime - MergeTime;
+	BuildTime = ExportTime + BinTime + RasterizeTime + MergeTime;
+
+	SpanCount = InsightRecast::CountSpans(*HeightField);
+}
+
+void AInsightRecastVoxel::RasterizeParallel(const float* Verts, int NumVerts, const int32* Indices, int NumTris)
+{
+	const rcHeightfield& Target = *HeightField;
+
+	InsightVoxel::FVoxelTiling Tiling;
+	Tiling.Init(Target.width, Target.height, ParallelTileColumns, ParallelTileColumns);
+	const int TileNum = Tiling.GetTileNum();
+
+	// Bin the triangles into the tiles their column rect (one column of margin) overlaps
+	double PhaseStart = FPlatformTime::Seconds();
+
+	TArray<TArray<int32>> TileIndices;
+	TileIndices.SetNum(TileNum);
+
+	const float InvCellSize = 1.0f / Target.cs;
+	for (int Tri = 0; Tri < NumTris; ++Tri)
+	{
+		const float* A = &Verts[Indices[Tri * 3 + 0] * 3];
+		const float* B = &Verts[Indices[Tri * 3 + 1] * 3];
+		const float* C = &Verts[Indices[Tri * 3 + 2] * 3];
+
+		const float MinX = FMath::Min3(A[0], B[0], C[0]);
+		const float MaxX = FMath::Max3(A[0], B[0], C[0]);
+		const float MinZ = FMath::Min3(A[2], B[2], C[2]);
+		const float MaxZ = FMath::Max3(A[2], B[2], C[2]);
+		if (MaxX < Target.bmin[0] || MinX > Target.bmax[0] || MaxZ < Target.bmin[2] || MinZ > Target.bmax[2])
+		{
+			continue;
+		}
+
+		const int X0 = FMath::Clamp(FMath::FloorToInt((MinX - Target.bmin[0]) * InvCellSize) - 1, 0, Target.width - 1);
+		const int X1 = FMath::Clamp(FMath::FloorToInt((MaxX - Target.bmin[0]) * InvCellSize) + 1, 0, Target.width - 1);
+		const int Y0 = FMath::Clamp(FMath::FloorToInt((MinZ - Target.bmin[2]) * InvCellSize) - 1, 0, Target.height - 1);
+		const int Y1 = FMath::Clamp(FMath::FloorToInt((MaxZ - Target.bmin[2]) * InvCellSize) + 1, 0, Target.height - 1);
+
+		for (int TY = Y0 / Tiling.GetTileY(); TY <= Y1 / Tiling.GetTileY(); ++TY)
+		{
+			for (int TX = X0 / Tiling.GetTileX(); TX <= X1 / Tiling.GetTileX(); ++TX)
+			{
+				TileIndices[Tiling.GetTileIndex(TX, TY)].Append(&Indices[Tri * 3], 3);
+			}
+		}
+	}
+
+	BinTime = FPlatformTime::Seconds() - PhaseStart;
+
+	// Every tile gets its own heightfield, one column wider on each side: Recast clamps the first row / column
+	// of a triangle to the heightfield, so the border cells also collect whatever lies beyond and are dropped.
+	// Tile heightfields are kept for the next build when reuse is on.
+	if (TileHeightFields.Num() != TileNum)
+	{
+		for (rcHeightfield* TileField : TileHeightFields)
+		{
+			if (TileField)
+			{
+				rcFreeHeightField(TileField);
+			}
+		}
+		TileHeightFields.Reset();
+		TileHeightFields.SetNumZeroed(TileNum);
+	}
+	TArray<bool> TileUsed;
+	TileUsed.SetNumZeroed(TileNum);
+
+	ParallelFor(TileNum, [&](int32 TileIndex) {
+		const TArray<int32>& TileTris = TileIndices[TileIndex];
+		if (TileTris.Num() == 0)
+		{
+			return;
+		}
+
+		const InsightVoxel::FVoxelTile Tile = Tiling.GetTile(TileIndex);
+		const int Width = Tile.X1 - Tile.X0 + 2;
+		const int Height = Tile.Y1 - Tile.Y0 + 2;
+
+		float TileMin[3] = {Target.bmin[0] + (Tile.X0 - 1) * Target.cs, Target.bmin[1], Target.bmin[2] + (Tile.Y0 - 1) * Target.cs};
+		float TileMax[3] = {TileMin[0] + Width * Target.cs, Target.bmax[1], TileMin[2] + Height * Target.cs};
+
+		rcHeightfield*& TileField = TileHeightFields[TileIndex];
+		InsightRecast::PrepareHeightField(TileField, bReuseHeightField, Width, Height, TileMin, TileMax, Target.cs, Target.ch);
+
+		// rcContext is not thread safe
+		rcContext TileContext;
+		TArray<uint8> Areas;
+		Areas.SetNumZeroed(TileTris.Num() / 3);
+		rcRasterizeTriangles(&TileContext, Verts, NumVerts, TileTris.GetData(), Areas.GetData(), TileTris.Num() / 3, *TileField);
+
+		TileUsed[TileIndex] = true;
+	});
+
+	// Tiles own disjoint columns, so the merge only appends already merged spans to empty columns
+	PhaseStart = FPlatformTime::Seconds();
+
+	rcContext Context;
+	for (int TileIndex = 0; TileIndex < TileNum; ++TileIndex)
+	{
+		rcHeightfield*& TileField = TileHeightFields[TileIndex];
+		if (!TileUsed[TileIndex])
+		{
+			continue;
+		}
+
+		const InsightVoxel::FVoxelTile Tile = Tiling.GetTile(TileIndex);
+		for (int y = 1; y < TileField->height - 1; ++y)
+		{
+			for (int x = 1; x < TileField->width - 1; ++x)
+			{
+				for (const rcSpan* Span = TileField->spans[x + y * TileField->width]; Span; Span = Span->next)
+				{
+					rcAddSpan(&Context, *HeightField, Tile.X0 + x - 1, Tile.Y0 + y - 1, Span->data.smin, Span->data.smax, Span->data.area, 1);
+				}
+			}
+		}
 
-	double TimeEnd = FPlatformTime::Seconds();
+		if (!bReuseHeightField)
+		{
+			rcFreeHeightField(TileField);
+			TileField = nullptr;
+		}
+	}
 
-	BuildTime = TimeEnd - TimeStart;
+	MergeTime = FPlatformTime::Seconds() - PhaseStart;
 }
 
 void AInsightRecastVoxel::LoadNavConfig()
@@ -137,19 +457,195 @@ void AInsightRecastVoxel::LoadNavConfig()
 	}
 
 	ANavigationData* NavData = NavSys->GetDefaultNavDataInstance();
-	if (!NavSys)
+	if (!NavData)
 	{
 		// Reach here due to in-approriate config. in most time
 		return;
 	}
 
+	// The default nav data may be another kind than Recast; keep the current cell size then
 	ARecastNavMesh* RecastNavData = Cast<ARecastNavMesh>(NavData);
+	if (!RecastNavData)
+	{
+		return;
+	}
+
 	CellSize = RecastNavData->CellSize;
 	CellHeight = RecastNavData->CellHeight;
 }
 
+// Recast is Y-up; the voxel grid gets recast X, Z, Y as its X, Y, Z so columns stay vertical
+static void HeightFieldToVoxelGrid(const rcHeightfield& HeightField, InsightVoxel::FVoxelGrid& OutGrid)
+{
+	int TopSpan = 0;
+	for (int i = 0; i < HeightField.width * HeightField.height; ++i)
+	{
+		for (const rcSpan* Span = HeightField.spans[i]; Span; Span = Span->next)
+		{
+			TopSpan = FMath::Max(TopSpan, static_cast<int>(Span->data.smax));
+		}
+	}
+
+	const InsightVoxel::FBounds3 Bounds = {
+		{HeightField.bmin[0], HeightField.bmin[2], HeightField.bmin[1]},
+		{HeightField.bmin[0] + HeightField.width * HeightField.cs, HeightField.bmin[2] + HeightField.height * HeightField.cs,
+		 HeightField.bmin[1] + TopSpan * HeightField.ch}
+	};
+	OutGrid.Init(Bounds, HeightField.cs, HeightField.ch);
+
+	for (int y = 0; y < HeightField.height; ++y)
+	{
+		for (int x = 0; x < HeightField.width; ++x)
+		{
+			for (const rcSpan* Span = HeightField.spans[x + y * HeightField.width]; Span; Span = Span->next)
+			{
+				OutGrid.SetSpan(x, y, Span->data.smin, Span->data.smax);
+			}
+		}
+	}
+}
+
+// Same axis mapping as HeightFieldToVoxelGrid; rcAddSpan keeps the spans of a column sorted and merged
+static bool HeightFieldToSpanGrid(const rcHeightfield& HeightField, InsightVoxel::FVoxelSpanGrid& OutSpans)
+{
+	int TopSpan = 0;
+	for (int i = 0; i < HeightField.width * HeightField.height; ++i)
+	{
+		for (const rcSpan* Span = HeightField.spans[i]; Span; Span = Span->next)
+		{
+			TopSpan = FMath::Max(TopSpan, static_cast<int>(Span->data.smax));
+		}
+	}
+
+	const InsightVoxel::FBounds3 Bounds = {
+		{HeightField.bmin[0], HeightField.bmin[2], HeightField.bmin[1]},
+		{HeightField.bmin[0] + HeightField.width * HeightField.cs, HeightField.bmin[2] + HeightField.height * HeightField.cs,
+		 HeightField.bmin[1] + TopSpan * HeightField.ch}
+	};
+	if (!OutSpans.Init(Bounds, HeightField.cs, HeightField.ch))
+	{
+		return false;
+	}
+
+	// Span grid columns are X major
+	for (int x = 0; x < HeightField.width; ++x)
+	{
+		for (int y = 0; y < HeightField.height; ++y)
+		{
+			for (const rcSpan* Span = HeightField.spans[x + y * HeightField.width]; Span; Span = Span->next)
+			{
+				OutSpans.AppendSpan(x, y, Span->data.smin, Span->data.smax);
+			}
+		}
+	}
+	OutSpans.FinishSpans();
+	return true;
+}
+
+void AInsightRecastVoxel::VisualizeHeightFieldGreedy() const
+{
+	InsightVoxel::FVoxelGrid Grid;
+	HeightFieldToVoxelGrid(*HeightField, Grid);
+
+	InsightVoxel::FVoxelTiling Tiling;
+	Tiling.Init(Grid.GetXNum(), Grid.GetYNum(), MeshTileColumns, MeshTileColumns);
+
+	const FVector Position = GetActorLocation();
+	const FLinearColor Color = { 1.0, 1.0, 0.0, 1.0 };
+	const FVector AxisNormals[3] = {FVector(1, 0, 0), FVector(0, 1, 0), FVector(0, 0, 1)};
+
+	// Grid space (recast X, Z, Y) to unreal
+	auto ToUnreal = [](const InsightVoxel::FVec3& V) { return Recast2UnrealPoint(FVector(V.X, V.Z, V.Y)); };
+	auto ToUnrealDir = [](const FVector& V) { return FVector(-V.X, -V.Y, V.Z); };
+
+	std::vector<InsightVoxel::FVoxelQuad> Quads;
+	TArray<FVector> Vertices;
+	TArray<int32> Triangles;
+	TArray<FVector> Normals;
+	TArray<FVector2D> UV0;
+	TArray<FProcMeshTangent> Tangents;
+	TArray<FLinearColor> VertexColors;
+
+	int32 SectionIndex = 0;
+	for (int TileIndex = 0; TileIndex < Tiling.GetTileNum(); ++TileIndex)
+	{
+		Quads.clear();
+		InsightVoxel::BuildGreedyQuads(Grid, Tiling.GetTile(TileIndex), Quads);
+		if (Quads.empty())
+		{
+			continue;
+		}
+
+		// Four corners shared by the two triangles of every quad
+		const int32 QuadNum = static_cast<int32>(Quads.size());
+		Vertices.SetNumUninitialized(QuadNum * 4, false);
+		Normals.SetNumUninitialized(QuadNum * 4, false);
+		Tangents.SetNumUninitialized(QuadNum * 4, false);
+		Triangles.SetNumUninitialized(QuadNum * 6, false);
+		VertexColors.Init(Color, QuadNum * 4);
+
+		for (int32 QuadIndex = 0; QuadIndex < QuadNum; ++QuadIndex)
+		{
+			const InsightVoxel::FVoxelQuad& Quad = Quads[QuadIndex];
+
+			InsightVoxel::FVec3 Corners[4];
+			InsightVoxel::GetQuadCorners(Grid, Quad, Corners);
+
+			const int Axis = Quad.Dir >> 1;
+			const FVector Normal = ToUnrealDir(AxisNormals[Axis] * ((Quad.Dir & 1) ? 1.0f : -1.0f));
+			const FVector Tangent = ToUnrealDir(AxisNormals[Axis == 0 ? 1 : 0]);
+
+			const int32 IndexBase = QuadIndex * 4;
+			for (int Corner = 0; Corner < 4; ++Corner)
+			{
+				Vertices[IndexBase + Corner] = ToUnreal(Corners[Corner]) - Position;
+				Normals[IndexBase + Corner] = Normal;
+				Tangents[IndexBase + Corner] = FProcMeshTangent(Tangent, false);
+			}
+
+			// Corners are counter-clockwise seen from outside, front faces are clockwise
+			int32* Tri = &Triangles[QuadIndex * 6];
+			Tri[0] = IndexBase + 0;
+			Tri[1] = IndexBase + 2;
+			Tri[2] = IndexBase + 1;
+			Tri[3] = IndexBase + 0;
+			Tri[4] = IndexBase + 3;
+			Tri[5] = IndexBase + 2;
+		}
+
+		Mesh->CreateMeshSection_LinearColor(SectionIndex, Vertices, Triangles, Normals, UV0, VertexColors, Tangents, false);
+		if (VolMaterial)
+		{
+			Mesh->SetMaterial(SectionIndex, VolMaterial);
+		}
+		++SectionIndex;
+	}
+}
+
 void AInsightRecastVoxel::VisualizeHeightField() const
 {
+	Mesh->ClearAllMeshSections();
+	if (!HeightField)
+	{
+		return;
+	}
+
+	if (bGreedyMeshing)
+	{
+		VisualizeHeightFieldGreedy();
+		return;
+	}
+
+	// Size the buffers up front, 24 vertices / 36 indices per span
+	int32 SpanNum = 0;
+	for (int i = 0; i < HeightField->width * HeightField->height; ++i)
+	{
+		for (const rcSpan* Span = HeightField->spans[i]; Span; Span = Span->next)
+		{
+			++SpanNum;
+		}
+	}
+
 	TArray<FVector> Vertices;
 	TArray<int32> Triangles;
 	TArray<FVector> Normals;
@@ -157,6 +653,12 @@ void AInsightRecastVoxel::VisualizeHeightField() const
 	TArray<FProcMeshTangent> Tangents;
 	TArray<FLinearColor> VertexColors;
 
+	Vertices.Reserve(SpanNum * 24);
+	Triangles.Reserve(SpanNum * 36);
+	Normals.Reserve(SpanNum * 24);
+	Tangents.Reserve(SpanNum * 24);
+	VertexColors.Reserve(SpanNum * 24);
+
 	FVector Position = GetActorLocation();
 
 	// Visualize a span (with a procedural cube)
@@ -362,10 +864,117 @@ void AInsightRecastVoxel::ComputeVoxelOfTargetMesh()
 	// Rasterize Mesh To the Height Field
 	RasterizeMeshToHeightField();
 
+	CompactSpanBytes = 0;
+	if (bBuildCompactSpans && HeightField && HeightFieldToSpanGrid(*HeightField, CompactHeightField))
+	{
+		CompactSpanBytes = static_cast<int>(CompactHeightField.GetAllocatedBytes());
+	}
+
 	// Visualize the Height Field
 	VisualizeHeightField();
 }
 
+void AInsightRecastVoxel::CompareWithRecast()
+{
+	TArray<float> Verts;
+	TArray<int32> Indices;
+	FBox BBox;
+	if (!InsightRecast::ExportTargetCollision(TargetMesh, Verts, Indices, BBox))
+	{
+		return;
+	}
+
+	// Same padding as RasterizeMeshToHeightField
+	static float Padding = 10.0f;
+	BBox.Min -= {Padding, Padding, Padding};
+	BBox.Max += {Padding, Padding, Padding};
+
+	const int32 NumVerts = Verts.Num() / 3;
+	const int32 NumTris = Indices.Num() / 3;
+
+	if (bDumpCompareMesh)
+	{
+		InsightRecast::SaveRawMesh(FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("NavInsight"), GetName() + TEXT(".bin")), Verts, Indices);
+	}
+
+	// The voxel core gets the vertices in grid space (recast X, Z, Y), see HeightFieldToVoxelGrid
+	TArray<float> GridVerts;
+	GridVerts.SetNumUninitialized(Verts.Num());
+	for (int32 i = 0; i < NumVerts; ++i)
+	{
+		GridVerts[i * 3 + 0] = Verts[i * 3 + 0];
+		GridVerts[i * 3 + 1] = Verts[i * 3 + 2];
+		GridVerts[i * 3 + 2] = Verts[i * 3 + 1];
+	}
+
+	TArray<FVector2D> Settings = CompareCellSettings;
+	if (Settings.Num() == 0)
+	{
+		LoadNavConfig();
+		Settings.Emplace(CellSize, CellHeight);
+	}
+
+	TArray<uint8> Areas;
+	Areas.SetNumZeroed(NumTris);
+	rcContext Context;
+
+	Comparisons.Reset();
+	for (const FVector2D& Setting : Settings)
+	{
+		FInsightVoxelComparison& Row = Comparisons.AddDefaulted_GetRef();
+		Row.CellSize = Setting.X;
+		Row.CellHeight = Setting.Y;
+
+		int Width = 0;
+		int Height = 0;
+		rcCalcGridSize(&BBox.Min.X, &BBox.Max.X, Row.CellSize, &Width, &Height);
+
+		rcHeightfield* Field = nullptr;
+		Row.RecastTime = TNumericLimits<double>::Max();
+		for (int Iter = 0; Iter < CompareIters; ++Iter)
+		{
+			InsightRecast::PrepareHeightField(Field, true, Width, Height, &BBox.Min.X, &BBox.Max.X, Row.CellSize, Row.CellHeight);
+
+			const double Start = FPlatformTime::Seconds();
+			rcRasterizeTriangles(&Context, Verts.GetData(), NumVerts, Indices.GetData(), Areas.GetData(), NumTris, *Field);
+			Row.RecastTime = FMath::Min(Row.RecastTime, FPlatformTime::Seconds() - Start);
+		}
+		Row.RecastBytes = InsightRecast::GetHeightFieldBytes(*Field);
+
+		// Same columns, bottom and top as the heightfield
+		const InsightVoxel::FBounds3 Bounds = {
+			{Field->bmin[0], Field->bmin[2], Field->bmin[1]},
+			{Field->bmin[0] + Width * Row.CellSize, Field->bmin[2] + Height * Row.CellSize, Field->bmax[1]}
+		};
+
+		InsightVoxel::FVoxelGrid Grid;
+		Row.InsightTime = TNumericLimits<double>::Max();
+		for (int Iter = 0; Iter < CompareIters; ++Iter)
+		{
+			Grid.Init(Bounds, Row.CellSize, Row.CellHeight);
+
+			const double Start = FPlatformTime::Seconds();
+			InsightVoxel::RasterizeTriangles(Grid, GridVerts.GetData(), NumVerts, Indices.GetData(), NumTris);
+			Row.InsightTime = FMath::Min(Row.InsightTime, FPlatformTime::Seconds() - Start);
+		}
+		Row.InsightBytes = static_cast<int64>(Grid.GetWordNum() * sizeof(uint64));
+
+		InsightVoxel::FVoxelGrid RecastGrid;
+		HeightFieldToVoxelGrid(*Field, RecastGrid);
+		rcFreeHeightField(Field);
+
+		InsightVoxel::FOccupancyDiff Diff;
+		if (InsightVoxel::CompareOccupancy(RecastGrid, Grid, Diff))
+		{
+			Row.BothVoxels = Diff.BothNum;
+			Row.RecastOnlyVoxels = Diff.OnlyANum;
+			Row.InsightOnlyVoxels = Diff.OnlyBNum;
+			Row.DiffColumns = Diff.DiffColumnNum;
+			Row.FirstDiffColumn = FIntPoint(Diff.FirstDiffX, Diff.FirstDiffY);
+		}
+	}
+}
+
 // Sets default values
 AInsightRecastVoxel::AInsightRecastVoxel()
 {
@@ -0,0 +1,410 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "InsightVoxelBuildJob.h"
+#include "HAL/FileManager.h"
+#include "Misc/Paths.h"
+#include "NavInsightStats.h"
+#include "ProfilingDebugging/ScopedTimers.h"
+#include "VoxelCore/InsightVoxelCache.h"
+#include "VoxelCore/InsightVoxelPipeline.h"
+#include "VoxelCore/InsightVoxelRasterizer.h"
+#include "VoxelCore/InsightVoxelSmoothing.h"
+#include "VoxelCore/InsightVoxelWalkable.h"
+
+#define LOCTEXT_NAMESPACE "InsightVoxelBuildJob"
+
+void FInsightVoxelSnapshot::UpdateCompactSpans(bool bCompactSpans)
+{
+	if (!bCompactSpans || !SolidSpans.BuildFromGrid(Grid))
+	{
+		SolidSpans = InsightVoxel::FVoxelSpanGrid();
+		WalkableSpans = InsightVoxel::FVoxelSpanGrid();
+		return;
+	}
+
+	InsightVoxel::BuildWalkableSpans(SolidSpans, WalkableSpans);
+}
+
+void FInsightVoxelSnapshot::UpdateCompactSpans(bool bCompactSpans, const InsightVoxel::FVoxelTile& Columns)
+{
+	// The walkable spans hold the voxels of WalkableGrid, which is already patched
+	if (!bCompactSpans || !SolidSpans.UpdateFromGrid(Grid, Columns) || !WalkableSpans.UpdateFromGrid(WalkableGrid, Columns))
+	{
+		SolidSpans = InsightVoxel::FVoxelSpanGrid();
+		WalkableSpans = InsightVoxel::FVoxelSpanGrid();
+	}
+}
+
+int64 FInsightVoxelSnapshot::GetAllocatedBytes() const
+{
+	return static_cast<int64>((Grid.GetWordNum() + WalkableGrid.GetWordNum()) * sizeof(uint64_t)
+		+ SolidSpans.GetAllocatedBytes() + WalkableSpans.GetAllocatedBytes() + PathHierarchy.GetAllocatedBytes()
+		+ Clearance.GetAllocatedBytes() + Components.GetAllocatedBytes());
+}
+
+bool FInsightVoxelSnapshot::FindPath(InsightVoxel::FPathSearch& Search, const FVector& StartPos, const FVector& EndPos,
+	InsightVoxel::EPathAlgorithm Algorithm, std::vector<InsightVoxel::FIntVec3>& OutPath, int32 MinClearance) const
+{
+	const InsightVoxel::FIntVec3 StartIdx = InsightVoxel::ProbeVoxel(Grid, ToVoxelVec(StartPos));
+	const InsightVoxel::FIntVec3 EndIdx = InsightVoxel::ProbeVoxel(Grid, ToVoxelVec(EndPos));
+
+	if (!Components.CanConnect(StartIdx, EndIdx))
+	{
+		return false;
+	}
+
+	// The spans carry no clearance, the filter needs the bitset the field is indexed by
+	if (MinClearance > 0 && Clearance.IsBuilt())
+	{
+		return Search.FindPath(WalkableGrid, Clearance, MinClearance, StartIdx, EndIdx, Algorithm, OutPath);
+	}
+
+	return WalkableSpans.GetXNum() > 0
+		? Search.FindPath(WalkableSpans, StartIdx, EndIdx, Algorithm, OutPath)
+		: Search.FindPath(WalkableGrid, StartIdx, EndIdx, Algorithm, OutPath);
+}
+
+bool FInsightVoxelSnapshot::FindPathHierarchical(InsightVoxel::FHierarchySearch& Search, const FVector& StartPos, const FVector& EndPos,
+	std::vector<InsightVoxel::FIntVec3>& OutPath) const
+{
+	if (!PathHierarchy.IsBuilt())
+	{
+		return false;
+	}
+
+	const InsightVoxel::FIntVec3 StartIdx = InsightVoxel::ProbeVoxel(Grid, ToVoxelVec(StartPos));
+	const InsightVoxel::FIntVec3 EndIdx = InsightVoxel::ProbeVoxel(Grid, ToVoxelVec(EndPos));
+	if (!Components.CanConnect(StartIdx, EndIdx))
+	{
+		return false;
+	}
+	return Search.FindPath(PathHierarchy, WalkableGrid, StartIdx, EndIdx, OutPath);
+}
+
+void FInsightVoxelSnapshot::SmoothPath(const std::vector<InsightVoxel::FIntVec3>& Path, std::vector<InsightVoxel::FIntVec3>& OutWaypoints,
+	int32 MinClearance) const
+{
+	const bool bClearance = MinClearance > 0 && Clearance.IsBuilt();
+	InsightVoxel::SmoothPath(WalkableGrid, Path, OutWaypoints, bClearance ? &Clearance : nullptr, MinClearance);
+}
+
+void FInsightVoxelSnapshot::FindPathBatch(InsightVoxel::FPathSearchPool& Pool, const TArray<FVector>& StartPositions,
+	const TArray<FVector>& GoalPositions, const InsightVoxel::FPathBatchSettings& Settings, InsightVoxel::FPathBatchResult& OutResult) const
+{
+	check(StartPositions.Num() == GoalPositions.Num());
+
+	std::vector<InsightVoxel::FPathQuery> Queries(StartPositions.Num());
+	for (int32 i = 0; i < StartPositions.Num(); ++i)
+	{
+		Queries[i].Start = InsightVoxel::ProbeVoxel(Grid, ToVoxelVec(StartPositions[i]));
+		Queries[i].Goal = InsightVoxel::ProbeVoxel(Grid, ToVoxelVec(GoalPositions[i]));
+		if (!Components.CanConnect(Queries[i].Start, Queries[i].Goal))
+		{
+			Queries[i].Goal = InsightVoxel::FIntVec3::Invalid();
+		}
+	}
+
+	// As in FindPath, the clearance filter needs the bitset the field is indexed by
+	InsightVoxel::FPathBatchSettings BatchSettings = Settings;
+	BatchSettings.Clearance = BatchSettings.MinClearance > 0 && Clearance.IsBuilt() ? &Clearance : nullptr;
+	if (WalkableSpans.GetXNum() > 0 && !BatchSettings.Clearance)
+	{
+		InsightVoxel::FindPathBatch(WalkableSpans, Queries.data(), StartPositions.Num(), BatchSettings, Pool, InsightParallelFor, OutResult);
+	}
+	else
+	{
+		InsightVoxel::FindPathBatch(WalkableGrid, Queries.data(), StartPositions.Num(), BatchSettings, Pool, InsightParallelFor, OutResult);
+	}
+}
+
+FInsightVoxelBuildJob::FInsightVoxelBuildJob(const FInsightVoxelBuildSettings& InSettings,
+	const TSharedRef<FInsightGeometryCache, ESPMode::ThreadSafe>& InGeometryCache)
+	: Settings(InSettings)
+	, GeometryCache(InGeometryCache)
+{
+}
+
+void FInsightVoxelBuildJob::Run()
+{
+	FInsightGeometryCache& Cache = *GeometryCache;
+
+	// Export: collision of body setups not seen before, in parallel
+	Stage = EStage::Export;
+	{
+		NAVINSIGHT_SCOPE(STAT_NavInsight_Export);
+		FScopedDurationTimer Timer(Stats.ExportSeconds);
+		Cache.PrepareBuild(InsightParallelFor);
+	}
+	GeometryCacheHits = Cache.GetHitNum();
+	GeometryCacheMisses = Cache.GetMissNum();
+	EntryNum = Cache.GetBuildEntryNum();
+	if (bCancelled)
+	{
+		return;
+	}
+
+	Snapshot = MakeShared<FInsightVoxelSnapshot, ESPMode::ThreadSafe>();
+	InsightVoxel::FVoxelGrid& Grid = Snapshot->Grid;
+	Grid.Init(Settings.Bounds, Settings.CellSize, Settings.CellHeight);
+
+	// The cache maps the grid of an earlier build of the same meshes instead of rasterizing them again. The key
+	// is taken from the gathered body setups and transforms, so it is known before anything is transformed.
+	const uint64_t GeometryHash = Cache.GetBuildHash();
+	const std::string CachePath = TCHAR_TO_UTF8(*Settings.CachePath);
+	bLoadedFromCache = !Settings.CachePath.IsEmpty()
+		&& InsightVoxel::LoadVoxelCache(CachePath, GeometryHash, Grid.GetBounds(), Grid.GetCellSize(), Grid.GetCellHeight(), Grid);
+
+	// Bricks of the sparse rasterization, read by the walkable stage
+	InsightVoxel::FSparseVoxelGrid SparseGrid;
+	const bool bSparse = Settings.bSparseRasterization && !bLoadedFromCache;
+
+	if (!bLoadedFromCache)
+	{
+		Stage = EStage::Rasterize;
+		{
+			NAVINSIGHT_SCOPE(STAT_NavInsight_Rasterize);
+			FScopedDurationTimer Timer(Stats.RasterizeSeconds);
+			if (bSparse)
+			{
+				SparseGrid.Init(Grid.GetBounds(), Grid.GetCellSize(), Grid.GetCellHeight());
+				RasterizeSparse(SparseGrid);
+				SparseGrid.WriteToDense(Grid);
+				Stats.SparseBytes = static_cast<int64>(SparseGrid.GetAllocatedBytes());
+			}
+			else
+			{
+				Rasterize(Grid);
+			}
+		}
+
+		// A partial grid must not end up in the cache
+		if (bCancelled)
+		{
+			return;
+		}
+
+		if (!Settings.CachePath.IsEmpty())
+		{
+			IFileManager::Get().MakeDirectory(*FPaths::GetPath(Settings.CachePath), true);
+			InsightVoxel::SaveVoxelCache(CachePath, Grid, GeometryHash);
+		}
+	}
+
+	// Path queries read the stayable bit only
+	Stage = EStage::Walkable;
+	{
+		NAVINSIGHT_SCOPE(STAT_NavInsight_Walkable);
+		FScopedDurationTimer Timer(Stats.WalkableSeconds);
+		if (bSparse)
+		{
+			// Only the blocks next to a brick are visited
+			InsightVoxel::BuildWalkableMask(SparseGrid, Snapshot->WalkableGrid, InsightParallelFor);
+			SparseGrid = InsightVoxel::FSparseVoxelGrid();
+		}
+		else
+		{
+			InsightVoxel::BuildWalkableMask(Grid, Snapshot->WalkableGrid, InsightParallelFor);
+		}
+	}
+	if (bCancelled)
+	{
+		return;
+	}
+
+	Stage = EStage::Components;
+	{
+		NAVINSIGHT_SCOPE(STAT_NavInsight_Components);
+		FScopedDurationTimer Timer(Stats.ComponentsSeconds);
+		Snapshot->Components.Build(Snapshot->WalkableGrid, Settings.ComponentBandColumns, InsightParallelFor);
+	}
+	if (bCancelled)
+	{
+		return;
+	}
+
+	Stage = EStage::Spans;
+	{
+		NAVINSIGHT_SCOPE(STAT_NavInsight_Spans);
+		FScopedDurationTimer Timer(Stats.SpansSeconds);
+		Snapshot->UpdateCompactSpans(Settings.bCompactSpans);
+	}
+	if (bCancelled)
+	{
+		return;
+	}
+
+	if (Settings.PathClusterColumns > 0)
+	{
+		Stage = EStage::Hierarchy;
+		NAVINSIGHT_SCOPE(STAT_NavInsight_Hierarchy);
+		FScopedDurationTimer Timer(Stats.HierarchySeconds);
+		Snapshot->PathHierarchy.Build(Snapshot->WalkableGrid, Settings.PathClusterColumns, InsightParallelFor);
+	}
+	if (bCancelled)
+	{
+		return;
+	}
+
+	if (Settings.ClearanceBodyLayers > 0)
+	{
+		Stage = EStage::Clearance;
+		NAVINSIGHT_SCOPE(STAT_NavInsight_Clearance);
+		FScopedDurationTimer Timer(Stats.ClearanceSeconds);
+		Snapshot->Clearance.Build(Grid, Snapshot->WalkableGrid, Settings.ClearanceBodyLayers, Settings.MaxClearance, InsightParallelFor);
+	}
+
+	Stats.GridBytes = static_cast<int64>(Grid.GetWordNum() * sizeof(uint64_t));
+	Stats.WalkableBytes = static_cast<int64>(Snapshot->WalkableGrid.GetWordNum() * sizeof(uint64_t));
+	Stats.ComponentsBytes = static_cast<int64>(Snapshot->Components.GetAllocatedBytes());
+	Stats.SpanBytes = static_cast<int64>(Snapshot->SolidSpans.GetAllocatedBytes() + Snapshot->WalkableSpans.GetAllocatedBytes());
+	Stats.HierarchyBytes = static_cast<int64>(Snapshot->PathHierarchy.GetAllocatedBytes());
+	Stats.ClearanceBytes = static_cast<int64>(Snapshot->Clearance.GetAllocatedBytes());
+
+	Stage = EStage::Done;
+}
+
+void FInsightVoxelBuildJob::Rasterize(InsightVoxel::FVoxelGrid& Grid)
+{
+	FInsightGeometryCache& Cache = *GeometryCache;
+
+	if (Settings.bPipelinedBuild)
+	{
+		// Transform on worker threads, rasterize each mesh as it comes out of the queue
+		InsightVoxel::RasterizePipelined(Grid, Cache.GetBuildEntryNum(),
+			[this, &Cache](int Index, InsightVoxel::FTriangleBatch& OutBatch)
+			{
+				if (bCancelled)
+				{
+					return false;
+				}
+
+				const FInsightGeometryView View = Cache.GetBuildEntry(Index);
+				OutBatch.Verts = reinterpret_cast<const float*>(View.Vertices);
+				OutBatch.NumVerts = View.VertexNum;
+				OutBatch.Indices = View.Indices;
+				OutBatch.NumTris = View.IndexNum / 3;
+				OutBatch.Bvh = View.Bvh;
+				++ExportedEntryNum;
+				return OutBatch.NumTris > 0;
+			},
+			InsightParallelFor, 64, &Stats.Raster);
+		return;
+	}
+
+	FInsightGeometryExport SceneGeo;
+	std::vector<int32_t> BvhTris;
+	for (int32 Index = 0; Index < Cache.GetBuildEntryNum() && !bCancelled; ++Index)
+	{
+		const FInsightGeometryView View = Cache.GetBuildEntry(Index);
+		const int32 IndexOffset = SceneGeo.VertexBuffer.Num();
+		SceneGeo.VertexBuffer.Append(View.Vertices, View.VertexNum);
+		++ExportedEntryNum;
+
+		// Large meshes only contribute the triangles their BVH finds inside the grid
+		if (View.Bvh)
+		{
+			BvhTris.clear();
+			View.Bvh->QueryBox(Grid.GetBounds(), BvhTris);
+			const int64 BvhCulled = View.IndexNum / 3 - static_cast<int64>(BvhTris.size());
+			Stats.Raster.TrianglesSubmitted += BvhCulled;
+			Stats.Raster.TrianglesCulled += BvhCulled;
+			SceneGeo.IndexBuffer.Reserve(SceneGeo.IndexBuffer.Num() + static_cast<int32>(BvhTris.size()) * 3);
+			for (const int32_t Tri : BvhTris)
+			{
+				SceneGeo.IndexBuffer.Add(View.Indices[Tri * 3 + 0] + IndexOffset);
+				SceneGeo.IndexBuffer.Add(View.Indices[Tri * 3 + 1] + IndexOffset);
+				SceneGeo.IndexBuffer.Add(View.Indices[Tri * 3 + 2] + IndexOffset);
+			}
+			continue;
+		}
+
+		SceneGeo.IndexBuffer.Reserve(SceneGeo.IndexBuffer.Num() + View.IndexNum);
+		for (int32 i = 0; i < View.IndexNum; ++i)
+		{
+			SceneGeo.IndexBuffer.Add(View.Indices[i] + IndexOffset);
+		}
+	}
+
+	if (bCancelled)
+	{
+		return;
+	}
+
+	const float* Verts = reinterpret_cast<const float*>(SceneGeo.VertexBuffer.GetData());
+	const int NumVerts = SceneGeo.VertexBuffer.Num();
+	const int NumTris = SceneGeo.IndexBuffer.Num() / 3;
+
+	if (Settings.bParallelRasterization)
+	{
+		InsightVoxel::FVoxelTiling Tiling;
+		Tiling.Init(Grid.GetXNum(), Grid.GetYNum(), Grid.GetXNum(), Settings.RasterBandRows);
+
+		InsightVoxel::RasterizeTrianglesTiled(Grid, Verts, NumVerts, SceneGeo.IndexBuffer.GetData(), NumTris, Tiling, InsightParallelFor, &Stats.Raster);
+	}
+	else
+	{
+		InsightVoxel::RasterizeTriangles(Grid, Verts, NumVerts, SceneGeo.IndexBuffer.GetData(), NumTris, &Stats.Raster);
+	}
+}
+
+void FInsightVoxelBuildJob::RasterizeSparse(InsightVoxel::FSparseVoxelGrid& SparseGrid)
+{
+	FInsightGeometryCache& Cache = *GeometryCache;
+
+	// Bricks are allocated while writing, so the meshes go in one after the other
+	std::vector<int32_t> BvhTris;
+	std::vector<int32_t> BvhIndices;
+	for (int32 Index = 0; Index < Cache.GetBuildEntryNum() && !bCancelled; ++Index)
+	{
+		const FInsightGeometryView View = Cache.GetBuildEntry(Index);
+		const float* Verts = reinterpret_cast<const float*>(View.Vertices);
+		++ExportedEntryNum;
+
+		// Large meshes only contribute the triangles their BVH finds inside the grid
+		if (View.Bvh)
+		{
+			BvhTris.clear();
+			View.Bvh->QueryBox(SparseGrid.GetBounds(), BvhTris);
+			const int64 BvhCulled = View.IndexNum / 3 - static_cast<int64>(BvhTris.size());
+			Stats.Raster.TrianglesSubmitted += BvhCulled;
+			Stats.Raster.TrianglesCulled += BvhCulled;
+			BvhIndices.resize(BvhTris.size() * 3);
+			for (size_t i = 0; i < BvhTris.size(); ++i)
+			{
+				BvhIndices[i * 3 + 0] = View.Indices[BvhTris[i] * 3 + 0];
+				BvhIndices[i * 3 + 1] = View.Indices[BvhTris[i] * 3 + 1];
+				BvhIndices[i * 3 + 2] = View.Indices[BvhTris[i] * 3 + 2];
+			}
+			InsightVoxel::RasterizeTriangles(SparseGrid, Verts, View.VertexNum, BvhIndices.data(), static_cast<int>(BvhTris.size()), &Stats.Raster);
+			continue;
+		}
+
+		InsightVoxel::RasterizeTriangles(SparseGrid, Verts, View.VertexNum, View.Indices, View.IndexNum / 3, &Stats.Raster);
+	}
+}
+
+FText FInsightVoxelBuildJob::GetProgressText() const
+{
+	switch (Stage.load())
+	{
+	case EStage::Export:
+		return LOCTEXT("Export", "Voxelizing: exporting collision");
+	case EStage::Rasterize:
+		return FText::Format(LOCTEXT("Rasterize", "Voxelizing: rasterized {0} / {1} meshes"),
+			FText::AsNumber(ExportedEntryNum.load()), FText::AsNumber(EntryNum.load()));
+	case EStage::Walkable:
+		return LOCTEXT("Walkable", "Voxelizing: finding walkable voxels");
+	case EStage::Components:
+		return LOCTEXT("Components", "Voxelizing: labelling connected regions");
+	case EStage::Spans:
+		return LOCTEXT("Spans", "Voxelizing: compacting spans");
+	case EStage::Hierarchy:
+		return LOCTEXT("Hierarchy", "Voxelizing: building the path hierarchy");
+	case EStage::Clearance:
+		return LOCTEXT("Clearance", "Voxelizing: computing clearance");
+	default:
+		return LOCTEXT("Done", "Voxelization done");
+	}
+}
+
+#undef LOCTEXT_NAMESPACE
@@ -2,19 +2,41 @@
 
 #include "InsightVoxelSpace.h"
 #include "EngineUtils.h"
+#include "Engine/Engine.h"
 #include "Engine/StaticMesh.h"
 #include "NavMesh/RecastNavMeshGenerator.h"
 #include "Navmesh/Public/Recast/Recast.h"
 #include "NavMesh/RecastHelpers.h"
 #include "DrawDebugHelpers.h"
-#include "Algo/Reverse.h"
+#include "Async/Async.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "Misc/Paths.h"
+#include "NavInsightStats.h"
+#include "UObject/ConstructorHelpers.h"
+#include "VoxelCore/InsightVoxelPathFinder.h"
+#include "VoxelCore/InsightVoxelRasterizer.h"
+#include "VoxelCore/InsightVoxelSurface.h"
+#include "VoxelCore/InsightVoxelWalkable.h"
+#if WITH_EDITOR
+#include "Framework/Notifications/NotificationManager.h"
+#include "Widgets/Notifications/SNotificationList.h"
+#endif
+
+#define LOCTEXT_NAMESPACE "InsightVoxelSpace"
+
+static_assert(sizeof(FVector) == sizeof(float) * 3, "Vertex buffers are handed to the voxel core as packed float triples");
 
 // Sets default values
 AInsightVoxelSpace::AInsightVoxelSpace()
+	: GeometryCache(MakeShared<FInsightGeometryCache, ESPMode::ThreadSafe>())
+	, PathSearchPool(MakeShared<InsightVoxel::FPathSearchPool, ESPMode::ThreadSafe>())
+	, HierarchySearchPool(MakeShared<InsightVoxel::FHierarchySearchPool, ESPMode::ThreadSafe>())
 {
  	// Set this actor to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
 	PrimaryActorTick.bCanEverTick = true;
 
+	static ConstructorHelpers::FObjectFinder<UStaticMesh> CubeMesh(TEXT("/Engine/BasicShapes/Cube.Cube"));
+	VoxelMesh = CubeMesh.Object;
 }
 
 // Called when the game starts or when spawned
@@ -31,168 +53,108 @@ void AInsightVoxelSpace::Tick(float DeltaTime)
 
 }
 
-struct FInsightGeometryExport
+void AInsightVoxelSpace::BeginDestroy()
 {
-	TNavStatArray<FVector> VertexBuffer;
-	TNavStatArray<int32> IndexBuffer;
-};
+	UnregisterLevelEvents();
 
-void ExportComponentGeo(UActorComponent* Component, FInsightGeometryExport& GeomExport)
-{
-	UPrimitiveComponent* PrimComp = Cast<UPrimitiveComponent>(Component);
-	if (PrimComp && PrimComp->IsNavigationRelevant())
+	// The build reads body setups only this actor keeps alive
+	if (BuildJob)
 	{
-
-		UBodySetup* BodySetup = PrimComp->GetBodySetup();
-		if (BodySetup)
-		{
-			FRecastNavMeshGenerator::ExportRigidBodyGeometry(*BodySetup, GeomExport.VertexBuffer, GeomExport.IndexBuffer, PrimComp->GetComponentTransform());
-		}
+		BuildJob->Cancel();
+		BuildTask.Wait();
 	}
+
+	Super::BeginDestroy();
 }
 
-void AInsightVoxelSpace::InitializeVoxelSpace()
+// Navigation relevant primitive components of Actor with collision overlapping the grid, and the union of their bounds
+static bool GatherActorComponents(AActor* Actor, const InsightVoxel::FBounds3& GridBounds, TArray<UPrimitiveComponent*>& OutComponents,
+	FBox& OutBounds)
 {
-	VoxelBBox = GetBounds().GetBox();
+	OutComponents.Reset();
+	OutBounds.Init();
 
-	VoxelXNum = static_cast<int>(
-		(VoxelBBox.Max.X - VoxelBBox.Min.X) / CellSize + 0.5f
-	);
-	VoxelYNum = static_cast<int>(
-		(VoxelBBox.Max.Y - VoxelBBox.Min.Y) / CellSize + 0.5f
-	);
-	VoxelZNum = static_cast<int>(
-		(VoxelBBox.Max.Z - VoxelBBox.Min.Z) / CellHeight + 0.5f
-	);
-
-	const int VoxelNum = VoxelXNum * VoxelYNum * VoxelZNum;
-	const int ArrSize = static_cast<int>(0.5f + VoxelNum / 8) + 1; // safe margin 
-	
-	VoxelsOccupied.SetNum(ArrSize, true);
-
-	for (int i = 0; i < ArrSize; ++i)
+	TInlineComponentArray<UPrimitiveComponent*> Components;
+	Actor->GetComponents(Components);
+	for (UPrimitiveComponent* Comp : Components)
 	{
-		VoxelsOccupied[i] = 0;
+		if (!Comp->IsRegistered() || !Comp->IsNavigationRelevant() || !Comp->GetBodySetup())
+		{
+			continue;
+		}
+
+		const FBox Bounds = Comp->GetNavigationBounds();
+		if (ToVoxelBounds(Bounds).Intersect(GridBounds))
+		{
+			OutComponents.Add(Comp);
+			OutBounds += Bounds;
+		}
 	}
-	
 
-	FlushPersistentDebugLines(GetWorld());
+	return OutComponents.Num() > 0;
 }
 
-void AInsightVoxelSpace::SetVoxelOccupied(int X, int Y, int Z, bool Flag)
+// World-space geometry of every component of Actor overlapping the grid
+static bool ExportActorGeo(AActor* Actor, const InsightVoxel::FVoxelGrid& Grid, FInsightGeometryCache& GeometryCache,
+	TArray<FInsightGeometryView>& OutGeos, FBox& OutBounds)
 {
-	const int NumBit = X * VoxelYNum * VoxelZNum + Y * VoxelZNum + Z;
-	const int NumByte = NumBit / 8;
-	const int NumBitLeftOver = NumBit - NumByte * 8;
+	OutGeos.Reset();
 
-	if (Flag)
+	TArray<UPrimitiveComponent*> Components;
+	if (!GatherActorComponents(Actor, Grid.GetBounds(), Components, OutBounds))
 	{
-		VoxelsOccupied[NumByte] = VoxelsOccupied[NumByte] | (0x1 << NumBitLeftOver);
-	}
-	else {
-		VoxelsOccupied[NumByte] = VoxelsOccupied[NumByte] & ~(0x1 << NumBitLeftOver);
+		return false;
 	}
-}
-
-bool AInsightVoxelSpace::GetVoxelOccupied(int X, int Y, int Z)
-{
-	const int NumBit = X * VoxelYNum * VoxelZNum + Y * VoxelZNum + Z;
-	const int NumByte = NumBit / 8;
-	const int NumBitLeftOver = NumBit - NumByte * 8;
 
-	return (VoxelsOccupied[NumByte] >> NumBitLeftOver) & 0x1;
+	for (UPrimitiveComponent* Comp : Components)
+	{
+		const FInsightGeometryView View = GeometryCache.GetComponentGeo(Comp);
+		if (View.IndexNum > 0)
+		{
+			OutGeos.Add(View);
+		}
+	}
+	return OutGeos.Num() > 0;
 }
 
-bool AInsightVoxelSpace::IsVoxelInside(int X, int Y, int Z)
+// Rasterize the part of Geo inside Tile, through its BVH when it has one
+static void RasterizeGeoView(InsightVoxel::FVoxelGrid& Grid, const FInsightGeometryView& Geo, const InsightVoxel::FVoxelTile& Tile)
 {
-	if (X < 0 || X >= VoxelXNum)
+	const float* Verts = reinterpret_cast<const float*>(Geo.Vertices);
+	if (Geo.Bvh)
 	{
-		return false;
+		InsightVoxel::RasterizeTriangles(Grid, Verts, Geo.VertexNum, Geo.Indices, *Geo.Bvh, Tile);
 	}
-	if (Y < 0 || Y >= VoxelYNum)
+	else
 	{
-		return false;
+		InsightVoxel::RasterizeTriangles(Grid, Verts, Geo.VertexNum, Geo.Indices, Geo.IndexNum / 3, Tile);
 	}
-	if (Z < 0 || Z >= VoxelZNum)
-	{
-		return false;
-	}
-
-	return true;
 }
 
-
-static void DividePoly(FVector* InPoly, int NIn,
-					  FVector* OutPolyLeft, int& NOutLeft,
-					  FVector* OutPolyRight, int& NOutRight,
-					  float X, int Axis)
+void AInsightVoxelSpace::InitializeVoxelSpace()
 {
-	// max poly edge (corner): 1 * 2 (axis-aligned) + 2 * 3 (triangle edge intersect.) + 4
-	float Diff[12];
-	for (int i = 0; i < NIn; ++i)
+	const InsightVoxel::FVoxelGrid& Grid = Snapshot->Grid;
+
+	// Chunk components are kept as long as the chunk layout does not change
+	const int OldChunkNum = RenderChunks.GetTileNum();
+	const int OldTilesX = RenderChunks.GetTilesX();
+	const int OldTileX = RenderChunks.GetTileX();
+	RenderChunks.Init(Grid.GetXNum(), Grid.GetYNum(), RenderChunkColumns, RenderChunkColumns);
+	if (RenderChunks.GetTileNum() != OldChunkNum || RenderChunks.GetTilesX() != OldTilesX || RenderChunks.GetTileX() != OldTileX)
 	{
-		Diff[i] = X - InPoly[i][Axis];
+		DestroyRenderChunks();
 	}
+	VoxelChunkComponents.SetNumZeroed(RenderChunks.GetTileNum());
+	WalkableChunkComponents.SetNumZeroed(RenderChunks.GetTileNum());
+	DirtyRenderChunks.Init(false, RenderChunks.GetTileNum());
 
-	NOutLeft = 0;
-	NOutRight = 0;
-
-	// Iterate over all vertex indexed by I
-	int IIdxPrev = NIn - 1;
-	for (int IIdx = 0; IIdx < NIn; ++IIdx)
-	{
-		// Current line seg. is <I-, I>
-		const bool bLeftIPrev = Diff[IIdxPrev] >= 0;
-		const bool bLeftI = Diff[IIdx] >= 0;
-		// I-, I is at separate line different side
-		if (bLeftI != bLeftIPrev)
-		{
-			// Compute <I-, I> intersection point with X-axis by linear interpolation
-			// Add intersection point to Left & Right Polygon
-			/*if (Diff[IIdxPrev] - Diff[IIdx] < 1e-3)
-			{
-				OutPolyLeft[NOutLeft++] = (InPoly[IIdx] + InPoly[IIdxPrev]) / 2;
-				OutPolyRight[NOutRight++] = OutPolyLeft[NOutLeft - 1];
-			} else {*/
-			float s = Diff[IIdxPrev] / (Diff[IIdxPrev] - Diff[IIdx]);
-			OutPolyLeft[NOutLeft++] = InPoly[IIdxPrev] + (InPoly[IIdx] - InPoly[IIdxPrev]) * s;
-			OutPolyRight[NOutRight++] = OutPolyLeft[NOutLeft - 1];
-			//}
-
-
-			// Add I to corresponding left / right polygon if exactly falls in LHS / RHS
-			if (Diff[IIdx] > 0)
-			{
-				OutPolyLeft[NOutLeft++] = InPoly[IIdx];
-			} else if (Diff[IIdx] < 0)
-			{
-				OutPolyRight[NOutRight++] = InPoly[IIdx];
-			}
-			
-		} else {
-			// <I-, I> are both at LHS or RHS of axis
-			// At I to corresponding polygon
-			
-			if (bLeftI)
-			{
-				// I is at LHS (I- is also at LHS, which is supposed to be added when visiting it)
-				OutPolyLeft[NOutLeft++] = InPoly[IIdx];
-				
-				// Exactly on the axis (add to both polygon)
-				if (Diff[IIdx] != 0)
-				{
-					IIdxPrev = IIdx;
-					continue;
-				}
-			}
+	VoxelizedActors.Reset();
+	ChunkActors.Reset();
+	ChunkActors.SetNum(RenderChunks.GetTileNum());
 
-			// I is at RHS or exactly on the edge
-			OutPolyRight[NOutRight++] = InPoly[IIdx];
-		}
-		
-		IIdxPrev = IIdx;
-	}
+	FlushPersistentDebugLines(GetWorld());
 }
+
 /*template<class T> inline void MySwap(T& a, T& b) { T t = a; a = b; b = t; }*/
 
 void DrawDebugPoly(UWorld* World, FVector* Verts, int N)
@@ -212,193 +174,402 @@ void DrawDebugPoly(UWorld* World, FVector* Verts, int N)
 	}
 }
 
-void AInsightVoxelSpace::RasterizeTriangle(FVector A, FVector B, FVector C)
+void AInsightVoxelSpace::VoxelizeInBox()
 {
-	FBox TrBBox;
-	TrBBox.Min = C.ComponentMin(A.ComponentMin(B));
-	TrBBox.Max = C.ComponentMax(A.ComponentMax(B));
-
-	if (!TrBBox.Intersect(VoxelBBox))
+	// The running build was gathered from an older level; it is stopped and started over once it has wound down
+	if (BuildJob)
 	{
+		BuildJob->Cancel();
+		bRebuildRequested = true;
 		return;
 	}
-	// Get voxel Y index
-	int Y0 = FMath::FloorToInt((TrBBox.Min[1] - VoxelBBox.Min[1]) / CellSize);
-	int Y1 = FMath::CeilToInt((TrBBox.Max[1] - VoxelBBox.Min[1]) / CellSize);
-	Y0 = FMath::Clamp(Y0, 0, VoxelYNum - 1);
-	Y1 = FMath::Clamp(Y1, 0, VoxelYNum - 1);
 
-	// Clip the triangle into all grid cells it touches.
-	// Initialize four polygon positions (<= 7 corners)
-	FVector Buf[7 * 4];
-	
-	FVector* In     = Buf;
-	FVector* InRow  = In + 7;
-	FVector* P1     = InRow + 7;
-	FVector* P2     = P1 + 7;
+	StartBuild();
+}
+
+void AInsightVoxelSpace::StartBuild()
+{
+	FInsightVoxelBuildSettings Settings;
+	Settings.Bounds = ToVoxelBounds(GetBounds().GetBox());
+	Settings.CellSize = CellSize;
+	Settings.CellHeight = CellHeight;
+	Settings.bPipelinedBuild = bPipelinedBuild;
+	Settings.bParallelRasterization = bParallelRasterization;
+	Settings.bSparseRasterization = bSparseRasterization;
+	Settings.RasterBandRows = RasterBandRows;
+	Settings.bCompactSpans = bCompactSpans;
+	Settings.PathClusterColumns = bPathHierarchy ? PathClusterColumns : 0;
+	Settings.ClearanceBodyLayers = bClearance ? ClearanceBodyLayers : 0;
+	Settings.MaxClearance = MaxClearanceCells;
+	if (bUseVoxelCache)
+	{
+		Settings.CachePath = GetVoxelCachePath();
+	}
 
-	In[0] = A;
-	In[1] = B;
-	In[2] = C;
+	const TSharedRef<FInsightVoxelBuildJob, ESPMode::ThreadSafe> Job =
+		MakeShared<FInsightVoxelBuildJob, ESPMode::ThreadSafe>(Settings, GeometryCache);
 
-	int NRow = 3;
-	int NIn = 3;
+	// Gather: snapshot the relevant components of every actor on the game thread
+	GeometryCache->BeginBuild();
 
-	// Cut along Y-Axis into Rows
-	for (int Y = Y0; Y <= Y1; ++Y)
+	TArray<UPrimitiveComponent*> Components;
+	TSet<UObject*> BodySetups;
+	for (TActorIterator<AActor> ActorItr(GetWorld()); ActorItr; ++ActorItr)
 	{
-		// Clip polygon to row. Store the remaining polygon as well
-		const float ClipY = VoxelBBox.Min.Y + Y * CellSize;
 
-		DividePoly(In, NIn, InRow, NRow, P1, NIn, ClipY, 1);
-		Swap(In, P1);
+		if (*ActorItr == this || *ActorItr == StartPoint || *ActorItr == EndPoint)
+		{
+			continue;
+		}
 
- 		if (NRow < 3)
+		FBox BBoxGeo;
+		if (!GatherActorComponents(*ActorItr, Settings.Bounds, Components, BBoxGeo))
 		{
-			// Nothing left
 			continue;
 		}
 
-		float MinX = InRow[0].X;
-		float MaxX = InRow[0].X;
-		for (int i = 0; i < NRow; ++i)
+		Job->GatheredActors.Emplace(*ActorItr, BBoxGeo);
+		for (UPrimitiveComponent* Comp : Components)
 		{
-			if (MinX > InRow[i].X) MinX = InRow[i].X;
-			if (MaxX < InRow[i].X) MaxX = InRow[i].X;
+			GeometryCache->AddBuildComponent(Comp);
+			BodySetups.Add(Comp->GetBodySetup());
 		}
+	}
+	BuildReferences = BodySetups.Array();
 
-		int X0 = FMath::FloorToInt((MinX - VoxelBBox.Min.X) / CellSize);
-		int X1 = FMath::CeilToInt((MaxX - VoxelBBox.Min.X) / CellSize);
-		X0 = FMath::Clamp(X0, 0, VoxelXNum - 1);
-		X1 = FMath::Clamp(X1, 0, VoxelXNum - 1);
+	BuildJob = Job;
 
-		int N, N2 = NRow;
+	TWeakObjectPtr<AInsightVoxelSpace> WeakThis(this);
+	BuildTask = Async(EAsyncExecution::ThreadPool, [Job, WeakThis]()
+	{
+		Job->Run();
 
-		for (int X = X0; X <= X1; ++X)
+		AsyncTask(ENamedThreads::GameThread, [Job, WeakThis]()
 		{
-			const float CX = VoxelBBox.Min.X + X * CellSize;
-			DividePoly(InRow, N2, // cut the row polygon (align with z) along the x-axis
-				P1, N, 
-				P2, N2, 
-				CX + CellSize, 
-				0
-			);
-			Swap(InRow, P2);
-			if (N < 3) continue;
-
-			// Calculate min and max of the span.
-			//   Remark: the height
-			float smin = P1[0].Z, smax = P1[0].Z;
-			for (int i = 1; i < N; ++i)
+			if (AInsightVoxelSpace* Space = WeakThis.Get())
 			{
-				smin = FMath::Min(smin, P1[i].Z);
-				smax = FMath::Max(smax, P1[i].Z);
+				Space->OnBuildFinished(Job);
 			}
+		});
+	});
+
+#if WITH_EDITOR
+	FNotificationInfo Info(TAttribute<FText>::Create(TAttribute<FText>::FGetter::CreateSP(Job, &FInsightVoxelBuildJob::GetProgressText)));
+	Info.bFireAndForget = false;
+	Info.bUseThrobber = true;
+	Info.ExpireDuration = 2.0f;
+	Info.ButtonDetails.Emplace(LOCTEXT("CancelBuild", "Cancel"), LOCTEXT("CancelBuildTooltip", "Stop the build and keep the current voxels"),
+		FSimpleDelegate::CreateSP(Job, &FInsightVoxelBuildJob::Cancel), SNotificationItem::CS_Pending);
+
+	BuildNotification = FSlateNotificationManager::Get().AddNotification(Info);
+	if (BuildNotification.IsValid())
+	{
+		BuildNotification->SetCompletionState(SNotificationItem::CS_Pending);
+	}
+#endif
+}
 
-			// Skip the span if it is outside the bbox
-			if (smax < VoxelBBox.Min.Z) continue;
-			if (smin > VoxelBBox.Max.Z) continue;
-			// Clamp the span to the bbox.
-			if (smin < VoxelBBox.Min.Z) smin = VoxelBBox.Min.Z;
-			if (smax > VoxelBBox.Max.Z) smax = VoxelBBox.Max.Z;
-
-			smin -= VoxelBBox.Min.Z;
-			smax -= VoxelBBox.Min.Z;
+void AInsightVoxelSpace::OnBuildFinished(const TSharedRef<FInsightVoxelBuildJob, ESPMode::ThreadSafe>& Job)
+{
+	check(BuildJob.Get() == &Job.Get());
+	BuildJob.Reset();
+	BuildTask.Reset();
 
-			const int ZMin = FMath::Clamp(FMath::FloorToInt(smin / CellHeight), 0, VoxelZNum - 1);
-			const int ZMax = FMath::Clamp(FMath::CeilToInt(smax / CellHeight), 0,  VoxelZNum - 1);
+	// Drops the exports of meshes that are gone or have moved
+	GeometryCache->EndBuild();
+	BuildReferences.Reset();
 
-			for (int Z = ZMin; Z < ZMax; ++Z)
+	const bool bPublished = !Job->IsCancelled() && Job->GetSnapshot().IsValid();
+	if (bPublished)
+	{
+		// Queries still running keep the previous snapshot until they are done
+		Snapshot = Job->GetSnapshot();
+		bLoadedFromCache = Job->WasLoadedFromCache();
+		GeometryCacheHits = Job->GetGeometryCacheHits();
+		GeometryCacheMisses = Job->GetGeometryCacheMisses();
+
+		LastBuildStats = Job->GetStats();
+		SET_DWORD_STAT(STAT_NavInsight_TrianglesSubmitted, LastBuildStats.Raster.TrianglesSubmitted);
+		SET_DWORD_STAT(STAT_NavInsight_TrianglesCulled, LastBuildStats.Raster.TrianglesCulled);
+		SET_DWORD_STAT(STAT_NavInsight_RowsClipped, LastBuildStats.Raster.RowsClipped);
+		SET_DWORD_STAT(STAT_NavInsight_VoxelsWritten, LastBuildStats.Raster.VoxelsWritten);
+		SET_MEMORY_STAT(STAT_NavInsight_SnapshotMemory, Snapshot->GetAllocatedBytes());
+
+		InitializeVoxelSpace();
+		for (const TPair<TWeakObjectPtr<AActor>, FBox>& Gathered : Job->GatheredActors)
+		{
+			if (AActor* Actor = Gathered.Key.Get())
 			{
-				SetVoxelOccupied(X, Y, Z, true);
+				RecordVoxelizedActor(Actor, Gathered.Value);
 			}
 		}
+
+		MarkRenderChunksDirty({0, 0, Snapshot->Grid.GetXNum(), Snapshot->Grid.GetYNum()});
+		VisualizeVoxelSpace();
+
+		UnregisterLevelEvents();
+		if (bIncrementalUpdates)
+		{
+			RegisterLevelEvents();
+		}
 	}
-}
 
-void AInsightVoxelSpace::VoxelizeInBox()
-{
-	InitializeVoxelSpace();
+#if WITH_EDITOR
+	if (BuildNotification.IsValid())
+	{
+		BuildNotification->SetText(bPublished ? LOCTEXT("BuildDone", "Voxelization done") : LOCTEXT("BuildCancelled", "Voxelization cancelled"));
+		BuildNotification->SetCompletionState(bPublished ? SNotificationItem::CS_Success : SNotificationItem::CS_Fail);
+		BuildNotification->ExpireAndFadeout();
+		BuildNotification.Reset();
+	}
+#endif
 
-	for (TActorIterator<AActor> ActorItr(GetWorld()); ActorItr; ++ActorItr)
+	// A new gather sees every edit made meanwhile
+	if (bRebuildRequested)
 	{
+		bRebuildRequested = false;
+		PendingActorUpdates.Reset();
+		StartBuild();
+		return;
+	}
 
-		if (*ActorItr == StartPoint || *ActorItr == EndPoint)
+	// Edits made while the build ran were missed by its gather (or hit the old snapshot)
+	const TArray<TPair<TWeakObjectPtr<AActor>, bool>> Updates = MoveTemp(PendingActorUpdates);
+	PendingActorUpdates.Reset();
+	for (const TPair<TWeakObjectPtr<AActor>, bool>& Update : Updates)
+	{
+		AActor* Actor = Update.Key.Get(true);
+		if (!Actor)
 		{
+			// Deleted and already collected: its old bounds are not known, so build again
+			if (Update.Value)
+			{
+				StartBuild();
+				return;
+			}
 			continue;
 		}
+		RevoxelizeActor(Actor, Update.Value);
+	}
+}
 
-		// Get StaticMesh Component
-		UStaticMeshComponent* Comp = Cast<UStaticMeshComponent>(
-			ActorItr->GetComponentByClass(
-				UStaticMeshComponent::StaticClass()
-			)
-		);
+// Indices of the render chunks overlapping Columns
+static void GetChunksInRect(const InsightVoxel::FVoxelTiling& Chunks, const InsightVoxel::FVoxelTile& Columns, TArray<int32>& OutChunks)
+{
+	OutChunks.Reset();
+	if (Columns.IsEmpty())
+	{
+		return;
+	}
 
-		if (!Comp)
+	for (int TY = Columns.Y0 / Chunks.GetTileY(); TY <= (Columns.Y1 - 1) / Chunks.GetTileY(); ++TY)
+	{
+		for (int TX = Columns.X0 / Chunks.GetTileX(); TX <= (Columns.X1 - 1) / Chunks.GetTileX(); ++TX)
 		{
-			continue;
+			OutChunks.Add(Chunks.GetTileIndex(TX, TY));
 		}
+	}
+}
 
-		FBox BBoxGeo = Comp->GetNavigationBounds();
-		
-		if (!(BBoxGeo.Intersect(VoxelBBox)))
-		{
-			continue;
-		}
+static InsightVoxel::FVoxelTile UnionColumnRects(const InsightVoxel::FVoxelTile& A, const InsightVoxel::FVoxelTile& B)
+{
+	if (A.IsEmpty())
+	{
+		return B;
+	}
+	if (B.IsEmpty())
+	{
+		return A;
+	}
+	return {FMath::Min(A.X0, B.X0), FMath::Min(A.Y0, B.Y0), FMath::Max(A.X1, B.X1), FMath::Max(A.Y1, B.Y1)};
+}
 
-		FNavigationRelevantData Data(*Comp);
-		FInsightGeometryExport GeoExport;
+FString AInsightVoxelSpace::GetVoxelCachePath() const
+{
+	return FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("NavInsight"), GetName() + TEXT(".voxcache"));
+}
 
-		ExportComponentGeo(Comp, GeoExport);
-		
-		if (GeoExport.VertexBuffer.Num() == 0)
-		{
-			continue;
-		}
-		
-		for (int IIdx = 0; IIdx < GeoExport.IndexBuffer.Num() / 3; ++IIdx)
-		{
-			FVector PosA = GeoExport.VertexBuffer[GeoExport.IndexBuffer[IIdx * 3 + 0]];
-			FVector PosB = GeoExport.VertexBuffer[GeoExport.IndexBuffer[IIdx * 3 + 1]];
-			FVector PosC = GeoExport.VertexBuffer[GeoExport.IndexBuffer[IIdx * 3 + 2]];
-			FColor Color = {0, 255, 0};
-			
-			RasterizeTriangle(PosA, PosB, PosC);
-		}
+FInsightVoxelSnapshot& AInsightVoxelSpace::GetMutableSnapshot()
+{
+	// Only the game thread hands out references, so once unique it stays unique
+	if (!Snapshot.IsUnique())
+	{
+		Snapshot = MakeShared<FInsightVoxelSnapshot, ESPMode::ThreadSafe>(*Snapshot);
+	}
+	return *Snapshot;
+}
 
+void AInsightVoxelSpace::RecordVoxelizedActor(AActor* Actor, const FBox& Bounds)
+{
+	VoxelizedActors.Add(Actor, Bounds);
 
+	TArray<int32> Chunks;
+	GetChunksInRect(RenderChunks, Snapshot->Grid.GetColumnRect(ToVoxelBounds(Bounds), 1), Chunks);
+	for (const int32 ChunkIndex : Chunks)
+	{
+		ChunkActors[ChunkIndex].AddUnique(Actor);
 	}
+}
 
-	VisualizeVoxelSpace();
+void AInsightVoxelSpace::ForgetVoxelizedActor(AActor* Actor)
+{
+	const FBox* Bounds = VoxelizedActors.Find(Actor);
+	if (!Bounds)
+	{
+		return;
+	}
+
+	TArray<int32> Chunks;
+	GetChunksInRect(RenderChunks, Snapshot->Grid.GetColumnRect(ToVoxelBounds(*Bounds), 1), Chunks);
+	for (const int32 ChunkIndex : Chunks)
+	{
+		ChunkActors[ChunkIndex].RemoveSwap(Actor);
+	}
+	VoxelizedActors.Remove(Actor);
 }
 
-FIntVector AInsightVoxelSpace::ProbeVoxel(FVector& Position)
+void AInsightVoxelSpace::RevoxelizeActor(AActor* Actor, bool bRemoved)
 {
-	int X = (Position.X - VoxelBBox.Min.X) / CellSize + 0.5f;
-	int Y = (Position.Y - VoxelBBox.Min.Y) / CellSize + 0.5f;
-	int Z = (Position.Z - VoxelBBox.Min.Z) / CellHeight + 0.5f;
+	if (!Actor || Actor == this || Actor == StartPoint || Actor == EndPoint || Actor->GetWorld() != GetWorld()
+		|| !Snapshot || ChunkActors.Num() != RenderChunks.GetTileNum())
+	{
+		return;
+	}
 
+	const InsightVoxel::FVoxelGrid& Layout = Snapshot->Grid;
 
-	if (GetVoxelOccupied(X, Y, Z))
+	TArray<FInsightGeometryView> ActorGeos;
+	FBox BBoxGeo;
+	const bool bContributes = !bRemoved && ExportActorGeo(Actor, Layout, *GeometryCache, ActorGeos, BBoxGeo);
+
+	const FBox* OldBounds = VoxelizedActors.Find(Actor);
+	if (!OldBounds && !bContributes)
 	{
-		return {-1, -1, -1};
+		return;
 	}
 
-	int ProbeDist = 3;
-	while (!GetVoxelOccupied(X, Y, Z - 1))
+	// Columns the actor covered before and covers now; the 1 column margin absorbs rounding at the edges
+	InsightVoxel::FVoxelTile Dirty;
+	if (OldBounds)
 	{
-		Z -= 1;
+		Dirty = Layout.GetColumnRect(ToVoxelBounds(*OldBounds), 1);
+	}
+	if (bContributes)
+	{
+		Dirty = UnionColumnRects(Dirty, Layout.GetColumnRect(ToVoxelBounds(BBoxGeo), 1));
+	}
+
+	ForgetVoxelizedActor(Actor);
+	if (Dirty.IsEmpty())
+	{
+		return;
+	}
+
+	NAVINSIGHT_SCOPE(STAT_NavInsight_Revoxelize);
 
-		if (--ProbeDist == 0 || Z == -1)
+	// Patched in place unless a path query still reads the snapshot
+	FInsightVoxelSnapshot& Voxels = GetMutableSnapshot();
+	InsightVoxel::FVoxelGrid& Grid = Voxels.Grid;
+	Grid.ClearColumns(Dirty);
+
+	// Everything else reaching into the cleared columns is rasterized again, clipped to them
+	TArray<int32> Chunks;
+	GetChunksInRect(RenderChunks, Dirty, Chunks);
+	TSet<AActor*> Neighbours;
+	for (const int32 ChunkIndex : Chunks)
+	{
+		for (const TWeakObjectPtr<AActor>& Other : ChunkActors[ChunkIndex])
+		{
+			if (Other.IsValid())
+			{
+				Neighbours.Add(Other.Get());
+			}
+		}
+	}
+
+	for (AActor* Other : Neighbours)
+	{
+		TArray<FInsightGeometryView> OtherGeos;
+		FBox OtherBounds;
+		ExportActorGeo(Other, Grid, *GeometryCache, OtherGeos, OtherBounds);
+		for (const FInsightGeometryView& Geo : OtherGeos)
+		{
+			RasterizeGeoView(Grid, Geo, Dirty);
+		}
+	}
+
+	if (bContributes)
+	{
+		for (const FInsightGeometryView& Geo : ActorGeos)
 		{
-			return {-1, -1, -1};
+			RasterizeGeoView(Grid, Geo, Dirty);
 		}
+		RecordVoxelizedActor(Actor, BBoxGeo);
 	}
 
-	return {X, Y, Z};
+	// Stayable bits look one column to the side
+	const InsightVoxel::FVoxelTile Grown(
+		FMath::Max(Dirty.X0 - 1, 0), FMath::Max(Dirty.Y0 - 1, 0),
+		FMath::Min(Dirty.X1 + 1, Grid.GetXNum()), FMath::Min(Dirty.Y1 + 1, Grid.GetYNum())
+	);
+	InsightVoxel::UpdateWalkableMask(Grid, Voxels.WalkableGrid, Grown, InsightParallelFor);
+	Voxels.UpdateCompactSpans(bCompactSpans, Grown);
+	Voxels.Components.Update(Voxels.WalkableGrid, Grown, InsightParallelFor);
+	Voxels.PathHierarchy.Update(Voxels.WalkableGrid, Grown, InsightParallelFor);
+	Voxels.Clearance.Update(Grid, Voxels.WalkableGrid, Grown, InsightParallelFor);
+	SET_MEMORY_STAT(STAT_NavInsight_SnapshotMemory, Voxels.GetAllocatedBytes());
+
+	MarkRenderChunksDirty(Grown);
+	VisualizeVoxelSpace();
 }
 
+void AInsightVoxelSpace::OnLevelActorChanged(AActor* Actor)
+{
+	// The geometry cache belongs to the running build
+	if (BuildJob)
+	{
+		PendingActorUpdates.Emplace(Actor, false);
+		return;
+	}
+	RevoxelizeActor(Actor, false);
+}
+
+void AInsightVoxelSpace::OnLevelActorDeleted(AActor* Actor)
+{
+	if (BuildJob)
+	{
+		PendingActorUpdates.Emplace(Actor, true);
+		return;
+	}
+	RevoxelizeActor(Actor, true);
+}
+
+void AInsightVoxelSpace::RegisterLevelEvents()
+{
+#if WITH_EDITOR
+	if (GEngine)
+	{
+		ActorMovedHandle = GEngine->OnActorMoved().AddUObject(this, &AInsightVoxelSpace::OnLevelActorChanged);
+		ActorAddedHandle = GEngine->OnLevelActorAdded().AddUObject(this, &AInsightVoxelSpace::OnLevelActorChanged);
+		ActorDeletedHandle = GEngine->OnLevelActorDeleted().AddUObject(this, &AInsightVoxelSpace::OnLevelActorDeleted);
+	}
+#endif
+}
+
+void AInsightVoxelSpace::UnregisterLevelEvents()
+{
+#if WITH_EDITOR
+	if (GEngine)
+	{
+		GEngine->OnActorMoved().Remove(ActorMovedHandle);
+		GEngine->OnLevelActorAdded().Remove(ActorAddedHandle);
+		GEngine->OnLevelActorDeleted().Remove(ActorDeletedHandle);
+	}
+#endif
+	ActorMovedHandle.Reset();
+	ActorAddedHandle.Reset();
+	ActorDeletedHandle.Reset();
+}
 
 void AInsightVoxelSpace::FindPath()
 {
@@ -412,142 +583,243 @@ void AInsightVoxelSpace::FindPath()
 		return;
 	}
 
-	FVector StartPos = StartPoint->GetActorLocation();
-	FVector EndPos = EndPoint->GetActorLocation();
-
-	FIntVector StartIdx = ProbeVoxel(StartPos);
-	FIntVector EndIdx = ProbeVoxel(EndPos);
-
-	if (StartIdx.X == -1 && EndIdx.X == -1)
+	if (!Snapshot)
 	{
 		return;
 	}
-	
-	// BFS
-	static int DNum = 6;
-	static int Dx[] = {-1, 0, 1, 0, 0, 0};
-	static int Dy[] = {0, 1, 0, -1, 0, 0};
-	static int Dz[] = {0, 0, 0, 0, -1, 1};
-	
-	TQueue<FIntVector> Frontier;
-	TMap<FIntVector, FIntVector> Prev;
-	Frontier.Enqueue(StartIdx);
-	Prev.Add(StartIdx, {-1, -1, -1});
-	bool Found = false;
-	
-	while (!Frontier.IsEmpty())
+
+	// The query holds on to the snapshot it started with, whatever is published or patched meanwhile
+	const FInsightVoxelSnapshotPtr PathSnapshot = Snapshot;
+	const FVector StartPos = StartPoint->GetActorLocation();
+	const FVector EndPos = EndPoint->GetActorLocation();
+	const InsightVoxel::EPathAlgorithm Algorithm = PathAlgorithm == EInsightPathAlgorithm::JumpPoint
+		? InsightVoxel::EPathAlgorithm::JumpPoint
+		: InsightVoxel::EPathAlgorithm::AStar;
+	const int32 MinClearance = PathSnapshot->Clearance.IsBuilt()
+		? InsightVoxel::FClearanceField::GetRequiredClearance(AgentRadius, PathSnapshot->Grid.GetCellSize())
+		: 0;
+	const bool bHierarchical = PathAlgorithm == EInsightPathAlgorithm::Hierarchical && PathSnapshot->PathHierarchy.IsBuilt()
+		&& MinClearance == 0;
+
+	TWeakObjectPtr<AInsightVoxelSpace> WeakThis(this);
+	const bool bSmooth = bSmoothPath;
+	const TSharedRef<InsightVoxel::FPathSearchPool, ESPMode::ThreadSafe> SearchPool = PathSearchPool;
+	const TSharedRef<InsightVoxel::FHierarchySearchPool, ESPMode::ThreadSafe> HierarchyPool = HierarchySearchPool;
+	Async(EAsyncExecution::ThreadPool, [PathSnapshot, StartPos, EndPos, Algorithm, bHierarchical, MinClearance, bSmooth, WeakThis,
+		SearchPool, HierarchyPool]()
 	{
-		FIntVector NowIdx;
-		Frontier.Dequeue(NowIdx);
+		// Search state comes from the actor's pools and goes back there, not to the pool thread
+		std::vector<InsightVoxel::FIntVec3> Path;
+		bool bFound;
+		InsightVoxel::FPathSearchStats PathStats;
+		{
+			NAVINSIGHT_SCOPE(STAT_NavInsight_FindPath);
+			if (bHierarchical)
+			{
+				std::unique_ptr<InsightVoxel::FHierarchySearch> Search = HierarchyPool->Acquire();
+				bFound = PathSnapshot->FindPathHierarchical(*Search, StartPos, EndPos, Path);
+				PathStats = Search->GetStats();
+				HierarchyPool->Release(MoveTemp(Search));
+			}
+			else
+			{
+				std::unique_ptr<InsightVoxel::FPathSearch> Search = SearchPool->Acquire();
+				bFound = PathSnapshot->FindPath(*Search, StartPos, EndPos, Algorithm, Path, MinClearance);
+				PathStats = Search->GetStats();
+				SearchPool->Release(MoveTemp(Search));
+			}
+		}
 
-		for (int DIdx = 0; DIdx < DNum; ++DIdx)
+		if (bFound && bSmooth)
 		{
-			FIntVector NextIdx = {
-				NowIdx.X + Dx[DIdx],
-				NowIdx.Y + Dy[DIdx],
-				NowIdx.Z + Dz[DIdx]
-			};
+			NAVINSIGHT_SCOPE(STAT_NavInsight_SmoothPath);
+			std::vector<InsightVoxel::FIntVec3> Waypoints;
+			PathSnapshot->SmoothPath(Path, Waypoints, MinClearance);
+			Path = MoveTemp(Waypoints);
+		}
 
-			if (!Prev.Find(NextIdx) && IsVoxelInside(NextIdx.X, NextIdx.Y, NextIdx.Z) && IsStayableVoxel(NextIdx.X, NextIdx.Y, NextIdx.Z))
+		// Failed queries report their counters too
+		AsyncTask(ENamedThreads::GameThread, [PathSnapshot, Path = MoveTemp(Path), bFound, PathStats, WeakThis]()
+		{
+			AInsightVoxelSpace* Space = WeakThis.Get();
+			if (!Space)
 			{
-				Frontier.Enqueue(NextIdx);
-				Prev.Add(NextIdx, NowIdx);
+				return;
 			}
 
-			if (NextIdx == EndIdx)
+			Space->LastPathStats = PathStats;
+			SET_DWORD_STAT(STAT_NavInsight_PathExpanded, PathStats.ExpandedNum);
+			SET_DWORD_STAT(STAT_NavInsight_PathPeakOpen, PathStats.PeakOpenNum);
+			if (bFound)
 			{
-				Found = true;
-				break;
+				Space->DrawPath(*PathSnapshot, Path);
 			}
-		}
-	}
+		});
+	});
+}
 
-	if (!Found)
-	{
-		return;
-	}
-	
-	TArray<FIntVector> Path;
-	FIntVector NowIdx = EndIdx;
-	while (NowIdx != StartIdx)
+bool AInsightVoxelSpace::FindPathBatch(const TArray<FVector>& Starts, const TArray<FVector>& Goals, InsightVoxel::FPathBatchResult& OutResult)
+{
+	if (!Snapshot || Starts.Num() != Goals.Num())
 	{
-		Path.Push(NowIdx);
-		NowIdx = Prev[NowIdx];
+		return false;
 	}
-	Path.Push(StartIdx);
-	Algo::Reverse(Path);
+
+	InsightVoxel::FPathBatchSettings Settings;
+	Settings.Algorithm = PathAlgorithm == EInsightPathAlgorithm::JumpPoint
+		? InsightVoxel::EPathAlgorithm::JumpPoint
+		: InsightVoxel::EPathAlgorithm::AStar;
+	Settings.MinClearance = Snapshot->Clearance.IsBuilt()
+		? InsightVoxel::FClearanceField::GetRequiredClearance(AgentRadius, Snapshot->Grid.GetCellSize())
+		: 0;
+	Snapshot->FindPathBatch(*PathSearchPool, Starts, Goals, Settings, OutResult);
+	return true;
+}
+
+void AInsightVoxelSpace::DrawPath(const FInsightVoxelSnapshot& PathSnapshot, const std::vector<InsightVoxel::FIntVec3>& Path)
+{
+	const InsightVoxel::FVoxelGrid& Grid = PathSnapshot.Grid;
+	const FVector GridMin(Grid.GetBounds().Min.X, Grid.GetBounds().Min.Y, Grid.GetBounds().Min.Z);
+	const float PathCellSize = Grid.GetCellSize();
+	const float PathCellHeight = Grid.GetCellHeight();
 
 	int j = 0;
 	FColor PathColor = {0, 255, 255};
-	for (int i = 1; i < Path.Num(); ++i)
+	for (int i = 1; i < static_cast<int>(Path.size()); ++i)
 	{
 		FVector PointPosA = {
-			Path[i].X * CellSize + VoxelBBox.Min.X,
-			Path[i].Y * CellSize + VoxelBBox.Min.Y,
-			Path[i].Z * CellHeight + VoxelBBox.Min.Z + CellHeight
+			Path[i].X * PathCellSize + GridMin.X,
+			Path[i].Y * PathCellSize + GridMin.Y,
+			Path[i].Z * PathCellHeight + GridMin.Z + PathCellHeight
 		};
 		FVector PointPosB = {
-			Path[j].X * CellSize + VoxelBBox.Min.X,
-			Path[j].Y * CellSize + VoxelBBox.Min.Y,
-			Path[j].Z * CellHeight + VoxelBBox.Min.Z + CellHeight
+			Path[j].X * PathCellSize + GridMin.X,
+			Path[j].Y * PathCellSize + GridMin.Y,
+			Path[j].Z * PathCellHeight + GridMin.Z + PathCellHeight
 		};
 		DrawDebugLine(GetWorld(), PointPosA, PointPosB, PathColor, true);
 		j = i;
 	}
-	
 }
 
-bool AInsightVoxelSpace::IsStayableVoxel(int X, int Y, int Z)
+void AInsightVoxelSpace::MarkRenderChunksDirty(const InsightVoxel::FVoxelTile& Columns)
 {
-	if (GetVoxelOccupied(X, Y, Z))
+	if (Columns.IsEmpty())
 	{
-		return false;
+		return;
 	}
 
-	for (int DX = -1; DX <= 1; ++DX)
+	const int TX0 = Columns.X0 / RenderChunks.GetTileX();
+	const int TY0 = Columns.Y0 / RenderChunks.GetTileY();
+	const int TX1 = (Columns.X1 - 1) / RenderChunks.GetTileX();
+	const int TY1 = (Columns.Y1 - 1) / RenderChunks.GetTileY();
+	for (int TY = TY0; TY <= TY1; ++TY)
 	{
-		for (int Dy = -1; Dy <= 1; ++Dy)
+		for (int TX = TX0; TX <= TX1; ++TX)
 		{
-			for (int Dz = -1; Dz <= 0; ++Dz)
-			{
-				if (DX == 0 && Dy == 0 && Dz == 0)
-				{
-					continue;
-				}
-				if (IsVoxelInside(X + DX, Y + Dy, Z + Dz) && GetVoxelOccupied(X + DX, Y + Dy, Z + Dz))
-				{
-					return true;
-				}
-			}
+			DirtyRenderChunks[RenderChunks.GetTileIndex(TX, TY)] = true;
 		}
 	}
-	
-	return false;
+}
+
+void AInsightVoxelSpace::UpdateChunkInstances(UInstancedStaticMeshComponent*& Component, UMaterialInterface* Material,
+											  const std::vector<InsightVoxel::FIntVec3>& Voxels)
+{
+	if (Voxels.empty() || !VoxelMesh)
+	{
+		if (Component)
+		{
+			Component->ClearInstances();
+		}
+		return;
+	}
+
+	if (!Component)
+	{
+		Component = NewObject<UInstancedStaticMeshComponent>(this, NAME_None, RF_Transient);
+		Component->SetStaticMesh(VoxelMesh);
+		Component->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+		Component->SetCanEverAffectNavigation(false);
+		Component->CastShadow = false;
+
+		// Instances are placed in world space
+		Component->SetUsingAbsoluteLocation(true);
+		Component->SetUsingAbsoluteRotation(true);
+		Component->SetUsingAbsoluteScale(true);
+		Component->SetupAttachment(GetRootComponent());
+		Component->RegisterComponent();
+		Component->SetWorldTransform(FTransform::Identity);
+	}
+	if (Material)
+	{
+		Component->SetMaterial(0, Material);
+	}
+
+	// Cell sizes of the drawn grid, which may differ from the properties until the next build is published
+	const InsightVoxel::FVoxelGrid& Grid = Snapshot->Grid;
+	const FBox MeshBox = VoxelMesh->GetBoundingBox();
+	const FVector CellExtent(Grid.GetCellSize(), Grid.GetCellSize(), Grid.GetCellHeight());
+	const FVector Scale = CellExtent / MeshBox.GetSize().ComponentMax(FVector(KINDA_SMALL_NUMBER));
+	const FVector Origin = FVector(Grid.GetBounds().Min.X, Grid.GetBounds().Min.Y, Grid.GetBounds().Min.Z) - MeshBox.Min * Scale;
+
+	TArray<FTransform> Transforms;
+	Transforms.Reserve(Voxels.size());
+	for (const InsightVoxel::FIntVec3& Voxel : Voxels)
+	{
+		Transforms.Emplace(FQuat::Identity, Origin + FVector(Voxel.X, Voxel.Y, Voxel.Z) * CellExtent, Scale);
+	}
+
+	Component->ClearInstances();
+	Component->AddInstances(Transforms, false);
+}
+
+void AInsightVoxelSpace::RebuildRenderChunk(int ChunkIndex)
+{
+	const InsightVoxel::FVoxelTile Chunk = RenderChunks.GetTile(ChunkIndex);
+
+	// Enclosed voxels are never visible and are left out
+	std::vector<InsightVoxel::FIntVec3> Voxels;
+	InsightVoxel::CollectSurfaceVoxels(Snapshot->Grid, Chunk, Voxels);
+	UpdateChunkInstances(VoxelChunkComponents[ChunkIndex], VoxelMaterial, Voxels);
+
+	Voxels.clear();
+	if (bVisualizeWalkable)
+	{
+		InsightVoxel::CollectSurfaceVoxels(Snapshot->WalkableGrid, Chunk, Voxels);
+	}
+	UpdateChunkInstances(WalkableChunkComponents[ChunkIndex], WalkableMaterial, Voxels);
+}
+
+void AInsightVoxelSpace::DestroyRenderChunks()
+{
+	for (UInstancedStaticMeshComponent* Component : VoxelChunkComponents)
+	{
+		if (Component)
+		{
+			Component->DestroyComponent();
+		}
+	}
+	for (UInstancedStaticMeshComponent* Component : WalkableChunkComponents)
+	{
+		if (Component)
+		{
+			Component->DestroyComponent();
+		}
+	}
+	VoxelChunkComponents.Reset();
+	WalkableChunkComponents.Reset();
 }
 
 void AInsightVoxelSpace::VisualizeVoxelSpace()
 {
-	
-	for (int X = 0; X < VoxelXNum; ++X)
+	for (int ChunkIndex = 0; ChunkIndex < DirtyRenderChunks.Num(); ++ChunkIndex)
 	{
-		for (int Y = 0; Y < VoxelYNum; ++Y)
+		if (DirtyRenderChunks[ChunkIndex])
 		{
-			for (int Z = 0; Z < VoxelZNum; ++Z)
-			{
-				FVector Center = {
-					(X + 0.5f) * CellSize + VoxelBBox.Min.X,
-					(Y + 0.5f) * CellSize + VoxelBBox.Min.Y,
-					(Z + 0.5f) * CellHeight + VoxelBBox.Min.Z
-				};
-				FVector Extent = {CellSize, CellSize, CellHeight};
-				FColor Color = {255, 0, 0};
-
-				if (GetVoxelOccupied(X, Y, Z))
-				{
-					DrawDebugBox(GetWorld(), Center, Extent, Color, true, -1);
-				}
-				
-			}
+			RebuildRenderChunk(ChunkIndex);
+			DirtyRenderChunks[ChunkIndex] = false;
 		}
 	}
-}
\ No newline at end of file
+}
+
+#undef LOCTEXT_NAMESPACE
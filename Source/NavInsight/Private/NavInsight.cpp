@@ -3,11 +3,32 @@
 #include "NavInsight.h"
 #include "NavInsightStyle.h"
 #include "NavInsightCommands.h"
+#include "NavInsightStats.h"
 #include "Misc/MessageDialog.h"
 #include "ToolMenus.h"
 
 static const FName NavInsightTabName("NavInsight");
 
+DEFINE_STAT(STAT_NavInsight_Export);
+DEFINE_STAT(STAT_NavInsight_Rasterize);
+DEFINE_STAT(STAT_NavInsight_Walkable);
+DEFINE_STAT(STAT_NavInsight_Components);
+DEFINE_STAT(STAT_NavInsight_Spans);
+DEFINE_STAT(STAT_NavInsight_Hierarchy);
+DEFINE_STAT(STAT_NavInsight_Clearance);
+DEFINE_STAT(STAT_NavInsight_Revoxelize);
+DEFINE_STAT(STAT_NavInsight_FindPath);
+DEFINE_STAT(STAT_NavInsight_SmoothPath);
+DEFINE_STAT(STAT_NavInsight_TrianglesSubmitted);
+DEFINE_STAT(STAT_NavInsight_TrianglesCulled);
+DEFINE_STAT(STAT_NavInsight_RowsClipped);
+DEFINE_STAT(STAT_NavInsight_VoxelsWritten);
+DEFINE_STAT(STAT_NavInsight_PathExpanded);
+DEFINE_STAT(STAT_NavInsight_PathPeakOpen);
+DEFINE_STAT(STAT_NavInsight_SnapshotMemory);
+
+UE_TRACE_CHANNEL_DEFINE(NavInsightChannel);
+
 #define LOCTEXT_NAMESPACE "FNavInsightModule"
 
 void FNavInsightModule::StartupModule()
@@ -0,0 +1,147 @@
+#include "VoxelCore/InsightVoxelBvh.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace InsightVoxel
+{
+	static FBounds3 EmptyBvhBounds()
+	{
+		const float Inf = std::numeric_limits<float>::infinity();
+		return {{Inf, Inf, Inf}, {-Inf, -Inf, -Inf}};
+	}
+
+	static void GrowBvhBounds(FBounds3& Bounds, const FBounds3& Other)
+	{
+		for (int Axis = 0; Axis < 3; ++Axis)
+		{
+			Bounds.Min[Axis] = std::min(Bounds.Min[Axis], Other.Min[Axis]);
+			Bounds.Max[Axis] = std::max(Bounds.Max[Axis], Other.Max[Axis]);
+		}
+	}
+
+	void FTriangleBvh::Reset()
+	{
+		Nodes.clear();
+		Tris.clear();
+	}
+
+	void FTriangleBvh::Build(const float* Verts, int NumVerts, const int32_t* Indices, int NumTris)
+	{
+		Reset();
+
+		std::vector<FBounds3> TriBounds(NumTris);
+		std::vector<FVec3> Centroids(NumTris);
+		Tris.reserve(NumTris);
+		for (int TIdx = 0; TIdx < NumTris; ++TIdx)
+		{
+			const int32_t* Tri = &Indices[TIdx * 3];
+			if (Tri[0] < 0 || Tri[1] < 0 || Tri[2] < 0 || Tri[0] >= NumVerts || Tri[1] >= NumVerts || Tri[2] >= NumVerts)
+			{
+				continue;
+			}
+
+			FBounds3& Bounds = TriBounds[TIdx];
+			Bounds = EmptyBvhBounds();
+			for (int Corner = 0; Corner < 3; ++Corner)
+			{
+				const float* Vert = &Verts[Tri[Corner] * 3];
+				const FBounds3 Point({Vert[0], Vert[1], Vert[2]}, {Vert[0], Vert[1], Vert[2]});
+				GrowBvhBounds(Bounds, Point);
+			}
+			Centroids[TIdx] = (Bounds.Min + Bounds.Max) * 0.5f;
+			Tris.push_back(TIdx);
+		}
+
+		if (Tris.empty())
+		{
+			return;
+		}
+
+		// A full binary tree over N leaves has 2N - 1 nodes
+		Nodes.reserve(2 * (Tris.size() / LeafTriangles + 1));
+		Nodes.emplace_back();
+		Nodes[0].First = 0;
+		Nodes[0].Count = static_cast<int32_t>(Tris.size());
+
+		std::vector<int32_t> Stack;
+		Stack.push_back(0);
+		while (!Stack.empty())
+		{
+			const int32_t NodeIndex = Stack.back();
+			Stack.pop_back();
+
+			const int32_t First = Nodes[NodeIndex].First;
+			const int32_t Count = Nodes[NodeIndex].Count;
+
+			FBounds3 Bounds = EmptyBvhBounds();
+			FBounds3 CentroidBounds = EmptyBvhBounds();
+			for (int32_t i = First; i < First + Count; ++i)
+			{
+				GrowBvhBounds(Bounds, TriBounds[Tris[i]]);
+				GrowBvhBounds(CentroidBounds, FBounds3(Centroids[Tris[i]], Centroids[Tris[i]]));
+			}
+			Nodes[NodeIndex].Bounds = Bounds;
+
+			if (Count <= LeafTriangles)
+			{
+				continue;
+			}
+
+			const FVec3 Extent = CentroidBounds.Max - CentroidBounds.Min;
+			const int Axis = Extent.X >= Extent.Y && Extent.X >= Extent.Z ? 0 : (Extent.Y >= Extent.Z ? 1 : 2);
+
+			const int32_t Half = Count / 2;
+			std::nth_element(Tris.begin() + First, Tris.begin() + First + Half, Tris.begin() + First + Count,
+				[&Centroids, Axis](int32_t A, int32_t B) { return Centroids[A][Axis] < Centroids[B][Axis]; });
+
+			const int32_t ChildIndex = static_cast<int32_t>(Nodes.size());
+			Nodes.resize(Nodes.size() + 2);
+			Nodes[ChildIndex].First = First;
+			Nodes[ChildIndex].Count = Half;
+			Nodes[ChildIndex + 1].First = First + Half;
+			Nodes[ChildIndex + 1].Count = Count - Half;
+			Nodes[NodeIndex].First = ChildIndex;
+			Nodes[NodeIndex].Count = 0;
+
+			Stack.push_back(ChildIndex + 1);
+			Stack.push_back(ChildIndex);
+		}
+	}
+
+	void FTriangleBvh::QueryBox(const FBounds3& Box, std::vector<int32_t>& OutTris) const
+	{
+		if (Nodes.empty())
+		{
+			return;
+		}
+
+		int32_t Stack[64];
+		int StackSize = 0;
+		Stack[StackSize++] = 0;
+		while (StackSize > 0)
+		{
+			const FNode& Node = Nodes[Stack[--StackSize]];
+			if (!Node.Bounds.Intersect(Box))
+			{
+				continue;
+			}
+
+			if (Node.Count > 0)
+			{
+				OutTris.insert(OutTris.end(), Tris.begin() + Node.First, Tris.begin() + Node.First + Node.Count);
+			}
+			else
+			{
+				// Median splits keep the depth at log2(triangles / leaf), far below the stack size
+				Stack[StackSize++] = Node.First + 1;
+				Stack[StackSize++] = Node.First;
+			}
+		}
+	}
+
+	size_t FTriangleBvh::GetAllocatedBytes() const
+	{
+		return Nodes.capacity() * sizeof(FNode) + Tris.capacity() * sizeof(int32_t);
+	}
+}
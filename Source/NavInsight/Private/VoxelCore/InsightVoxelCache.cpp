@@ -0,0 +1,222 @@
+#include "VoxelCore/InsightVoxelCache.h"
+#include "VoxelCore/InsightVoxelGrid.h"
+
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <utility>
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace InsightVoxel
+{
+	static const char VoxelCacheMagic[4] = {'N', 'I', 'V', 'X'};
+
+	// MurmurHash64A over a byte range, chained through Hash
+	static uint64_t HashBytes(const void* Bytes, size_t Size, uint64_t Hash)
+	{
+		const uint64_t M = 0xc6a4a7935bd1e995ull;
+		const int R = 47;
+
+		Hash ^= Size * M;
+
+		const unsigned char* Data = static_cast<const unsigned char*>(Bytes);
+		const unsigned char* End = Data + (Size & ~size_t(7));
+		for (; Data != End; Data += 8)
+		{
+			uint64_t K;
+			std::memcpy(&K, Data, 8);
+			K *= M;
+			K ^= K >> R;
+			K *= M;
+			Hash ^= K;
+			Hash *= M;
+		}
+
+		uint64_t Tail = 0;
+		std::memcpy(&Tail, Data, Size & 7);
+		if (Size & 7)
+		{
+			Hash ^= Tail;
+			Hash *= M;
+		}
+
+		Hash ^= Hash >> R;
+		Hash *= M;
+		Hash ^= Hash >> R;
+		return Hash;
+	}
+
+	uint64_t HashGeometry(const float* Verts, int NumVerts, const int32_t* Indices, int NumTris)
+	{
+		uint64_t Hash = HashBytes(Verts, sizeof(float) * 3 * static_cast<size_t>(NumVerts), 0x4e617649u);
+		return HashBytes(Indices, sizeof(int32_t) * 3 * static_cast<size_t>(NumTris), Hash);
+	}
+
+	bool SaveVoxelCache(const std::string& Path, const FVoxelGrid& Grid, uint64_t GeometryHash)
+	{
+		FVoxelCacheHeader Header;
+		std::memset(&Header, 0, sizeof(Header));
+		std::memcpy(Header.Magic, VoxelCacheMagic, sizeof(Header.Magic));
+		Header.Version = VoxelCacheVersion;
+		Header.HeaderSize = sizeof(FVoxelCacheHeader);
+		Header.GeometryHash = GeometryHash;
+		for (int Axis = 0; Axis < 3; ++Axis)
+		{
+			Header.BoundsMin[Axis] = Grid.GetBounds().Min[Axis];
+			Header.BoundsMax[Axis] = Grid.GetBounds().Max[Axis];
+		}
+		Header.CellSize = Grid.GetCellSize();
+		Header.CellHeight = Grid.GetCellHeight();
+		Header.XNum = Grid.GetXNum();
+		Header.YNum = Grid.GetYNum();
+		Header.ZNum = Grid.GetZNum();
+		Header.ColumnWords = Grid.GetColumnWords();
+		Header.WordNum = Grid.GetWordNum();
+
+		const std::string TempPath = Path + ".tmp";
+		FILE* File = std::fopen(TempPath.c_str(), "wb");
+		if (!File)
+		{
+			return false;
+		}
+
+		bool bWritten = std::fwrite(&Header, sizeof(Header), 1, File) == 1;
+		if (bWritten && Header.WordNum > 0)
+		{
+			bWritten = std::fwrite(Grid.GetWords(), sizeof(uint64_t), Header.WordNum, File) == Header.WordNum;
+		}
+		bWritten &= std::fclose(File) == 0;
+
+		if (!bWritten)
+		{
+			std::remove(TempPath.c_str());
+			return false;
+		}
+
+#if defined(_WIN32)
+		// rename does not replace existing files on Windows
+		std::remove(Path.c_str());
+#endif
+		return std::rename(TempPath.c_str(), Path.c_str()) == 0;
+	}
+
+	// Private (copy-on-write) read/write mapping of a whole file. The returned owner unmaps it.
+	static std::shared_ptr<void> MapFileCopyOnWrite(const std::string& Path, size_t& OutSize)
+	{
+#if defined(_WIN32)
+		HANDLE File = CreateFileA(Path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING,
+								  FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (File == INVALID_HANDLE_VALUE)
+		{
+			return nullptr;
+		}
+
+		LARGE_INTEGER Size;
+		if (!GetFileSizeEx(File, &Size) || Size.QuadPart == 0)
+		{
+			CloseHandle(File);
+			return nullptr;
+		}
+
+		HANDLE Mapping = CreateFileMappingA(File, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+		CloseHandle(File);
+		if (!Mapping)
+		{
+			return nullptr;
+		}
+
+		// The view keeps the mapping object alive
+		void* Base = MapViewOfFile(Mapping, FILE_MAP_COPY, 0, 0, 0);
+		CloseHandle(Mapping);
+		if (!Base)
+		{
+			return nullptr;
+		}
+
+		OutSize = static_cast<size_t>(Size.QuadPart);
+		return std::shared_ptr<void>(Base, [](void* P) { UnmapViewOfFile(P); });
+#else
+		const int File = open(Path.c_str(), O_RDONLY);
+		if (File < 0)
+		{
+			return nullptr;
+		}
+
+		struct stat Stat;
+		if (fstat(File, &Stat) != 0 || Stat.st_size == 0)
+		{
+			close(File);
+			return nullptr;
+		}
+
+		const size_t Size = static_cast<size_t>(Stat.st_size);
+		void* Base = mmap(nullptr, Size, PROT_READ | PROT_WRITE, MAP_PRIVATE, File, 0);
+		close(File);
+		if (Base == MAP_FAILED)
+		{
+			return nullptr;
+		}
+
+		OutSize = Size;
+		return std::shared_ptr<void>(Base, [Size](void* P) { munmap(P, Size); });
+#endif
+	}
+
+	bool LoadVoxelCache(const std::string& Path, uint64_t GeometryHash, const FBounds3& Bounds, float CellSize, float CellHeight,
+						FVoxelGrid& OutGrid)
+	{
+		size_t FileSize = 0;
+		std::shared_ptr<void> Mapping = MapFileCopyOnWrite(Path, FileSize);
+		if (!Mapping || FileSize < sizeof(FVoxelCacheHeader))
+		{
+			return false;
+		}
+
+		FVoxelCacheHeader Header;
+		std::memcpy(&Header, Mapping.get(), sizeof(Header));
+		if (std::memcmp(Header.Magic, VoxelCacheMagic, sizeof(Header.Magic)) != 0 || Header.Version != VoxelCacheVersion
+			|| Header.HeaderSize != sizeof(FVoxelCacheHeader) || Header.GeometryHash != GeometryHash
+			|| Header.CellSize != CellSize || Header.CellHeight != CellHeight)
+		{
+			return false;
+		}
+		for (int Axis = 0; Axis < 3; ++Axis)
+		{
+			if (Header.BoundsMin[Axis] != Bounds.Min[Axis] || Header.BoundsMax[Axis] != Bounds.Max[Axis])
+			{
+				return false;
+			}
+		}
+		if (FileSize - Header.HeaderSize < Header.WordNum * sizeof(uint64_t))
+		{
+			return false;
+		}
+
+		uint64_t* Words = reinterpret_cast<uint64_t*>(static_cast<char*>(Mapping.get()) + Header.HeaderSize);
+
+		FVoxelGrid Mapped;
+		Mapped.InitExternal(Bounds, CellSize, CellHeight, Words, std::move(Mapping));
+		if (Mapped.GetWordNum() != Header.WordNum || Mapped.GetXNum() != Header.XNum || Mapped.GetYNum() != Header.YNum
+			|| Mapped.GetZNum() != Header.ZNum)
+		{
+			return false;
+		}
+
+		OutGrid = std::move(Mapped);
+		return true;
+	}
+}
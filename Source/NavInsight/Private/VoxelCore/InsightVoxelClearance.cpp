@@ -0,0 +1,273 @@
+#include "VoxelCore/InsightVoxelClearance.h"
+#include "VoxelCore/InsightVoxelBits.h"
+#include "VoxelCore/InsightVoxelGrid.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <utility>
+
+namespace InsightVoxel
+{
+	int FClearanceField::GetRequiredClearance(float Radius, float CellSize)
+	{
+		// An obstacle column C cells away starts C - 0.5 cells from the voxel center
+		return std::max(static_cast<int>(std::ceil(Radius / CellSize + 0.5f)), 0);
+	}
+
+	void FClearanceField::Build(const FVoxelGrid& Grid, const FVoxelGrid& Walkable, int InBodyLayers, int InMaxClearance,
+								const FParallelForFn& ParallelFor)
+	{
+		XNum = Grid.GetXNum();
+		YNum = Grid.GetYNum();
+		ZNum = Grid.GetZNum();
+		BodyLayers = std::min(std::max(InBodyLayers, 1), 63);
+		MaxClearance = std::min(std::max(InMaxClearance, 1), 255);
+
+		CountColumns(Walkable);
+		ComputeColumns(Grid, Walkable, {0, 0, XNum, YNum}, ParallelFor);
+	}
+
+	void FClearanceField::Update(const FVoxelGrid& Grid, const FVoxelGrid& Walkable, const FVoxelTile& Columns,
+								 const FParallelForFn& ParallelFor)
+	{
+		if (!IsBuilt())
+		{
+			return;
+		}
+		if (Grid.GetXNum() != XNum || Grid.GetYNum() != YNum || Grid.GetZNum() != ZNum)
+		{
+			Build(Grid, Walkable, BodyLayers, MaxClearance, ParallelFor);
+			return;
+		}
+
+		// Obstacles reach MaxClearance columns, stayable voxels only changed inside Columns
+		const FVoxelTile Affected(
+			std::max(Columns.X0 - MaxClearance, 0), std::max(Columns.Y0 - MaxClearance, 0),
+			std::min(Columns.X1 + MaxClearance, XNum), std::min(Columns.Y1 + MaxClearance, YNum)
+		);
+		if (Affected.IsEmpty())
+		{
+			return;
+		}
+
+		const std::vector<uint32_t> OldStart = std::move(ColumnStart);
+		const std::vector<uint8_t> OldValues = std::move(Values);
+		CountColumns(Walkable);
+
+		for (int X = 0; X < XNum; ++X)
+		{
+			for (int Y = 0; Y < YNum; ++Y)
+			{
+				if (Affected.Contains(X, Y))
+				{
+					continue;
+				}
+				const size_t Column = static_cast<size_t>(X) * YNum + Y;
+				const uint32_t Num = std::min(OldStart[Column + 1] - OldStart[Column], ColumnStart[Column + 1] - ColumnStart[Column]);
+				std::memcpy(&Values[ColumnStart[Column]], &OldValues[OldStart[Column]], Num);
+			}
+		}
+
+		ComputeColumns(Grid, Walkable, Affected, ParallelFor);
+	}
+
+	void FClearanceField::Reset()
+	{
+		*this = FClearanceField();
+	}
+
+	uint8_t FClearanceField::GetClearance(const FVoxelGrid& Walkable, int X, int Y, int Z) const
+	{
+		const uint64_t* Column = Walkable.GetColumn(X, Y);
+		const int Word = Z >> 6;
+		const uint64_t Bit = 1ull << (Z & 63);
+		if (!(Column[Word] & Bit))
+		{
+			return 0;
+		}
+
+		// Rank of the voxel among the stayable voxels of its column
+		uint32_t Index = ColumnStart[static_cast<size_t>(X) * YNum + Y];
+		for (int i = 0; i < Word; ++i)
+		{
+			Index += PopCount64(Column[i]);
+		}
+		Index += PopCount64(Column[Word] & (Bit - 1));
+		return Values[Index];
+	}
+
+	size_t FClearanceField::GetAllocatedBytes() const
+	{
+		return ColumnStart.capacity() * sizeof(uint32_t) + Values.capacity();
+	}
+
+	bool FClearanceField::HasSameValues(const FClearanceField& Other) const
+	{
+		return XNum == Other.XNum && YNum == Other.YNum && ZNum == Other.ZNum && BodyLayers == Other.BodyLayers
+			&& MaxClearance == Other.MaxClearance && ColumnStart == Other.ColumnStart && Values == Other.Values;
+	}
+
+	void FClearanceField::CountColumns(const FVoxelGrid& Walkable)
+	{
+		const int ColumnWords = Walkable.GetColumnWords();
+		ColumnStart.assign(static_cast<size_t>(XNum) * YNum + 1, 0);
+		uint32_t Total = 0;
+		for (int X = 0; X < XNum; ++X)
+		{
+			for (int Y = 0; Y < YNum; ++Y)
+			{
+				ColumnStart[static_cast<size_t>(X) * YNum + Y] = Total;
+				const uint64_t* Column = Walkable.GetColumn(X, Y);
+				for (int Word = 0; Word < ColumnWords; ++Word)
+				{
+					Total += PopCount64(Column[Word]);
+				}
+			}
+		}
+		ColumnStart.back() = Total;
+		Values.assign(Total, 0);
+	}
+
+	void FClearanceField::ComputeColumns(const FVoxelGrid& Grid, const FVoxelGrid& Walkable, const FVoxelTile& Columns,
+										 const FParallelForFn& ParallelFor)
+	{
+		const int ColumnWords = Grid.GetColumnWords();
+		if (Columns.IsEmpty() || ColumnWords == 0)
+		{
+			return;
+		}
+
+		// Obstacles further than MaxClearance from Columns cannot lower any of its values
+		const FVoxelTile Region(
+			std::max(Columns.X0 - MaxClearance, 0), std::max(Columns.Y0 - MaxClearance, 0),
+			std::min(Columns.X1 + MaxClearance, XNum), std::min(Columns.Y1 + MaxClearance, YNum)
+		);
+		const int RegionXNum = Region.X1 - Region.X0;
+		const int RegionYNum = Region.Y1 - Region.Y0;
+		const size_t SliceWords = static_cast<size_t>(RegionYNum) * ColumnWords;
+
+		// Covered holds the obstacle columns grown by the steps so far, Grown the next step
+		std::vector<uint64_t> Covered(RegionXNum * SliceWords);
+		std::vector<uint64_t> Grown(RegionXNum * SliceWords);
+
+		// Step 0: bit Z is set if any of Z + 1 ... Z + BodyLayers is solid (shift down, borrowing from the word above)
+		ParallelFor(RegionXNum, [&](int Slice) {
+			for (int Y = 0; Y < RegionYNum; ++Y)
+			{
+				const uint64_t* Column = Grid.GetColumn(Region.X0 + Slice, Region.Y0 + Y);
+				uint64_t* Out = &Covered[Slice * SliceWords + static_cast<size_t>(Y) * ColumnWords];
+				for (int Word = 0; Word < ColumnWords; ++Word)
+				{
+					const uint64_t Above = Word + 1 < ColumnWords ? Column[Word + 1] : 0;
+					uint64_t Body = 0;
+					for (int Shift = 1; Shift <= BodyLayers; ++Shift)
+					{
+						Body |= (Column[Word] >> Shift) | (Above << (64 - Shift));
+					}
+					Out[Word] = Body;
+				}
+			}
+		});
+
+		// Give the stayable voxels of Columns newly covered by Now (and not by Before) the value Step
+		auto AssignSlice = [&](int Slice, const uint64_t* Now, const uint64_t* Before, uint8_t Step) {
+			const int X = Region.X0 + Slice;
+			int64_t Remaining = 0;
+			for (int Y = Columns.Y0; Y < Columns.Y1; ++Y)
+			{
+				const size_t Local = Slice * SliceWords + static_cast<size_t>(Y - Region.Y0) * ColumnWords;
+				const uint64_t* Column = Walkable.GetColumn(X, Y);
+				uint32_t Index = ColumnStart[static_cast<size_t>(X) * YNum + Y];
+				for (int Word = 0; Word < ColumnWords; ++Word)
+				{
+					uint64_t New = Column[Word] & Now[Local + Word] & (Before ? ~Before[Local + Word] : ~0ull);
+					while (New)
+					{
+						const int Bit = LowestBit64(New);
+						Values[Index + PopCount64(Column[Word] & ((1ull << Bit) - 1))] = Step;
+						New &= New - 1;
+					}
+					Remaining += PopCount64(Column[Word] & ~Now[Local + Word]);
+					Index += PopCount64(Column[Word]);
+				}
+			}
+			return Remaining;
+		};
+
+		const int SliceX0 = Columns.X0 - Region.X0;
+		const int SliceX1 = Columns.X1 - Region.X0;
+		std::vector<int64_t> SliceRemaining(RegionXNum, 0);
+
+		// Everything left uncovered after the last step is at least MaxClearance away
+		for (int X = Columns.X0; X < Columns.X1; ++X)
+		{
+			const size_t Begin = ColumnStart[static_cast<size_t>(X) * YNum + Columns.Y0];
+			const size_t End = ColumnStart[static_cast<size_t>(X) * YNum + Columns.Y1];
+			std::fill(Values.begin() + Begin, Values.begin() + End, static_cast<uint8_t>(MaxClearance));
+		}
+
+		ParallelFor(SliceX1 - SliceX0, [&](int i) {
+			SliceRemaining[SliceX0 + i] = AssignSlice(SliceX0 + i, Covered.data(), nullptr, 0);
+		});
+
+		for (int Step = 1; Step < MaxClearance; ++Step)
+		{
+			int64_t Remaining = 0;
+			for (const int64_t SliceNum : SliceRemaining)
+			{
+				Remaining += SliceNum;
+			}
+			if (Remaining == 0)
+			{
+				break;
+			}
+
+			// Odd steps reach the 8 neighbours, even steps the 4 side neighbours
+			const bool bDiagonal = Step & 1;
+			ParallelFor(RegionXNum, [&](int Slice) {
+				const int NX0 = std::max(Slice - 1, 0);
+				const int NX1 = std::min(Slice + 1, RegionXNum - 1);
+				uint64_t* Out = &Grown[Slice * SliceWords];
+
+				// OR of the slices around along X, then along Y: the 3x3 block, or the plus without its corners
+				std::vector<uint64_t> SliceOr(Covered.begin() + NX0 * SliceWords, Covered.begin() + (NX0 + 1) * SliceWords);
+				for (int NX = NX0 + 1; NX <= NX1; ++NX)
+				{
+					const uint64_t* Src = &Covered[NX * SliceWords];
+					for (size_t i = 0; i < SliceWords; ++i)
+					{
+						SliceOr[i] |= Src[i];
+					}
+				}
+
+				const uint64_t* Center = &Covered[Slice * SliceWords];
+				const uint64_t* Rows = bDiagonal ? SliceOr.data() : Center;
+				for (int Y = 0; Y < RegionYNum; ++Y)
+				{
+					const size_t Local = static_cast<size_t>(Y) * ColumnWords;
+					for (int Word = 0; Word < ColumnWords; ++Word)
+					{
+						uint64_t Near = SliceOr[Local + Word];
+						if (Y > 0)
+						{
+							Near |= Rows[Local - ColumnWords + Word];
+						}
+						if (Y + 1 < RegionYNum)
+						{
+							Near |= Rows[Local + ColumnWords + Word];
+						}
+						Out[Local + Word] = Near;
+					}
+				}
+
+				if (Slice >= SliceX0 && Slice < SliceX1)
+				{
+					SliceRemaining[Slice] = AssignSlice(Slice, Grown.data(), Covered.data(), static_cast<uint8_t>(Step));
+				}
+			});
+
+			std::swap(Covered, Grown);
+		}
+	}
+}
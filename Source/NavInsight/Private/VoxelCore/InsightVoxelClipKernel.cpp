@@ -0,0 +1,503 @@
+#include "VoxelCore/InsightVoxelClipKernel.h"
+
+#include <cmath>
+#include <limits>
+
+#if defined(__AVX__)
+#define INSIGHT_CLIP_KERNEL_AVX 1
+#else
+#define INSIGHT_CLIP_KERNEL_AVX 0
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define INSIGHT_CLIP_KERNEL_SSE 1
+#else
+#define INSIGHT_CLIP_KERNEL_SSE 0
+#endif
+
+#if INSIGHT_CLIP_KERNEL_AVX
+#include <immintrin.h>
+#elif INSIGHT_CLIP_KERNEL_SSE
+#include <emmintrin.h>
+#if defined(__SSE4_1__)
+#include <smmintrin.h>
+#endif
+#endif
+
+namespace InsightVoxel
+{
+	// Per-boundary accumulators. Boundary J is the upper edge of cell X0 - 1 + J.
+	struct FClipBoundaries
+	{
+		// Padded for the four-wide folds of the SIMD kernels
+		float Min[ClipKernelMaxCells + 4];
+		float Max[ClipKernelMaxCells + 4];
+		float Cnt[ClipKernelMaxCells + 4];
+	};
+
+	// Upper edge of cell X, computed exactly like the scalar rasterizer (CX + CellSize)
+	static inline float ClipCellUpper(float GridMinX, float CellSize, int X)
+	{
+		const float CX = GridMinX + X * CellSize;
+		return CX + CellSize;
+	}
+
+	// Cell of every corner: the first cell from RowX0 whose upper edge is not left of it, or X1 + 1 past the end.
+	// Same comparison as DividePoly's side test, so a corner exactly on a boundary belongs to the cell below it.
+	static void ClipVertexCells(const FRowPolySoA& Poly, float GridMinX, float CellSize, int RowX0, int X1, int* OutCells)
+	{
+		// Only a first guess, corrected below. Clamped before the conversion: corners may lie far outside the grid.
+		const float InvCellSize = 1.0f / CellSize;
+		for (int V = 0; V < Poly.Num; ++V)
+		{
+			const float VX = Poly.X[V];
+			const float Guess = std::ceil((VX - GridMinX) * InvCellSize) - 1.0f;
+			int X = !(Guess > RowX0) ? RowX0 : (Guess > X1 + 1 ? X1 + 1 : static_cast<int>(Guess));
+			while (X > RowX0 && ClipCellUpper(GridMinX, CellSize, X - 1) >= VX)
+			{
+				--X;
+			}
+			while (X <= X1 && ClipCellUpper(GridMinX, CellSize, X) < VX)
+			{
+				++X;
+			}
+			OutCells[V] = X;
+		}
+	}
+
+	// Edge IPrev -> I of the row polygon as DividePoly's remaining polygon holds it. DividePoly interpolates from
+	// IPrev (B) towards I (O); each cut replaces the left one of them by the crossing, which is B when the edge
+	// runs left to right. The edge crosses the upper edges of cells Start ... End - 1.
+	struct FClipEdge
+	{
+		float BX, BZ, OX, OZ;
+		bool bBaseMoves;
+		int Start, End;
+	};
+
+	static inline FClipEdge ClipEdge(const FRowPolySoA& Poly, const int* VertCells, int I)
+	{
+		const int IPrev = I == 0 ? Poly.Num - 1 : I - 1;
+		const bool bBaseMoves = Poly.X[IPrev] < Poly.X[I];
+		const int L = bBaseMoves ? IPrev : I;
+		const int R = bBaseMoves ? I : IPrev;
+		return {Poly.X[IPrev], Poly.Z[IPrev], Poly.X[I], Poly.Z[I], bBaseMoves, VertCells[L], VertCells[R]};
+	}
+
+	// Walks every edge across the boundaries it crosses, in the order DividePoly cuts the row, and intersects each
+	// boundary with what is left of the edge. Operands and their order are those of DividePoly, so crossings are
+	// bit-identical to the sequential chain. Boundaries before FirstX are only walked to carry the edge along;
+	// Edges keep what is left of every edge afterwards.
+	static void IntersectEdgesScalar(FClipEdge* Edges, int Num, float GridMinX, float CellSize, int FirstX, FClipBoundaries& Out)
+	{
+		for (int I = 0; I < Num; ++I)
+		{
+			FClipEdge& Edge = Edges[I];
+			for (int X = Edge.Start; X < Edge.End; ++X)
+			{
+				const float U = ClipCellUpper(GridMinX, CellSize, X);
+				const float DB = U - Edge.BX;
+				const float DO = U - Edge.OX;
+				const float S = DB / (DB - DO);
+				const float PX = Edge.BX + (Edge.OX - Edge.BX) * S;
+				const float PZ = Edge.BZ + (Edge.OZ - Edge.BZ) * S;
+				if (Edge.bBaseMoves)
+				{
+					Edge.BX = PX;
+					Edge.BZ = PZ;
+				}
+				else
+				{
+					Edge.OX = PX;
+					Edge.OZ = PZ;
+				}
+
+				if (X >= FirstX)
+				{
+					const int J = X - FirstX;
+					Out.Min[J] = PZ < Out.Min[J] ? PZ : Out.Min[J];
+					Out.Max[J] = PZ > Out.Max[J] ? PZ : Out.Max[J];
+					Out.Cnt[J] += 1.0f;
+				}
+			}
+		}
+	}
+
+#if INSIGHT_CLIP_KERNEL_SSE
+	static inline __m128 ClipSelect128(__m128 Mask, __m128 A, __m128 B)
+	{
+#if defined(__SSE4_1__)
+		return _mm_blendv_ps(B, A, Mask);
+#else
+		return _mm_or_ps(_mm_and_ps(Mask, A), _mm_andnot_ps(Mask, B));
+#endif
+	}
+
+	// Crossings the SIMD walks store per boundary and lane: +inf / -inf / 0 where a lane does not cross, so
+	// folding every lane is the same as folding the crossing ones
+	struct FClipLaneCrossings
+	{
+		static const int MaxLanes = 8;
+
+		alignas(32) float Min[(ClipKernelMaxCells + 4) * MaxLanes];
+		alignas(32) float Max[(ClipKernelMaxCells + 4) * MaxLanes];
+		alignas(32) float Cnt[(ClipKernelMaxCells + 4) * MaxLanes];
+	};
+
+	// Folds lanes First ... First + 3 of boundaries [JBegin, JEnd) into Out, lane by lane in edge order like the
+	// scalar walk (MINPS / MAXPS pick like its compares). Four boundaries at a time; the rows past JEnd up to
+	// the next multiple of four are padded here.
+	static void ClipFoldLanes(FClipLaneCrossings& Lanes, int Stride, int First, int JBegin, int JEnd, FClipBoundaries& Out)
+	{
+		const __m128 Inf = _mm_set1_ps(std::numeric_limits<float>::infinity());
+		const __m128 NegInf = _mm_set1_ps(-std::numeric_limits<float>::infinity());
+		for (int J = JEnd; (J - JBegin) & 3; ++J)
+		{
+			_mm_storeu_ps(Lanes.Min + J * Stride + First, Inf);
+			_mm_storeu_ps(Lanes.Max + J * Stride + First, NegInf);
+			_mm_storeu_ps(Lanes.Cnt + J * Stride + First, _mm_setzero_ps());
+		}
+
+		for (int J = JBegin; J < JEnd; J += 4)
+		{
+			const int Row = J * Stride + First;
+			__m128 A0 = _mm_loadu_ps(Lanes.Min + Row), A1 = _mm_loadu_ps(Lanes.Min + Row + Stride);
+			__m128 A2 = _mm_loadu_ps(Lanes.Min + Row + 2 * Stride), A3 = _mm_loadu_ps(Lanes.Min + Row + 3 * Stride);
+			_MM_TRANSPOSE4_PS(A0, A1, A2, A3);
+			_mm_storeu_ps(Out.Min + J, _mm_min_ps(A3, _mm_min_ps(A2, _mm_min_ps(A1, _mm_min_ps(A0, _mm_loadu_ps(Out.Min + J))))));
+
+			A0 = _mm_loadu_ps(Lanes.Max + Row), A1 = _mm_loadu_ps(Lanes.Max + Row + Stride);
+			A2 = _mm_loadu_ps(Lanes.Max + Row + 2 * Stride), A3 = _mm_loadu_ps(Lanes.Max + Row + 3 * Stride);
+			_MM_TRANSPOSE4_PS(A0, A1, A2, A3);
+			_mm_storeu_ps(Out.Max + J, _mm_max_ps(A3, _mm_max_ps(A2, _mm_max_ps(A1, _mm_max_ps(A0, _mm_loadu_ps(Out.Max + J))))));
+
+			A0 = _mm_loadu_ps(Lanes.Cnt + Row), A1 = _mm_loadu_ps(Lanes.Cnt + Row + Stride);
+			A2 = _mm_loadu_ps(Lanes.Cnt + Row + 2 * Stride), A3 = _mm_loadu_ps(Lanes.Cnt + Row + 3 * Stride);
+			_MM_TRANSPOSE4_PS(A0, A1, A2, A3);
+			_mm_storeu_ps(Out.Cnt + J, _mm_add_ps(_mm_add_ps(_mm_loadu_ps(Out.Cnt + J), _mm_add_ps(A0, A1)), _mm_add_ps(A2, A3)));
+		}
+	}
+
+	// Same walk with 4 edges in the lanes, all advanced one boundary per iteration. Lanes past the last edge have
+	// an empty range.
+	static void IntersectEdgesSSE(FClipEdge* Edges, int Num, float GridMinX, float CellSize, int FirstX, FClipBoundaries& Out)
+	{
+		const __m128 Inf = _mm_set1_ps(std::numeric_limits<float>::infinity());
+		const __m128 NegInf = _mm_set1_ps(-std::numeric_limits<float>::infinity());
+		const __m128 One = _mm_set1_ps(1.0f);
+		FClipLaneCrossings Lanes;
+
+		for (int Begin = 0; Begin < Num; Begin += 4)
+		{
+			FClipEdge E[4] = {};
+			int XBegin = 0, XEnd = 0;
+			const int LaneNum = Num - Begin < 4 ? Num - Begin : 4;
+			for (int Lane = 0; Lane < LaneNum; ++Lane)
+			{
+				E[Lane] = Edges[Begin + Lane];
+				if (E[Lane].Start < E[Lane].End)
+				{
+					XBegin = XBegin == XEnd || E[Lane].Start < XBegin ? E[Lane].Start : XBegin;
+					XEnd = E[Lane].End > XEnd ? E[Lane].End : XEnd;
+				}
+			}
+
+			__m128 BX = _mm_setr_ps(E[0].BX, E[1].BX, E[2].BX, E[3].BX);
+			__m128 BZ = _mm_setr_ps(E[0].BZ, E[1].BZ, E[2].BZ, E[3].BZ);
+			__m128 OX = _mm_setr_ps(E[0].OX, E[1].OX, E[2].OX, E[3].OX);
+			__m128 OZ = _mm_setr_ps(E[0].OZ, E[1].OZ, E[2].OZ, E[3].OZ);
+			const __m128 BaseMoves = _mm_castsi128_ps(
+				_mm_setr_epi32(-E[0].bBaseMoves, -E[1].bBaseMoves, -E[2].bBaseMoves, -E[3].bBaseMoves));
+			// Cell indices are small integers, exactly representable in float
+			const __m128 Start = _mm_cvtepi32_ps(_mm_setr_epi32(E[0].Start, E[1].Start, E[2].Start, E[3].Start));
+			const __m128 End = _mm_cvtepi32_ps(_mm_setr_epi32(E[0].End, E[1].End, E[2].End, E[3].End));
+
+			for (int X = XBegin; X < XEnd; ++X)
+			{
+				const __m128 XF = _mm_set1_ps(static_cast<float>(X));
+				const __m128 Cross = _mm_and_ps(_mm_cmpge_ps(XF, Start), _mm_cmplt_ps(XF, End));
+
+				const __m128 U = _mm_set1_ps(ClipCellUpper(GridMinX, CellSize, X));
+				const __m128 DB = _mm_sub_ps(U, BX);
+				const __m128 DO = _mm_sub_ps(U, OX);
+				const __m128 S = _mm_div_ps(DB, _mm_sub_ps(DB, DO));
+				const __m128 PX = _mm_add_ps(BX, _mm_mul_ps(_mm_sub_ps(OX, BX), S));
+				const __m128 PZ = _mm_add_ps(BZ, _mm_mul_ps(_mm_sub_ps(OZ, BZ), S));
+				const __m128 CutB = _mm_and_ps(Cross, BaseMoves);
+				const __m128 CutO = _mm_andnot_ps(BaseMoves, Cross);
+				BX = ClipSelect128(CutB, PX, BX);
+				BZ = ClipSelect128(CutB, PZ, BZ);
+				OX = ClipSelect128(CutO, PX, OX);
+				OZ = ClipSelect128(CutO, PZ, OZ);
+
+				if (X >= FirstX)
+				{
+					const int Row = (X - FirstX) * 4;
+					_mm_store_ps(Lanes.Min + Row, ClipSelect128(Cross, PZ, Inf));
+					_mm_store_ps(Lanes.Max + Row, ClipSelect128(Cross, PZ, NegInf));
+					_mm_store_ps(Lanes.Cnt + Row, _mm_and_ps(Cross, One));
+				}
+			}
+
+			const int JBegin = XBegin > FirstX ? XBegin - FirstX : 0;
+			const int JEnd = XEnd - FirstX;
+			if (JBegin < JEnd)
+			{
+				ClipFoldLanes(Lanes, 4, 0, JBegin, JEnd, Out);
+			}
+
+			alignas(16) float Cut[4][4];
+			_mm_store_ps(Cut[0], BX);
+			_mm_store_ps(Cut[1], BZ);
+			_mm_store_ps(Cut[2], OX);
+			_mm_store_ps(Cut[3], OZ);
+			for (int Lane = 0; Lane < LaneNum; ++Lane)
+			{
+				FClipEdge& Edge = Edges[Begin + Lane];
+				Edge.BX = Cut[0][Lane];
+				Edge.BZ = Cut[1][Lane];
+				Edge.OX = Cut[2][Lane];
+				Edge.OZ = Cut[3][Lane];
+			}
+		}
+	}
+#endif
+
+#if INSIGHT_CLIP_KERNEL_AVX
+	// Same walk with 8 edges in the lanes, which covers any row polygon in one pass. Most row polygons have no
+	// more than four edges and leave half of that idle, those take the SSE walk.
+	static void IntersectEdgesAVX(FClipEdge* Edges, int Num, float GridMinX, float CellSize, int FirstX, FClipBoundaries& Out)
+	{
+		if (Num <= 4)
+		{
+			IntersectEdgesSSE(Edges, Num, GridMinX, CellSize, FirstX, Out);
+			return;
+		}
+
+		const __m256 Inf = _mm256_set1_ps(std::numeric_limits<float>::infinity());
+		const __m256 NegInf = _mm256_set1_ps(-std::numeric_limits<float>::infinity());
+		const __m256 One = _mm256_set1_ps(1.0f);
+		FClipLaneCrossings Lanes;
+
+		FClipEdge E[8] = {};
+		int XBegin = 0, XEnd = 0;
+		for (int Lane = 0; Lane < Num; ++Lane)
+		{
+			E[Lane] = Edges[Lane];
+			if (E[Lane].Start < E[Lane].End)
+			{
+				XBegin = XBegin == XEnd || E[Lane].Start < XBegin ? E[Lane].Start : XBegin;
+				XEnd = E[Lane].End > XEnd ? E[Lane].End : XEnd;
+			}
+		}
+
+		__m256 BX = _mm256_setr_ps(E[0].BX, E[1].BX, E[2].BX, E[3].BX, E[4].BX, E[5].BX, E[6].BX, E[7].BX);
+		__m256 BZ = _mm256_setr_ps(E[0].BZ, E[1].BZ, E[2].BZ, E[3].BZ, E[4].BZ, E[5].BZ, E[6].BZ, E[7].BZ);
+		__m256 OX = _mm256_setr_ps(E[0].OX, E[1].OX, E[2].OX, E[3].OX, E[4].OX, E[5].OX, E[6].OX, E[7].OX);
+		__m256 OZ = _mm256_setr_ps(E[0].OZ, E[1].OZ, E[2].OZ, E[3].OZ, E[4].OZ, E[5].OZ, E[6].OZ, E[7].OZ);
+		const __m256 BaseMoves = _mm256_castsi256_ps(_mm256_setr_epi32(-E[0].bBaseMoves, -E[1].bBaseMoves, -E[2].bBaseMoves,
+			-E[3].bBaseMoves, -E[4].bBaseMoves, -E[5].bBaseMoves, -E[6].bBaseMoves, -E[7].bBaseMoves));
+		const __m256 Start = _mm256_cvtepi32_ps(_mm256_setr_epi32(E[0].Start, E[1].Start, E[2].Start, E[3].Start, E[4].Start,
+			E[5].Start, E[6].Start, E[7].Start));
+		const __m256 End = _mm256_cvtepi32_ps(_mm256_setr_epi32(E[0].End, E[1].End, E[2].End, E[3].End, E[4].End, E[5].End,
+			E[6].End, E[7].End));
+
+		for (int X = XBegin; X < XEnd; ++X)
+		{
+			const __m256 XF = _mm256_set1_ps(static_cast<float>(X));
+			const __m256 Cross = _mm256_and_ps(_mm256_cmp_ps(XF, Start, _CMP_GE_OQ), _mm256_cmp_ps(XF, End, _CMP_LT_OQ));
+
+			const __m256 U = _mm256_set1_ps(ClipCellUpper(GridMinX, CellSize, X));
+			const __m256 DB = _mm256_sub_ps(U, BX);
+			const __m256 DO = _mm256_sub_ps(U, OX);
+			const __m256 S = _mm256_div_ps(DB, _mm256_sub_ps(DB, DO));
+			const __m256 PX = _mm256_add_ps(BX, _mm256_mul_ps(_mm256_sub_ps(OX, BX), S));
+			const __m256 PZ = _mm256_add_ps(BZ, _mm256_mul_ps(_mm256_sub_ps(OZ, BZ), S));
+			const __m256 CutB = _mm256_and_ps(Cross, BaseMoves);
+			const __m256 CutO = _mm256_andnot_ps(BaseMoves, Cross);
+			BX = _mm256_blendv_ps(BX, PX, CutB);
+			BZ = _mm256_blendv_ps(BZ, PZ, CutB);
+			OX = _mm256_blendv_ps(OX, PX, CutO);
+			OZ = _mm256_blendv_ps(OZ, PZ, CutO);
+
+			if (X >= FirstX)
+			{
+				const int Row = (X - FirstX) * 8;
+				_mm256_store_ps(Lanes.Min + Row, _mm256_blendv_ps(Inf, PZ, Cross));
+				_mm256_store_ps(Lanes.Max + Row, _mm256_blendv_ps(NegInf, PZ, Cross));
+				_mm256_store_ps(Lanes.Cnt + Row, _mm256_and_ps(Cross, One));
+			}
+		}
+
+		const int JBegin = XBegin > FirstX ? XBegin - FirstX : 0;
+		const int JEnd = XEnd - FirstX;
+		if (JBegin < JEnd)
+		{
+			ClipFoldLanes(Lanes, 8, 0, JBegin, JEnd, Out);
+			ClipFoldLanes(Lanes, 8, 4, JBegin, JEnd, Out);
+		}
+
+		alignas(32) float Cut[4][8];
+		_mm256_store_ps(Cut[0], BX);
+		_mm256_store_ps(Cut[1], BZ);
+		_mm256_store_ps(Cut[2], OX);
+		_mm256_store_ps(Cut[3], OZ);
+		for (int Lane = 0; Lane < Num; ++Lane)
+		{
+			Edges[Lane].BX = Cut[0][Lane];
+			Edges[Lane].BZ = Cut[1][Lane];
+			Edges[Lane].OX = Cut[2][Lane];
+			Edges[Lane].OZ = Cut[3][Lane];
+		}
+	}
+#endif
+
+	static void ResolveCells(const FRowPolySoA& Poly, const int* VertCells, float GridMinX, float CellSize, int RowX0, int X0, int X1,
+							 const FClipBoundaries& Bounds, float* OutMin, float* OutMax, uint8_t* OutValid)
+	{
+		const float Inf = std::numeric_limits<float>::infinity();
+		const int CellNum = X1 - X0 + 1;
+
+		// Boundary I is the lower edge of cell I, boundary I + 1 the upper edge. Cell RowX0 has no lower edge.
+		int Cnt[ClipKernelMaxCells];
+		for (int I = 0; I < CellNum; ++I)
+		{
+			const bool bHasLower = X0 + I > RowX0;
+			OutMin[I] = bHasLower && Bounds.Min[I] < Bounds.Min[I + 1] ? Bounds.Min[I] : Bounds.Min[I + 1];
+			OutMax[I] = bHasLower && Bounds.Max[I] > Bounds.Max[I + 1] ? Bounds.Max[I] : Bounds.Max[I + 1];
+			Cnt[I] = static_cast<int>(Bounds.Cnt[I + 1]) + (bHasLower ? static_cast<int>(Bounds.Cnt[I]) : 0);
+		}
+
+		// Corners of the row polygon. A corner exactly on the upper boundary of its cell is already emitted as
+		// an edge crossing when the previous corner lies to the right; DividePoly then does not add it again.
+		for (int V = 0; V < Poly.Num; ++V)
+		{
+			const int X = VertCells[V];
+			if (X < X0 || X > X1)
+			{
+				continue;
+			}
+			const float VX = Poly.X[V];
+			const float VZ = Poly.Z[V];
+			const float PrevX = Poly.X[V == 0 ? Poly.Num - 1 : V - 1];
+			if (ClipCellUpper(GridMinX, CellSize, X) == VX && PrevX > VX)
+			{
+				continue;
+			}
+
+			const int I = X - X0;
+			OutMin[I] = VZ < OutMin[I] ? VZ : OutMin[I];
+			OutMax[I] = VZ > OutMax[I] ? VZ : OutMax[I];
+			++Cnt[I];
+		}
+
+		for (int I = 0; I < CellNum; ++I)
+		{
+			OutValid[I] = Cnt[I] >= 3 && OutMin[I] != Inf;
+		}
+	}
+
+	bool ClipRowSpansWith(EClipKernel Kernel, const FRowPolySoA& Poly, float GridMinX, float CellSize, int RowX0, int X0, int X1,
+						  float* OutMin, float* OutMax, uint8_t* OutValid, FClipRowState* State)
+	{
+		// Boundaries of cells X0 - 1 ... X1
+		FClipBoundaries Bounds;
+		const int FirstX = X0 - 1;
+		const int Num = X1 - X0 + 2;
+		for (int J = 0; J < ((Num + 3) & ~3); ++J)
+		{
+			Bounds.Min[J] = std::numeric_limits<float>::infinity();
+			Bounds.Max[J] = -std::numeric_limits<float>::infinity();
+			Bounds.Cnt[J] = 0.0f;
+		}
+
+		int VertCells[FRowPolySoA::MaxVerts];
+		ClipVertexCells(Poly, GridMinX, CellSize, RowX0, X1, VertCells);
+
+		// Resuming the previous call of the row: its edges are cut up to boundary X0 - 1, whose crossings it kept
+		const bool bResume = State && State->bStarted && State->NextX == X0;
+		FClipEdge Edges[FRowPolySoA::MaxVerts];
+		for (int I = 0; I < Poly.Num; ++I)
+		{
+			Edges[I] = ClipEdge(Poly, VertCells, I);
+			if (bResume)
+			{
+				Edges[I].BX = State->BX[I];
+				Edges[I].BZ = State->BZ[I];
+				Edges[I].OX = State->OX[I];
+				Edges[I].OZ = State->OZ[I];
+				Edges[I].Start = Edges[I].Start > X0 ? Edges[I].Start : X0;
+			}
+		}
+		if (bResume)
+		{
+			Bounds.Min[0] = State->LastMin;
+			Bounds.Max[0] = State->LastMax;
+			Bounds.Cnt[0] = State->LastCnt;
+		}
+
+		switch (Kernel)
+		{
+		case EClipKernel::Scalar:
+			IntersectEdgesScalar(Edges, Poly.Num, GridMinX, CellSize, FirstX, Bounds);
+			break;
+		case EClipKernel::SSE:
+#if INSIGHT_CLIP_KERNEL_SSE
+			IntersectEdgesSSE(Edges, Poly.Num, GridMinX, CellSize, FirstX, Bounds);
+			break;
+#else
+			return false;
+#endif
+		case EClipKernel::AVX:
+#if INSIGHT_CLIP_KERNEL_AVX
+			IntersectEdgesAVX(Edges, Poly.Num, GridMinX, CellSize, FirstX, Bounds);
+			break;
+#else
+			return false;
+#endif
+		}
+
+		if (State)
+		{
+			State->bStarted = true;
+			State->NextX = X1 + 1;
+			for (int I = 0; I < Poly.Num; ++I)
+			{
+				State->BX[I] = Edges[I].BX;
+				State->BZ[I] = Edges[I].BZ;
+				State->OX[I] = Edges[I].OX;
+				State->OZ[I] = Edges[I].OZ;
+			}
+			State->LastMin = Bounds.Min[Num - 1];
+			State->LastMax = Bounds.Max[Num - 1];
+			State->LastCnt = Bounds.Cnt[Num - 1];
+		}
+
+		ResolveCells(Poly, VertCells, GridMinX, CellSize, RowX0, X0, X1, Bounds, OutMin, OutMax, OutValid);
+		return true;
+	}
+
+	EClipKernel GetDefaultClipKernel()
+	{
+		return EClipKernel::Scalar;
+	}
+
+	const char* GetClipKernelName(EClipKernel Kernel)
+	{
+		switch (Kernel)
+		{
+		case EClipKernel::SSE:
+			return "sse";
+		case EClipKernel::AVX:
+			return "avx";
+		default:
+			return "scalar";
+		}
+	}
+
+	void ClipRowSpans(const FRowPolySoA& Poly, float GridMinX, float CellSize, int RowX0, int X0, int X1,
+					  float* OutMin, float* OutMax, uint8_t* OutValid, FClipRowState* State)
+	{
+		ClipRowSpansWith(GetDefaultClipKernel(), Poly, GridMinX, CellSize, RowX0, X0, X1, OutMin, OutMax, OutValid, State);
+	}
+}
@@ -0,0 +1,325 @@
+#include "VoxelCore/InsightVoxelComponents.h"
+#include "VoxelCore/InsightVoxelBits.h"
+#include "VoxelCore/InsightVoxelGrid.h"
+
+#include <algorithm>
+
+namespace InsightVoxel
+{
+	const uint32_t FComponentLabels::NoComponent;
+
+	// Union-find over run indices. The higher root is always linked below the lower one, so every parent is at
+	// most its child and an ascending pass sees the roots first.
+	static uint32_t FindRoot(std::vector<uint32_t>& Parents, uint32_t Index)
+	{
+		while (Parents[Index] != Index)
+		{
+			Parents[Index] = Parents[Parents[Index]];
+			Index = Parents[Index];
+		}
+		return Index;
+	}
+
+	static void UnionRoots(std::vector<uint32_t>& Parents, uint32_t A, uint32_t B)
+	{
+		A = FindRoot(Parents, A);
+		B = FindRoot(Parents, B);
+		if (A != B)
+		{
+			Parents[std::max(A, B)] = std::min(A, B);
+		}
+	}
+
+	// Union the runs of two neighbouring columns that share a Z (ranges sorted, so one merge pass)
+	template <typename FRunType, typename FUnionFn>
+	static void JoinColumns(const FRunType* RunsA, uint32_t NumA, uint32_t BeginA, const FRunType* RunsB, uint32_t NumB, uint32_t BeginB,
+							FUnionFn&& Union)
+	{
+		uint32_t A = 0, B = 0;
+		while (A < NumA && B < NumB)
+		{
+			if (RunsA[A].ZMin < RunsB[B].ZMax && RunsB[B].ZMin < RunsA[A].ZMax)
+			{
+				Union(BeginA + A, BeginB + B);
+			}
+			if (RunsA[A].ZMax < RunsB[B].ZMax)
+			{
+				++A;
+			}
+			else
+			{
+				++B;
+			}
+		}
+	}
+
+	// First bit of the column at or above Z that is set (bSet) or clear, ZNum if there is none
+	static int FindNextBit(const uint64_t* Column, int ColumnWords, int ZNum, int Z, bool bSet)
+	{
+		for (int Word = Z >> 6; Word < ColumnWords; ++Word)
+		{
+			uint64_t Bits = bSet ? Column[Word] : ~Column[Word];
+			if (Word == Z >> 6)
+			{
+				Bits &= ~0ull << (Z & 63);
+			}
+			if (Bits)
+			{
+				return std::min(Word * 64 + LowestBit64(Bits), ZNum);
+			}
+		}
+		return ZNum;
+	}
+
+	void FComponentLabels::Build(const FVoxelGrid& Walkable, int InBandColumns, const FParallelForFn& ParallelFor)
+	{
+		Reset();
+		if (Walkable.GetXNum() == 0 || Walkable.GetYNum() == 0)
+		{
+			return;
+		}
+
+		XNum = Walkable.GetXNum();
+		YNum = Walkable.GetYNum();
+		ZNum = Walkable.GetZNum();
+		BandColumns = std::max(InBandColumns, 1);
+		Tiling.Init(XNum, YNum, BandColumns, YNum);
+
+		Bands.resize(Tiling.GetTileNum());
+		ParallelFor(static_cast<int>(Bands.size()), [&](int BandIndex) { BuildBand(Walkable, BandIndex); });
+		RebuiltBandNum = static_cast<int>(Bands.size());
+
+		LabelComponents();
+	}
+
+	void FComponentLabels::Update(const FVoxelGrid& Walkable, const FVoxelTile& Columns, const FParallelForFn& ParallelFor)
+	{
+		if (!IsBuilt())
+		{
+			return;
+		}
+
+		if (Walkable.GetXNum() != XNum || Walkable.GetYNum() != YNum || Walkable.GetZNum() != ZNum)
+		{
+			Build(Walkable, BandColumns, ParallelFor);
+			return;
+		}
+
+		const FVoxelTile Clipped(std::max(Columns.X0, 0), std::max(Columns.Y0, 0), std::min(Columns.X1, XNum), std::min(Columns.Y1, YNum));
+		RebuiltBandNum = 0;
+		if (Clipped.IsEmpty())
+		{
+			return;
+		}
+
+		// Joins only ever look one column back along X, inside a band; the border joins are all redone anyway
+		const int Band0 = Clipped.X0 / BandColumns;
+		const int Band1 = (Clipped.X1 - 1) / BandColumns;
+		ParallelFor(Band1 - Band0 + 1, [&](int i) { BuildBand(Walkable, Band0 + i); });
+		RebuiltBandNum = Band1 - Band0 + 1;
+
+		LabelComponents();
+	}
+
+	void FComponentLabels::Reset()
+	{
+		*this = FComponentLabels();
+	}
+
+	void FComponentLabels::BuildBand(const FVoxelGrid& Walkable, int BandIndex)
+	{
+		const FVoxelTile Tile = Tiling.GetTile(BandIndex);
+		const int ColumnWords = Walkable.GetColumnWords();
+		FBand& Band = Bands[BandIndex];
+		Band.ColumnStart.assign(static_cast<size_t>(Tile.X1 - Tile.X0) * YNum + 1, 0);
+		Band.Runs.clear();
+
+		for (int X = Tile.X0; X < Tile.X1; ++X)
+		{
+			for (int Y = 0; Y < YNum; ++Y)
+			{
+				Band.ColumnStart[static_cast<size_t>(X - Tile.X0) * YNum + Y] = static_cast<uint32_t>(Band.Runs.size());
+				const uint64_t* Column = Walkable.GetColumn(X, Y);
+				for (int Z = FindNextBit(Column, ColumnWords, ZNum, 0, true); Z < ZNum;)
+				{
+					const int End = FindNextBit(Column, ColumnWords, ZNum, Z, false);
+					Band.Runs.push_back({Z, End});
+					Z = FindNextBit(Column, ColumnWords, ZNum, End, true);
+				}
+			}
+		}
+		Band.ColumnStart.back() = static_cast<uint32_t>(Band.Runs.size());
+
+		Band.LocalRoots.resize(Band.Runs.size());
+		for (uint32_t Run = 0; Run < Band.LocalRoots.size(); ++Run)
+		{
+			Band.LocalRoots[Run] = Run;
+		}
+
+		auto Union = [&Band](uint32_t A, uint32_t B) { UnionRoots(Band.LocalRoots, A, B); };
+		for (int X = Tile.X0; X < Tile.X1; ++X)
+		{
+			for (int Y = 0; Y < YNum; ++Y)
+			{
+				const size_t Column = static_cast<size_t>(X - Tile.X0) * YNum + Y;
+				const uint32_t Begin = Band.ColumnStart[Column];
+				const uint32_t Num = Band.ColumnStart[Column + 1] - Begin;
+				if (Y > 0)
+				{
+					const uint32_t Other = Band.ColumnStart[Column - 1];
+					JoinColumns(Band.Runs.data() + Begin, Num, Begin, Band.Runs.data() + Other, Begin - Other, Other, Union);
+				}
+				if (X > Tile.X0)
+				{
+					const uint32_t Other = Band.ColumnStart[Column - YNum];
+					JoinColumns(Band.Runs.data() + Begin, Num, Begin, Band.Runs.data() + Other, Band.ColumnStart[Column - YNum + 1] - Other, Other,
+						Union);
+				}
+			}
+		}
+
+		for (uint32_t Run = 0; Run < Band.LocalRoots.size(); ++Run)
+		{
+			Band.LocalRoots[Run] = Band.LocalRoots[Band.LocalRoots[Run]];
+		}
+	}
+
+	void FComponentLabels::LabelComponents()
+	{
+		BandRunBegin.resize(Bands.size() + 1);
+		BandRunBegin[0] = 0;
+		for (size_t BandIndex = 0; BandIndex < Bands.size(); ++BandIndex)
+		{
+			BandRunBegin[BandIndex + 1] = BandRunBegin[BandIndex] + static_cast<uint32_t>(Bands[BandIndex].Runs.size());
+		}
+
+		// Bands are in run order, so their local roots stay valid parents globally
+		Labels.resize(BandRunBegin.back());
+		for (size_t BandIndex = 0; BandIndex < Bands.size(); ++BandIndex)
+		{
+			const uint32_t Begin = BandRunBegin[BandIndex];
+			const std::vector<uint32_t>& LocalRoots = Bands[BandIndex].LocalRoots;
+			for (size_t Run = 0; Run < LocalRoots.size(); ++Run)
+			{
+				Labels[Begin + Run] = Begin + LocalRoots[Run];
+			}
+		}
+
+		auto Union = [this](uint32_t A, uint32_t B) { UnionRoots(Labels, A, B); };
+		for (size_t BandIndex = 1; BandIndex < Bands.size(); ++BandIndex)
+		{
+			const int X = Tiling.GetTile(static_cast<int>(BandIndex)).X0;
+			for (int Y = 0; Y < YNum; ++Y)
+			{
+				uint32_t NumA, NumB;
+				const uint32_t BeginA = GetColumnRuns(X - 1, Y, NumA);
+				const uint32_t BeginB = GetColumnRuns(X, Y, NumB);
+				const FBand& BandA = Bands[BandIndex - 1];
+				const FBand& BandB = Bands[BandIndex];
+				JoinColumns(BandA.Runs.data() + (BeginA - BandRunBegin[BandIndex - 1]), NumA, BeginA,
+					BandB.Runs.data() + (BeginB - BandRunBegin[BandIndex]), NumB, BeginB, Union);
+			}
+		}
+
+		// Parents come first and already hold their component, so components are numbered by their lowest run
+		ComponentNum = 0;
+		for (uint32_t Run = 0; Run < Labels.size(); ++Run)
+		{
+			const uint32_t Parent = Labels[Run];
+			Labels[Run] = Parent == Run ? static_cast<uint32_t>(ComponentNum++) : Labels[Parent];
+		}
+	}
+
+	uint32_t FComponentLabels::GetColumnRuns(int X, int Y, uint32_t& OutNum) const
+	{
+		const int BandIndex = X / BandColumns;
+		const FBand& Band = Bands[BandIndex];
+		const size_t Column = static_cast<size_t>(X - BandIndex * BandColumns) * YNum + Y;
+		OutNum = Band.ColumnStart[Column + 1] - Band.ColumnStart[Column];
+		return BandRunBegin[BandIndex] + Band.ColumnStart[Column];
+	}
+
+	uint32_t FComponentLabels::GetComponent(int X, int Y, int Z) const
+	{
+		if (!IsBuilt() || X < 0 || X >= XNum || Y < 0 || Y >= YNum || Z < 0 || Z >= ZNum)
+		{
+			return NoComponent;
+		}
+
+		uint32_t Num;
+		const uint32_t Begin = GetColumnRuns(X, Y, Num);
+		const FRun* Runs = Bands[X / BandColumns].Runs.data() + (Begin - BandRunBegin[X / BandColumns]);
+		for (uint32_t Run = 0; Run < Num && Runs[Run].ZMin <= Z; ++Run)
+		{
+			if (Z < Runs[Run].ZMax)
+			{
+				return Labels[Begin + Run];
+			}
+		}
+		return NoComponent;
+	}
+
+	bool FComponentLabels::CanConnect(const FIntVec3& StartIdx, const FIntVec3& EndIdx) const
+	{
+		if (!StartIdx.IsValid() || !EndIdx.IsValid())
+		{
+			return false;
+		}
+		if (!IsBuilt() || StartIdx == EndIdx)
+		{
+			return true;
+		}
+
+		const uint32_t Goal = GetComponent(EndIdx.X, EndIdx.Y, EndIdx.Z);
+		if (Goal == NoComponent)
+		{
+			return false;
+		}
+
+		const uint32_t Start = GetComponent(StartIdx.X, StartIdx.Y, StartIdx.Z);
+		if (Start != NoComponent)
+		{
+			return Start == Goal;
+		}
+
+		// A start that is not stayable itself still steps onto its neighbours
+		static const int DirX[] = {-1, 1, 0, 0, 0, 0};
+		static const int DirY[] = {0, 0, -1, 1, 0, 0};
+		static const int DirZ[] = {0, 0, 0, 0, -1, 1};
+		for (int Dir = 0; Dir < 6; ++Dir)
+		{
+			if (GetComponent(StartIdx.X + DirX[Dir], StartIdx.Y + DirY[Dir], StartIdx.Z + DirZ[Dir]) == Goal)
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	size_t FComponentLabels::GetAllocatedBytes() const
+	{
+		size_t Bytes = (BandRunBegin.capacity() + Labels.capacity()) * sizeof(uint32_t) + Bands.capacity() * sizeof(FBand);
+		for (const FBand& Band : Bands)
+		{
+			Bytes += (Band.ColumnStart.capacity() + Band.LocalRoots.capacity()) * sizeof(uint32_t) + Band.Runs.capacity() * sizeof(FRun);
+		}
+		return Bytes;
+	}
+
+	bool FComponentLabels::HasSameLabels(const FComponentLabels& Other) const
+	{
+		if (XNum != Other.XNum || YNum != Other.YNum || ZNum != Other.ZNum || BandColumns != Other.BandColumns
+			|| ComponentNum != Other.ComponentNum || Labels != Other.Labels || Bands.size() != Other.Bands.size())
+		{
+			return false;
+		}
+		for (size_t BandIndex = 0; BandIndex < Bands.size(); ++BandIndex)
+		{
+			if (Bands[BandIndex].ColumnStart != Other.Bands[BandIndex].ColumnStart || Bands[BandIndex].Runs != Other.Bands[BandIndex].Runs)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+}
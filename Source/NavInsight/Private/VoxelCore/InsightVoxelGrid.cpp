@@ -0,0 +1,323 @@
+#include "VoxelCore/InsightVoxelGrid.h"
+#include "VoxelCore/InsightVoxelBits.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+namespace InsightVoxel
+{
+	FVoxelGrid::FVoxelGrid(const FVoxelGrid& Other)
+	{
+		*this = Other;
+	}
+
+	FVoxelGrid& FVoxelGrid::operator=(const FVoxelGrid& Other)
+	{
+		if (this != &Other)
+		{
+			Bounds = Other.Bounds;
+			CellSize = Other.CellSize;
+			CellHeight = Other.CellHeight;
+			XNum = Other.XNum;
+			YNum = Other.YNum;
+			ZNum = Other.ZNum;
+			ColumnWords = Other.ColumnWords;
+
+			Words.assign(Other.Data, Other.Data + Other.WordNum);
+			ExternalOwner.reset();
+			Data = Words.data();
+			WordNum = Other.WordNum;
+		}
+		return *this;
+	}
+
+	FVoxelGrid::FVoxelGrid(FVoxelGrid&& Other) noexcept
+	{
+		*this = std::move(Other);
+	}
+
+	FVoxelGrid& FVoxelGrid::operator=(FVoxelGrid&& Other) noexcept
+	{
+		if (this != &Other)
+		{
+			Bounds = Other.Bounds;
+			CellSize = Other.CellSize;
+			CellHeight = Other.CellHeight;
+			XNum = Other.XNum;
+			YNum = Other.YNum;
+			ZNum = Other.ZNum;
+			ColumnWords = Other.ColumnWords;
+
+			// Moving the vector keeps its buffer, so Data stays valid
+			Words = std::move(Other.Words);
+			ExternalOwner = std::move(Other.ExternalOwner);
+			Data = Other.Data;
+			WordNum = Other.WordNum;
+
+			Other.Words.clear();
+			Other.Data = nullptr;
+			Other.WordNum = 0;
+			Other.XNum = Other.YNum = Other.ZNum = Other.ColumnWords = 0;
+		}
+		return *this;
+	}
+
+	void FVoxelGrid::SetDimensions(const FBounds3& InBounds, float InCellSize, float InCellHeight)
+	{
+		Bounds = InBounds;
+		CellSize = InCellSize;
+		CellHeight = InCellHeight;
+
+		XNum = static_cast<int>((Bounds.Max.X - Bounds.Min.X) / CellSize + 0.5f);
+		YNum = static_cast<int>((Bounds.Max.Y - Bounds.Min.Y) / CellSize + 0.5f);
+		ZNum = static_cast<int>((Bounds.Max.Z - Bounds.Min.Z) / CellHeight + 0.5f);
+
+		ColumnWords = (ZNum + 63) / 64;
+		WordNum = static_cast<size_t>(static_cast<int64_t>(XNum) * YNum * ColumnWords);
+	}
+
+	void FVoxelGrid::Init(const FBounds3& InBounds, float InCellSize, float InCellHeight)
+	{
+		SetDimensions(InBounds, InCellSize, InCellHeight);
+
+		ExternalOwner.reset();
+		Words.assign(WordNum, 0);
+		Data = Words.data();
+	}
+
+	void FVoxelGrid::InitExternal(const FBounds3& InBounds, float InCellSize, float InCellHeight, uint64_t* InWords,
+								  std::shared_ptr<void> InOwner)
+	{
+		SetDimensions(InBounds, InCellSize, InCellHeight);
+
+		Words.clear();
+		Words.shrink_to_fit();
+		ExternalOwner = std::move(InOwner);
+		Data = InWords;
+	}
+
+	void FVoxelGrid::SetVoxelOccupied(int X, int Y, int Z, bool Flag)
+	{
+		uint64_t& Word = Data[ColumnOffset(X, Y) + (Z >> 6)];
+		const uint64_t Bit = 1ull << (Z & 63);
+
+		if (Flag)
+		{
+			Word |= Bit;
+		}
+		else
+		{
+			Word &= ~Bit;
+		}
+	}
+
+	bool FVoxelGrid::GetVoxelOccupied(int X, int Y, int Z) const
+	{
+		return (Data[ColumnOffset(X, Y) + (Z >> 6)] >> (Z & 63)) & 0x1;
+	}
+
+	void FVoxelGrid::SetSpan(int X, int Y, int ZMin, int ZMax)
+	{
+		if (ZMin >= ZMax)
+		{
+			return;
+		}
+
+		uint64_t* Column = GetColumn(X, Y);
+		const int WordMin = ZMin >> 6;
+		const int WordMax = (ZMax - 1) >> 6;
+
+		if (WordMin == WordMax)
+		{
+			Column[WordMin] |= BitRangeMask64(ZMin & 63, ZMax - (WordMin << 6));
+			return;
+		}
+
+		Column[WordMin] |= BitRangeMask64(ZMin & 63, 64);
+		for (int WordIndex = WordMin + 1; WordIndex < WordMax; ++WordIndex)
+		{
+			Column[WordIndex] = ~0ull;
+		}
+		Column[WordMax] |= BitRangeMask64(0, ZMax - (WordMax << 6));
+	}
+
+	void FVoxelGrid::ClearColumns(const FVoxelTile& Columns)
+	{
+		// Columns of one X are consecutive, so every X of the rect is a single run of words
+		for (int X = std::max(Columns.X0, 0); X < std::min(Columns.X1, XNum); ++X)
+		{
+			const int Y0 = std::max(Columns.Y0, 0);
+			const int Y1 = std::min(Columns.Y1, YNum);
+			if (Y0 < Y1)
+			{
+				std::fill(Data + ColumnOffset(X, Y0), Data + ColumnOffset(X, Y1 - 1) + ColumnWords, 0);
+			}
+		}
+	}
+
+	FVoxelTile FVoxelGrid::GetColumnRect(const FBounds3& Box, int Margin) const
+	{
+		if (!Box.Intersect(Bounds) || XNum == 0 || YNum == 0)
+		{
+			return {};
+		}
+
+		const int X0 = static_cast<int>(std::floor((Box.Min.X - Bounds.Min.X) / CellSize)) - Margin;
+		const int Y0 = static_cast<int>(std::floor((Box.Min.Y - Bounds.Min.Y) / CellSize)) - Margin;
+		const int X1 = static_cast<int>(std::floor((Box.Max.X - Bounds.Min.X) / CellSize)) + 1 + Margin;
+		const int Y1 = static_cast<int>(std::floor((Box.Max.Y - Bounds.Min.Y) / CellSize)) + 1 + Margin;
+
+		return {
+			std::min(std::max(X0, 0), XNum),
+			std::min(std::max(Y0, 0), YNum),
+			std::min(std::max(X1, 0), XNum),
+			std::min(std::max(Y1, 0), YNum)
+		};
+	}
+
+	bool FVoxelGrid::IsAnyOccupied(int X, int Y, int ZMin, int ZMax) const
+	{
+		ZMin = std::max(ZMin, 0);
+		ZMax = std::min(ZMax, ZNum);
+		if (ZMin >= ZMax)
+		{
+			return false;
+		}
+
+		const uint64_t* Column = GetColumn(X, Y);
+		const int WordMin = ZMin >> 6;
+		const int WordMax = (ZMax - 1) >> 6;
+
+		for (int WordIndex = WordMin; WordIndex <= WordMax; ++WordIndex)
+		{
+			const int Lo = WordIndex == WordMin ? (ZMin & 63) : 0;
+			const int Hi = WordIndex == WordMax ? ZMax - (WordMax << 6) : 64;
+			if (Column[WordIndex] & BitRangeMask64(Lo, Hi))
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	int FVoxelGrid::FindHighestOccupied(int X, int Y, int ZMin, int ZMax) const
+	{
+		ZMin = std::max(ZMin, 0);
+		ZMax = std::min(ZMax, ZNum);
+		if (ZMin >= ZMax)
+		{
+			return -1;
+		}
+
+		const uint64_t* Column = GetColumn(X, Y);
+		const int WordMin = ZMin >> 6;
+		const int WordMax = (ZMax - 1) >> 6;
+
+		for (int WordIndex = WordMax; WordIndex >= WordMin; --WordIndex)
+		{
+			const int Lo = WordIndex == WordMin ? (ZMin & 63) : 0;
+			const int Hi = WordIndex == WordMax ? ZMax - (WordMax << 6) : 64;
+			const uint64_t Masked = Column[WordIndex] & BitRangeMask64(Lo, Hi);
+			if (Masked)
+			{
+				return (WordIndex << 6) + HighestBit64(Masked);
+			}
+		}
+		return -1;
+	}
+
+	bool FVoxelGrid::IsVoxelInside(int X, int Y, int Z) const
+	{
+		if (X < 0 || X >= XNum)
+		{
+			return false;
+		}
+		if (Y < 0 || Y >= YNum)
+		{
+			return false;
+		}
+		if (Z < 0 || Z >= ZNum)
+		{
+			return false;
+		}
+
+		return true;
+	}
+
+	int64_t FVoxelGrid::CountOccupied() const
+	{
+		// Padding bits at the top of each column are never set
+		int64_t Count = 0;
+		for (size_t i = 0; i < WordNum; ++i)
+		{
+			Count += PopCount64(Data[i]);
+		}
+		return Count;
+	}
+
+	bool FVoxelGrid::HasSameOccupancy(const FVoxelGrid& Other) const
+	{
+		return XNum == Other.XNum && YNum == Other.YNum && ZNum == Other.ZNum && std::equal(Data, Data + WordNum, Other.Data);
+	}
+
+	double FOccupancyDiff::GetIoU() const
+	{
+		const int64_t UnionNum = BothNum + OnlyANum + OnlyBNum;
+		return UnionNum > 0 ? static_cast<double>(BothNum) / UnionNum : 1.0;
+	}
+
+	bool CompareOccupancy(const FVoxelGrid& A, const FVoxelGrid& B, FOccupancyDiff& OutDiff)
+	{
+		// Origins a fraction of a cell apart would shift every voxel
+		const float Tolerance = 1e-3f * std::min(A.GetCellSize(), A.GetCellHeight());
+		const FVec3& MinA = A.GetBounds().Min;
+		const FVec3& MinB = B.GetBounds().Min;
+		if (A.GetXNum() != B.GetXNum() || A.GetYNum() != B.GetYNum() || A.GetCellSize() != B.GetCellSize()
+			|| A.GetCellHeight() != B.GetCellHeight() || std::abs(MinA.X - MinB.X) > Tolerance
+			|| std::abs(MinA.Y - MinB.Y) > Tolerance || std::abs(MinA.Z - MinB.Z) > Tolerance)
+		{
+			return false;
+		}
+
+		FOccupancyDiff Diff;
+		const int WordsA = A.GetColumnWords();
+		const int WordsB = B.GetColumnWords();
+		const int Words = std::max(WordsA, WordsB);
+		for (int X = 0; X < A.GetXNum(); ++X)
+		{
+			for (int Y = 0; Y < A.GetYNum(); ++Y)
+			{
+				const uint64_t* ColumnA = A.GetColumn(X, Y);
+				const uint64_t* ColumnB = B.GetColumn(X, Y);
+				bool bDiffers = false;
+				for (int i = 0; i < Words; ++i)
+				{
+					// Padding bits are 0, so the shorter column simply runs out of words
+					const uint64_t WordA = i < WordsA ? ColumnA[i] : 0;
+					const uint64_t WordB = i < WordsB ? ColumnB[i] : 0;
+					Diff.BothNum += PopCount64(WordA & WordB);
+					if (WordA != WordB)
+					{
+						Diff.OnlyANum += PopCount64(WordA & ~WordB);
+						Diff.OnlyBNum += PopCount64(WordB & ~WordA);
+						bDiffers = true;
+					}
+				}
+
+				if (bDiffers)
+				{
+					if (Diff.DiffColumnNum == 0)
+					{
+						Diff.FirstDiffX = X;
+						Diff.FirstDiffY = Y;
+					}
+					++Diff.DiffColumnNum;
+				}
+			}
+		}
+
+		OutDiff = Diff;
+		return true;
+	}
+}
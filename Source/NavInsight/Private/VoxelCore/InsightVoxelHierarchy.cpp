@@ -0,0 +1,800 @@
+#include "VoxelCore/InsightVoxelHierarchy.h"
+#include "VoxelCore/InsightVoxelBits.h"
+#include "VoxelCore/InsightVoxelGrid.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+namespace InsightVoxel
+{
+	// 6 move directions, Dir / 2 is the axis and Dir & 1 the sign (0: negative, 1: positive)
+	static const int FloodDirNum = 6;
+	static const int FloodDirX[] = {-1, 1, 0, 0, 0, 0};
+	static const int FloodDirY[] = {0, 0, -1, 1, 0, 0};
+	static const int FloodDirZ[] = {0, 0, 0, 0, -1, 1};
+
+	// Entrance runs at least this long along the border get a node pair at both ends instead of one in the middle
+	static const int LongEntranceCells = 6;
+
+	// Clusters rebuilt by one task, which share its flood scratch
+	static const int ClustersPerTask = 16;
+
+	const uint32_t FPathHierarchy::NoPath;
+
+	static inline uint32_t HierarchyHeuristic(const FIntVec3& A, const FIntVec3& B)
+	{
+		return static_cast<uint32_t>(std::abs(A.X - B.X) + std::abs(A.Y - B.Y) + std::abs(A.Z - B.Z));
+	}
+
+	// Breadth first search over the walkable voxels of one cluster's columns. Moves all cost 1, so the first
+	// visit of a voxel is a shortest one; visits are stamped with a generation instead of being cleared.
+	class FClusterFlood
+	{
+	public:
+		void Init(const FVoxelGrid& InWalkable, const FVoxelTile& InTile)
+		{
+			Walkable = &InWalkable;
+			Tile = InTile;
+			ZNum = InWalkable.GetZNum();
+			const size_t CellNum = static_cast<size_t>(Tile.X1 - Tile.X0) * (Tile.Y1 - Tile.Y0) * ZNum;
+			if (Cells.size() < CellNum)
+			{
+				Cells.resize(CellNum);
+			}
+		}
+
+		// Visit everything reachable from Source inside the tile, or stop once Target is reached
+		void Run(const FIntVec3& Source, const FIntVec3& Target)
+		{
+			if (++Generation == 0)
+			{
+				for (FCell& Cell : Cells)
+				{
+					Cell.Stamp = 0;
+				}
+				Generation = 1;
+			}
+
+			Queue.clear();
+			Cells[GetCellIndex(Source)] = {Generation, 0, -1};
+			Queue.push_back(Source);
+
+			for (size_t Head = 0; Head < Queue.size(); ++Head)
+			{
+				const FIntVec3 Idx = Queue[Head];
+				if (Idx == Target)
+				{
+					return;
+				}
+
+				const uint32_t Dist = Cells[GetCellIndex(Idx)].Dist + 1;
+				for (int Dir = 0; Dir < FloodDirNum; ++Dir)
+				{
+					const FIntVec3 Next(Idx.X + FloodDirX[Dir], Idx.Y + FloodDirY[Dir], Idx.Z + FloodDirZ[Dir]);
+					if (!Tile.Contains(Next.X, Next.Y) || Next.Z < 0 || Next.Z >= ZNum)
+					{
+						continue;
+					}
+
+					FCell& Cell = Cells[GetCellIndex(Next)];
+					if (Cell.Stamp == Generation || !Walkable->GetVoxelOccupied(Next.X, Next.Y, Next.Z))
+					{
+						continue;
+					}
+					Cell = {Generation, Dist, static_cast<int8_t>(Dir)};
+					Queue.push_back(Next);
+				}
+			}
+		}
+
+		// Path length from the last Source, NoPath if the run did not reach Idx
+		uint32_t GetDist(const FIntVec3& Idx) const
+		{
+			const FCell& Cell = Cells[GetCellIndex(Idx)];
+			return Cell.Stamp == Generation ? Cell.Dist : FPathHierarchy::NoPath;
+		}
+
+		// Append the voxels after the last Source up to Target (included)
+		bool AppendPath(const FIntVec3& Target, std::vector<FIntVec3>& OutPath)
+		{
+			if (GetDist(Target) == FPathHierarchy::NoPath)
+			{
+				return false;
+			}
+
+			Trace.clear();
+			FIntVec3 Idx = Target;
+			for (int Dir = Cells[GetCellIndex(Idx)].Dir; Dir >= 0; Dir = Cells[GetCellIndex(Idx)].Dir)
+			{
+				Trace.push_back(Idx);
+				Idx = {Idx.X - FloodDirX[Dir], Idx.Y - FloodDirY[Dir], Idx.Z - FloodDirZ[Dir]};
+			}
+			OutPath.insert(OutPath.end(), Trace.rbegin(), Trace.rend());
+			return true;
+		}
+
+		size_t GetAllocatedBytes() const
+		{
+			return Cells.capacity() * sizeof(FCell) + (Queue.capacity() + Trace.capacity()) * sizeof(FIntVec3);
+		}
+
+	private:
+		struct FCell
+		{
+			uint32_t Stamp;
+			uint32_t Dist;
+			// Direction the voxel was entered with, -1 for the source
+			int8_t Dir;
+		};
+
+		const FVoxelGrid* Walkable = nullptr;
+		FVoxelTile Tile;
+		int ZNum = 0;
+		std::vector<FCell> Cells;
+		std::vector<FIntVec3> Queue;
+		std::vector<FIntVec3> Trace;
+		uint32_t Generation = 0;
+
+		size_t GetCellIndex(const FIntVec3& Idx) const
+		{
+			return (static_cast<size_t>(Idx.X - Tile.X0) * (Tile.Y1 - Tile.Y0) + (Idx.Y - Tile.Y0)) * ZNum + Idx.Z;
+		}
+	};
+
+	void FPathHierarchy::Build(const FVoxelGrid& Walkable, int InClusterColumns, const FParallelForFn& ParallelFor)
+	{
+		Reset();
+		if (Walkable.GetXNum() == 0 || Walkable.GetYNum() == 0)
+		{
+			return;
+		}
+
+		XNum = Walkable.GetXNum();
+		YNum = Walkable.GetYNum();
+		ZNum = Walkable.GetZNum();
+		ClusterColumns = std::max(InClusterColumns, 1);
+		Tiling.Init(XNum, YNum, ClusterColumns, ClusterColumns);
+
+		const int ClusterNum = Tiling.GetTileNum();
+		XBorders.resize(ClusterNum);
+		YBorders.resize(ClusterNum);
+		Clusters.resize(ClusterNum);
+
+		ParallelFor(ClusterNum, [&](int ClusterIndex)
+		{
+			FindBorderEntrances(Walkable, ClusterIndex, 0, XBorders[ClusterIndex]);
+			FindBorderEntrances(Walkable, ClusterIndex, 1, YBorders[ClusterIndex]);
+		});
+
+		std::vector<int32_t> ClusterIndices(ClusterNum);
+		for (int ClusterIndex = 0; ClusterIndex < ClusterNum; ++ClusterIndex)
+		{
+			ClusterIndices[ClusterIndex] = ClusterIndex;
+		}
+		RebuildClusters(Walkable, ClusterIndices, ParallelFor);
+		UpdateNodeIndices();
+	}
+
+	void FPathHierarchy::Update(const FVoxelGrid& Walkable, const FVoxelTile& Columns, const FParallelForFn& ParallelFor)
+	{
+		if (!IsBuilt())
+		{
+			return;
+		}
+
+		if (Walkable.GetXNum() != XNum || Walkable.GetYNum() != YNum || Walkable.GetZNum() != ZNum)
+		{
+			Build(Walkable, ClusterColumns, ParallelFor);
+			return;
+		}
+
+		const FVoxelTile Clipped(std::max(Columns.X0, 0), std::max(Columns.Y0, 0), std::min(Columns.X1, XNum), std::min(Columns.Y1, YNum));
+		RebuiltClusterNum = 0;
+		if (Clipped.IsEmpty())
+		{
+			return;
+		}
+
+		// Clusters overlapping the changed columns
+		const int TX0 = Clipped.X0 / Tiling.GetTileX();
+		const int TY0 = Clipped.Y0 / Tiling.GetTileY();
+		const int TX1 = (Clipped.X1 - 1) / Tiling.GetTileX();
+		const int TY1 = (Clipped.Y1 - 1) / Tiling.GetTileY();
+
+		// Their borders: +X borders of clusters [TX0 - 1, TX1], +Y borders of rows [TY0 - 1, TY1]
+		struct FBorderJob
+		{
+			int ClusterIndex;
+			int Axis;
+			std::vector<FIntVec3> Entrances;
+		};
+		std::vector<FBorderJob> Jobs;
+		for (int TY = std::max(TY0 - 1, 0); TY <= TY1; ++TY)
+		{
+			for (int TX = std::max(TX0 - 1, 0); TX <= TX1; ++TX)
+			{
+				if (TY >= TY0)
+				{
+					Jobs.push_back({Tiling.GetTileIndex(TX, TY), 0, {}});
+				}
+				if (TX >= TX0)
+				{
+					Jobs.push_back({Tiling.GetTileIndex(TX, TY), 1, {}});
+				}
+			}
+		}
+
+		ParallelFor(static_cast<int>(Jobs.size()), [&](int JobIndex)
+		{
+			FBorderJob& Job = Jobs[JobIndex];
+			FindBorderEntrances(Walkable, Job.ClusterIndex, Job.Axis, Job.Entrances);
+		});
+
+		// The changed clusters, and the neighbours whose entrances on a shared border changed
+		std::vector<uint8_t> bRebuild(Clusters.size(), 0);
+		for (int TY = TY0; TY <= TY1; ++TY)
+		{
+			for (int TX = TX0; TX <= TX1; ++TX)
+			{
+				bRebuild[Tiling.GetTileIndex(TX, TY)] = 1;
+			}
+		}
+
+		for (FBorderJob& Job : Jobs)
+		{
+			std::vector<FIntVec3>& Entrances = Job.Axis == 0 ? XBorders[Job.ClusterIndex] : YBorders[Job.ClusterIndex];
+			if (Entrances == Job.Entrances)
+			{
+				continue;
+			}
+			Entrances.swap(Job.Entrances);
+
+			const int TX = Job.ClusterIndex % Tiling.GetTilesX();
+			const int TY = Job.ClusterIndex / Tiling.GetTilesX();
+			bRebuild[Job.ClusterIndex] = 1;
+			bRebuild[Job.Axis == 0 ? Tiling.GetTileIndex(TX + 1, TY) : Tiling.GetTileIndex(TX, TY + 1)] = 1;
+		}
+
+		std::vector<int32_t> ClusterIndices;
+		for (int ClusterIndex = 0; ClusterIndex < static_cast<int>(Clusters.size()); ++ClusterIndex)
+		{
+			if (bRebuild[ClusterIndex])
+			{
+				ClusterIndices.push_back(ClusterIndex);
+			}
+		}
+		RebuildClusters(Walkable, ClusterIndices, ParallelFor);
+		UpdateNodeIndices();
+	}
+
+	void FPathHierarchy::Reset()
+	{
+		Tiling = FVoxelTiling();
+		XNum = 0;
+		YNum = 0;
+		ZNum = 0;
+		ClusterColumns = 0;
+		XBorders.clear();
+		YBorders.clear();
+		Clusters.clear();
+		ClusterNodeBegin.clear();
+		NodeClusters.clear();
+		RebuiltClusterNum = 0;
+	}
+
+	void FPathHierarchy::FindBorderEntrances(const FVoxelGrid& Walkable, int ClusterIndex, int Axis, std::vector<FIntVec3>& OutEntrances) const
+	{
+		OutEntrances.clear();
+
+		// The border runs along Y between columns X = Across and Across + 1 (Axis 0), or along X between rows
+		// Y = Across and Across + 1 (Axis 1)
+		const FVoxelTile Tile = Tiling.GetTile(ClusterIndex);
+		const int Across = Axis == 0 ? Tile.X1 - 1 : Tile.Y1 - 1;
+		if (Across + 1 >= (Axis == 0 ? XNum : YNum))
+		{
+			return;
+		}
+		const int First = Axis == 0 ? Tile.Y0 : Tile.X0;
+		const int Length = Axis == 0 ? Tile.Y1 - Tile.Y0 : Tile.X1 - Tile.X0;
+
+		// Face cell (T, Z): both voxels of the pair at T along the border and height Z are walkable.
+		// 0 = no crossing, 1 = crossing, 2 = assigned to an entrance.
+		std::vector<uint8_t> Face(static_cast<size_t>(Length) * ZNum, 0);
+		for (int T = 0; T < Length; ++T)
+		{
+			const int X = Axis == 0 ? Across : First + T;
+			const int Y = Axis == 0 ? First + T : Across;
+			const uint64_t* Near = Walkable.GetColumn(X, Y);
+			const uint64_t* Far = Axis == 0 ? Walkable.GetColumn(X + 1, Y) : Walkable.GetColumn(X, Y + 1);
+			for (int Word = 0; Word < Walkable.GetColumnWords(); ++Word)
+			{
+				for (uint64_t Bits = Near[Word] & Far[Word]; Bits; Bits &= Bits - 1)
+				{
+					Face[static_cast<size_t>(T) * ZNum + Word * 64 + LowestBit64(Bits)] = 1;
+				}
+			}
+		}
+
+		// Every 4-connected run of crossings is one entrance. Neighbouring crossings are walkable next to each other
+		// on both sides, so any crossing of a run connects to the one chosen for it without leaving the clusters.
+		std::vector<int> Stack;
+		std::vector<int> Run;
+		for (int Cell = 0; Cell < static_cast<int>(Face.size()); ++Cell)
+		{
+			if (Face[Cell] != 1)
+			{
+				continue;
+			}
+
+			Run.clear();
+			Stack.push_back(Cell);
+			Face[Cell] = 2;
+			while (!Stack.empty())
+			{
+				const int Current = Stack.back();
+				Stack.pop_back();
+				Run.push_back(Current);
+
+				const int T = Current / ZNum;
+				const int Z = Current % ZNum;
+				const int Neighbours[4] = {
+					T > 0 ? Current - ZNum : -1,
+					T + 1 < Length ? Current + ZNum : -1,
+					Z > 0 ? Current - 1 : -1,
+					Z + 1 < ZNum ? Current + 1 : -1
+				};
+				for (const int Neighbour : Neighbours)
+				{
+					if (Neighbour >= 0 && Face[Neighbour] == 1)
+					{
+						Face[Neighbour] = 2;
+						Stack.push_back(Neighbour);
+					}
+				}
+			}
+
+			// Cells are numbered T-major, so the lowest and highest cells are the two ends along the border
+			const int Low = *std::min_element(Run.begin(), Run.end());
+			const int High = *std::max_element(Run.begin(), Run.end());
+			int Chosen[2] = {Low, High};
+			int ChosenNum = 2;
+			if (High / ZNum - Low / ZNum + 1 < LongEntranceCells)
+			{
+				// Short run: the cell closest to its middle
+				int64_t SumT = 0, SumZ = 0;
+				for (const int RunCell : Run)
+				{
+					SumT += RunCell / ZNum;
+					SumZ += RunCell % ZNum;
+				}
+				const int64_t RunNum = static_cast<int64_t>(Run.size());
+				int64_t BestDist = INT64_MAX;
+				for (const int RunCell : Run)
+				{
+					const int64_t Dist = std::abs(RunCell / ZNum * RunNum - SumT) + std::abs(RunCell % ZNum * RunNum - SumZ);
+					if (Dist < BestDist || (Dist == BestDist && RunCell < Chosen[0]))
+					{
+						BestDist = Dist;
+						Chosen[0] = RunCell;
+					}
+				}
+				ChosenNum = 1;
+			}
+
+			for (int i = 0; i < ChosenNum; ++i)
+			{
+				const int T = Chosen[i] / ZNum;
+				const int Z = Chosen[i] % ZNum;
+				OutEntrances.push_back(Axis == 0 ? FIntVec3(Across, First + T, Z) : FIntVec3(First + T, Across, Z));
+			}
+		}
+	}
+
+	void FPathHierarchy::RebuildCluster(const FVoxelGrid& Walkable, int ClusterIndex, FClusterFlood& Flood)
+	{
+		FCluster& Cluster = Clusters[ClusterIndex];
+		const int TX = ClusterIndex % Tiling.GetTilesX();
+		const int TY = ClusterIndex / Tiling.GetTilesX();
+
+		// Nodes on the -X / -Y borders are the voxels across the entrances of the neighbour's +X / +Y border
+		Cluster.Nodes.clear();
+		Cluster.SideBegin[SideNegX] = 0;
+		if (TX > 0)
+		{
+			for (const FIntVec3& Entrance : XBorders[Tiling.GetTileIndex(TX - 1, TY)])
+			{
+				Cluster.Nodes.push_back({Entrance.X + 1, Entrance.Y, Entrance.Z});
+			}
+		}
+		Cluster.SideBegin[SidePosX] = static_cast<int>(Cluster.Nodes.size());
+		Cluster.Nodes.insert(Cluster.Nodes.end(), XBorders[ClusterIndex].begin(), XBorders[ClusterIndex].end());
+		Cluster.SideBegin[SideNegY] = static_cast<int>(Cluster.Nodes.size());
+		if (TY > 0)
+		{
+			for (const FIntVec3& Entrance : YBorders[Tiling.GetTileIndex(TX, TY - 1)])
+			{
+				Cluster.Nodes.push_back({Entrance.X, Entrance.Y + 1, Entrance.Z});
+			}
+		}
+		Cluster.SideBegin[SidePosY] = static_cast<int>(Cluster.Nodes.size());
+		Cluster.Nodes.insert(Cluster.Nodes.end(), YBorders[ClusterIndex].begin(), YBorders[ClusterIndex].end());
+		Cluster.SideBegin[SideNum] = static_cast<int>(Cluster.Nodes.size());
+
+		// One flood per node gives its row; paths are reversible, so the costs are symmetric
+		const size_t NodeNum = Cluster.Nodes.size();
+		Cluster.Costs.assign(NodeNum * NodeNum, NoPath);
+		Flood.Init(Walkable, Tiling.GetTile(ClusterIndex));
+		for (size_t i = 0; i < NodeNum; ++i)
+		{
+			Cluster.Costs[i * NodeNum + i] = 0;
+			if (i + 1 == NodeNum)
+			{
+				break;
+			}
+
+			Flood.Run(Cluster.Nodes[i], FIntVec3::Invalid());
+			for (size_t j = i + 1; j < NodeNum; ++j)
+			{
+				const uint32_t Cost = Flood.GetDist(Cluster.Nodes[j]);
+				Cluster.Costs[i * NodeNum + j] = Cost;
+				Cluster.Costs[j * NodeNum + i] = Cost;
+			}
+		}
+	}
+
+	void FPathHierarchy::RebuildClusters(const FVoxelGrid& Walkable, const std::vector<int32_t>& ClusterIndices, const FParallelForFn& ParallelFor)
+	{
+		const int ClusterNum = static_cast<int>(ClusterIndices.size());
+		ParallelFor((ClusterNum + ClustersPerTask - 1) / ClustersPerTask, [&](int Task)
+		{
+			FClusterFlood Flood;
+			const int Last = std::min((Task + 1) * ClustersPerTask, ClusterNum);
+			for (int i = Task * ClustersPerTask; i < Last; ++i)
+			{
+				RebuildCluster(Walkable, ClusterIndices[i], Flood);
+			}
+		});
+		RebuiltClusterNum = ClusterNum;
+	}
+
+	void FPathHierarchy::UpdateNodeIndices()
+	{
+		ClusterNodeBegin.resize(Clusters.size() + 1);
+		ClusterNodeBegin[0] = 0;
+		for (size_t ClusterIndex = 0; ClusterIndex < Clusters.size(); ++ClusterIndex)
+		{
+			ClusterNodeBegin[ClusterIndex + 1] = ClusterNodeBegin[ClusterIndex] + static_cast<int32_t>(Clusters[ClusterIndex].Nodes.size());
+		}
+
+		NodeClusters.resize(ClusterNodeBegin.back());
+		for (size_t ClusterIndex = 0; ClusterIndex < Clusters.size(); ++ClusterIndex)
+		{
+			std::fill(NodeClusters.begin() + ClusterNodeBegin[ClusterIndex], NodeClusters.begin() + ClusterNodeBegin[ClusterIndex + 1],
+				static_cast<int32_t>(ClusterIndex));
+		}
+	}
+
+	int32_t FPathHierarchy::GetPartner(int ClusterIndex, int Local) const
+	{
+		const FCluster& Cluster = Clusters[ClusterIndex];
+		int Side = 0;
+		while (Local >= Cluster.SideBegin[Side + 1])
+		{
+			++Side;
+		}
+
+		const int TX = ClusterIndex % Tiling.GetTilesX();
+		const int TY = ClusterIndex / Tiling.GetTilesX();
+		static const int SideStepX[] = {-1, 1, 0, 0};
+		static const int SideStepY[] = {0, 0, -1, 1};
+		const int Neighbour = Tiling.GetTileIndex(TX + SideStepX[Side], TY + SideStepY[Side]);
+
+		// The opposite side of the neighbour holds the same entrances in the same order
+		return ClusterNodeBegin[Neighbour] + Clusters[Neighbour].SideBegin[Side ^ 1] + (Local - Cluster.SideBegin[Side]);
+	}
+
+	int64_t FPathHierarchy::GetIntraEdgeNum() const
+	{
+		int64_t EdgeNum = 0;
+		for (const FCluster& Cluster : Clusters)
+		{
+			const size_t NodeNum = Cluster.Nodes.size();
+			for (size_t i = 0; i < NodeNum; ++i)
+			{
+				for (size_t j = i + 1; j < NodeNum; ++j)
+				{
+					EdgeNum += Cluster.Costs[i * NodeNum + j] != NoPath ? 1 : 0;
+				}
+			}
+		}
+		return EdgeNum;
+	}
+
+	size_t FPathHierarchy::GetAllocatedBytes() const
+	{
+		size_t Bytes = (XBorders.capacity() + YBorders.capacity()) * sizeof(std::vector<FIntVec3>)
+			+ Clusters.capacity() * sizeof(FCluster)
+			+ (ClusterNodeBegin.capacity() + NodeClusters.capacity()) * sizeof(int32_t);
+		for (size_t ClusterIndex = 0; ClusterIndex < Clusters.size(); ++ClusterIndex)
+		{
+			Bytes += (XBorders[ClusterIndex].capacity() + YBorders[ClusterIndex].capacity() + Clusters[ClusterIndex].Nodes.capacity()) * sizeof(FIntVec3)
+				+ Clusters[ClusterIndex].Costs.capacity() * sizeof(uint32_t);
+		}
+		return Bytes;
+	}
+
+	bool FPathHierarchy::HasSameGraph(const FPathHierarchy& Other) const
+	{
+		if (XNum != Other.XNum || YNum != Other.YNum || ZNum != Other.ZNum || ClusterColumns != Other.ClusterColumns
+			|| XBorders != Other.XBorders || YBorders != Other.YBorders || ClusterNodeBegin != Other.ClusterNodeBegin)
+		{
+			return false;
+		}
+
+		for (size_t ClusterIndex = 0; ClusterIndex < Clusters.size(); ++ClusterIndex)
+		{
+			const FCluster& A = Clusters[ClusterIndex];
+			const FCluster& B = Other.Clusters[ClusterIndex];
+			if (A.Nodes != B.Nodes || A.Costs != B.Costs || !std::equal(A.SideBegin, A.SideBegin + SideNum + 1, B.SideBegin))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	struct FHierarchySearch::FNode
+	{
+		// Node belongs to the current query only if Stamp == Generation
+		uint32_t Stamp = 0;
+		uint32_t G = 0;
+		// Previous abstract node, -1 for the start
+		int32_t Parent = -1;
+		bool bClosed = false;
+	};
+
+	struct FHierarchySearch::FOpenEntry
+	{
+		uint32_t F;
+		uint32_t G;
+		int32_t Node;
+
+		// Min-heap on F; among equal F prefer the deeper node
+		bool operator<(const FOpenEntry& Other) const
+		{
+			return F != Other.F ? F > Other.F : G < Other.G;
+		}
+	};
+
+	FHierarchySearch::FHierarchySearch() = default;
+	FHierarchySearch::~FHierarchySearch() = default;
+
+	void FHierarchySearch::PushOpen(int32_t Node, int32_t Parent, uint32_t G, uint32_t H)
+	{
+		FNode& State = Nodes[Node];
+		if (State.Stamp == Generation && (State.bClosed || State.G <= G))
+		{
+			return;
+		}
+
+		State.Stamp = Generation;
+		State.G = G;
+		State.Parent = Parent;
+		State.bClosed = false;
+		Open.push_back({G + H, G, Node});
+		std::push_heap(Open.begin(), Open.end());
+		++Stats.PushedNum;
+		Stats.PeakOpenNum = std::max(Stats.PeakOpenNum, static_cast<int64_t>(Open.size()));
+	}
+
+	FPathSearchStats FHierarchySearch::GetStats() const
+	{
+		FPathSearchStats Result = Stats;
+		Result.AllocatedBytes = Nodes.capacity() * sizeof(FNode) + Open.capacity() * sizeof(FOpenEntry)
+			+ (GoalCosts.capacity() + AbstractPath.capacity()) * sizeof(uint32_t) + (Flood ? Flood->GetAllocatedBytes() : 0);
+		return Result;
+	}
+
+	bool FHierarchySearch::FindPath(const FPathHierarchy& Hierarchy, const FVoxelGrid& Walkable, const FIntVec3& StartIdx,
+		const FIntVec3& EndIdx, std::vector<FIntVec3>& OutPath)
+	{
+		OutPath.clear();
+		Stats = FPathSearchStats();
+		RefinedClusterNum = 0;
+
+		if (!Hierarchy.IsBuilt() || !StartIdx.IsValid() || !EndIdx.IsValid()
+			|| !Walkable.IsVoxelInside(StartIdx.X, StartIdx.Y, StartIdx.Z) || !Walkable.IsVoxelInside(EndIdx.X, EndIdx.Y, EndIdx.Z))
+		{
+			return false;
+		}
+
+		if (StartIdx == EndIdx)
+		{
+			OutPath.push_back(StartIdx);
+			return true;
+		}
+
+		// The goal is entered like any other voxel of the path
+		if (!Walkable.GetVoxelOccupied(EndIdx.X, EndIdx.Y, EndIdx.Z))
+		{
+			return false;
+		}
+
+		if (!Flood)
+		{
+			Flood.reset(new FClusterFlood());
+		}
+
+		// The goal is one extra node after the hierarchy's
+		const int32_t GoalNode = Hierarchy.GetNodeNum();
+		if (Nodes.size() < static_cast<size_t>(GoalNode) + 1)
+		{
+			Nodes.resize(GoalNode + 1);
+		}
+		if (++Generation == 0)
+		{
+			for (FNode& State : Nodes)
+			{
+				State.Stamp = 0;
+			}
+			Generation = 1;
+		}
+		Open.clear();
+
+		auto GetNodeVoxel = [&Hierarchy](int32_t Node)
+		{
+			const int32_t ClusterIndex = Hierarchy.NodeClusters[Node];
+			return Hierarchy.Clusters[ClusterIndex].Nodes[Node - Hierarchy.ClusterNodeBegin[ClusterIndex]];
+		};
+
+		const FVoxelTiling& Tiling = Hierarchy.GetTiling();
+		const int StartCluster = Tiling.GetTileIndexOfColumn(StartIdx.X, StartIdx.Y);
+		const int GoalCluster = Tiling.GetTileIndexOfColumn(EndIdx.X, EndIdx.Y);
+
+		// Links from the nodes of the goal's cluster to the goal, flooded from the goal (paths are reversible)
+		const FPathHierarchy::FCluster& GoalNodes = Hierarchy.Clusters[GoalCluster];
+		Flood->Init(Walkable, Tiling.GetTile(GoalCluster));
+		Flood->Run(EndIdx, FIntVec3::Invalid());
+		GoalCosts.resize(GoalNodes.Nodes.size());
+		for (size_t i = 0; i < GoalNodes.Nodes.size(); ++i)
+		{
+			GoalCosts[i] = Flood->GetDist(GoalNodes.Nodes[i]);
+		}
+
+		// Links from the start to the nodes of its cluster, and straight to the goal if it is in there too
+		const FPathHierarchy::FCluster& StartNodes = Hierarchy.Clusters[StartCluster];
+		Flood->Init(Walkable, Tiling.GetTile(StartCluster));
+		Flood->Run(StartIdx, FIntVec3::Invalid());
+		if (StartCluster == GoalCluster && Flood->GetDist(EndIdx) != FPathHierarchy::NoPath)
+		{
+			PushOpen(GoalNode, -1, Flood->GetDist(EndIdx), 0);
+		}
+		for (size_t i = 0; i < StartNodes.Nodes.size(); ++i)
+		{
+			const uint32_t Cost = Flood->GetDist(StartNodes.Nodes[i]);
+			if (Cost != FPathHierarchy::NoPath)
+			{
+				PushOpen(Hierarchy.ClusterNodeBegin[StartCluster] + static_cast<int32_t>(i), -1, Cost, HierarchyHeuristic(StartNodes.Nodes[i], EndIdx));
+			}
+		}
+
+		bool bFound = false;
+		while (!Open.empty())
+		{
+			std::pop_heap(Open.begin(), Open.end());
+			const FOpenEntry Entry = Open.back();
+			Open.pop_back();
+
+			FNode& State = Nodes[Entry.Node];
+			if (State.bClosed || Entry.G != State.G)
+			{
+				continue;
+			}
+			State.bClosed = true;
+			++Stats.ExpandedNum;
+
+			if (Entry.Node == GoalNode)
+			{
+				bFound = true;
+				break;
+			}
+
+			const int32_t ClusterIndex = Hierarchy.NodeClusters[Entry.Node];
+			const FPathHierarchy::FCluster& Cluster = Hierarchy.Clusters[ClusterIndex];
+			const int32_t Begin = Hierarchy.ClusterNodeBegin[ClusterIndex];
+			const int Local = Entry.Node - Begin;
+			const size_t NodeNum = Cluster.Nodes.size();
+
+			const int32_t Partner = Hierarchy.GetPartner(ClusterIndex, Local);
+			PushOpen(Partner, Entry.Node, Entry.G + 1, HierarchyHeuristic(GetNodeVoxel(Partner), EndIdx));
+
+			for (size_t j = 0; j < NodeNum; ++j)
+			{
+				const uint32_t Cost = Cluster.Costs[Local * NodeNum + j];
+				if (static_cast<int>(j) != Local && Cost != FPathHierarchy::NoPath)
+				{
+					PushOpen(Begin + static_cast<int32_t>(j), Entry.Node, Entry.G + Cost, HierarchyHeuristic(Cluster.Nodes[j], EndIdx));
+				}
+			}
+
+			if (ClusterIndex == GoalCluster && GoalCosts[Local] != FPathHierarchy::NoPath)
+			{
+				PushOpen(GoalNode, Entry.Node, Entry.G + GoalCosts[Local], 0);
+			}
+		}
+
+		if (!bFound)
+		{
+			return false;
+		}
+
+		AbstractPath.clear();
+		for (int32_t Node = Nodes[GoalNode].Parent; Node >= 0; Node = Nodes[Node].Parent)
+		{
+			AbstractPath.push_back(Node);
+		}
+		std::reverse(AbstractPath.begin(), AbstractPath.end());
+
+		// Consecutive nodes in one cluster are joined by a search inside it, nodes in two clusters are neighbours
+		OutPath.push_back(StartIdx);
+		FIntVec3 From = StartIdx;
+		int FromCluster = StartCluster;
+		for (const int32_t Node : AbstractPath)
+		{
+			const int NodeCluster = Hierarchy.NodeClusters[Node];
+			const FIntVec3 NodeVoxel = GetNodeVoxel(Node);
+			if (NodeCluster != FromCluster)
+			{
+				OutPath.push_back(NodeVoxel);
+			}
+			else if (!Refine(Walkable, Tiling.GetTile(NodeCluster), From, NodeVoxel, OutPath))
+			{
+				OutPath.clear();
+				return false;
+			}
+			From = NodeVoxel;
+			FromCluster = NodeCluster;
+		}
+
+		if (!Refine(Walkable, Tiling.GetTile(GoalCluster), From, EndIdx, OutPath))
+		{
+			OutPath.clear();
+			return false;
+		}
+		return true;
+	}
+
+	bool FHierarchySearch::Refine(const FVoxelGrid& Walkable, const FVoxelTile& Tile, const FIntVec3& From, const FIntVec3& To,
+		std::vector<FIntVec3>& OutPath)
+	{
+		if (From == To)
+		{
+			return true;
+		}
+
+		++RefinedClusterNum;
+		Flood->Init(Walkable, Tile);
+		Flood->Run(From, To);
+		return Flood->AppendPath(To, OutPath);
+	}
+
+	std::unique_ptr<FHierarchySearch> FHierarchySearchPool::Acquire()
+	{
+		{
+			std::lock_guard<std::mutex> Lock(Mutex);
+			if (!Free.empty())
+			{
+				std::unique_ptr<FHierarchySearch> Search = std::move(Free.back());
+				Free.pop_back();
+				return Search;
+			}
+		}
+		return std::unique_ptr<FHierarchySearch>(new FHierarchySearch());
+	}
+
+	void FHierarchySearchPool::Release(std::unique_ptr<FHierarchySearch> Search)
+	{
+		std::lock_guard<std::mutex> Lock(Mutex);
+		Free.push_back(std::move(Search));
+	}
+}
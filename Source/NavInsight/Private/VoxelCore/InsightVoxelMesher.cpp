@@ -0,0 +1,247 @@
+#include "VoxelCore/InsightVoxelMesher.h"
+#include "VoxelCore/InsightVoxelBits.h"
+#include "VoxelCore/InsightVoxelGrid.h"
+
+#include <algorithm>
+
+namespace InsightVoxel
+{
+	// Whether bits [Lo, Hi) of a multi-word mask are all set
+	static bool IsRangeSet(const uint64_t* Words, int Lo, int Hi)
+	{
+		for (int Word = Lo >> 6; Word <= (Hi - 1) >> 6; ++Word)
+		{
+			const uint64_t Mask = BitRangeMask64(std::max(Lo - (Word << 6), 0), std::min(Hi - (Word << 6), 64));
+			if ((Words[Word] & Mask) != Mask)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	static void ClearRange(uint64_t* Words, int Lo, int Hi)
+	{
+		for (int Word = Lo >> 6; Word <= (Hi - 1) >> 6; ++Word)
+		{
+			Words[Word] &= ~BitRangeMask64(std::max(Lo - (Word << 6), 0), std::min(Hi - (Word << 6), 64));
+		}
+	}
+
+	// End of the run of set bits starting at Lo
+	static int FindRunEnd(const uint64_t* Words, int WordNum, int Lo)
+	{
+		int Word = Lo >> 6;
+		uint64_t Clear = ~Words[Word] & BitRangeMask64(Lo & 63, 64);
+		while (!Clear)
+		{
+			if (++Word == WordNum)
+			{
+				return WordNum << 6;
+			}
+			Clear = ~Words[Word];
+		}
+		return (Word << 6) + LowestBit64(Clear);
+	}
+
+	// Exposed faces of column (X, Y) towards Dir, one bit per Z
+	static void GetFaceWords(const FVoxelGrid& Grid, int X, int Y, int Dir, uint64_t* OutWords)
+	{
+		const int ColumnWords = Grid.GetColumnWords();
+		const uint64_t* Column = Grid.GetColumn(X, Y);
+
+		if (Dir >= 4)
+		{
+			for (int Word = 0; Word < ColumnWords; ++Word)
+			{
+				// Padding bits are 0, so the top and bottom of the grid count as free
+				const uint64_t Neighbour = Dir == 5
+					? (Column[Word] >> 1) | (Word + 1 < ColumnWords ? Column[Word + 1] << 63 : 0)
+					: (Column[Word] << 1) | (Word > 0 ? Column[Word - 1] >> 63 : 0);
+				OutWords[Word] = Column[Word] & ~Neighbour;
+			}
+			return;
+		}
+
+		const int NX = X + (Dir == 0 ? -1 : Dir == 1 ? 1 : 0);
+		const int NY = Y + (Dir == 2 ? -1 : Dir == 3 ? 1 : 0);
+		const uint64_t* Neighbour = NX >= 0 && NX < Grid.GetXNum() && NY >= 0 && NY < Grid.GetYNum() ? Grid.GetColumn(NX, NY) : nullptr;
+		for (int Word = 0; Word < ColumnWords; ++Word)
+		{
+			OutWords[Word] = Column[Word] & ~(Neighbour ? Neighbour[Word] : 0);
+		}
+	}
+
+	int64_t BuildGreedyQuads(const FVoxelGrid& Grid, const FVoxelTile& Tile, std::vector<FVoxelQuad>& OutQuads)
+	{
+		if (Tile.IsEmpty())
+		{
+			return 0;
+		}
+
+		const int ColumnWords = Grid.GetColumnWords();
+		const int TileXNum = Tile.X1 - Tile.X0;
+		const int TileYNum = Tile.Y1 - Tile.Y0;
+		int64_t FaceNum = 0;
+
+		std::vector<uint64_t> Faces;
+
+		// Side faces: per slice across the normal axis, runs of Z bits grown along the other horizontal axis
+		for (int Dir = 0; Dir < 4; ++Dir)
+		{
+			const bool bAlongX = Dir < 2;
+			const int SliceNum = bAlongX ? TileXNum : TileYNum;
+			const int RowNum = bAlongX ? TileYNum : TileXNum;
+			Faces.assign(static_cast<size_t>(RowNum) * ColumnWords, 0);
+
+			for (int Slice = 0; Slice < SliceNum; ++Slice)
+			{
+				for (int Row = 0; Row < RowNum; ++Row)
+				{
+					const int X = bAlongX ? Tile.X0 + Slice : Tile.X0 + Row;
+					const int Y = bAlongX ? Tile.Y0 + Row : Tile.Y0 + Slice;
+					GetFaceWords(Grid, X, Y, Dir, &Faces[static_cast<size_t>(Row) * ColumnWords]);
+				}
+
+				for (int Row = 0; Row < RowNum; ++Row)
+				{
+					uint64_t* RowFaces = &Faces[static_cast<size_t>(Row) * ColumnWords];
+					for (int Word = 0; Word < ColumnWords; ++Word)
+					{
+						while (RowFaces[Word])
+						{
+							const int ZMin = (Word << 6) + LowestBit64(RowFaces[Word]);
+							const int ZMax = FindRunEnd(RowFaces, ColumnWords, ZMin);
+							ClearRange(RowFaces, ZMin, ZMax);
+
+							int RowEnd = Row + 1;
+							for (; RowEnd < RowNum; ++RowEnd)
+							{
+								uint64_t* NextFaces = &Faces[static_cast<size_t>(RowEnd) * ColumnWords];
+								if (!IsRangeSet(NextFaces, ZMin, ZMax))
+								{
+									break;
+								}
+								ClearRange(NextFaces, ZMin, ZMax);
+							}
+
+							FVoxelQuad Quad;
+							Quad.Min = bAlongX
+								? FIntVec3{Tile.X0 + Slice, Tile.Y0 + Row, ZMin}
+								: FIntVec3{Tile.X0 + Row, Tile.Y0 + Slice, ZMin};
+							Quad.SizeU = RowEnd - Row;
+							Quad.SizeV = ZMax - ZMin;
+							Quad.Dir = Dir;
+							OutQuads.push_back(Quad);
+							FaceNum += static_cast<int64_t>(Quad.SizeU) * Quad.SizeV;
+						}
+					}
+				}
+			}
+		}
+
+		// Top and bottom faces: per Z, rectangles grown along X then Y
+		Faces.resize(static_cast<size_t>(TileXNum) * TileYNum * ColumnWords);
+		auto ColumnFaces = [&](int LX, int LY) { return &Faces[(static_cast<size_t>(LY) * TileXNum + LX) * ColumnWords]; };
+
+		for (int Dir = 4; Dir < 6; ++Dir)
+		{
+			for (int LY = 0; LY < TileYNum; ++LY)
+			{
+				for (int LX = 0; LX < TileXNum; ++LX)
+				{
+					GetFaceWords(Grid, Tile.X0 + LX, Tile.Y0 + LY, Dir, ColumnFaces(LX, LY));
+				}
+			}
+
+			for (int LY = 0; LY < TileYNum; ++LY)
+			{
+				for (int LX = 0; LX < TileXNum; ++LX)
+				{
+					uint64_t* StartFaces = ColumnFaces(LX, LY);
+					for (int Word = 0; Word < ColumnWords; ++Word)
+					{
+						while (StartFaces[Word])
+						{
+							const int Bit = LowestBit64(StartFaces[Word]);
+							const uint64_t Mask = 1ull << Bit;
+
+							int XEnd = LX + 1;
+							while (XEnd < TileXNum && (ColumnFaces(XEnd, LY)[Word] & Mask))
+							{
+								++XEnd;
+							}
+
+							int YEnd = LY + 1;
+							for (; YEnd < TileYNum; ++YEnd)
+							{
+								bool bRowSet = true;
+								for (int RX = LX; RX < XEnd && bRowSet; ++RX)
+								{
+									bRowSet = (ColumnFaces(RX, YEnd)[Word] & Mask) != 0;
+								}
+								if (!bRowSet)
+								{
+									break;
+								}
+							}
+
+							for (int RY = LY; RY < YEnd; ++RY)
+							{
+								for (int RX = LX; RX < XEnd; ++RX)
+								{
+									ColumnFaces(RX, RY)[Word] &= ~Mask;
+								}
+							}
+
+							FVoxelQuad Quad;
+							Quad.Min = {Tile.X0 + LX, Tile.Y0 + LY, (Word << 6) + Bit};
+							Quad.SizeU = XEnd - LX;
+							Quad.SizeV = YEnd - LY;
+							Quad.Dir = Dir;
+							OutQuads.push_back(Quad);
+							FaceNum += static_cast<int64_t>(Quad.SizeU) * Quad.SizeV;
+						}
+					}
+				}
+			}
+		}
+
+		return FaceNum;
+	}
+
+	void GetQuadCorners(const FVoxelGrid& Grid, const FVoxelQuad& Quad, FVec3 OutCorners[4])
+	{
+		const int Axis = Quad.Dir >> 1;
+		const int AxisU = Axis == 0 ? 1 : 0;
+		const int AxisV = Axis == 2 ? 1 : 2;
+		const FVec3 CellExtent(Grid.GetCellSize(), Grid.GetCellSize(), Grid.GetCellHeight());
+
+		// Cell coordinates of the quad's lower corner, on the far side of the voxels for positive normals
+		float Lo[3] = {static_cast<float>(Quad.Min.X), static_cast<float>(Quad.Min.Y), static_cast<float>(Quad.Min.Z)};
+		Lo[Axis] += Quad.Dir & 1;
+
+		float Corners[4][3];
+		for (int Corner = 0; Corner < 4; ++Corner)
+		{
+			Corners[Corner][0] = Lo[0];
+			Corners[Corner][1] = Lo[1];
+			Corners[Corner][2] = Lo[2];
+		}
+		Corners[1][AxisU] += Quad.SizeU;
+		Corners[2][AxisU] += Quad.SizeU;
+		Corners[2][AxisV] += Quad.SizeV;
+		Corners[3][AxisV] += Quad.SizeV;
+
+		// U x V is +X, -Y, +Z for the three axes; flip the winding where that is not the outward normal
+		const bool bUVOutward = (Axis == 1) != ((Quad.Dir & 1) != 0);
+		const int Order[2][4] = {{0, 3, 2, 1}, {0, 1, 2, 3}};
+
+		const FVec3& Min = Grid.GetBounds().Min;
+		for (int Corner = 0; Corner < 4; ++Corner)
+		{
+			const float* Cell = Corners[Order[bUVOutward][Corner]];
+			OutCorners[Corner] = FVec3(Min.X + Cell[0] * CellExtent.X, Min.Y + Cell[1] * CellExtent.Y, Min.Z + Cell[2] * CellExtent.Z);
+		}
+	}
+}
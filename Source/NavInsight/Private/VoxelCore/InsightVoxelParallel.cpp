@@ -0,0 +1,66 @@
+#include "VoxelCore/InsightVoxelParallel.h"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace InsightVoxel
+{
+	static std::atomic<int> ThreadedForWorkerNum{0};
+
+	void SerialFor(int Num, const std::function<void(int Index)>& Body)
+	{
+		for (int Index = 0; Index < Num; ++Index)
+		{
+			Body(Index);
+		}
+	}
+
+	int GetThreadedForWorkerNum()
+	{
+		const int WorkerNum = ThreadedForWorkerNum.load();
+		if (WorkerNum > 0)
+		{
+			return WorkerNum;
+		}
+		return std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+	}
+
+	void SetThreadedForWorkerNum(int WorkerNum)
+	{
+		ThreadedForWorkerNum.store(WorkerNum);
+	}
+
+	void ThreadedFor(int Num, const std::function<void(int Index)>& Body)
+	{
+		const int WorkerNum = std::min(GetThreadedForWorkerNum(), Num);
+		if (WorkerNum <= 1)
+		{
+			SerialFor(Num, Body);
+			return;
+		}
+
+		std::atomic<int> Next{0};
+		auto Work = [&]() {
+			for (int Index = Next.fetch_add(1); Index < Num; Index = Next.fetch_add(1))
+			{
+				Body(Index);
+			}
+		};
+
+		// The calling thread is one of the workers
+		std::vector<std::thread> Workers;
+		Workers.reserve(WorkerNum - 1);
+		for (int i = 1; i < WorkerNum; ++i)
+		{
+			Workers.emplace_back(Work);
+		}
+		Work();
+
+		for (std::thread& Worker : Workers)
+		{
+			Worker.join();
+		}
+	}
+}
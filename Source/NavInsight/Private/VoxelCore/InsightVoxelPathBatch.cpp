@@ -0,0 +1,218 @@
+#include "VoxelCore/InsightVoxelPathBatch.h"
+#include "VoxelCore/InsightVoxelGrid.h"
+#include "VoxelCore/InsightVoxelSpans.h"
+
+#include <algorithm>
+#include <numeric>
+
+namespace InsightVoxel
+{
+	std::unique_ptr<FPathSearch> FPathSearchPool::Acquire()
+	{
+		{
+			std::lock_guard<std::mutex> Lock(Mutex);
+			if (!Free.empty())
+			{
+				std::unique_ptr<FPathSearch> Search = std::move(Free.back());
+				Free.pop_back();
+				return Search;
+			}
+		}
+		return std::unique_ptr<FPathSearch>(new FPathSearch());
+	}
+
+	void FPathSearchPool::Release(std::unique_ptr<FPathSearch> Search)
+	{
+		std::lock_guard<std::mutex> Lock(Mutex);
+		Free.push_back(std::move(Search));
+	}
+
+	static bool PathVoxelLess(const FIntVec3& A, const FIntVec3& B)
+	{
+		if (A.X != B.X)
+		{
+			return A.X < B.X;
+		}
+		return A.Y != B.Y ? A.Y < B.Y : A.Z < B.Z;
+	}
+
+	static bool HasClearanceFilter(const FVoxelGrid&, const FPathBatchSettings& Settings)
+	{
+		return Settings.Clearance && Settings.MinClearance > 0;
+	}
+
+	static bool HasClearanceFilter(const FVoxelSpanGrid&, const FPathBatchSettings&)
+	{
+		return false;
+	}
+
+	static bool FindGroupPath(FPathSearch& Search, const FVoxelGrid& Walkable, const FIntVec3& Start, const FIntVec3& Goal,
+							  const FPathBatchSettings& Settings, std::vector<FIntVec3>& OutPath)
+	{
+		if (HasClearanceFilter(Walkable, Settings))
+		{
+			return Search.FindPath(Walkable, *Settings.Clearance, Settings.MinClearance, Start, Goal, Settings.Algorithm, OutPath);
+		}
+		return Search.FindPath(Walkable, Start, Goal, Settings.Algorithm, OutPath);
+	}
+
+	static bool FindGroupPath(FPathSearch& Search, const FVoxelSpanGrid& Walkable, const FIntVec3& Start, const FIntVec3& Goal,
+							  const FPathBatchSettings& Settings, std::vector<FIntVec3>& OutPath)
+	{
+		return Search.FindPath(Walkable, Start, Goal, Settings.Algorithm, OutPath);
+	}
+
+	template <typename WalkableType>
+	static void FindPathBatchImpl(const WalkableType& Walkable, const FPathQuery* Queries, int QueryNum, const FPathBatchSettings& Settings,
+								  FPathSearchPool& Pool, const FParallelForFn& ParallelFor, FPathBatchResult& OutResult)
+	{
+		// Sorted by start, then goal: a group is a run of equal starts, repeated goals are neighbours in it
+		std::vector<int32_t> Order(QueryNum);
+		std::iota(Order.begin(), Order.end(), 0);
+		std::sort(Order.begin(), Order.end(), [Queries](int32_t A, int32_t B)
+		{
+			if (Queries[A].Start != Queries[B].Start)
+			{
+				return PathVoxelLess(Queries[A].Start, Queries[B].Start);
+			}
+			return PathVoxelLess(Queries[A].Goal, Queries[B].Goal);
+		});
+
+		std::vector<int32_t> GroupFirst;
+		for (int i = 0; i < QueryNum; ++i)
+		{
+			if (i == 0 || Queries[Order[i]].Start != Queries[Order[i - 1]].Start)
+			{
+				GroupFirst.push_back(i);
+			}
+		}
+		const int GroupNum = static_cast<int>(GroupFirst.size());
+		GroupFirst.push_back(QueryNum);
+
+		// Each group appends its paths to its own buffer; QueryFirst is where a query's path starts in there
+		std::vector<std::vector<FIntVec3>> GroupVoxels(GroupNum);
+		std::vector<int32_t> QueryFirst(QueryNum, 0);
+		std::vector<int32_t> QueryLength(QueryNum, 0);
+
+		ParallelFor(GroupNum, [&](int Group)
+		{
+			const int First = GroupFirst[Group];
+			const int Last = GroupFirst[Group + 1];
+			const FIntVec3 Start = Queries[Order[First]].Start;
+			if (!Start.IsValid())
+			{
+				return;
+			}
+
+			std::vector<FIntVec3> Goals;
+			for (int i = First; i < Last; ++i)
+			{
+				const FIntVec3& Goal = Queries[Order[i]].Goal;
+				if (Goal.IsValid() && (Goals.empty() || Goals.back() != Goal))
+				{
+					Goals.push_back(Goal);
+				}
+			}
+
+			std::unique_ptr<FPathSearch> Search = Pool.Acquire();
+			std::vector<FIntVec3>& Voxels = GroupVoxels[Group];
+			const bool bTree = static_cast<int>(Goals.size()) >= Settings.MinTreeGoals && !HasClearanceFilter(Walkable, Settings);
+			if (bTree)
+			{
+				Search->BuildPathTree(Walkable, Start, Goals.data(), static_cast<int>(Goals.size()));
+			}
+
+			std::vector<FIntVec3> Path;
+			for (int i = First; i < Last; ++i)
+			{
+				const int32_t Query = Order[i];
+				const FIntVec3& Goal = Queries[Query].Goal;
+				QueryFirst[Query] = static_cast<int32_t>(Voxels.size());
+
+				// A repeated goal shares the path of the one before it
+				if (i > First && Goal == Queries[Order[i - 1]].Goal)
+				{
+					const int32_t Previous = Order[i - 1];
+					QueryFirst[Query] = QueryFirst[Previous];
+					QueryLength[Query] = QueryLength[Previous];
+					continue;
+				}
+
+				if (bTree)
+				{
+					Search->AppendTreePath(Goal, Voxels);
+				}
+				else if (FindGroupPath(*Search, Walkable, Start, Goal, Settings, Path))
+				{
+					Voxels.insert(Voxels.end(), Path.begin(), Path.end());
+				}
+				QueryLength[Query] = static_cast<int32_t>(Voxels.size()) - QueryFirst[Query];
+			}
+
+			Pool.Release(std::move(Search));
+		});
+
+		// Flatten in query order
+		OutResult.Offsets.resize(QueryNum + 1);
+		OutResult.Offsets[0] = 0;
+		for (int Query = 0; Query < QueryNum; ++Query)
+		{
+			OutResult.Offsets[Query + 1] = OutResult.Offsets[Query] + QueryLength[Query];
+		}
+		OutResult.Voxels.resize(OutResult.Offsets[QueryNum]);
+
+		ParallelFor(GroupNum, [&](int Group)
+		{
+			for (int i = GroupFirst[Group]; i < GroupFirst[Group + 1]; ++i)
+			{
+				const int32_t Query = Order[i];
+				const std::vector<FIntVec3>& Voxels = GroupVoxels[Group];
+				std::copy(Voxels.begin() + QueryFirst[Query], Voxels.begin() + QueryFirst[Query] + QueryLength[Query],
+					OutResult.Voxels.begin() + OutResult.Offsets[Query]);
+			}
+		});
+	}
+
+	template <typename WalkableType>
+	static void FindPathsManyToManyImpl(const WalkableType& Walkable, const FIntVec3* Starts, int StartNum, const FIntVec3* Goals,
+										int GoalNum, const FPathBatchSettings& Settings, FPathSearchPool& Pool,
+										const FParallelForFn& ParallelFor, FPathBatchResult& OutResult)
+	{
+		std::vector<FPathQuery> Queries;
+		Queries.reserve(static_cast<size_t>(StartNum) * GoalNum);
+		for (int S = 0; S < StartNum; ++S)
+		{
+			for (int G = 0; G < GoalNum; ++G)
+			{
+				Queries.push_back({Starts[S], Goals[G]});
+			}
+		}
+		FindPathBatchImpl(Walkable, Queries.data(), static_cast<int>(Queries.size()), Settings, Pool, ParallelFor, OutResult);
+	}
+
+	void FindPathBatch(const FVoxelGrid& Walkable, const FPathQuery* Queries, int QueryNum, const FPathBatchSettings& Settings,
+					   FPathSearchPool& Pool, const FParallelForFn& ParallelFor, FPathBatchResult& OutResult)
+	{
+		FindPathBatchImpl(Walkable, Queries, QueryNum, Settings, Pool, ParallelFor, OutResult);
+	}
+
+	void FindPathBatch(const FVoxelSpanGrid& Walkable, const FPathQuery* Queries, int QueryNum, const FPathBatchSettings& Settings,
+					   FPathSearchPool& Pool, const FParallelForFn& ParallelFor, FPathBatchResult& OutResult)
+	{
+		FindPathBatchImpl(Walkable, Queries, QueryNum, Settings, Pool, ParallelFor, OutResult);
+	}
+
+	void FindPathsManyToMany(const FVoxelGrid& Walkable, const FIntVec3* Starts, int StartNum, const FIntVec3* Goals, int GoalNum,
+							 const FPathBatchSettings& Settings, FPathSearchPool& Pool, const FParallelForFn& ParallelFor,
+							 FPathBatchResult& OutResult)
+	{
+		FindPathsManyToManyImpl(Walkable, Starts, StartNum, Goals, GoalNum, Settings, Pool, ParallelFor, OutResult);
+	}
+
+	void FindPathsManyToMany(const FVoxelSpanGrid& Walkable, const FIntVec3* Starts, int StartNum, const FIntVec3* Goals, int GoalNum,
+							 const FPathBatchSettings& Settings, FPathSearchPool& Pool, const FParallelForFn& ParallelFor,
+							 FPathBatchResult& OutResult)
+	{
+		FindPathsManyToManyImpl(Walkable, Starts, StartNum, Goals, GoalNum, Settings, Pool, ParallelFor, OutResult);
+	}
+}
@@ -0,0 +1,524 @@
+#include "VoxelCore/InsightVoxelPathFinder.h"
+#include "VoxelCore/InsightVoxelClearance.h"
+#include "VoxelCore/InsightVoxelGrid.h"
+#include "VoxelCore/InsightVoxelSpans.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+
+namespace InsightVoxel
+{
+	bool IsStayableVoxel(const FVoxelGrid& Grid, int X, int Y, int Z)
+	{
+		if (Grid.GetVoxelOccupied(X, Y, Z))
+		{
+			return false;
+		}
+
+		// (X, Y, Z) itself is free, so testing [Z - 1, Z] of all 9 columns covers exactly the 17 neighbours
+		for (int DX = -1; DX <= 1; ++DX)
+		{
+			for (int DY = -1; DY <= 1; ++DY)
+			{
+				if (Grid.IsVoxelInside(X + DX, Y + DY, Z) && Grid.IsAnyOccupied(X + DX, Y + DY, Z - 1, Z + 1))
+				{
+					return true;
+				}
+			}
+		}
+
+		return false;
+	}
+
+	FIntVec3 ProbeVoxel(const FVoxelGrid& Grid, const FVec3& Position)
+	{
+		const FBounds3& Bounds = Grid.GetBounds();
+
+		const int X = static_cast<int>((Position.X - Bounds.Min.X) / Grid.GetCellSize() + 0.5f);
+		const int Y = static_cast<int>((Position.Y - Bounds.Min.Y) / Grid.GetCellSize() + 0.5f);
+		const int Z = static_cast<int>((Position.Z - Bounds.Min.Z) / Grid.GetCellHeight() + 0.5f);
+
+		if (!Grid.IsVoxelInside(X, Y, Z) || Grid.GetVoxelOccupied(X, Y, Z))
+		{
+			return FIntVec3::Invalid();
+		}
+
+		// Ground must be within 3 cells below the position
+		static const int ProbeDist = 3;
+		const int GroundZ = Grid.FindHighestOccupied(X, Y, Z - ProbeDist, Z);
+		if (GroundZ < 0)
+		{
+			return FIntVec3::Invalid();
+		}
+
+		return {X, Y, GroundZ + 1};
+	}
+
+	// 6 move directions, Dir / 2 is the axis and Dir & 1 the sign (0: negative, 1: positive)
+	static const int PathDirNum = 6;
+	static const int PathDirX[] = {-1, 1, 0, 0, 0, 0};
+	static const int PathDirY[] = {0, 0, -1, 1, 0, 0};
+	static const int PathDirZ[] = {0, 0, 0, 0, -1, 1};
+	static const int PathNoDir = -1;
+
+	static inline FIntVec3 PathStep(const FIntVec3& Idx, int Dir, int Dist = 1)
+	{
+		return {Idx.X + PathDirX[Dir] * Dist, Idx.Y + PathDirY[Dir] * Dist, Idx.Z + PathDirZ[Dir] * Dist};
+	}
+
+	static inline uint32_t PathHeuristic(const FIntVec3& A, const FIntVec3& B)
+	{
+		return static_cast<uint32_t>(std::abs(A.X - B.X) + std::abs(A.Y - B.Y) + std::abs(A.Z - B.Z));
+	}
+
+	static const int PathPageShift = 3;
+	static const int PathPageMask = (1 << PathPageShift) - 1;
+	static const int PathPageNodes = 1 << (3 * PathPageShift);
+
+	struct FPathSearch::FNode
+	{
+		FIntVec3 Parent;
+		// Node belongs to the current query only if Stamp == Generation
+		uint32_t Stamp = 0;
+		uint32_t G = 0;
+		// Direction the node was entered with (jump point search prunes on it)
+		int8_t Dir = PathNoDir;
+		bool bClosed = false;
+		// Target of the running BuildPathTree
+		bool bGoal = false;
+	};
+
+	struct FPathSearch::FOpenEntry
+	{
+		uint32_t F;
+		uint32_t G;
+		FIntVec3 Idx;
+
+		// Min-heap on F; among equal F prefer the deeper node, which keeps A* from flooding open plateaus
+		bool operator<(const FOpenEntry& Other) const
+		{
+			return F != Other.F ? F > Other.F : G < Other.G;
+		}
+	};
+
+	FPathSearch::FPathSearch() = default;
+	FPathSearch::~FPathSearch() = default;
+
+	void FPathSearch::Reset(int XNum, int YNum, int ZNum)
+	{
+		const int NewPagesX = (XNum + PathPageMask) >> PathPageShift;
+		const int NewPagesY = (YNum + PathPageMask) >> PathPageShift;
+		const int NewPagesZ = (ZNum + PathPageMask) >> PathPageShift;
+
+		if (NewPagesX != PagesX || NewPagesY != PagesY || NewPagesZ != PagesZ)
+		{
+			PagesX = NewPagesX;
+			PagesY = NewPagesY;
+			PagesZ = NewPagesZ;
+			Pages.clear();
+			Pages.resize(static_cast<size_t>(PagesX) * PagesY * PagesZ);
+			PageNum = 0;
+			Generation = 0;
+		}
+
+		// Stamps start at 0 in fresh pages, so generation 0 is never used
+		if (++Generation == 0)
+		{
+			for (std::unique_ptr<FNode[]>& Page : Pages)
+			{
+				Page.reset();
+			}
+			PageNum = 0;
+			Generation = 1;
+		}
+
+		Open.clear();
+		TreeGoals.clear();
+		TreeRoot = FIntVec3::Invalid();
+		Stats = FPathSearchStats();
+	}
+
+	FPathSearchStats FPathSearch::GetStats() const
+	{
+		FPathSearchStats Result = Stats;
+		Result.AllocatedBytes = PageNum * PathPageNodes * sizeof(FNode) + Pages.capacity() * sizeof(Pages[0])
+			+ Open.capacity() * sizeof(FOpenEntry);
+		return Result;
+	}
+
+	FPathSearch::FNode& FPathSearch::GetNode(const FIntVec3& Idx)
+	{
+		const size_t PageIndex = (static_cast<size_t>(Idx.X >> PathPageShift) * PagesY + (Idx.Y >> PathPageShift)) * PagesZ
+			+ (Idx.Z >> PathPageShift);
+		std::unique_ptr<FNode[]>& Page = Pages[PageIndex];
+		if (!Page)
+		{
+			Page.reset(new FNode[PathPageNodes]);
+			++PageNum;
+		}
+
+		FNode& Node = Page[((Idx.X & PathPageMask) << (2 * PathPageShift)) | ((Idx.Y & PathPageMask) << PathPageShift)
+			| (Idx.Z & PathPageMask)];
+		if (Node.Stamp != Generation)
+		{
+			Node.Stamp = Generation;
+			Node.G = UINT32_MAX;
+			Node.Dir = PathNoDir;
+			Node.bClosed = false;
+			Node.bGoal = false;
+		}
+		return Node;
+	}
+
+	bool FPathSearch::IsWalkable(const FIntVec3& Idx) const
+	{
+		if (WalkableSpans)
+		{
+			return WalkableSpans->IsVoxelInside(Idx.X, Idx.Y, Idx.Z) && WalkableSpans->GetVoxelOccupied(Idx.X, Idx.Y, Idx.Z);
+		}
+		return Walkable->IsVoxelInside(Idx.X, Idx.Y, Idx.Z) && Walkable->GetVoxelOccupied(Idx.X, Idx.Y, Idx.Z)
+			&& (!Clearance || Clearance->GetClearance(*Walkable, Idx.X, Idx.Y, Idx.Z) >= MinClearance);
+	}
+
+	uint32_t FPathSearch::Heuristic(const FIntVec3& Idx) const
+	{
+		if (TreeGoals.empty())
+		{
+			return PathHeuristic(Idx, Goal);
+		}
+
+		// The minimum of consistent estimates is consistent, so nodes are still closed at their shortest distance
+		uint32_t Best = UINT32_MAX;
+		for (const FIntVec3& TreeGoal : TreeGoals)
+		{
+			Best = std::min(Best, PathHeuristic(Idx, TreeGoal));
+		}
+		return Best;
+	}
+
+	void FPathSearch::PushOpen(const FIntVec3& Idx, const FIntVec3& Parent, uint32_t G, int Dir)
+	{
+		FNode& Node = GetNode(Idx);
+		if (Node.bClosed || G >= Node.G)
+		{
+			return;
+		}
+
+		Node.G = G;
+		Node.Parent = Parent;
+		Node.Dir = static_cast<int8_t>(Dir);
+
+		// Stale entries of the node stay in the heap and are skipped when popped
+		Open.push_back({G + Heuristic(Idx), G, Idx});
+		std::push_heap(Open.begin(), Open.end());
+		++Stats.PushedNum;
+		Stats.PeakOpenNum = std::max(Stats.PeakOpenNum, static_cast<int64_t>(Open.size()));
+	}
+
+	void FPathSearch::ExpandAStar(const FIntVec3& Idx, uint32_t G)
+	{
+		for (int Dir = 0; Dir < PathDirNum; ++Dir)
+		{
+			const FIntVec3 NextIdx = PathStep(Idx, Dir);
+			if (IsWalkable(NextIdx))
+			{
+				PushOpen(NextIdx, Idx, G + 1, Dir);
+			}
+		}
+	}
+
+	bool FPathSearch::HasForcedNeighbour(const FIntVec3& Idx, int Dir) const
+	{
+		// A side neighbour is forced if it is open while the same side of the previous voxel is blocked:
+		// the only shortest way to it then leads through Idx
+		const int Back = Dir ^ 1;
+		for (int Side = 0; Side < PathDirNum; ++Side)
+		{
+			if ((Side >> 1) == (Dir >> 1))
+			{
+				continue;
+			}
+			if (IsWalkable(PathStep(Idx, Side)) && !IsWalkable(PathStep(PathStep(Idx, Back), Side)))
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	bool FPathSearch::Jump(const FIntVec3& From, int Dir, FIntVec3& OutJumpPoint, uint32_t& OutDist) const
+	{
+		// Axes are ordered X < Y < Z: a run along an axis stops wherever a run along a lower axis would find
+		// a jump point, so paths only turn at jump points
+		const int Axis = Dir >> 1;
+
+		FIntVec3 Idx = From;
+		for (uint32_t Dist = 1;; ++Dist)
+		{
+			Idx = PathStep(Idx, Dir);
+			if (!IsWalkable(Idx))
+			{
+				return false;
+			}
+
+			bool bJumpPoint = Idx == Goal || HasForcedNeighbour(Idx, Dir);
+			for (int SubDir = 0; !bJumpPoint && SubDir < 2 * Axis; ++SubDir)
+			{
+				FIntVec3 SubJumpPoint;
+				uint32_t SubDist;
+				bJumpPoint = Jump(Idx, SubDir, SubJumpPoint, SubDist);
+			}
+
+			if (bJumpPoint)
+			{
+				OutJumpPoint = Idx;
+				OutDist = Dist;
+				return true;
+			}
+		}
+	}
+
+	void FPathSearch::ExpandJumpPoint(const FIntVec3& Idx, uint32_t G, int Dir)
+	{
+		// Natural neighbours: straight on and every side; the start has no incoming direction
+		for (int NextDir = 0; NextDir < PathDirNum; ++NextDir)
+		{
+			if (Dir != PathNoDir && NextDir == (Dir ^ 1))
+			{
+				continue;
+			}
+
+			FIntVec3 JumpPoint;
+			uint32_t Dist;
+			if (Jump(Idx, NextDir, JumpPoint, Dist))
+			{
+				PushOpen(JumpPoint, Idx, G + Dist, NextDir);
+			}
+		}
+	}
+
+	bool FPathSearch::FindPath(const FVoxelGrid& InWalkable, const FIntVec3& StartIdx, const FIntVec3& EndIdx, EPathAlgorithm Algorithm,
+							   std::vector<FIntVec3>& OutPath)
+	{
+		Walkable = &InWalkable;
+		WalkableSpans = nullptr;
+		Clearance = nullptr;
+		Reset(InWalkable.GetXNum(), InWalkable.GetYNum(), InWalkable.GetZNum());
+		return Search(StartIdx, EndIdx, Algorithm, OutPath);
+	}
+
+	bool FPathSearch::FindPath(const FVoxelGrid& InWalkable, const FClearanceField& InClearance, int InMinClearance,
+							   const FIntVec3& StartIdx, const FIntVec3& EndIdx, EPathAlgorithm Algorithm, std::vector<FIntVec3>& OutPath)
+	{
+		Walkable = &InWalkable;
+		WalkableSpans = nullptr;
+		Clearance = InClearance.IsBuilt() && InMinClearance > 0 ? &InClearance : nullptr;
+		MinClearance = InMinClearance;
+		Reset(InWalkable.GetXNum(), InWalkable.GetYNum(), InWalkable.GetZNum());
+		return Search(StartIdx, EndIdx, Algorithm, OutPath);
+	}
+
+	bool FPathSearch::FindPath(const FVoxelSpanGrid& InWalkable, const FIntVec3& StartIdx, const FIntVec3& EndIdx, EPathAlgorithm Algorithm,
+							   std::vector<FIntVec3>& OutPath)
+	{
+		Walkable = nullptr;
+		WalkableSpans = &InWalkable;
+		Clearance = nullptr;
+		Reset(InWalkable.GetXNum(), InWalkable.GetYNum(), InWalkable.GetZNum());
+		return Search(StartIdx, EndIdx, Algorithm, OutPath);
+	}
+
+	bool FPathSearch::Search(const FIntVec3& StartIdx, const FIntVec3& EndIdx, EPathAlgorithm Algorithm, std::vector<FIntVec3>& OutPath)
+	{
+		OutPath.clear();
+
+		if (!StartIdx.IsValid() || !EndIdx.IsValid())
+		{
+			return false;
+		}
+
+		Goal = EndIdx;
+
+		PushOpen(StartIdx, FIntVec3::Invalid(), 0, PathNoDir);
+
+		bool Found = false;
+		while (!Open.empty())
+		{
+			std::pop_heap(Open.begin(), Open.end());
+			const FOpenEntry Entry = Open.back();
+			Open.pop_back();
+
+			FNode& Node = GetNode(Entry.Idx);
+			if (Node.bClosed || Entry.G != Node.G)
+			{
+				continue;
+			}
+			Node.bClosed = true;
+			++Stats.ExpandedNum;
+
+			if (Entry.Idx == EndIdx)
+			{
+				Found = true;
+				break;
+			}
+
+			if (Algorithm == EPathAlgorithm::JumpPoint)
+			{
+				ExpandJumpPoint(Entry.Idx, Entry.G, Node.Dir);
+			}
+			else
+			{
+				ExpandAStar(Entry.Idx, Entry.G);
+			}
+		}
+
+		if (!Found)
+		{
+			return false;
+		}
+
+		AppendPath(StartIdx, EndIdx, OutPath);
+		return true;
+	}
+
+	void FPathSearch::AppendPath(const FIntVec3& StartIdx, const FIntVec3& EndIdx, std::vector<FIntVec3>& OutPath)
+	{
+		const size_t First = OutPath.size();
+
+		// Walk the parents back; consecutive jump points lie on one axis, fill the voxels in between
+		FIntVec3 NowIdx = EndIdx;
+		while (NowIdx != StartIdx)
+		{
+			const FIntVec3 Parent = GetNode(NowIdx).Parent;
+			const int Dist = PathHeuristic(NowIdx, Parent);
+			const int Dir = GetNode(NowIdx).Dir;
+			for (int Step = 0; Step < Dist; ++Step)
+			{
+				OutPath.push_back(PathStep(NowIdx, Dir ^ 1, Step));
+			}
+			NowIdx = Parent;
+		}
+		OutPath.push_back(StartIdx);
+		std::reverse(OutPath.begin() + First, OutPath.end());
+	}
+
+	int FPathSearch::BuildPathTree(const FVoxelGrid& InWalkable, const FIntVec3& StartIdx, const FIntVec3* Goals, int GoalNum)
+	{
+		Walkable = &InWalkable;
+		WalkableSpans = nullptr;
+		Clearance = nullptr;
+		Reset(InWalkable.GetXNum(), InWalkable.GetYNum(), InWalkable.GetZNum());
+		return GrowTree(StartIdx, Goals, GoalNum);
+	}
+
+	int FPathSearch::BuildPathTree(const FVoxelSpanGrid& InWalkable, const FIntVec3& StartIdx, const FIntVec3* Goals, int GoalNum)
+	{
+		Walkable = nullptr;
+		WalkableSpans = &InWalkable;
+		Clearance = nullptr;
+		Reset(InWalkable.GetXNum(), InWalkable.GetYNum(), InWalkable.GetZNum());
+		return GrowTree(StartIdx, Goals, GoalNum);
+	}
+
+	int FPathSearch::GrowTree(const FIntVec3& StartIdx, const FIntVec3* Goals, int GoalNum)
+	{
+		if (!StartIdx.IsValid())
+		{
+			return 0;
+		}
+
+		// Only goals a path can end on count, an unreachable one would have the tree flood the whole region
+		for (int i = 0; i < GoalNum; ++i)
+		{
+			if (Goals[i] == StartIdx || (Goals[i].IsValid() && IsWalkable(Goals[i])))
+			{
+				FNode& Node = GetNode(Goals[i]);
+				if (!Node.bGoal)
+				{
+					Node.bGoal = true;
+					TreeGoals.push_back(Goals[i]);
+				}
+			}
+		}
+		const int TargetNum = static_cast<int>(TreeGoals.size());
+		if (TargetNum == 0)
+		{
+			return 0;
+		}
+
+		// A* towards the nearest goal not reached yet
+		TreeRoot = StartIdx;
+		PushOpen(StartIdx, FIntVec3::Invalid(), 0, PathNoDir);
+
+		bool bStaleEstimates = false;
+		while (!Open.empty() && !TreeGoals.empty())
+		{
+			// Once a goal drops out the estimates in the heap are only lower bounds. The top entry is still the
+			// next one if its own estimate is unchanged; if not, the whole heap is refreshed once.
+			if (bStaleEstimates && Open.front().F != Open.front().G + Heuristic(Open.front().Idx))
+			{
+				RefreshOpenEstimates();
+				bStaleEstimates = false;
+			}
+
+			std::pop_heap(Open.begin(), Open.end());
+			const FOpenEntry Entry = Open.back();
+			Open.pop_back();
+
+			FNode& Node = GetNode(Entry.Idx);
+			if (Node.bClosed || Entry.G != Node.G)
+			{
+				continue;
+			}
+			Node.bClosed = true;
+			++Stats.ExpandedNum;
+
+			if (Node.bGoal)
+			{
+				*std::find(TreeGoals.begin(), TreeGoals.end(), Entry.Idx) = TreeGoals.back();
+				TreeGoals.pop_back();
+
+				bStaleEstimates = true;
+			}
+
+			ExpandAStar(Entry.Idx, Entry.G);
+		}
+
+		return TargetNum - static_cast<int>(TreeGoals.size());
+	}
+
+	void FPathSearch::RefreshOpenEstimates()
+	{
+		// Superseded entries are dropped on the way, the rest keep their distance
+		size_t KeptNum = 0;
+		for (const FOpenEntry& Entry : Open)
+		{
+			const FNode& Node = GetNode(Entry.Idx);
+			if (!Node.bClosed && Node.G == Entry.G)
+			{
+				Open[KeptNum++] = {Entry.G + Heuristic(Entry.Idx), Entry.G, Entry.Idx};
+			}
+		}
+		Open.resize(KeptNum);
+		std::make_heap(Open.begin(), Open.end());
+	}
+
+	bool FPathSearch::AppendTreePath(const FIntVec3& Goal, std::vector<FIntVec3>& OutPath)
+	{
+		if (!TreeRoot.IsValid() || !Goal.IsValid() || (Goal != TreeRoot && !IsWalkable(Goal)) || !GetNode(Goal).bClosed)
+		{
+			return false;
+		}
+
+		AppendPath(TreeRoot, Goal, OutPath);
+		return true;
+	}
+
+	bool FindPath(const FVoxelGrid& Walkable, const FIntVec3& StartIdx, const FIntVec3& EndIdx, std::vector<FIntVec3>& OutPath,
+				  EPathAlgorithm Algorithm)
+	{
+		FPathSearch Search;
+		return Search.FindPath(Walkable, StartIdx, EndIdx, Algorithm, OutPath);
+	}
+}
@@ -0,0 +1,83 @@
+#include "VoxelCore/InsightVoxelPipeline.h"
+#include "VoxelCore/InsightVoxelBvh.h"
+#include "VoxelCore/InsightVoxelGrid.h"
+#include "VoxelCore/InsightVoxelRasterizer.h"
+
+#include <algorithm>
+#include <thread>
+
+namespace InsightVoxel
+{
+	FTriangleBatchQueue::FTriangleBatchQueue(int InCapacity)
+		: Capacity(std::max(InCapacity, 1))
+	{
+	}
+
+	void FTriangleBatchQueue::Push(const FTriangleBatch& Batch)
+	{
+		std::unique_lock<std::mutex> Lock(Mutex);
+		NotFull.wait(Lock, [this] { return static_cast<int>(Batches.size()) < Capacity; });
+		Batches.push_back(Batch);
+		Lock.unlock();
+		NotEmpty.notify_one();
+	}
+
+	bool FTriangleBatchQueue::Pop(FTriangleBatch& OutBatch)
+	{
+		std::unique_lock<std::mutex> Lock(Mutex);
+		NotEmpty.wait(Lock, [this] { return !Batches.empty() || bClosed; });
+		if (Batches.empty())
+		{
+			return false;
+		}
+
+		OutBatch = Batches.front();
+		Batches.pop_front();
+		Lock.unlock();
+		NotFull.notify_one();
+		return true;
+	}
+
+	void FTriangleBatchQueue::Close()
+	{
+		{
+			std::lock_guard<std::mutex> Lock(Mutex);
+			bClosed = true;
+		}
+		NotEmpty.notify_all();
+	}
+
+	void RasterizePipelined(FVoxelGrid& Grid, int ItemNum, const FExportBatchFn& Export, const FParallelForFn& ParallelFor,
+							int QueueCapacity, FVoxelStats* Stats)
+	{
+		FTriangleBatchQueue Queue(QueueCapacity);
+
+		// The consumer gets its own thread rather than a ParallelFor slot: with a serial ParallelFor the
+		// producers would otherwise fill the queue and wait forever
+		std::thread Rasterizer([&Grid, &Queue, Stats] {
+			FTriangleBatch Batch;
+			while (Queue.Pop(Batch))
+			{
+				if (Batch.Bvh)
+				{
+					RasterizeTriangles(Grid, Batch.Verts, Batch.NumVerts, Batch.Indices, *Batch.Bvh, Stats);
+				}
+				else
+				{
+					RasterizeTriangles(Grid, Batch.Verts, Batch.NumVerts, Batch.Indices, Batch.NumTris, Stats);
+				}
+			}
+		});
+
+		ParallelFor(ItemNum, [&Export, &Queue](int Index) {
+			FTriangleBatch Batch;
+			if (Export(Index, Batch) && Batch.NumTris > 0)
+			{
+				Queue.Push(Batch);
+			}
+		});
+
+		Queue.Close();
+		Rasterizer.join();
+	}
+}
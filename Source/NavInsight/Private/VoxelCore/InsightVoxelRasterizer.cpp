@@ -0,0 +1,533 @@
+#include "VoxelCore/InsightVoxelRasterizer.h"
+#include "VoxelCore/InsightVoxelBvh.h"
+#include "VoxelCore/InsightVoxelClipKernel.h"
+#include "VoxelCore/InsightVoxelGrid.h"
+#include "VoxelCore/InsightVoxelSparseGrid.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+namespace InsightVoxel
+{
+	static int FloorToIntVoxel(float Value)
+	{
+		return static_cast<int>(std::floor(Value));
+	}
+
+	static int CeilToIntVoxel(float Value)
+	{
+		return static_cast<int>(std::ceil(Value));
+	}
+
+	static int ClampVoxel(int Value, int Lo, int Hi)
+	{
+		return Value < Lo ? Lo : (Value > Hi ? Hi : Value);
+	}
+
+	void DividePoly(const FVec3* InPoly, int NIn,
+					FVec3* OutPolyLeft, int& NOutLeft,
+					FVec3* OutPolyRight, int& NOutRight,
+					float X, int Axis)
+	{
+		// max poly edge (corner): 1 * 2 (axis-aligned) + 2 * 3 (triangle edge intersect.) + 4
+		float Diff[12];
+		for (int i = 0; i < NIn; ++i)
+		{
+			Diff[i] = X - InPoly[i][Axis];
+		}
+
+		NOutLeft = 0;
+		NOutRight = 0;
+
+		// Iterate over all vertex indexed by I
+		int IIdxPrev = NIn - 1;
+		for (int IIdx = 0; IIdx < NIn; ++IIdx)
+		{
+			// Current line seg. is <I-, I>
+			const bool bLeftIPrev = Diff[IIdxPrev] >= 0;
+			const bool bLeftI = Diff[IIdx] >= 0;
+			// I-, I is at separate line different side
+			if (bLeftI != bLeftIPrev)
+			{
+				// Compute <I-, I> intersection point with X-axis by linear interpolation
+				// Add intersection point to Left & Right Polygon
+				const float s = Diff[IIdxPrev] / (Diff[IIdxPrev] - Diff[IIdx]);
+				OutPolyLeft[NOutLeft++] = InPoly[IIdxPrev] + (InPoly[IIdx] - InPoly[IIdxPrev]) * s;
+				OutPolyRight[NOutRight++] = OutPolyLeft[NOutLeft - 1];
+
+				// Add I to corresponding left / right polygon if exactly falls in LHS / RHS
+				if (Diff[IIdx] > 0)
+				{
+					OutPolyLeft[NOutLeft++] = InPoly[IIdx];
+				}
+				else if (Diff[IIdx] < 0)
+				{
+					OutPolyRight[NOutRight++] = InPoly[IIdx];
+				}
+			}
+			else
+			{
+				// <I-, I> are both at LHS or RHS of axis
+				// At I to corresponding polygon
+				if (bLeftI)
+				{
+					// I is at LHS (I- is also at LHS, which is supposed to be added when visiting it)
+					OutPolyLeft[NOutLeft++] = InPoly[IIdx];
+
+					// Exactly on the axis (add to both polygon)
+					if (Diff[IIdx] != 0)
+					{
+						IIdxPrev = IIdx;
+						continue;
+					}
+				}
+
+				// I is at RHS or exactly on the edge
+				OutPolyRight[NOutRight++] = InPoly[IIdx];
+			}
+
+			IIdxPrev = IIdx;
+		}
+	}
+
+	// Shared by the dense and the sparse grid, which only differ in SetSpan
+	template <typename GridType>
+	static void RasterizeTriangleInGrid(GridType& Grid, const FVec3& A, const FVec3& B, const FVec3& C, const FVoxelTile& Tile,
+										FVoxelStats& Stats)
+	{
+		const FBounds3& VoxelBBox = Grid.GetBounds();
+		const float CellSize = Grid.GetCellSize();
+		const float CellHeight = Grid.GetCellHeight();
+		const int VoxelXNum = Grid.GetXNum();
+		const int VoxelYNum = Grid.GetYNum();
+		const int VoxelZNum = Grid.GetZNum();
+
+		FBounds3 TrBBox;
+		TrBBox.Min = {std::min(C.X, std::min(A.X, B.X)), std::min(C.Y, std::min(A.Y, B.Y)), std::min(C.Z, std::min(A.Z, B.Z))};
+		TrBBox.Max = {std::max(C.X, std::max(A.X, B.X)), std::max(C.Y, std::max(A.Y, B.Y)), std::max(C.Z, std::max(A.Z, B.Z))};
+
+		if (!TrBBox.Intersect(VoxelBBox))
+		{
+			++Stats.TrianglesCulled;
+			return;
+		}
+		// Get voxel Y index
+		int Y0 = FloorToIntVoxel((TrBBox.Min.Y - VoxelBBox.Min.Y) / CellSize);
+		int Y1 = CeilToIntVoxel((TrBBox.Max.Y - VoxelBBox.Min.Y) / CellSize);
+		Y0 = ClampVoxel(Y0, 0, VoxelYNum - 1);
+		Y1 = ClampVoxel(Y1, 0, VoxelYNum - 1);
+		Y1 = std::min(Y1, Tile.Y1 - 1);
+
+		// Clip the triangle into all grid rows it touches, then split every row into cells with ClipRowSpans.
+		// Initialize three polygon positions (<= 7 corners)
+		FVec3 Buf[7 * 3];
+
+		FVec3* In     = Buf;
+		FVec3* InRow  = In + 7;
+		FVec3* P1     = InRow + 7;
+
+		In[0] = A;
+		In[1] = B;
+		In[2] = C;
+
+		int NRow = 3;
+		int NIn = 3;
+
+		// Cut along Y-Axis into Rows
+		for (int Y = Y0; Y <= Y1; ++Y)
+		{
+			// Clip polygon to row (upper edge of the row, same as the column clipping below).
+			// Store the remaining polygon as well
+			const float ClipY = VoxelBBox.Min.Y + (Y + 1) * CellSize;
+
+			DividePoly(In, NIn, InRow, NRow, P1, NIn, ClipY, 1);
+			std::swap(In, P1);
+			++Stats.RowsClipped;
+
+			if (NRow < 3 || Y < Tile.Y0)
+			{
+				// Nothing left, or the row belongs to another tile
+				continue;
+			}
+
+			float MinX = InRow[0].X;
+			float MaxX = InRow[0].X;
+			for (int i = 0; i < NRow; ++i)
+			{
+				if (MinX > InRow[i].X) MinX = InRow[i].X;
+				if (MaxX < InRow[i].X) MaxX = InRow[i].X;
+			}
+
+			int X0 = FloorToIntVoxel((MinX - VoxelBBox.Min.X) / CellSize);
+			int X1 = CeilToIntVoxel((MaxX - VoxelBBox.Min.X) / CellSize);
+			X0 = ClampVoxel(X0, 0, VoxelXNum - 1);
+			X1 = ClampVoxel(X1, 0, VoxelXNum - 1);
+			X1 = std::min(X1, Tile.X1 - 1);
+
+			// Split the row polygon into all of its cells at once
+			FRowPolySoA RowPoly;
+			RowPoly.Num = NRow;
+			for (int i = 0; i < NRow; ++i)
+			{
+				RowPoly.X[i] = InRow[i].X;
+				RowPoly.Z[i] = InRow[i].Z;
+			}
+
+			float SpanMin[ClipKernelMaxCells];
+			float SpanMax[ClipKernelMaxCells];
+			uint8_t SpanValid[ClipKernelMaxCells];
+
+			FClipRowState RowState;
+			for (int ChunkX0 = std::max(X0, Tile.X0); ChunkX0 <= X1; ChunkX0 += ClipKernelMaxCells)
+			{
+				const int ChunkX1 = std::min(X1, ChunkX0 + ClipKernelMaxCells - 1);
+				ClipRowSpans(RowPoly, VoxelBBox.Min.X, CellSize, X0, ChunkX0, ChunkX1, SpanMin, SpanMax, SpanValid, &RowState);
+				Stats.CellsClipped += ChunkX1 - ChunkX0 + 1;
+
+				for (int X = ChunkX0; X <= ChunkX1; ++X)
+				{
+					if (!SpanValid[X - ChunkX0]) continue;
+
+					float smin = SpanMin[X - ChunkX0];
+					float smax = SpanMax[X - ChunkX0];
+
+					// Skip the span if it is outside the bbox
+					if (smax < VoxelBBox.Min.Z) continue;
+					if (smin > VoxelBBox.Max.Z) continue;
+					// Clamp the span to the bbox.
+					if (smin < VoxelBBox.Min.Z) smin = VoxelBBox.Min.Z;
+					if (smax > VoxelBBox.Max.Z) smax = VoxelBBox.Max.Z;
+
+					smin -= VoxelBBox.Min.Z;
+					smax -= VoxelBBox.Min.Z;
+
+					const int ZMin = ClampVoxel(FloorToIntVoxel(smin / CellHeight), 0, VoxelZNum - 1);
+					const int ZMax = ClampVoxel(CeilToIntVoxel(smax / CellHeight), 0, VoxelZNum);
+
+					Grid.SetSpan(X, Y, ZMin, ZMax);
+					++Stats.SpansWritten;
+					Stats.VoxelsWritten += ZMax - ZMin;
+				}
+			}
+		}
+	}
+
+	template <typename GridType>
+	static void RasterizeTrianglesInGrid(GridType& Grid, const float* Verts, int NumVerts, const int32_t* Indices, int NumTris,
+										 FVoxelStats* Stats)
+	{
+		FVoxelStats Local;
+		Local.TrianglesSubmitted = NumTris;
+		for (int TIdx = 0; TIdx < NumTris; ++TIdx)
+		{
+			const int32_t IA = Indices[TIdx * 3 + 0];
+			const int32_t IB = Indices[TIdx * 3 + 1];
+			const int32_t IC = Indices[TIdx * 3 + 2];
+			if (IA < 0 || IB < 0 || IC < 0 || IA >= NumVerts || IB >= NumVerts || IC >= NumVerts)
+			{
+				++Local.TrianglesCulled;
+				continue;
+			}
+
+			const FVec3 PosA(Verts[IA * 3 + 0], Verts[IA * 3 + 1], Verts[IA * 3 + 2]);
+			const FVec3 PosB(Verts[IB * 3 + 0], Verts[IB * 3 + 1], Verts[IB * 3 + 2]);
+			const FVec3 PosC(Verts[IC * 3 + 0], Verts[IC * 3 + 1], Verts[IC * 3 + 2]);
+
+			RasterizeTriangleInGrid(Grid, PosA, PosB, PosC, FVoxelTile(0, 0, Grid.GetXNum(), Grid.GetYNum()), Local);
+		}
+
+		if (Stats)
+		{
+			*Stats += Local;
+		}
+	}
+
+	// Column rectangle (inclusive) a triangle can write to, computed the same way RasterizeTriangle does
+	template <typename GridType>
+	static bool GetTriangleColumnRect(const GridType& Grid, const FVec3& A, const FVec3& B, const FVec3& C,
+									  int& OutX0, int& OutY0, int& OutX1, int& OutY1)
+	{
+		const FBounds3& VoxelBBox = Grid.GetBounds();
+
+		FBounds3 TrBBox;
+		TrBBox.Min = {std::min(C.X, std::min(A.X, B.X)), std::min(C.Y, std::min(A.Y, B.Y)), std::min(C.Z, std::min(A.Z, B.Z))};
+		TrBBox.Max = {std::max(C.X, std::max(A.X, B.X)), std::max(C.Y, std::max(A.Y, B.Y)), std::max(C.Z, std::max(A.Z, B.Z))};
+
+		if (!TrBBox.Intersect(VoxelBBox))
+		{
+			return false;
+		}
+
+		OutX0 = ClampVoxel(FloorToIntVoxel((TrBBox.Min.X - VoxelBBox.Min.X) / Grid.GetCellSize()), 0, Grid.GetXNum() - 1);
+		OutX1 = ClampVoxel(CeilToIntVoxel((TrBBox.Max.X - VoxelBBox.Min.X) / Grid.GetCellSize()), 0, Grid.GetXNum() - 1);
+		OutY0 = ClampVoxel(FloorToIntVoxel((TrBBox.Min.Y - VoxelBBox.Min.Y) / Grid.GetCellSize()), 0, Grid.GetYNum() - 1);
+		OutY1 = ClampVoxel(CeilToIntVoxel((TrBBox.Max.Y - VoxelBBox.Min.Y) / Grid.GetCellSize()), 0, Grid.GetYNum() - 1);
+		return true;
+	}
+
+	template <typename GridType>
+	static void RasterizeTrianglesInGrid(GridType& Grid, const float* Verts, int NumVerts, const int32_t* Indices, int NumTris,
+										 const FVoxelTile& Tile, FVoxelStats* Stats)
+	{
+		FVoxelStats Local;
+		Local.TrianglesSubmitted = NumTris;
+		for (int TIdx = 0; TIdx < NumTris; ++TIdx)
+		{
+			const int32_t IA = Indices[TIdx * 3 + 0];
+			const int32_t IB = Indices[TIdx * 3 + 1];
+			const int32_t IC = Indices[TIdx * 3 + 2];
+			if (IA < 0 || IB < 0 || IC < 0 || IA >= NumVerts || IB >= NumVerts || IC >= NumVerts)
+			{
+				++Local.TrianglesCulled;
+				continue;
+			}
+
+			const FVec3 PosA(Verts[IA * 3 + 0], Verts[IA * 3 + 1], Verts[IA * 3 + 2]);
+			const FVec3 PosB(Verts[IB * 3 + 0], Verts[IB * 3 + 1], Verts[IB * 3 + 2]);
+			const FVec3 PosC(Verts[IC * 3 + 0], Verts[IC * 3 + 1], Verts[IC * 3 + 2]);
+
+			int X0, Y0, X1, Y1;
+			if (!GetTriangleColumnRect(Grid, PosA, PosB, PosC, X0, Y0, X1, Y1)
+				|| X1 < Tile.X0 || X0 >= Tile.X1 || Y1 < Tile.Y0 || Y0 >= Tile.Y1)
+			{
+				++Local.TrianglesCulled;
+				continue;
+			}
+
+			RasterizeTriangleInGrid(Grid, PosA, PosB, PosC, Tile, Local);
+		}
+
+		if (Stats)
+		{
+			*Stats += Local;
+		}
+	}
+
+	void RasterizeTriangle(FVoxelGrid& Grid, const FVec3& A, const FVec3& B, const FVec3& C)
+	{
+		FVoxelStats Unused;
+		RasterizeTriangleInGrid(Grid, A, B, C, FVoxelTile(0, 0, Grid.GetXNum(), Grid.GetYNum()), Unused);
+	}
+
+	void RasterizeTriangle(FVoxelGrid& Grid, const FVec3& A, const FVec3& B, const FVec3& C, const FVoxelTile& Tile)
+	{
+		FVoxelStats Unused;
+		RasterizeTriangleInGrid(Grid, A, B, C, Tile, Unused);
+	}
+
+	void RasterizeTriangles(FVoxelGrid& Grid, const float* Verts, int NumVerts, const int32_t* Indices, int NumTris, FVoxelStats* Stats)
+	{
+		RasterizeTrianglesInGrid(Grid, Verts, NumVerts, Indices, NumTris, Stats);
+	}
+
+	void RasterizeTriangles(FVoxelGrid& Grid, const float* Verts, int NumVerts, const int32_t* Indices, int NumTris, const FVoxelTile& Tile,
+							FVoxelStats* Stats)
+	{
+		RasterizeTrianglesInGrid(Grid, Verts, NumVerts, Indices, NumTris, Tile, Stats);
+	}
+
+	// World box holding every triangle whose column rectangle can overlap Tile. Column rectangles round outwards
+	// (see GetTriangleColumnRect), so the box reaches one extra column beyond the tile on each inner side.
+	static FBounds3 GetTileQueryBox(const FVoxelGrid& Grid, const FVoxelTile& Tile)
+	{
+		FBounds3 Box = Grid.GetBounds();
+		if (Tile.X0 > 0)
+		{
+			Box.Min.X = Grid.GetBounds().Min.X + (Tile.X0 - 1) * Grid.GetCellSize();
+		}
+		if (Tile.X1 < Grid.GetXNum())
+		{
+			Box.Max.X = Grid.GetBounds().Min.X + (Tile.X1 + 1) * Grid.GetCellSize();
+		}
+		if (Tile.Y0 > 0)
+		{
+			Box.Min.Y = Grid.GetBounds().Min.Y + (Tile.Y0 - 1) * Grid.GetCellSize();
+		}
+		if (Tile.Y1 < Grid.GetYNum())
+		{
+			Box.Max.Y = Grid.GetBounds().Min.Y + (Tile.Y1 + 1) * Grid.GetCellSize();
+		}
+		return Box;
+	}
+
+	void RasterizeTriangles(FVoxelGrid& Grid, const float* Verts, int NumVerts, const int32_t* Indices, const FTriangleBvh& Bvh,
+							FVoxelStats* Stats)
+	{
+		RasterizeTriangles(Grid, Verts, NumVerts, Indices, Bvh, FVoxelTile(0, 0, Grid.GetXNum(), Grid.GetYNum()), Stats);
+	}
+
+	void RasterizeTriangles(FVoxelGrid& Grid, const float* Verts, int NumVerts, const int32_t* Indices, const FTriangleBvh& Bvh,
+							const FVoxelTile& Tile, FVoxelStats* Stats)
+	{
+		// Everything the query leaves out counts as culled
+		FVoxelStats Local;
+		Local.TrianglesSubmitted = Bvh.GetTriangleNum();
+		Local.TrianglesCulled = Bvh.GetTriangleNum();
+		if (Tile.IsEmpty() || Bvh.IsEmpty())
+		{
+			if (Stats)
+			{
+				*Stats += Local;
+			}
+			return;
+		}
+
+		std::vector<int32_t> Tris;
+		Bvh.QueryBox(GetTileQueryBox(Grid, Tile), Tris);
+		Local.TrianglesCulled -= static_cast<int64_t>(Tris.size());
+
+		for (const int32_t TIdx : Tris)
+		{
+			const int32_t IA = Indices[TIdx * 3 + 0];
+			const int32_t IB = Indices[TIdx * 3 + 1];
+			const int32_t IC = Indices[TIdx * 3 + 2];
+			if (IA < 0 || IB < 0 || IC < 0 || IA >= NumVerts || IB >= NumVerts || IC >= NumVerts)
+			{
+				++Local.TrianglesCulled;
+				continue;
+			}
+
+			const FVec3 PosA(Verts[IA * 3 + 0], Verts[IA * 3 + 1], Verts[IA * 3 + 2]);
+			const FVec3 PosB(Verts[IB * 3 + 0], Verts[IB * 3 + 1], Verts[IB * 3 + 2]);
+			const FVec3 PosC(Verts[IC * 3 + 0], Verts[IC * 3 + 1], Verts[IC * 3 + 2]);
+
+			int X0, Y0, X1, Y1;
+			if (!GetTriangleColumnRect(Grid, PosA, PosB, PosC, X0, Y0, X1, Y1)
+				|| X1 < Tile.X0 || X0 >= Tile.X1 || Y1 < Tile.Y0 || Y0 >= Tile.Y1)
+			{
+				++Local.TrianglesCulled;
+				continue;
+			}
+
+			RasterizeTriangleInGrid(Grid, PosA, PosB, PosC, Tile, Local);
+		}
+
+		if (Stats)
+		{
+			*Stats += Local;
+		}
+	}
+
+	void RasterizeTriangle(FSparseVoxelGrid& Grid, const FVec3& A, const FVec3& B, const FVec3& C)
+	{
+		FVoxelStats Unused;
+		RasterizeTriangleInGrid(Grid, A, B, C, FVoxelTile(0, 0, Grid.GetXNum(), Grid.GetYNum()), Unused);
+	}
+
+	void RasterizeTriangles(FSparseVoxelGrid& Grid, const float* Verts, int NumVerts, const int32_t* Indices, int NumTris,
+							FVoxelStats* Stats)
+	{
+		RasterizeTrianglesInGrid(Grid, Verts, NumVerts, Indices, NumTris, Stats);
+	}
+
+	void RasterizeTriangles(FSparseVoxelGrid& Grid, const float* Verts, int NumVerts, const int32_t* Indices, int NumTris,
+							const FVoxelTile& Tile, FVoxelStats* Stats)
+	{
+		RasterizeTrianglesInGrid(Grid, Verts, NumVerts, Indices, NumTris, Tile, Stats);
+	}
+
+	void RasterizeTrianglesTiled(FVoxelGrid& Grid, const float* Verts, int NumVerts, const int32_t* Indices, int NumTris,
+								 const FVoxelTiling& Tiling, const FParallelForFn& ParallelFor, FVoxelStats* Stats)
+	{
+		const int TileNum = Tiling.GetTileNum();
+		if (TileNum == 0 || NumTris == 0)
+		{
+			return;
+		}
+
+		auto GetVert = [Verts](int32_t Index) {
+			return FVec3(Verts[Index * 3 + 0], Verts[Index * 3 + 1], Verts[Index * 3 + 2]);
+		};
+
+		// Tile range of every triangle (TX0, TY0, TX1, TY1 inclusive, TX0 = -1 when culled)
+		std::vector<int> TriTiles(static_cast<size_t>(NumTris) * 4, -1);
+		std::vector<int> TileOffsets(TileNum + 1, 0);
+		FVoxelStats Binned;
+		Binned.TrianglesSubmitted = NumTris;
+
+		for (int TIdx = 0; TIdx < NumTris; ++TIdx)
+		{
+			const int32_t IA = Indices[TIdx * 3 + 0];
+			const int32_t IB = Indices[TIdx * 3 + 1];
+			const int32_t IC = Indices[TIdx * 3 + 2];
+			if (IA < 0 || IB < 0 || IC < 0 || IA >= NumVerts || IB >= NumVerts || IC >= NumVerts)
+			{
+				++Binned.TrianglesCulled;
+				continue;
+			}
+
+			int X0, Y0, X1, Y1;
+			if (!GetTriangleColumnRect(Grid, GetVert(IA), GetVert(IB), GetVert(IC), X0, Y0, X1, Y1))
+			{
+				++Binned.TrianglesCulled;
+				continue;
+			}
+
+			int* Range = &TriTiles[TIdx * 4];
+			Range[0] = X0 / Tiling.GetTileX();
+			Range[1] = Y0 / Tiling.GetTileY();
+			Range[2] = X1 / Tiling.GetTileX();
+			Range[3] = Y1 / Tiling.GetTileY();
+
+			for (int TY = Range[1]; TY <= Range[3]; ++TY)
+			{
+				for (int TX = Range[0]; TX <= Range[2]; ++TX)
+				{
+					++TileOffsets[Tiling.GetTileIndex(TX, TY) + 1];
+				}
+			}
+		}
+
+		for (int TileIndex = 0; TileIndex < TileNum; ++TileIndex)
+		{
+			TileOffsets[TileIndex + 1] += TileOffsets[TileIndex];
+		}
+
+		// Triangles are appended in submission order, so every tile is rasterized in the same order as the serial path
+		std::vector<int32_t> TileTris(TileOffsets[TileNum]);
+		std::vector<int> TileFill(TileOffsets.begin(), TileOffsets.end() - 1);
+		for (int TIdx = 0; TIdx < NumTris; ++TIdx)
+		{
+			const int* Range = &TriTiles[TIdx * 4];
+			if (Range[0] < 0)
+			{
+				continue;
+			}
+			for (int TY = Range[1]; TY <= Range[3]; ++TY)
+			{
+				for (int TX = Range[0]; TX <= Range[2]; ++TX)
+				{
+					TileTris[TileFill[Tiling.GetTileIndex(TX, TY)]++] = TIdx;
+				}
+			}
+		}
+
+		// A triangle binned into several tiles is clipped in each of them, and its rows and cells count in each
+		std::vector<FVoxelStats> TileStats(Stats ? TileNum : 0);
+		ParallelFor(TileNum, [&](int TileIndex) {
+			const FVoxelTile Tile = Tiling.GetTile(TileIndex);
+			FVoxelStats Local;
+			for (int i = TileOffsets[TileIndex]; i < TileOffsets[TileIndex + 1]; ++i)
+			{
+				const int32_t TIdx = TileTris[i];
+				RasterizeTriangleInGrid(Grid, GetVert(Indices[TIdx * 3 + 0]), GetVert(Indices[TIdx * 3 + 1]), GetVert(Indices[TIdx * 3 + 2]),
+					Tile, Local);
+			}
+			if (Stats)
+			{
+				TileStats[TileIndex] = Local;
+			}
+		});
+
+		if (Stats)
+		{
+			*Stats += Binned;
+			for (const FVoxelStats& Local : TileStats)
+			{
+				*Stats += Local;
+			}
+		}
+	}
+}
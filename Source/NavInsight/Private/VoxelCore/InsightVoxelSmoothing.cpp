@@ -0,0 +1,141 @@
+#include "VoxelCore/InsightVoxelSmoothing.h"
+#include "VoxelCore/InsightVoxelBits.h"
+#include "VoxelCore/InsightVoxelClearance.h"
+#include "VoxelCore/InsightVoxelGrid.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace InsightVoxel
+{
+	// Edge and corner crossings closer than this (in segment parameter) count as simultaneous
+	static const double CrossingTolerance = 1e-9;
+
+	// Whether voxels [ZMin, ZMax] of column (X, Y) are all stayable (and clear enough)
+	static bool IsColumnRangeClear(const FVoxelGrid& Walkable, int X, int Y, int ZMin, int ZMax, const FClearanceField* Clearance,
+								   int MinClearance)
+	{
+		if (X < 0 || X >= Walkable.GetXNum() || Y < 0 || Y >= Walkable.GetYNum() || ZMin < 0 || ZMax >= Walkable.GetZNum())
+		{
+			return false;
+		}
+
+		const uint64_t* Column = Walkable.GetColumn(X, Y);
+		for (int Word = ZMin >> 6; Word <= ZMax >> 6; ++Word)
+		{
+			const uint64_t Mask = BitRangeMask64(std::max(ZMin - Word * 64, 0), std::min(ZMax + 1 - Word * 64, 64));
+			if ((Column[Word] & Mask) != Mask)
+			{
+				return false;
+			}
+		}
+
+		if (Clearance)
+		{
+			for (int Z = ZMin; Z <= ZMax; ++Z)
+			{
+				if (Clearance->GetClearance(Walkable, X, Y, Z) < MinClearance)
+				{
+					return false;
+				}
+			}
+		}
+		return true;
+	}
+
+	bool HasLineOfSight(const FVoxelGrid& Walkable, const FIntVec3& From, const FIntVec3& To, const FClearanceField* Clearance,
+						int MinClearance)
+	{
+		if (!From.IsValid() || !To.IsValid())
+		{
+			return false;
+		}
+
+		// Voxel I spans [I - 0.5, I + 0.5] around its center; boundaries touched count on both sides
+		const double DZ = To.Z - From.Z;
+		auto ClearBetween = [&](int X, int Y, double T0, double T1)
+		{
+			const double Z0 = From.Z + DZ * T0;
+			const double Z1 = From.Z + DZ * T1;
+			const int ZMin = static_cast<int>(std::ceil(std::min(Z0, Z1) - 0.5 - CrossingTolerance));
+			const int ZMax = static_cast<int>(std::floor(std::max(Z0, Z1) + 0.5 + CrossingTolerance));
+			return IsColumnRangeClear(Walkable, X, Y, ZMin, ZMax, Clearance, MinClearance);
+		};
+
+		const int DX = To.X - From.X;
+		const int DY = To.Y - From.Y;
+		const int StepX = DX > 0 ? 1 : -1;
+		const int StepY = DY > 0 ? 1 : -1;
+		const double Infinity = std::numeric_limits<double>::infinity();
+		const double DeltaX = DX != 0 ? 1.0 / std::abs(DX) : Infinity;
+		const double DeltaY = DY != 0 ? 1.0 / std::abs(DY) : Infinity;
+		double NextX = DeltaX * 0.5;
+		double NextY = DeltaY * 0.5;
+
+		int X = From.X;
+		int Y = From.Y;
+		double T = 0.0;
+		for (;;)
+		{
+			const double Exit = std::min(std::min(NextX, NextY), 1.0);
+			if (!ClearBetween(X, Y, T, Exit))
+			{
+				return false;
+			}
+			if (Exit >= 1.0)
+			{
+				return true;
+			}
+
+			if (std::abs(NextX - NextY) <= CrossingTolerance)
+			{
+				// Through a column corner: both columns beside it are touched
+				if (!ClearBetween(X + StepX, Y, Exit, Exit) || !ClearBetween(X, Y + StepY, Exit, Exit))
+				{
+					return false;
+				}
+				X += StepX;
+				Y += StepY;
+				NextX += DeltaX;
+				NextY += DeltaY;
+			}
+			else if (NextX < NextY)
+			{
+				X += StepX;
+				NextX += DeltaX;
+			}
+			else
+			{
+				Y += StepY;
+				NextY += DeltaY;
+			}
+			T = Exit;
+		}
+	}
+
+	void SmoothPath(const FVoxelGrid& Walkable, const std::vector<FIntVec3>& Path, std::vector<FIntVec3>& OutWaypoints,
+					const FClearanceField* Clearance, int MinClearance)
+	{
+		OutWaypoints.clear();
+		if (Path.empty())
+		{
+			return;
+		}
+
+		OutWaypoints.push_back(Path[0]);
+		size_t Anchor = 0;
+		for (size_t Index = 2; Index < Path.size(); ++Index)
+		{
+			if (!HasLineOfSight(Walkable, Path[Anchor], Path[Index], Clearance, MinClearance))
+			{
+				Anchor = Index - 1;
+				OutWaypoints.push_back(Path[Anchor]);
+			}
+		}
+		if (Path.size() > 1)
+		{
+			OutWaypoints.push_back(Path.back());
+		}
+	}
+}
@@ -0,0 +1,247 @@
+#include "VoxelCore/InsightVoxelSpans.h"
+#include "VoxelCore/InsightVoxelBits.h"
+#include "VoxelCore/InsightVoxelGrid.h"
+
+#include <algorithm>
+
+namespace InsightVoxel
+{
+	// Append the runs of ones of a column word by word, a run reaching the top of a word merged with the next
+	static void CollectColumnSpans(const uint64_t* Column, int ColumnWords, std::vector<FVoxelSpan>& OutSpans)
+	{
+		const size_t Begin = OutSpans.size();
+		for (int WordIndex = 0; WordIndex < ColumnWords; ++WordIndex)
+		{
+			uint64_t Word = Column[WordIndex];
+			while (Word)
+			{
+				const int Lo = LowestBit64(Word);
+				const uint64_t Rest = ~Word & ~BitRangeMask64(0, Lo);
+				const int Hi = Rest ? LowestBit64(Rest) : 64;
+				const int ZMin = (WordIndex << 6) + Lo;
+				const int ZMax = (WordIndex << 6) + Hi;
+				if (OutSpans.size() > Begin && OutSpans.back().ZMax == ZMin)
+				{
+					OutSpans.back().ZMax = static_cast<uint16_t>(ZMax);
+				}
+				else
+				{
+					FVoxelSpan Span;
+					Span.ZMin = static_cast<uint16_t>(ZMin);
+					Span.ZMax = static_cast<uint16_t>(ZMax);
+					OutSpans.push_back(Span);
+				}
+				Word &= ~BitRangeMask64(Lo, Hi);
+			}
+		}
+	}
+
+	bool FVoxelSpanGrid::Init(const FBounds3& InBounds, float InCellSize, float InCellHeight)
+	{
+		Bounds = InBounds;
+		CellSize = InCellSize;
+		CellHeight = InCellHeight;
+
+		XNum = static_cast<int>((Bounds.Max.X - Bounds.Min.X) / CellSize + 0.5f);
+		YNum = static_cast<int>((Bounds.Max.Y - Bounds.Min.Y) / CellSize + 0.5f);
+		ZNum = static_cast<int>((Bounds.Max.Z - Bounds.Min.Z) / CellHeight + 0.5f);
+
+		Spans.clear();
+		BuildColumn = 0;
+
+		if (ZNum > MaxZNum)
+		{
+			XNum = YNum = ZNum = 0;
+			ColumnStart.assign(1, 0);
+			return false;
+		}
+
+		ColumnStart.assign(static_cast<size_t>(XNum) * YNum + 1, 0);
+		return true;
+	}
+
+	void FVoxelSpanGrid::AppendSpan(int X, int Y, int ZMin, int ZMax)
+	{
+		ZMin = std::max(ZMin, 0);
+		ZMax = std::min(ZMax, ZNum);
+		if (ZMin >= ZMax)
+		{
+			return;
+		}
+
+		// Columns between the last one written and this one are empty
+		const size_t Column = ColumnIndex(X, Y);
+		for (; BuildColumn < Column; ++BuildColumn)
+		{
+			ColumnStart[BuildColumn + 1] = static_cast<uint32_t>(Spans.size());
+		}
+
+		if (Spans.size() > ColumnStart[Column] && Spans.back().ZMax >= ZMin)
+		{
+			Spans.back().ZMax = static_cast<uint16_t>(std::max<int>(Spans.back().ZMax, ZMax));
+			return;
+		}
+
+		FVoxelSpan Span;
+		Span.ZMin = static_cast<uint16_t>(ZMin);
+		Span.ZMax = static_cast<uint16_t>(ZMax);
+		Spans.push_back(Span);
+	}
+
+	void FVoxelSpanGrid::FinishSpans()
+	{
+		for (; BuildColumn + 1 < ColumnStart.size(); ++BuildColumn)
+		{
+			ColumnStart[BuildColumn + 1] = static_cast<uint32_t>(Spans.size());
+		}
+		Spans.shrink_to_fit();
+	}
+
+	bool FVoxelSpanGrid::BuildFromGrid(const FVoxelGrid& Grid)
+	{
+		if (!Init(Grid.GetBounds(), Grid.GetCellSize(), Grid.GetCellHeight()))
+		{
+			return false;
+		}
+
+		const int ColumnWords = Grid.GetColumnWords();
+		for (int X = 0; X < XNum; ++X)
+		{
+			for (int Y = 0; Y < YNum; ++Y)
+			{
+				CollectColumnSpans(Grid.GetColumn(X, Y), ColumnWords, Spans);
+				ColumnStart[ColumnIndex(X, Y) + 1] = static_cast<uint32_t>(Spans.size());
+			}
+		}
+
+		BuildColumn = ColumnStart.size() - 1;
+		Spans.shrink_to_fit();
+		return true;
+	}
+
+	bool FVoxelSpanGrid::UpdateFromGrid(const FVoxelGrid& Grid, const FVoxelTile& Columns)
+	{
+		if (XNum != Grid.GetXNum() || YNum != Grid.GetYNum() || ZNum != Grid.GetZNum()
+			|| ColumnStart.size() != static_cast<size_t>(XNum) * YNum + 1)
+		{
+			return BuildFromGrid(Grid);
+		}
+
+		const FVoxelTile Clamped(std::max(Columns.X0, 0), std::max(Columns.Y0, 0), std::min(Columns.X1, XNum), std::min(Columns.Y1, YNum));
+		if (Clamped.IsEmpty())
+		{
+			return true;
+		}
+
+		// Spans of the columns from the first one of Clamped to its last one: the changed columns collected again,
+		// the ones between its X rows copied
+		const int ColumnWords = Grid.GetColumnWords();
+		const size_t FirstColumn = ColumnIndex(Clamped.X0, Clamped.Y0);
+		const size_t EndColumn = ColumnIndex(Clamped.X1 - 1, Clamped.Y1);
+		std::vector<FVoxelSpan> Band;
+		std::vector<uint32_t> BandStart;
+		Band.reserve(ColumnStart[EndColumn] - ColumnStart[FirstColumn]);
+		BandStart.reserve(EndColumn - FirstColumn + 1);
+		for (size_t Column = FirstColumn; Column < EndColumn; ++Column)
+		{
+			BandStart.push_back(static_cast<uint32_t>(Band.size()));
+			const int X = static_cast<int>(Column / YNum);
+			const int Y = static_cast<int>(Column % YNum);
+			if (Clamped.Contains(X, Y))
+			{
+				CollectColumnSpans(Grid.GetColumn(X, Y), ColumnWords, Band);
+			}
+			else
+			{
+				Band.insert(Band.end(), Spans.begin() + ColumnStart[Column], Spans.begin() + ColumnStart[Column + 1]);
+			}
+		}
+
+		// Make room for the band (or close the gap it leaves), then shift the offsets after it
+		const size_t OldBegin = ColumnStart[FirstColumn];
+		const size_t OldEnd = ColumnStart[EndColumn];
+		if (Band.size() > OldEnd - OldBegin)
+		{
+			Spans.insert(Spans.begin() + OldEnd, Band.size() - (OldEnd - OldBegin), FVoxelSpan());
+		}
+		else
+		{
+			Spans.erase(Spans.begin() + OldBegin + Band.size(), Spans.begin() + OldEnd);
+		}
+		std::copy(Band.begin(), Band.end(), Spans.begin() + OldBegin);
+
+		for (size_t Column = FirstColumn + 1; Column < EndColumn; ++Column)
+		{
+			ColumnStart[Column] = static_cast<uint32_t>(OldBegin + BandStart[Column - FirstColumn]);
+		}
+		const uint32_t NewEnd = static_cast<uint32_t>(OldBegin + Band.size());
+		if (NewEnd != OldEnd)
+		{
+			for (size_t Column = EndColumn; Column < ColumnStart.size(); ++Column)
+			{
+				ColumnStart[Column] = ColumnStart[Column] - static_cast<uint32_t>(OldEnd) + NewEnd;
+			}
+		}
+		return true;
+	}
+
+	bool FVoxelSpanGrid::GetVoxelOccupied(int X, int Y, int Z) const
+	{
+		const size_t Column = ColumnIndex(X, Y);
+		for (uint32_t i = ColumnStart[Column]; i < ColumnStart[Column + 1]; ++i)
+		{
+			if (Z < Spans[i].ZMin)
+			{
+				return false;
+			}
+			if (Z < Spans[i].ZMax)
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	bool FVoxelSpanGrid::IsVoxelInside(int X, int Y, int Z) const
+	{
+		return X >= 0 && X < XNum && Y >= 0 && Y < YNum && Z >= 0 && Z < ZNum;
+	}
+
+	int64_t FVoxelSpanGrid::CountOccupied() const
+	{
+		int64_t Count = 0;
+		for (const FVoxelSpan& Span : Spans)
+		{
+			Count += Span.ZMax - Span.ZMin;
+		}
+		return Count;
+	}
+
+	bool FVoxelSpanGrid::HasSameOccupancy(const FVoxelGrid& Grid) const
+	{
+		if (XNum != Grid.GetXNum() || YNum != Grid.GetYNum() || ZNum != Grid.GetZNum())
+		{
+			return false;
+		}
+
+		FVoxelGrid Expanded;
+		Expanded.Init(Bounds, CellSize, CellHeight);
+		for (int X = 0; X < XNum; ++X)
+		{
+			for (int Y = 0; Y < YNum; ++Y)
+			{
+				const FVoxelSpan* ColumnSpans = GetSpans(X, Y);
+				for (int i = 0; i < GetSpanNum(X, Y); ++i)
+				{
+					Expanded.SetSpan(X, Y, ColumnSpans[i].ZMin, ColumnSpans[i].ZMax);
+				}
+			}
+		}
+		return Expanded.HasSameOccupancy(Grid);
+	}
+
+	size_t FVoxelSpanGrid::GetAllocatedBytes() const
+	{
+		return ColumnStart.capacity() * sizeof(uint32_t) + Spans.capacity() * sizeof(FVoxelSpan);
+	}
+}
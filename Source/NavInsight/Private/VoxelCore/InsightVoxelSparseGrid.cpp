@@ -0,0 +1,436 @@
+#include "VoxelCore/InsightVoxelSparseGrid.h"
+#include "VoxelCore/InsightVoxelBits.h"
+#include "VoxelCore/InsightVoxelGrid.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace InsightVoxel
+{
+	void FSparseVoxelGrid::Init(const FBounds3& InBounds, float InCellSize, float InCellHeight)
+	{
+		Bounds = InBounds;
+		CellSize = InCellSize;
+		CellHeight = InCellHeight;
+
+		XNum = static_cast<int>((Bounds.Max.X - Bounds.Min.X) / CellSize + 0.5f);
+		YNum = static_cast<int>((Bounds.Max.Y - Bounds.Min.Y) / CellSize + 0.5f);
+		ZNum = static_cast<int>((Bounds.Max.Z - Bounds.Min.Z) / CellHeight + 0.5f);
+
+		ColumnWords = (ZNum + 63) / 64;
+
+		Bricks.clear();
+		BrickPool.clear();
+		FreeBricks.clear();
+		FullBrickNum = 0;
+	}
+
+	uint64_t FSparseVoxelGrid::GetValidMask(int WordIndex) const
+	{
+		return BitRangeMask64(0, std::min(ZNum - (WordIndex << 6), 64));
+	}
+
+	uint32_t FSparseVoxelGrid::AllocBrick(uint64_t Fill)
+	{
+		uint32_t Slot;
+		if (!FreeBricks.empty())
+		{
+			Slot = FreeBricks.back();
+			FreeBricks.pop_back();
+		}
+		else
+		{
+			Slot = static_cast<uint32_t>(BrickPool.size() / BrickWords);
+			BrickPool.resize(BrickPool.size() + BrickWords);
+		}
+
+		std::fill_n(&BrickPool[static_cast<size_t>(Slot) * BrickWords], BrickWords, Fill);
+		return Slot;
+	}
+
+	void FSparseVoxelGrid::ReleaseBrick(uint32_t Slot)
+	{
+		FreeBricks.push_back(Slot);
+	}
+
+	uint64_t* FSparseVoxelGrid::GetBrickForWrite(int X, int Y, int WordIndex)
+	{
+		auto Result = Bricks.emplace(BrickKey(X >> BrickShift, Y >> BrickShift, WordIndex), 0);
+		uint32_t& Slot = Result.first->second;
+		if (Result.second)
+		{
+			Slot = AllocBrick(0);
+		}
+		else if (Slot == FullBrick)
+		{
+			// Expand a collapsed brick before changing it
+			Slot = AllocBrick(GetValidMask(WordIndex));
+			--FullBrickNum;
+		}
+		return &BrickPool[static_cast<size_t>(Slot) * BrickWords];
+	}
+
+	uint64_t FSparseVoxelGrid::GetColumnMask(int X, int Y, int WordIndex) const
+	{
+		const auto It = Bricks.find(BrickKey(X >> BrickShift, Y >> BrickShift, WordIndex));
+		if (It == Bricks.end())
+		{
+			return 0;
+		}
+		if (It->second == FullBrick)
+		{
+			return GetValidMask(WordIndex);
+		}
+		return BrickPool[static_cast<size_t>(It->second) * BrickWords + BrickWordIndex(X, Y)];
+	}
+
+	void FSparseVoxelGrid::SetVoxelOccupied(int X, int Y, int Z, bool Flag)
+	{
+		const uint64_t Bit = 1ull << (Z & 63);
+		if (Flag)
+		{
+			if (!(GetColumnMask(X, Y, Z >> 6) & Bit))
+			{
+				GetBrickForWrite(X, Y, Z >> 6)[BrickWordIndex(X, Y)] |= Bit;
+			}
+		}
+		else if (GetColumnMask(X, Y, Z >> 6) & Bit)
+		{
+			GetBrickForWrite(X, Y, Z >> 6)[BrickWordIndex(X, Y)] &= ~Bit;
+		}
+	}
+
+	bool FSparseVoxelGrid::GetVoxelOccupied(int X, int Y, int Z) const
+	{
+		return (GetColumnMask(X, Y, Z >> 6) >> (Z & 63)) & 0x1;
+	}
+
+	void FSparseVoxelGrid::SetSpan(int X, int Y, int ZMin, int ZMax)
+	{
+		if (ZMin >= ZMax)
+		{
+			return;
+		}
+
+		const int WordMin = ZMin >> 6;
+		const int WordMax = (ZMax - 1) >> 6;
+		const int WordInBrick = BrickWordIndex(X, Y);
+
+		for (int WordIndex = WordMin; WordIndex <= WordMax; ++WordIndex)
+		{
+			const int Lo = WordIndex == WordMin ? (ZMin & 63) : 0;
+			const int Hi = WordIndex == WordMax ? ZMax - (WordMax << 6) : 64;
+
+			// Bits above ZNum stay 0, as in FVoxelGrid
+			const uint64_t Bits = BitRangeMask64(Lo, Hi) & GetValidMask(WordIndex);
+			auto Result = Bricks.emplace(BrickKey(X >> BrickShift, Y >> BrickShift, WordIndex), 0);
+			if (Result.second)
+			{
+				Result.first->second = AllocBrick(0);
+			}
+			else if (Result.first->second == FullBrick)
+			{
+				continue;
+			}
+			BrickPool[static_cast<size_t>(Result.first->second) * BrickWords + WordInBrick] |= Bits;
+		}
+	}
+
+	void FSparseVoxelGrid::ClearColumns(const FVoxelTile& Columns)
+	{
+		const int X0 = std::max(Columns.X0, 0);
+		const int Y0 = std::max(Columns.Y0, 0);
+		const int X1 = std::min(Columns.X1, XNum);
+		const int Y1 = std::min(Columns.Y1, YNum);
+		if (X0 >= X1 || Y0 >= Y1)
+		{
+			return;
+		}
+
+		for (int BX = X0 >> BrickShift; BX <= (X1 - 1) >> BrickShift; ++BX)
+		{
+			for (int BY = Y0 >> BrickShift; BY <= (Y1 - 1) >> BrickShift; ++BY)
+			{
+				// Part of the brick inside the rect
+				const int CX0 = std::max(X0, BX << BrickShift);
+				const int CY0 = std::max(Y0, BY << BrickShift);
+				const int CX1 = std::min(X1, (BX + 1) << BrickShift);
+				const int CY1 = std::min(Y1, (BY + 1) << BrickShift);
+				const bool bWholeBrick = CX1 - CX0 == BrickColumns && CY1 - CY0 == BrickColumns;
+
+				for (int BZ = 0; BZ < ColumnWords; ++BZ)
+				{
+					const auto It = Bricks.find(BrickKey(BX, BY, BZ));
+					if (It == Bricks.end())
+					{
+						continue;
+					}
+
+					if (!bWholeBrick)
+					{
+						uint64_t* Words = GetBrickForWrite(CX0, CY0, BZ);
+						bool bAnySet = false;
+						for (int X = BX << BrickShift; X < (BX + 1) << BrickShift; ++X)
+						{
+							for (int Y = BY << BrickShift; Y < (BY + 1) << BrickShift; ++Y)
+							{
+								uint64_t& Word = Words[BrickWordIndex(X, Y)];
+								if (X >= CX0 && X < CX1 && Y >= CY0 && Y < CY1)
+								{
+									Word = 0;
+								}
+								bAnySet |= Word != 0;
+							}
+						}
+						if (bAnySet)
+						{
+							continue;
+						}
+					}
+
+					if (It->second == FullBrick)
+					{
+						--FullBrickNum;
+					}
+					else
+					{
+						ReleaseBrick(It->second);
+					}
+					Bricks.erase(It);
+				}
+			}
+		}
+	}
+
+	FVoxelTile FSparseVoxelGrid::GetColumnRect(const FBounds3& Box, int Margin) const
+	{
+		if (!Box.Intersect(Bounds) || XNum == 0 || YNum == 0)
+		{
+			return {};
+		}
+
+		const int X0 = static_cast<int>(std::floor((Box.Min.X - Bounds.Min.X) / CellSize)) - Margin;
+		const int Y0 = static_cast<int>(std::floor((Box.Min.Y - Bounds.Min.Y) / CellSize)) - Margin;
+		const int X1 = static_cast<int>(std::floor((Box.Max.X - Bounds.Min.X) / CellSize)) + 1 + Margin;
+		const int Y1 = static_cast<int>(std::floor((Box.Max.Y - Bounds.Min.Y) / CellSize)) + 1 + Margin;
+
+		return {
+			std::min(std::max(X0, 0), XNum),
+			std::min(std::max(Y0, 0), YNum),
+			std::min(std::max(X1, 0), XNum),
+			std::min(std::max(Y1, 0), YNum)
+		};
+	}
+
+	bool FSparseVoxelGrid::IsAnyOccupied(int X, int Y, int ZMin, int ZMax) const
+	{
+		ZMin = std::max(ZMin, 0);
+		ZMax = std::min(ZMax, ZNum);
+		if (ZMin >= ZMax)
+		{
+			return false;
+		}
+
+		const int WordMin = ZMin >> 6;
+		const int WordMax = (ZMax - 1) >> 6;
+
+		for (int WordIndex = WordMin; WordIndex <= WordMax; ++WordIndex)
+		{
+			const int Lo = WordIndex == WordMin ? (ZMin & 63) : 0;
+			const int Hi = WordIndex == WordMax ? ZMax - (WordMax << 6) : 64;
+			if (GetColumnMask(X, Y, WordIndex) & BitRangeMask64(Lo, Hi))
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	int FSparseVoxelGrid::FindHighestOccupied(int X, int Y, int ZMin, int ZMax) const
+	{
+		ZMin = std::max(ZMin, 0);
+		ZMax = std::min(ZMax, ZNum);
+		if (ZMin >= ZMax)
+		{
+			return -1;
+		}
+
+		const int WordMin = ZMin >> 6;
+		const int WordMax = (ZMax - 1) >> 6;
+
+		for (int WordIndex = WordMax; WordIndex >= WordMin; --WordIndex)
+		{
+			const int Lo = WordIndex == WordMin ? (ZMin & 63) : 0;
+			const int Hi = WordIndex == WordMax ? ZMax - (WordMax << 6) : 64;
+			const uint64_t Masked = GetColumnMask(X, Y, WordIndex) & BitRangeMask64(Lo, Hi);
+			if (Masked)
+			{
+				return (WordIndex << 6) + HighestBit64(Masked);
+			}
+		}
+		return -1;
+	}
+
+	bool FSparseVoxelGrid::IsVoxelInside(int X, int Y, int Z) const
+	{
+		return X >= 0 && X < XNum && Y >= 0 && Y < YNum && Z >= 0 && Z < ZNum;
+	}
+
+	int64_t FSparseVoxelGrid::CountOccupied() const
+	{
+		int64_t Count = 0;
+		for (const auto& Brick : Bricks)
+		{
+			const int BX = static_cast<int>(Brick.first & 0x1fffff);
+			const int BY = static_cast<int>((Brick.first >> 21) & 0x1fffff);
+			const int BZ = static_cast<int>(Brick.first >> 42);
+			if (Brick.second == FullBrick)
+			{
+				// Bricks on the +X / +Y border may hang over the grid
+				const int Columns = (std::min(XNum, (BX + 1) << BrickShift) - (BX << BrickShift))
+					* (std::min(YNum, (BY + 1) << BrickShift) - (BY << BrickShift));
+				Count += static_cast<int64_t>(Columns) * PopCount64(GetValidMask(BZ));
+				continue;
+			}
+
+			const uint64_t* Words = &BrickPool[static_cast<size_t>(Brick.second) * BrickWords];
+			for (int i = 0; i < BrickWords; ++i)
+			{
+				Count += PopCount64(Words[i]);
+			}
+		}
+		return Count;
+	}
+
+	bool FSparseVoxelGrid::HasSameOccupancy(const FVoxelGrid& Dense) const
+	{
+		if (XNum != Dense.GetXNum() || YNum != Dense.GetYNum() || ZNum != Dense.GetZNum())
+		{
+			return false;
+		}
+
+		for (int X = 0; X < XNum; ++X)
+		{
+			for (int Y = 0; Y < YNum; ++Y)
+			{
+				for (int WordIndex = 0; WordIndex < ColumnWords; ++WordIndex)
+				{
+					if (GetColumnMask(X, Y, WordIndex) != Dense.GetColumnMask(X, Y, WordIndex))
+					{
+						return false;
+					}
+				}
+			}
+		}
+		return true;
+	}
+
+	void FSparseVoxelGrid::WriteToDense(FVoxelGrid& Dense) const
+	{
+		for (const auto& Brick : Bricks)
+		{
+			const int BX = static_cast<int>(Brick.first & 0x1fffff);
+			const int BY = static_cast<int>((Brick.first >> 21) & 0x1fffff);
+			const int BZ = static_cast<int>(Brick.first >> 42);
+			for (int X = BX << BrickShift; X < std::min(XNum, (BX + 1) << BrickShift); ++X)
+			{
+				for (int Y = BY << BrickShift; Y < std::min(YNum, (BY + 1) << BrickShift); ++Y)
+				{
+					Dense.GetColumn(X, Y)[BZ] |= Brick.second == FullBrick
+						? GetValidMask(BZ)
+						: BrickPool[static_cast<size_t>(Brick.second) * BrickWords + BrickWordIndex(X, Y)];
+				}
+			}
+		}
+	}
+
+	void FSparseVoxelGrid::GetBrickWords(int BX, int BY, int BZ, uint64_t* OutWords) const
+	{
+		const auto It = Bricks.find(BrickKey(BX, BY, BZ));
+		if (It == Bricks.end())
+		{
+			std::fill_n(OutWords, BrickWords, 0);
+		}
+		else if (It->second == FullBrick)
+		{
+			// Columns hanging over the +X / +Y border stay clear, as in the allocated bricks
+			for (int i = 0; i < BrickWords; ++i)
+			{
+				const bool bInside = (BX << BrickShift) + (i >> BrickShift) < XNum && (BY << BrickShift) + (i & (BrickColumns - 1)) < YNum;
+				OutWords[i] = bInside ? GetValidMask(BZ) : 0;
+			}
+		}
+		else
+		{
+			std::copy_n(&BrickPool[static_cast<size_t>(It->second) * BrickWords], BrickWords, OutWords);
+		}
+	}
+
+	void FSparseVoxelGrid::GetBricks(std::vector<FIntVec3>& OutBricks) const
+	{
+		OutBricks.clear();
+		OutBricks.reserve(Bricks.size());
+		for (const auto& Brick : Bricks)
+		{
+			OutBricks.push_back({
+				static_cast<int>(Brick.first & 0x1fffff),
+				static_cast<int>((Brick.first >> 21) & 0x1fffff),
+				static_cast<int>(Brick.first >> 42)
+			});
+		}
+	}
+
+	int64_t FSparseVoxelGrid::CollapseUniformBricks()
+	{
+		int64_t Collapsed = 0;
+		for (auto It = Bricks.begin(); It != Bricks.end();)
+		{
+			if (It->second == FullBrick)
+			{
+				++It;
+				continue;
+			}
+
+			const int BX = static_cast<int>(It->first & 0x1fffff);
+			const int BY = static_cast<int>((It->first >> 21) & 0x1fffff);
+			const int BZ = static_cast<int>(It->first >> 42);
+			const uint64_t ValidMask = GetValidMask(BZ);
+			const uint64_t* Words = &BrickPool[static_cast<size_t>(It->second) * BrickWords];
+
+			// Columns hanging over the +X / +Y border are never set, so border bricks are never full
+			const bool bInside = ((BX + 1) << BrickShift) <= XNum && ((BY + 1) << BrickShift) <= YNum;
+			bool bEmpty = true;
+			bool bFull = bInside;
+			for (int i = 0; i < BrickWords; ++i)
+			{
+				bEmpty &= Words[i] == 0;
+				bFull &= Words[i] == ValidMask;
+			}
+
+			if (bEmpty)
+			{
+				ReleaseBrick(It->second);
+				It = Bricks.erase(It);
+				++Collapsed;
+				continue;
+			}
+			if (bFull)
+			{
+				ReleaseBrick(It->second);
+				It->second = FullBrick;
+				++FullBrickNum;
+				++Collapsed;
+			}
+			++It;
+		}
+		return Collapsed;
+	}
+
+	size_t FSparseVoxelGrid::GetAllocatedBytes() const
+	{
+		// unordered_map: one node (key, value, next pointer, cached hash) per brick and one pointer per bucket
+		const size_t NodeBytes = sizeof(uint64_t) * 2 + sizeof(void*) * 2;
+		return BrickPool.capacity() * sizeof(uint64_t) + FreeBricks.capacity() * sizeof(uint32_t)
+			+ Bricks.size() * NodeBytes + Bricks.bucket_count() * sizeof(void*);
+	}
+}
@@ -0,0 +1,53 @@
+#include "VoxelCore/InsightVoxelSurface.h"
+#include "VoxelCore/InsightVoxelBits.h"
+#include "VoxelCore/InsightVoxelGrid.h"
+
+#include <cstdint>
+
+namespace InsightVoxel
+{
+	void CollectSurfaceVoxels(const FVoxelGrid& Grid, const FVoxelTile& Tile, std::vector<FIntVec3>& OutVoxels)
+	{
+		const int XNum = Grid.GetXNum();
+		const int YNum = Grid.GetYNum();
+		const int ColumnWords = Grid.GetColumnWords();
+
+		for (int X = Tile.X0; X < Tile.X1; ++X)
+		{
+			for (int Y = Tile.Y0; Y < Tile.Y1; ++Y)
+			{
+				const uint64_t* Column = Grid.GetColumn(X, Y);
+				const uint64_t* Side[4] = {
+					X > 0 ? Grid.GetColumn(X - 1, Y) : nullptr,
+					X + 1 < XNum ? Grid.GetColumn(X + 1, Y) : nullptr,
+					Y > 0 ? Grid.GetColumn(X, Y - 1) : nullptr,
+					Y + 1 < YNum ? Grid.GetColumn(X, Y + 1) : nullptr,
+				};
+
+				for (int Word = 0; Word < ColumnWords; ++Word)
+				{
+					const uint64_t Occupied = Column[Word];
+					if (!Occupied)
+					{
+						continue;
+					}
+
+					// Neighbours above and below, shifted onto Z (padding bits are 0, so the top of the grid is free)
+					const uint64_t Above = (Occupied >> 1) | (Word + 1 < ColumnWords ? Column[Word + 1] << 63 : 0);
+					const uint64_t Below = (Occupied << 1) | (Word > 0 ? Column[Word - 1] >> 63 : 0);
+
+					uint64_t Enclosed = Occupied & Above & Below;
+					for (const uint64_t* SideColumn : Side)
+					{
+						Enclosed &= SideColumn ? SideColumn[Word] : 0;
+					}
+
+					for (uint64_t Surface = Occupied & ~Enclosed; Surface; Surface &= Surface - 1)
+					{
+						OutVoxels.push_back({X, Y, (Word << 6) + LowestBit64(Surface)});
+					}
+				}
+			}
+		}
+	}
+}
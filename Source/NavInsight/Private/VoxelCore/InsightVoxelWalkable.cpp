@@ -0,0 +1,330 @@
+#include "VoxelCore/InsightVoxelWalkable.h"
+#include "VoxelCore/InsightVoxelBits.h"
+#include "VoxelCore/InsightVoxelGrid.h"
+#include "VoxelCore/InsightVoxelSpans.h"
+#include "VoxelCore/InsightVoxelSparseGrid.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace InsightVoxel
+{
+	void BuildWalkableMask(const FVoxelGrid& Grid, FVoxelGrid& OutWalkable, const FParallelForFn& ParallelFor)
+	{
+		OutWalkable.Init(Grid.GetBounds(), Grid.GetCellSize(), Grid.GetCellHeight());
+		UpdateWalkableMask(Grid, OutWalkable, {0, 0, Grid.GetXNum(), Grid.GetYNum()}, ParallelFor);
+	}
+
+	void BuildWalkableMask(const FSparseVoxelGrid& Grid, FVoxelGrid& OutWalkable, const FParallelForFn& ParallelFor)
+	{
+		OutWalkable.Init(Grid.GetBounds(), Grid.GetCellSize(), Grid.GetCellHeight());
+
+		const int XNum = Grid.GetXNum();
+		const int YNum = Grid.GetYNum();
+		const int ZNum = Grid.GetZNum();
+		const int ColumnWords = Grid.GetColumnWords();
+		if (XNum == 0 || YNum == 0 || ColumnWords == 0)
+		{
+			return;
+		}
+
+		// A word of a block can only hold stayable voxels if a block around it (a column sees the columns one step
+		// to the side) has a brick at that word or at the one below (through the shift). Keys are block << 32 | word.
+		const int Shift = FSparseVoxelGrid::BrickShift;
+		const int BXNum = (XNum + FSparseVoxelGrid::BrickColumns - 1) >> Shift;
+		const int BYNum = (YNum + FSparseVoxelGrid::BrickColumns - 1) >> Shift;
+		std::vector<FIntVec3> Bricks;
+		Grid.GetBricks(Bricks);
+		std::vector<uint64_t> NearWords;
+		NearWords.reserve(Bricks.size() * 18);
+		for (const FIntVec3& Brick : Bricks)
+		{
+			for (int NX = std::max(Brick.X - 1, 0); NX <= std::min(Brick.X + 1, BXNum - 1); ++NX)
+			{
+				for (int NY = std::max(Brick.Y - 1, 0); NY <= std::min(Brick.Y + 1, BYNum - 1); ++NY)
+				{
+					const uint64_t Block = static_cast<uint64_t>(NX) * BYNum + NY;
+					NearWords.push_back(Block << 32 | static_cast<uint32_t>(Brick.Z));
+					if (Brick.Z + 1 < ColumnWords)
+					{
+						NearWords.push_back(Block << 32 | static_cast<uint32_t>(Brick.Z + 1));
+					}
+				}
+			}
+		}
+		std::sort(NearWords.begin(), NearWords.end());
+		NearWords.erase(std::unique(NearWords.begin(), NearWords.end()), NearWords.end());
+
+		// First key of every block, one past the last: the key count
+		std::vector<size_t> BlockStart;
+		for (size_t i = 0; i < NearWords.size(); ++i)
+		{
+			if (i == 0 || NearWords[i] >> 32 != NearWords[i - 1] >> 32)
+			{
+				BlockStart.push_back(i);
+			}
+		}
+		BlockStart.push_back(NearWords.size());
+
+		const int LastWord = ColumnWords - 1;
+		const uint64_t LastWordMask = BitRangeMask64(0, ZNum - (LastWord << 6));
+
+		ParallelFor(static_cast<int>(BlockStart.size()) - 1, [&](int Index) {
+			const int BlockX = static_cast<int>((NearWords[BlockStart[Index]] >> 32) / BYNum);
+			const int BlockY = static_cast<int>((NearWords[BlockStart[Index]] >> 32) % BYNum);
+			const FVoxelTile Block(BlockX << Shift, BlockY << Shift, std::min(XNum, (BlockX + 1) << Shift), std::min(YNum, (BlockY + 1) << Shift));
+
+			// One word of the block and of the columns around it, one brick lookup per block around
+			const int LX0 = std::max(Block.X0 - 1, 0);
+			const int LY0 = std::max(Block.Y0 - 1, 0);
+			const int LX1 = std::min(Block.X1 + 1, XNum);
+			const int LY1 = std::min(Block.Y1 + 1, YNum);
+			const int LYNum = LY1 - LY0;
+			std::vector<uint64_t> Local(static_cast<size_t>(LX1 - LX0) * LYNum);
+			std::vector<uint64_t> SliceOr(LYNum);
+			uint64_t Carry[FSparseVoxelGrid::BrickWords] = {};
+			uint64_t BrickWords[FSparseVoxelGrid::BrickWords];
+
+			// Results column by column, written out at the end so every column of the grid is touched once
+			const size_t KeyNum = BlockStart[Index + 1] - BlockStart[Index];
+			std::vector<uint64_t> Results(KeyNum * FSparseVoxelGrid::BrickWords);
+
+			for (size_t Key = BlockStart[Index]; Key < BlockStart[Index + 1]; ++Key)
+			{
+				const int Word = static_cast<int>(NearWords[Key] & 0xffffffffu);
+				if (Key == BlockStart[Index] || static_cast<int>(NearWords[Key - 1] & 0xffffffffu) != Word - 1)
+				{
+					// Nothing solid near the word below
+					std::fill_n(Carry, FSparseVoxelGrid::BrickWords, 0);
+				}
+
+				for (int BX = LX0 >> Shift; BX <= (LX1 - 1) >> Shift; ++BX)
+				{
+					for (int BY = LY0 >> Shift; BY <= (LY1 - 1) >> Shift; ++BY)
+					{
+						Grid.GetBrickWords(BX, BY, Word, BrickWords);
+						for (int X = std::max(LX0, BX << Shift); X < std::min(LX1, (BX + 1) << Shift); ++X)
+						{
+							for (int Y = std::max(LY0, BY << Shift); Y < std::min(LY1, (BY + 1) << Shift); ++Y)
+							{
+								Local[static_cast<size_t>(X - LX0) * LYNum + (Y - LY0)] = BrickWords[((X - (BX << Shift)) << Shift) + (Y - (BY << Shift))];
+							}
+						}
+					}
+				}
+
+				// As in UpdateWalkableMask: the columns X - 1 ... X + 1 OR-ed first, then Y - 1 ... Y + 1
+				for (int X = Block.X0; X < Block.X1; ++X)
+				{
+					std::fill(SliceOr.begin(), SliceOr.end(), 0);
+					for (int NX = std::max(X - 1, LX0); NX < std::min(X + 2, LX1); ++NX)
+					{
+						const uint64_t* Slice = &Local[static_cast<size_t>(NX - LX0) * LYNum];
+						for (int Y = 0; Y < LYNum; ++Y)
+						{
+							SliceOr[Y] |= Slice[Y];
+						}
+					}
+
+					for (int Y = Block.Y0; Y < Block.Y1; ++Y)
+					{
+						const int LocalY = Y - LY0;
+						const uint64_t Near = SliceOr[LocalY] | (Y > LY0 ? SliceOr[LocalY - 1] : 0) | (Y + 1 < LY1 ? SliceOr[LocalY + 1] : 0);
+						const int Column = ((X - Block.X0) << Shift) + (Y - Block.Y0);
+						const uint64_t NearOrBelow = Near | (Near << 1) | Carry[Column];
+						Carry[Column] = Near >> 63;
+
+						const uint64_t Occupied = Local[static_cast<size_t>(X - LX0) * LYNum + LocalY];
+						Results[Column * KeyNum + (Key - BlockStart[Index])] = ~Occupied & NearOrBelow & (Word == LastWord ? LastWordMask : ~0ull);
+					}
+				}
+			}
+
+			for (int X = Block.X0; X < Block.X1; ++X)
+			{
+				for (int Y = Block.Y0; Y < Block.Y1; ++Y)
+				{
+					const uint64_t* ColumnResults = &Results[(((X - Block.X0) << Shift) + (Y - Block.Y0)) * KeyNum];
+					uint64_t* Out = OutWalkable.GetColumn(X, Y);
+					for (size_t Key = 0; Key < KeyNum; ++Key)
+					{
+						Out[NearWords[BlockStart[Index] + Key] & 0xffffffffu] = ColumnResults[Key];
+					}
+				}
+			}
+		});
+	}
+
+	void UpdateWalkableMask(const FVoxelGrid& Grid, FVoxelGrid& Walkable, const FVoxelTile& Columns, const FParallelForFn& ParallelFor)
+	{
+		const int XNum = Grid.GetXNum();
+		const int YNum = Grid.GetYNum();
+		const int ZNum = Grid.GetZNum();
+		const int ColumnWords = Grid.GetColumnWords();
+		const int RectX0 = std::max(Columns.X0, 0);
+		const int RectY0 = std::max(Columns.Y0, 0);
+		const int RectX1 = std::min(Columns.X1, XNum);
+		const int RectY1 = std::min(Columns.Y1, YNum);
+		if (RectX0 >= RectX1 || RectY0 >= RectY1 || ColumnWords == 0)
+		{
+			return;
+		}
+
+		// Slices also need the rows just outside the rect for the Y neighbourhood
+		const int SliceY0 = std::max(RectY0 - 1, 0);
+		const int SliceY1 = std::min(RectY1 + 1, YNum);
+		const int SliceYNum = SliceY1 - SliceY0;
+
+		// Keeps the padding bits above ZNum clear
+		const int LastWord = ColumnWords - 1;
+		const uint64_t LastWordMask = BitRangeMask64(0, ZNum - (LastWord << 6));
+
+		ParallelFor(RectX1 - RectX0, [&](int Slice) {
+			const int X = RectX0 + Slice;
+
+			// OR of the columns X - 1 ... X + 1 for every Y of the slice
+			std::vector<uint64_t> SliceOr(static_cast<size_t>(SliceYNum) * ColumnWords, 0);
+			for (int NX = std::max(X - 1, 0); NX <= std::min(X + 1, XNum - 1); ++NX)
+			{
+				for (int Y = SliceY0; Y < SliceY1; ++Y)
+				{
+					const uint64_t* Column = Grid.GetColumn(NX, Y);
+					uint64_t* Out = &SliceOr[static_cast<size_t>(Y - SliceY0) * ColumnWords];
+					for (int Word = 0; Word < ColumnWords; ++Word)
+					{
+						Out[Word] |= Column[Word];
+					}
+				}
+			}
+
+			for (int Y = RectY0; Y < RectY1; ++Y)
+			{
+				const uint64_t* Center = &SliceOr[static_cast<size_t>(Y - SliceY0) * ColumnWords];
+				const uint64_t* Before = Y > SliceY0 ? Center - ColumnWords : nullptr;
+				const uint64_t* After = Y + 1 < SliceY1 ? Center + ColumnWords : nullptr;
+				const uint64_t* Occupied = Grid.GetColumn(X, Y);
+				uint64_t* Out = Walkable.GetColumn(X, Y);
+
+				// Solid voxels at Z in the 3x3 columns, and at Z - 1 through the shift (carrying across words)
+				uint64_t Carry = 0;
+				for (int Word = 0; Word < ColumnWords; ++Word)
+				{
+					const uint64_t Near = Center[Word] | (Before ? Before[Word] : 0) | (After ? After[Word] : 0);
+					const uint64_t NearOrBelow = Near | (Near << 1) | Carry;
+					Carry = Near >> 63;
+
+					Out[Word] = ~Occupied[Word] & NearOrBelow & (Word == LastWord ? LastWordMask : ~0ull);
+				}
+			}
+		});
+	}
+
+	// Union of the spans of columns (X0, Y0), (X0 + DX, Y0 + DY), ... (Num of them) of Source in Z order.
+	// Spans of every column are sorted, so this is a merge of Num lists.
+	static void MergeColumnSpans(const FVoxelSpanGrid& Source, int X0, int Y0, int DX, int DY, int Num, std::vector<FVoxelSpan>& OutSpans)
+	{
+		const FVoxelSpan* Cursor[3];
+		const FVoxelSpan* End[3];
+		for (int List = 0; List < Num; ++List)
+		{
+			Cursor[List] = Source.GetSpans(X0 + List * DX, Y0 + List * DY);
+			End[List] = Cursor[List] + Source.GetSpanNum(X0 + List * DX, Y0 + List * DY);
+		}
+
+		OutSpans.clear();
+		for (;;)
+		{
+			int Best = -1;
+			for (int List = 0; List < Num; ++List)
+			{
+				if (Cursor[List] != End[List] && (Best < 0 || Cursor[List]->ZMin < Cursor[Best]->ZMin))
+				{
+					Best = List;
+				}
+			}
+			if (Best < 0)
+			{
+				break;
+			}
+
+			const FVoxelSpan Span = *Cursor[Best]++;
+			if (!OutSpans.empty() && OutSpans.back().ZMax >= Span.ZMin)
+			{
+				OutSpans.back().ZMax = std::max(OutSpans.back().ZMax, Span.ZMax);
+			}
+			else
+			{
+				OutSpans.push_back(Span);
+			}
+		}
+	}
+
+	void BuildWalkableSpans(const FVoxelSpanGrid& Solid, FVoxelSpanGrid& OutWalkable)
+	{
+		const int XNum = Solid.GetXNum();
+		const int YNum = Solid.GetYNum();
+		const int ZNum = Solid.GetZNum();
+		OutWalkable.Init(Solid.GetBounds(), Solid.GetCellSize(), Solid.GetCellHeight());
+
+		// Separable like the bitset version: union over the Y neighbours first, then over the X neighbours of
+		// that. Both passes read their inputs as 1 to 3 sequential streams.
+		FVoxelSpanGrid NearY;
+		NearY.Init(Solid.GetBounds(), Solid.GetCellSize(), Solid.GetCellHeight());
+
+		std::vector<FVoxelSpan> Merged;
+		for (int X = 0; X < XNum; ++X)
+		{
+			for (int Y = 0; Y < YNum; ++Y)
+			{
+				const int Y0 = std::max(Y - 1, 0);
+				MergeColumnSpans(Solid, X, Y0, 0, 1, std::min(Y + 1, YNum - 1) - Y0 + 1, Merged);
+				for (const FVoxelSpan& Span : Merged)
+				{
+					NearY.AppendSpan(X, Y, Span.ZMin, Span.ZMax);
+				}
+			}
+		}
+		NearY.FinishSpans();
+
+		for (int X = 0; X < XNum; ++X)
+		{
+			const int X0 = std::max(X - 1, 0);
+			const int NearNum = std::min(X + 1, XNum - 1) - X0 + 1;
+			for (int Y = 0; Y < YNum; ++Y)
+			{
+				// Voxels resting on or beside a solid span of the 3x3 neighbourhood
+				MergeColumnSpans(NearY, X0, Y, 1, 0, NearNum, Merged);
+
+				// Subtract the column's own spans (both lists are sorted and disjoint)
+				const FVoxelSpan* Own = Solid.GetSpans(X, Y);
+				const int OwnNum = Solid.GetSpanNum(X, Y);
+				int OwnIndex = 0;
+				for (const FVoxelSpan& Span : Merged)
+				{
+					int ZMin = Span.ZMin;
+					const int ZMax = std::min(Span.ZMax + 1, ZNum);
+					while (ZMin < ZMax)
+					{
+						while (OwnIndex < OwnNum && Own[OwnIndex].ZMax <= ZMin)
+						{
+							++OwnIndex;
+						}
+						if (OwnIndex == OwnNum || Own[OwnIndex].ZMin >= ZMax)
+						{
+							OutWalkable.AppendSpan(X, Y, ZMin, ZMax);
+							break;
+						}
+						if (Own[OwnIndex].ZMin > ZMin)
+						{
+							OutWalkable.AppendSpan(X, Y, ZMin, Own[OwnIndex].ZMin);
+						}
+						ZMin = Own[OwnIndex].ZMax;
+					}
+				}
+			}
+		}
+
+		OutWalkable.FinishSpans();
+	}
+}
@@ -0,0 +1,155 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "AI/NavigationSystemBase.h"
+#include "Templates/UniquePtr.h"
+#include "UObject/WeakObjectPtrTemplates.h"
+#include "VoxelCore/InsightVoxelBvh.h"
+#include "VoxelCore/InsightVoxelParallel.h"
+
+class UBodySetup;
+class UPrimitiveComponent;
+
+// Triangle soup in world space, as handed to the voxel rasterizer
+struct FInsightGeometryExport
+{
+	TNavStatArray<FVector> VertexBuffer;
+	TNavStatArray<int32> IndexBuffer;
+};
+
+// World-space soup of one cache entry, valid until the entry is dropped (EndBuild, Reset)
+struct FInsightGeometryView
+{
+	const FVector* Vertices = nullptr;
+	int32 VertexNum = 0;
+	const int32* Indices = nullptr;
+	int32 IndexNum = 0;
+	// Only for meshes of at least FInsightGeometryCache::BvhMinTriangles triangles
+	const InsightVoxel::FTriangleBvh* Bvh = nullptr;
+};
+
+// Collision geometry exported by ExportRigidBodyGeometry, kept across builds.
+//
+// Every body setup is exported once, in its local space; all components using it (the instances of a mesh)
+// share that soup. World-space vertices are cached per (body setup, component transform) and reused while
+// neither changes. A body setup whose collision is rebuilt gets a new BodySetupGuid, which invalidates its
+// local soup. Every component remembers the entry it last used: when GetComponentGeo moves it to another one,
+// the old entry is dropped as soon as no component uses it anymore, so edits between full builds do not pile
+// up transformed copies.
+class NAVINSIGHT_API FInsightGeometryCache
+{
+public:
+	// Meshes with at least this many triangles (landscapes, merged proxies) get a BVH over their world-space
+	// soup, so rasterizing a tile or an incremental region only visits the triangles around it
+	static const int32 BvhMinTriangles = 1024;
+
+	// World-space collision of Component, empty if it has no navigation relevant collision
+	FInsightGeometryView GetComponentGeo(UPrimitiveComponent* Component);
+
+	// Start a full build: entries not used again before EndBuild are dropped there
+	void BeginBuild();
+	void EndBuild();
+
+	// Staged export for a full build, between BeginBuild and EndBuild. On the game thread, AddBuildComponent
+	// every component, then PrepareBuild (exports the missing local soups on ParallelFor). After that
+	// GetBuildEntry may run concurrently for distinct indices in [0, GetBuildEntryNum()); it transforms the
+	// entry on a miss. Components sharing a body setup and transform share one entry.
+	//
+	// Everything after AddBuildComponent may run off the game thread, provided the caller keeps the gathered
+	// body setups alive and does not use the cache otherwise until EndBuild (which belongs to the game thread).
+	void AddBuildComponent(UPrimitiveComponent* Component);
+	void PrepareBuild(const InsightVoxel::FParallelForFn& ParallelFor);
+	int32 GetBuildEntryNum() const { return BuildEntries.Num(); }
+	FInsightGeometryView GetBuildEntry(int32 Index);
+
+	// Hash of the body setup GUIDs and transforms of the build entries, in order; valid after PrepareBuild
+	uint64 GetBuildHash() const;
+
+	void Reset();
+
+	// Hits and misses since the last BeginBuild
+	int32 GetHitNum() const { return HitNum; }
+	int32 GetMissNum() const { return MissNum; }
+
+private:
+	// Soup of a body setup in its own space. The arrays keep their allocation when the map grows, so views
+	// into them survive later exports.
+	struct FLocalGeo
+	{
+		FGuid BodySetupGuid;
+		TArray<FVector> Vertices;
+		TArray<int32> Indices;
+	};
+
+	struct FWorldKey
+	{
+		TWeakObjectPtr<UBodySetup> BodySetup;
+		FTransform Transform;
+
+		bool operator==(const FWorldKey& Other) const
+		{
+			return BodySetup == Other.BodySetup && Transform.Equals(Other.Transform, 0.0f);
+		}
+
+		// Bitwise, so transforms equal up to the sign of zero (or of the quaternion) just miss
+		friend uint32 GetTypeHash(const FWorldKey& Key)
+		{
+			const FVector Translation = Key.Transform.GetTranslation();
+			const FQuat Rotation = Key.Transform.GetRotation();
+			const FVector Scale = Key.Transform.GetScale3D();
+
+			uint32 Hash = GetTypeHash(Key.BodySetup);
+			Hash = FCrc::MemCrc32(&Translation, sizeof(Translation), Hash);
+			Hash = FCrc::MemCrc32(&Rotation, sizeof(Rotation), Hash);
+			return FCrc::MemCrc32(&Scale, sizeof(Scale), Hash);
+		}
+	};
+
+	struct FWorldGeo
+	{
+		FGuid BodySetupGuid;
+		TArray<FVector> Vertices;
+		TUniquePtr<InsightVoxel::FTriangleBvh> Bvh;
+		uint32 LastUsedBuild = 0;
+		// Components whose ComponentKeys entry is this one
+		int32 ComponentNum = 0;
+	};
+
+	// One (body setup, transform) pair of the running build
+	struct FBuildEntry
+	{
+		FWorldKey Key;
+		UBodySetup* BodySetup = nullptr;
+		FGuid BodySetupGuid;
+		const FLocalGeo* Local = nullptr;
+		FWorldGeo* World = nullptr;
+		bool bTransform = false;
+	};
+
+	const FLocalGeo& FindOrExportLocal(UBodySetup& BodySetup);
+
+	// Transform Local into World and build its BVH if it is large enough
+	static void BuildWorldGeo(const FTransform& Transform, const FLocalGeo& Local, FWorldGeo& World);
+
+	static FInsightGeometryView MakeView(const FLocalGeo& Local, const FWorldGeo& World);
+
+	// Point Component at Key (which must be in WorldGeos, or null to forget it) and drop its previous entry if
+	// no other component uses it
+	void SetComponentKey(UPrimitiveComponent* Component, const FWorldKey* Key);
+
+	TMap<TWeakObjectPtr<UBodySetup>, FLocalGeo> LocalGeos;
+
+	TMap<FWorldKey, FWorldGeo> WorldGeos;
+	uint32 BuildIndex = 0;
+
+	// Entry of WorldGeos every component gathered by the last build or passed to GetComponentGeo since uses
+	TMap<TWeakObjectPtr<UPrimitiveComponent>, FWorldKey> ComponentKeys;
+
+	TArray<FBuildEntry> BuildEntries;
+	TMap<FWorldKey, int32> BuildEntryIndices;
+
+	int32 HitNum = 0;
+	int32 MissNum = 0;
+};
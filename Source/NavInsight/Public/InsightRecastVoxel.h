@@ -6,8 +6,64 @@
 #include "GameFramework/Actor.h"
 #include "Navmesh/Public/Recast/Recast.h"
 #include "ProceduralMeshComponent.h"
+#include "VoxelCore/InsightVoxelSpans.h"
 #include "InsightRecastVoxel.generated.h"
 
+UENUM()
+enum class EInsightRecastRasterMode : uint8
+{
+	// One rcRasterizeTriangle call per triangle
+	PerTriangle,
+	// A single rcRasterizeTriangles call on the exported buffers
+	Batched,
+	// Tiles of sub-heightfields rasterized on worker threads, then merged
+	Parallel,
+};
+
+// Recast and the voxel core on the same triangles at one cell setting, see AInsightRecastVoxel::CompareWithRecast
+USTRUCT()
+struct FInsightVoxelComparison
+{
+	GENERATED_BODY()
+
+	UPROPERTY(VisibleAnywhere, Category = "NavInsight")
+	float CellSize = 0.0f;
+
+	UPROPERTY(VisibleAnywhere, Category = "NavInsight")
+	float CellHeight = 0.0f;
+
+	// Best rasterization time (seconds) of rcRasterizeTriangles and of InsightVoxel::RasterizeTriangles
+	UPROPERTY(VisibleAnywhere, Category = "NavInsight")
+	double RecastTime = 0.0;
+
+	UPROPERTY(VisibleAnywhere, Category = "NavInsight")
+	double InsightTime = 0.0;
+
+	// Memory held afterwards: heightfield columns and span pools, occupancy bitset
+	UPROPERTY(VisibleAnywhere, Category = "NavInsight")
+	int64 RecastBytes = 0;
+
+	UPROPERTY(VisibleAnywhere, Category = "NavInsight")
+	int64 InsightBytes = 0;
+
+	// Cell by cell difference of the two (see InsightVoxel::CompareOccupancy)
+	UPROPERTY(VisibleAnywhere, Category = "NavInsight")
+	int64 BothVoxels = 0;
+
+	UPROPERTY(VisibleAnywhere, Category = "NavInsight")
+	int64 RecastOnlyVoxels = 0;
+
+	UPROPERTY(VisibleAnywhere, Category = "NavInsight")
+	int64 InsightOnlyVoxels = 0;
+
+	UPROPERTY(VisibleAnywhere, Category = "NavInsight")
+	int64 DiffColumns = 0;
+
+	// (-1, -1) when both agree everywhere
+	UPROPERTY(VisibleAnywhere, Category = "NavInsight")
+	FIntPoint FirstDiffColumn = FIntPoint(-1, -1);
+};
+
 UCLASS()
 class NAVINSIGHT_API AInsightRecastVoxel : public AActor
 {
@@ -21,9 +77,75 @@ public:
 	UPROPERTY(EditAnywhere, Category = "NavInsight")
 	UMaterial* VolMaterial;
 
+	UPROPERTY(EditAnywhere, Category = "NavInsight")
+	EInsightRecastRasterMode RasterMode = EInsightRecastRasterMode::Batched;
+
+	// Width (in heightfield columns) of the square tiles of the parallel mode
+	UPROPERTY(EditAnywhere, Category = "NavInsight", meta = (ClampMin = "1", EditCondition = "RasterMode == EInsightRecastRasterMode::Parallel"))
+	int ParallelTileColumns = 64;
+
+	// Reset the heightfields in place (keeping their span pools) when the grid layout is unchanged
+	UPROPERTY(EditAnywhere, Category = "NavInsight")
+	bool bReuseHeightField = true;
+
+	// Before rasterizing, grow the span pools to SpanReserveScale x the span count of the last build (0 to disable)
+	UPROPERTY(EditAnywhere, Category = "NavInsight", meta = (ClampMin = "0"))
+	float SpanReserveScale = 1.1f;
+
+	// Spans in the heightfield after the last build
+	UPROPERTY(VisibleAnywhere, Category = "NavInsight")
+	int SpanCount = 0;
+
+	// Total of the phases below (seconds)
 	UPROPERTY(VisibleAnywhere, Category = "NavInsight")
 	double BuildTime = 0.0f;
 
+	UPROPERTY(VisibleAnywhere, Category = "NavInsight")
+	double ExportTime = 0.0;
+
+	// Parallel mode only: sorting the triangles into tiles
+	UPROPERTY(VisibleAnywhere, Category = "NavInsight")
+	double BinTime = 0.0;
+
+	UPROPERTY(VisibleAnywhere, Category = "NavInsight")
+	double RasterizeTime = 0.0;
+
+	// Parallel mode only: copying the tile spans into the heightfield
+	UPROPERTY(VisibleAnywhere, Category = "NavInsight")
+	double MergeTime = 0.0;
+
+	// Convert the heightfield into compacted spans after every build (CompactHeightField)
+	UPROPERTY(EditAnywhere, Category = "NavInsight")
+	bool bBuildCompactSpans = false;
+
+	// Memory of CompactHeightField after the last build
+	UPROPERTY(VisibleAnywhere, Category = "NavInsight")
+	int CompactSpanBytes = 0;
+
+	// Merge coplanar faces of adjacent spans and drop hidden ones instead of drawing a box per span
+	UPROPERTY(EditAnywhere, Category = "NavInsight")
+	bool bGreedyMeshing = true;
+
+	// Greedy meshing emits one mesh section per tile of MeshTileColumns x MeshTileColumns heightfield columns
+	UPROPERTY(EditAnywhere, Category = "NavInsight", meta = (ClampMin = "1", EditCondition = "bGreedyMeshing"))
+	int MeshTileColumns = 64;
+
+	// Cell size (X) and cell height (Y) of every CompareWithRecast row, the nav mesh's when empty
+	UPROPERTY(EditAnywhere, Category = "NavInsight")
+	TArray<FVector2D> CompareCellSettings;
+
+	// Each rasterizer runs this many times per setting, the best time is kept
+	UPROPERTY(EditAnywhere, Category = "NavInsight", meta = (ClampMin = "1"))
+	int CompareIters = 3;
+
+	// Also write the compared triangles to Saved/NavInsight/<Name>.bin for InsightVoxelBench --raw
+	UPROPERTY(EditAnywhere, Category = "NavInsight")
+	bool bDumpCompareMesh = true;
+
+	// Results of the last CompareWithRecast, one row per setting
+	UPROPERTY(VisibleAnywhere, Category = "NavInsight")
+	TArray<FInsightVoxelComparison> Comparisons;
+
 	// Sets default values for this actor's properties
 	AInsightRecastVoxel();
 
@@ -31,10 +153,21 @@ public:
 	UFUNCTION(CallInEditor, Category = "NavInsight")
 	void ComputeVoxelOfTargetMesh();
 
+	// Rasterize the target mesh with Recast (batched) and with the voxel core at every CompareCellSettings entry,
+	// timing both and diffing their occupancy cell by cell
+	UFUNCTION(CallInEditor, Category = "NavInsight")
+	void CompareWithRecast();
+
 	rcHeightfield* HeightField;
 
+	// Heightfield spans in the compact layout AInsightVoxelSpace converts to, in grid space (recast X, Z, Y)
+	InsightVoxel::FVoxelSpanGrid CompactHeightField;
+
+	// Reuses HeightField when its layout matches, see bReuseHeightField
 	void CreateNewHeightField(FBox& BBox);
 
+	virtual void BeginDestroy() override;
+
 private:
 	float CellSize = 25.0f;
 
@@ -42,12 +175,21 @@ private:
 
 	UProceduralMeshComponent* Mesh;
 
+	// Sub-heightfields of the parallel mode, one per tile
+	TArray<rcHeightfield*> TileHeightFields;
+
+	void FreeHeightFields();
+
 	void RasterizeMeshToHeightField();
 
+	void RasterizeParallel(const float* Verts, int NumVerts, const int32* Indices, int NumTris);
+
 	void LoadNavConfig();
 
 	void VisualizeHeightField() const;
 
+	void VisualizeHeightFieldGreedy() const;
+
 protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
@@ -0,0 +1,202 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Async/ParallelFor.h"
+#include "InsightGeometryCache.h"
+#include "VoxelCore/InsightVoxelClearance.h"
+#include "VoxelCore/InsightVoxelComponents.h"
+#include "VoxelCore/InsightVoxelGrid.h"
+#include "VoxelCore/InsightVoxelHierarchy.h"
+#include "VoxelCore/InsightVoxelPathBatch.h"
+#include "VoxelCore/InsightVoxelPathFinder.h"
+#include "VoxelCore/InsightVoxelSpans.h"
+#include "VoxelCore/InsightVoxelSparseGrid.h"
+#include "VoxelCore/InsightVoxelStats.h"
+
+#include <atomic>
+
+inline InsightVoxel::FVec3 ToVoxelVec(const FVector& V)
+{
+	return {V.X, V.Y, V.Z};
+}
+
+inline InsightVoxel::FBounds3 ToVoxelBounds(const FBox& Box)
+{
+	return {ToVoxelVec(Box.Min), ToVoxelVec(Box.Max)};
+}
+
+// InsightVoxel::FParallelForFn on the task graph
+inline void InsightParallelFor(int Num, const std::function<void(int)>& Body)
+{
+	ParallelFor(Num, [&Body](int32 Index) { Body(Index); });
+}
+
+// Complete result of one voxelization. Once published a snapshot is only read, so path queries can run on
+// any thread against the one they started with while the next is being built or patched.
+struct NAVINSIGHT_API FInsightVoxelSnapshot
+{
+	// Occupancy grid (see VoxelCore/)
+	InsightVoxel::FVoxelGrid Grid;
+
+	// Stayable voxels of Grid (see BuildWalkableMask)
+	InsightVoxel::FVoxelGrid WalkableGrid;
+
+	// Connected components of WalkableGrid; queries between two of them fail before any search. Patched together
+	// with WalkableGrid by incremental updates.
+	InsightVoxel::FComponentLabels Components;
+
+	// Compacted copies of Grid and of its stayable voxels, only built with bCompactSpans
+	InsightVoxel::FVoxelSpanGrid SolidSpans;
+	InsightVoxel::FVoxelSpanGrid WalkableSpans;
+
+	// Clusters, entrances and in-cluster costs over WalkableGrid, only built with PathClusterColumns > 0. Patched
+	// together with WalkableGrid by incremental updates.
+	InsightVoxel::FPathHierarchy PathHierarchy;
+
+	// Clearance of every voxel of WalkableGrid, only built with ClearanceBodyLayers > 0. Patched together with
+	// WalkableGrid by incremental updates.
+	InsightVoxel::FClearanceField Clearance;
+
+	// Rebuild (or drop) the compacted spans from Grid
+	void UpdateCompactSpans(bool bCompactSpans);
+
+	// Redo the spans of Columns only, after Grid and WalkableGrid changed there
+	void UpdateCompactSpans(bool bCompactSpans, const InsightVoxel::FVoxelTile& Columns);
+
+	// Memory of the grids, spans and hierarchy (a mapped voxel cache counts as its size)
+	int64 GetAllocatedBytes() const;
+
+	// Path between the voxels below two world positions, over the spans when they are built. False right away if
+	// either position has no voxel or they lie in different components. With MinClearance > 0
+	// and Clearance built, the bitset is searched instead and voxels with less clearance are avoided. Thread safe
+	// as long as every thread brings its own Search.
+	bool FindPath(InsightVoxel::FPathSearch& Search, const FVector& StartPos, const FVector& EndPos,
+				  InsightVoxel::EPathAlgorithm Algorithm, std::vector<InsightVoxel::FIntVec3>& OutPath, int32 MinClearance = 0) const;
+
+	// Same query on PathHierarchy: coarse path first, refined inside the clusters it crosses. False if the hierarchy
+	// is not built or the components differ. Thread safe as long as every thread brings its own Search.
+	bool FindPathHierarchical(InsightVoxel::FHierarchySearch& Search, const FVector& StartPos, const FVector& EndPos,
+							  std::vector<InsightVoxel::FIntVec3>& OutPath) const;
+
+	// Waypoints of a path found on this snapshot with the voxels any waypoint sees past dropped (see
+	// InsightVoxel::SmoothPath); MinClearance as given to FindPath. Thread safe.
+	void SmoothPath(const std::vector<InsightVoxel::FIntVec3>& Path, std::vector<InsightVoxel::FIntVec3>& OutWaypoints,
+					int32 MinClearance = 0) const;
+
+	// Paths from StartPositions[i] to GoalPositions[i], probed as in FindPath and searched as one batch (see
+	// InsightVoxel::FindPathBatch). Queries across components get an empty path without a search. Settings.Clearance
+	// is ignored: a MinClearance filters on this snapshot's field, when built. Thread safe; concurrent batches may
+	// share Pool.
+	void FindPathBatch(InsightVoxel::FPathSearchPool& Pool, const TArray<FVector>& StartPositions, const TArray<FVector>& GoalPositions,
+					   const InsightVoxel::FPathBatchSettings& Settings, InsightVoxel::FPathBatchResult& OutResult) const;
+};
+
+using FInsightVoxelSnapshotPtr = TSharedPtr<const FInsightVoxelSnapshot, ESPMode::ThreadSafe>;
+
+// Settings of one build, copied from the actor when it starts
+struct FInsightVoxelBuildSettings
+{
+	InsightVoxel::FBounds3 Bounds;
+	float CellSize = 20.0f;
+	float CellHeight = 50.0f;
+	bool bPipelinedBuild = true;
+	bool bParallelRasterization = true;
+	int32 RasterBandRows = 8;
+	bool bSparseRasterization = false;
+	bool bCompactSpans = false;
+	// X rows per band of the component labelling
+	int32 ComponentBandColumns = 16;
+	// Columns per side of the path hierarchy's clusters, 0 to build none
+	int32 PathClusterColumns = 0;
+	// Layers above a voxel an agent's body occupies, 0 to build no clearance field
+	int32 ClearanceBodyLayers = 0;
+	int32 MaxClearance = 16;
+	// Empty to build without the voxel cache
+	FString CachePath;
+};
+
+// What one build did, filled in by FInsightVoxelBuildJob::Run
+struct FInsightVoxelBuildStats
+{
+	// Wall time of every stage, 0 for the stages skipped
+	double ExportSeconds = 0.0;
+	double RasterizeSeconds = 0.0;
+	double WalkableSeconds = 0.0;
+	double ComponentsSeconds = 0.0;
+	double SpansSeconds = 0.0;
+	double HierarchySeconds = 0.0;
+	double ClearanceSeconds = 0.0;
+
+	// Rasterizer counters, all 0 when the grid came from the voxel cache
+	InsightVoxel::FVoxelStats Raster;
+
+	// Memory of the resulting snapshot
+	int64 GridBytes = 0;
+	int64 WalkableBytes = 0;
+	int64 ComponentsBytes = 0;
+	int64 SpanBytes = 0;
+	int64 HierarchyBytes = 0;
+	int64 ClearanceBytes = 0;
+	// Bricks of the sparse rasterization, freed after the walkable stage; 0 without it
+	int64 SparseBytes = 0;
+};
+
+// One voxelization running off the game thread. The game thread gathers the components into the geometry cache
+// (AddBuildComponent), hands the cache over and leaves it alone until the job has finished; Run does the export,
+// rasterization, walkability, component, span, path hierarchy and clearance stages into a new snapshot.
+class NAVINSIGHT_API FInsightVoxelBuildJob
+{
+public:
+	enum class EStage : uint8
+	{
+		Export,
+		Rasterize,
+		Walkable,
+		Components,
+		Spans,
+		Hierarchy,
+		Clearance,
+		Done,
+	};
+
+	FInsightVoxelBuildJob(const FInsightVoxelBuildSettings& InSettings, const TSharedRef<FInsightGeometryCache, ESPMode::ThreadSafe>& InGeometryCache);
+
+	// Checks for cancellation between stages and between meshes; a cancelled job publishes nothing and does not
+	// write the voxel cache
+	void Run();
+
+	void Cancel() { bCancelled = true; }
+	bool IsCancelled() const { return bCancelled; }
+
+	FText GetProgressText() const;
+
+	// Results, valid after Run
+	TSharedPtr<FInsightVoxelSnapshot, ESPMode::ThreadSafe> GetSnapshot() const { return Snapshot; }
+	bool WasLoadedFromCache() const { return bLoadedFromCache; }
+	int32 GetGeometryCacheHits() const { return GeometryCacheHits; }
+	int32 GetGeometryCacheMisses() const { return GeometryCacheMisses; }
+	const FInsightVoxelBuildStats& GetStats() const { return Stats; }
+
+	// Game thread only: actors found by the gather, with the bounds they are recorded with once the snapshot is published
+	TArray<TPair<TWeakObjectPtr<AActor>, FBox>> GatheredActors;
+
+private:
+	void Rasterize(InsightVoxel::FVoxelGrid& Grid);
+	void RasterizeSparse(InsightVoxel::FSparseVoxelGrid& SparseGrid);
+
+	FInsightVoxelBuildSettings Settings;
+	TSharedRef<FInsightGeometryCache, ESPMode::ThreadSafe> GeometryCache;
+	TSharedPtr<FInsightVoxelSnapshot, ESPMode::ThreadSafe> Snapshot;
+
+	std::atomic<bool> bCancelled{false};
+	std::atomic<EStage> Stage{EStage::Export};
+	std::atomic<int32> ExportedEntryNum{0};
+	std::atomic<int32> EntryNum{0};
+
+	bool bLoadedFromCache = false;
+	int32 GeometryCacheHits = 0;
+	int32 GeometryCacheMisses = 0;
+	FInsightVoxelBuildStats Stats;
+};
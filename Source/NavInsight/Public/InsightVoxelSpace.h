@@ -3,10 +3,31 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "Async/Future.h"
 #include "GameFramework/Actor.h"
 #include "GameFramework/Volume.h"
+#include "InsightGeometryCache.h"
+#include "InsightVoxelBuildJob.h"
+#include "VoxelCore/InsightVoxelGrid.h"
+#include "VoxelCore/InsightVoxelPathFinder.h"
+#include "VoxelCore/InsightVoxelSpans.h"
+#include "VoxelCore/InsightVoxelTiling.h"
 #include "InsightVoxelSpace.generated.h"
 
+UENUM()
+enum class EInsightPathAlgorithm : uint8
+{
+	AStar UMETA(DisplayName = "A*"),
+	JumpPoint UMETA(DisplayName = "Jump Point Search"),
+	// Cluster graph first, then the clusters on the coarse path (needs bPathHierarchy, A* otherwise)
+	Hierarchical UMETA(DisplayName = "Hierarchical (HPA*)"),
+};
+
+class SNotificationItem;
+class UInstancedStaticMeshComponent;
+class UMaterialInterface;
+class UStaticMesh;
+
 UCLASS()
 class NAVINSIGHT_API AInsightVoxelSpace : public AVolume
 {
@@ -20,6 +41,96 @@ class NAVINSIGHT_API AInsightVoxelSpace : public AVolume
 	UPROPERTY(EditAnywhere, Category = "NavInsight")
 	float CellHeight = 50.0f;
 
+	// Rasterize on worker threads, one band of Y rows per task
+	UPROPERTY(EditAnywhere, Category = "NavInsight")
+	bool bParallelRasterization = true;
+
+	UPROPERTY(EditAnywhere, Category = "NavInsight", meta = (ClampMin = "1", EditCondition = "bParallelRasterization"))
+	int RasterBandRows = 8;
+
+	// Transform the gathered meshes on worker threads and rasterize each one as soon as it is ready, instead of
+	// building the whole soup first (bParallelRasterization only applies to the latter)
+	UPROPERTY(EditAnywhere, Category = "NavInsight")
+	bool bPipelinedBuild = true;
+
+	// Rasterize into sparse bricks allocated only where there is geometry and find the walkable voxels from those,
+	// for large volumes that are mostly empty. Serial; bPipelinedBuild and bParallelRasterization do not apply.
+	// The snapshot still keeps the dense grid the visualization, edits and queries read.
+	UPROPERTY(EditAnywhere, Category = "NavInsight")
+	bool bSparseRasterization = false;
+
+	// Also draw the stayable voxels path queries run on
+	UPROPERTY(EditAnywhere, Category = "NavInsight")
+	bool bVisualizeWalkable = false;
+
+	// Voxels are drawn as instances of this mesh, scaled to the cell size (defaults to the engine cube)
+	UPROPERTY(EditAnywhere, Category = "NavInsight")
+	UStaticMesh* VoxelMesh;
+
+	UPROPERTY(EditAnywhere, Category = "NavInsight")
+	UMaterialInterface* VoxelMaterial = nullptr;
+
+	UPROPERTY(EditAnywhere, Category = "NavInsight")
+	UMaterialInterface* WalkableMaterial = nullptr;
+
+	// Visualization is split into chunks of RenderChunkColumns x RenderChunkColumns columns, rebuilt only when dirty
+	UPROPERTY(EditAnywhere, Category = "NavInsight", meta = (ClampMin = "1"))
+	int RenderChunkColumns = 32;
+
+	// Keep the occupancy grid in Saved/NavInsight/<Name>.voxcache and map it instead of rasterizing again
+	// while the exported geometry and the grid layout are unchanged
+	UPROPERTY(EditAnywhere, Category = "NavInsight")
+	bool bUseVoxelCache = true;
+
+	// Whether the last VoxelizeInBox was served from the cache
+	UPROPERTY(VisibleAnywhere, Category = "NavInsight")
+	bool bLoadedFromCache = false;
+
+	// Meshes of the last VoxelizeInBox whose exported collision was reused, and those exported again
+	UPROPERTY(VisibleAnywhere, Category = "NavInsight")
+	int32 GeometryCacheHits = 0;
+
+	UPROPERTY(VisibleAnywhere, Category = "NavInsight")
+	int32 GeometryCacheMisses = 0;
+
+	// After VoxelizeInBox, re-rasterize only the columns around actors that are moved, added or deleted
+	UPROPERTY(EditAnywhere, Category = "NavInsight")
+	bool bIncrementalUpdates = true;
+
+	// Also keep the voxels as compacted spans and run the walkability pass and path search over those
+	UPROPERTY(EditAnywhere, Category = "NavInsight")
+	bool bCompactSpans = false;
+
+	// Also build a cluster graph over the stayable voxels for long range queries (see PathAlgorithm)
+	UPROPERTY(EditAnywhere, Category = "NavInsight")
+	bool bPathHierarchy = false;
+
+	UPROPERTY(EditAnywhere, Category = "NavInsight", meta = (ClampMin = "4", EditCondition = "bPathHierarchy"))
+	int PathClusterColumns = 16;
+
+	// Also store how far every stayable voxel is from the nearest wall or overhang, so FindPath keeps an agent of
+	// AgentRadius clear of them (the hierarchy knows no clearance, Hierarchical then falls back to A*)
+	UPROPERTY(EditAnywhere, Category = "NavInsight")
+	bool bClearance = false;
+
+	// Layers above the floor an agent's body takes up; solid voxels there are obstacles
+	UPROPERTY(EditAnywhere, Category = "NavInsight", meta = (ClampMin = "1", ClampMax = "63", EditCondition = "bClearance"))
+	int ClearanceBodyLayers = 4;
+
+	// Clearances are only told apart up to this many cells
+	UPROPERTY(EditAnywhere, Category = "NavInsight", meta = (ClampMin = "1", ClampMax = "255", EditCondition = "bClearance"))
+	int MaxClearanceCells = 16;
+
+	UPROPERTY(EditAnywhere, Category = "NavInsight", meta = (ClampMin = "0", EditCondition = "bClearance"))
+	float AgentRadius = 0.0f;
+
+	// Draw FindPath's result as the waypoints left after dropping those in line of sight, not voxel by voxel
+	UPROPERTY(EditAnywhere, Category = "NavInsight")
+	bool bSmoothPath = true;
+
+	UPROPERTY(EditAnywhere, Category = "NavInsight")
+	EInsightPathAlgorithm PathAlgorithm = EInsightPathAlgorithm::AStar;
+
 	UPROPERTY(EditAnywhere, Category = "NavInsight")
 	AActor* StartPoint;
 
@@ -34,33 +145,123 @@ public:
 	// Called every frame
 	virtual void Tick(float DeltaTime) override;
 
+	virtual void BeginDestroy() override;
+
+	// Starts a build on the thread pool and returns; the current voxels stay in use until it is published. A
+	// request while a build runs cancels it and starts over once it has stopped.
 	UFUNCTION(CallInEditor)
 	void VoxelizeInBox();
 
+	// Searches the current snapshot on the thread pool and draws the path when done
 	UFUNCTION(CallInEditor)
 	void FindPath();
 
+	// Paths from Starts[i] to Goals[i] on the current snapshot with PathAlgorithm (A* for Hierarchical), as flat
+	// voxel index arrays and without any drawing. Queries sharing a start are searched together, groups in parallel;
+	// with bClearance, every query keeps AgentRadius clear like FindPath. Returns false before the first build has
+	// been published.
+	bool FindPathBatch(const TArray<FVector>& Starts, const TArray<FVector>& Goals, InsightVoxel::FPathBatchResult& OutResult);
+
+	// Last published voxelization, null before the first build has finished. Game thread only; the snapshot
+	// itself may be read from any thread and stays valid while it is referenced.
+	FInsightVoxelSnapshotPtr GetVoxelSnapshot() const { return Snapshot; }
+
+	// Stayable voxels of the last published build (bit set = stayable), same layout as the occupancy grid
+	const InsightVoxel::FVoxelGrid* GetWalkableGrid() const { return Snapshot ? &Snapshot->WalkableGrid : nullptr; }
+
+	// Stage timings, counters and memory of the last published build, and counters of the last FindPath to come
+	// back (also in "stat NavInsight")
+	const FInsightVoxelBuildStats& GetLastBuildStats() const { return LastBuildStats; }
+	const InsightVoxel::FPathSearchStats& GetLastPathStats() const { return LastPathStats; }
+
 private:
-	TArray<char> VoxelsOccupied;
+	// Grid, stayable mask and spans the visualization and path queries read. Replaced as a whole when a build
+	// finishes; incremental updates patch it in place unless a query still holds it (see GetMutableSnapshot).
+	TSharedPtr<FInsightVoxelSnapshot, ESPMode::ThreadSafe> Snapshot;
 
-	FBox VoxelBBox;
+	// Snapshot, copied first if a path query still reads it
+	FInsightVoxelSnapshot& GetMutableSnapshot();
 
-	int VoxelXNum;
-	int VoxelYNum;
-	int VoxelZNum;
+	FString GetVoxelCachePath() const;
 
-	void SetVoxelOccupied(int X, int Y, int Z, bool Flag);
-	bool GetVoxelOccupied(int X, int Y, int Z);
-	
-	bool IsVoxelInside(int X, int Y, int Z);
+	// Collision exports kept across VoxelizeInBox and RevoxelizeActor calls, owned by the running build meanwhile
+	TSharedRef<FInsightGeometryCache, ESPMode::ThreadSafe> GeometryCache;
+
+	FInsightVoxelBuildStats LastBuildStats;
+	InsightVoxel::FPathSearchStats LastPathStats;
+
+	// Search states of FindPath and FindPathBatch, reused across queries. Shared with the running queries, which
+	// take one each and give it back when done.
+	TSharedRef<InsightVoxel::FPathSearchPool, ESPMode::ThreadSafe> PathSearchPool;
+	TSharedRef<InsightVoxel::FHierarchySearchPool, ESPMode::ThreadSafe> HierarchySearchPool;
+
+	// Running build, and whether VoxelizeInBox was called again while it ran
+	TSharedPtr<FInsightVoxelBuildJob, ESPMode::ThreadSafe> BuildJob;
+	TFuture<void> BuildTask;
+	bool bRebuildRequested = false;
+
+	// Body setups the running build reads, kept from the garbage collector until it finishes
+	UPROPERTY(Transient)
+	TArray<UObject*> BuildReferences;
+
+	// Level edits made while a build runs, applied to its result
+	TArray<TPair<TWeakObjectPtr<AActor>, bool>> PendingActorUpdates;
+
+#if WITH_EDITOR
+	TSharedPtr<SNotificationItem> BuildNotification;
+#endif
+
+	void StartBuild();
+
+	void OnBuildFinished(const TSharedRef<FInsightVoxelBuildJob, ESPMode::ThreadSafe>& Job);
 
-	void RasterizeTriangle(FVector A, FVector B, FVector C);
+	void DrawPath(const FInsightVoxelSnapshot& PathSnapshot, const std::vector<InsightVoxel::FIntVec3>& Path);
+
+	// One instanced component per render chunk (null while the chunk has nothing to draw)
+	UPROPERTY(Transient)
+	TArray<UInstancedStaticMeshComponent*> VoxelChunkComponents;
+
+	UPROPERTY(Transient)
+	TArray<UInstancedStaticMeshComponent*> WalkableChunkComponents;
+
+	InsightVoxel::FVoxelTiling RenderChunks;
+	TArray<bool> DirtyRenderChunks;
+
+	// Flag the render chunks overlapping a rectangle of columns for the next VisualizeVoxelSpace
+	void MarkRenderChunksDirty(const InsightVoxel::FVoxelTile& Columns);
+
+	void RebuildRenderChunk(int ChunkIndex);
+
+	void UpdateChunkInstances(UInstancedStaticMeshComponent*& Component, UMaterialInterface* Material,
+							  const std::vector<InsightVoxel::FIntVec3>& Voxels);
+
+	void DestroyRenderChunks();
+
+	// Bounds every rasterized actor contributed with, and the actors touching each render chunk
+	TMap<TWeakObjectPtr<AActor>, FBox> VoxelizedActors;
+	TArray<TArray<TWeakObjectPtr<AActor>>> ChunkActors;
+
+	FDelegateHandle ActorMovedHandle;
+	FDelegateHandle ActorAddedHandle;
+	FDelegateHandle ActorDeletedHandle;
+
+	void RecordVoxelizedActor(AActor* Actor, const FBox& Bounds);
+
+	void ForgetVoxelizedActor(AActor* Actor);
+
+	// Clear the columns covered by the old and the new geometry of Actor and rasterize everything touching them again
+	void RevoxelizeActor(AActor* Actor, bool bRemoved);
+
+	void OnLevelActorChanged(AActor* Actor);
+
+	void OnLevelActorDeleted(AActor* Actor);
+
+	void RegisterLevelEvents();
+
+	void UnregisterLevelEvents();
 
 	void VisualizeVoxelSpace();
 
+	// Lay out the render chunks and the actor bookkeeping for the grid of Snapshot
 	void InitializeVoxelSpace();
-
-	bool IsStayableVoxel(int X, int Y, int Z);
-	
-	FIntVector ProbeVoxel(FVector& Position);
 };
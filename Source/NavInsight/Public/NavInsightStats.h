@@ -0,0 +1,41 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Stats/Stats.h"
+#include "Trace/Trace.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+
+// "stat NavInsight": stage timings of the builds, counters of the last build and the last path query, and the
+// memory held by the published snapshot
+DECLARE_STATS_GROUP(TEXT("NavInsight"), STATGROUP_NavInsight, STATCAT_Advanced);
+
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Build Export"), STAT_NavInsight_Export, STATGROUP_NavInsight, NAVINSIGHT_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Build Rasterize"), STAT_NavInsight_Rasterize, STATGROUP_NavInsight, NAVINSIGHT_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Build Walkable"), STAT_NavInsight_Walkable, STATGROUP_NavInsight, NAVINSIGHT_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Build Components"), STAT_NavInsight_Components, STATGROUP_NavInsight, NAVINSIGHT_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Build Spans"), STAT_NavInsight_Spans, STATGROUP_NavInsight, NAVINSIGHT_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Build Hierarchy"), STAT_NavInsight_Hierarchy, STATGROUP_NavInsight, NAVINSIGHT_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Build Clearance"), STAT_NavInsight_Clearance, STATGROUP_NavInsight, NAVINSIGHT_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Revoxelize Actor"), STAT_NavInsight_Revoxelize, STATGROUP_NavInsight, NAVINSIGHT_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Find Path"), STAT_NavInsight_FindPath, STATGROUP_NavInsight, NAVINSIGHT_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Smooth Path"), STAT_NavInsight_SmoothPath, STATGROUP_NavInsight, NAVINSIGHT_API);
+
+// Set when a build is published or a path query comes back (accumulators are not reset every frame)
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Triangles Submitted"), STAT_NavInsight_TrianglesSubmitted, STATGROUP_NavInsight, NAVINSIGHT_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Triangles Culled"), STAT_NavInsight_TrianglesCulled, STATGROUP_NavInsight, NAVINSIGHT_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Rows Clipped"), STAT_NavInsight_RowsClipped, STATGROUP_NavInsight, NAVINSIGHT_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Voxels Written"), STAT_NavInsight_VoxelsWritten, STATGROUP_NavInsight, NAVINSIGHT_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Path Nodes Expanded"), STAT_NavInsight_PathExpanded, STATGROUP_NavInsight, NAVINSIGHT_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Path Peak Open"), STAT_NavInsight_PathPeakOpen, STATGROUP_NavInsight, NAVINSIGHT_API);
+
+DECLARE_MEMORY_STAT_EXTERN(TEXT("Snapshot Memory"), STAT_NavInsight_SnapshotMemory, STATGROUP_NavInsight, NAVINSIGHT_API);
+
+// Insights channel of the build stages and path queries ("-trace=cpu,NavInsight")
+UE_TRACE_CHANNEL_EXTERN(NavInsightChannel, NAVINSIGHT_API);
+
+// Stage scope seen by both "stat NavInsight" and Insights
+#define NAVINSIGHT_SCOPE(Stat) \
+	SCOPE_CYCLE_COUNTER(Stat); \
+	TRACE_CPUPROFILER_EVENT_SCOPE_ON_CHANNEL(Stat, NavInsightChannel)
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+namespace InsightVoxel
+{
+	inline int PopCount64(uint64_t Value)
+	{
+#if defined(_MSC_VER) && !defined(__clang__)
+		return static_cast<int>(__popcnt64(Value));
+#else
+		return __builtin_popcountll(Value);
+#endif
+	}
+
+	// Index of the lowest set bit. Value must not be 0.
+	inline int LowestBit64(uint64_t Value)
+	{
+#if defined(_MSC_VER) && !defined(__clang__)
+		unsigned long Index;
+		_BitScanForward64(&Index, Value);
+		return static_cast<int>(Index);
+#else
+		return __builtin_ctzll(Value);
+#endif
+	}
+
+	// Index of the highest set bit. Value must not be 0.
+	inline int HighestBit64(uint64_t Value)
+	{
+#if defined(_MSC_VER) && !defined(__clang__)
+		unsigned long Index;
+		_BitScanReverse64(&Index, Value);
+		return static_cast<int>(Index);
+#else
+		return 63 - __builtin_clzll(Value);
+#endif
+	}
+
+	// Bits [Lo, Hi) of a word, 0 <= Lo <= Hi <= 64
+	inline uint64_t BitRangeMask64(int Lo, int Hi)
+	{
+		const uint64_t HiMask = Hi >= 64 ? ~0ull : ((1ull << Hi) - 1);
+		const uint64_t LoMask = Lo >= 64 ? ~0ull : ((1ull << Lo) - 1);
+		return HiMask & ~LoMask;
+	}
+}
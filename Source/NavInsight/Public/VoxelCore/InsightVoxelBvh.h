@@ -0,0 +1,51 @@
+#pragma once
+
+#include "VoxelCore/InsightVoxelTypes.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace InsightVoxel
+{
+	// Bounding volume hierarchy over the triangles of one indexed soup, to enumerate only the triangles that
+	// overlap a box (the grid, a tile, the columns of an incremental update) without touching the others.
+	//
+	// Built top-down with median splits on the longest centroid axis; leaves hold up to LeafTriangles
+	// triangles. The hierarchy stores triangle numbers, not vertices, so it stays valid for the soup it was
+	// built over and for any copy of it.
+	class FTriangleBvh
+	{
+	public:
+		static const int LeafTriangles = 8;
+
+		// Triangles with an invalid index are left out
+		void Build(const float* Verts, int NumVerts, const int32_t* Indices, int NumTris);
+
+		void Reset();
+
+		bool IsEmpty() const { return Nodes.empty(); }
+
+		// Append the numbers of the triangles whose bounds overlap Box (touching counts, as in FBounds3::Intersect)
+		void QueryBox(const FBounds3& Box, std::vector<int32_t>& OutTris) const;
+
+		int GetTriangleNum() const { return static_cast<int>(Tris.size()); }
+		int GetNodeNum() const { return static_cast<int>(Nodes.size()); }
+		const FBounds3& GetBounds() const { return Nodes[0].Bounds; }
+
+		size_t GetAllocatedBytes() const;
+
+	private:
+		struct FNode
+		{
+			FBounds3 Bounds;
+			// Leaves: first triangle in Tris. Inner nodes: index of the first child (the second one follows it).
+			int32_t First = 0;
+			// Triangle count of a leaf, 0 for inner nodes
+			int32_t Count = 0;
+		};
+
+		std::vector<FNode> Nodes;
+		std::vector<int32_t> Tris;
+	};
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "VoxelCore/InsightVoxelTypes.h"
+
+#include <cstdint>
+#include <string>
+
+namespace InsightVoxel
+{
+	class FVoxelGrid;
+
+	// Bumped whenever the file layout or the rasterization rules change, so older caches are rebuilt
+	static const uint32_t VoxelCacheVersion = 1;
+
+	// On-disk layout: this header, then the XNum * YNum * ColumnWords column words of FVoxelGrid as they
+	// are in memory (little endian). HeaderSize keeps the words 64-byte aligned in the file.
+	struct FVoxelCacheHeader
+	{
+		char Magic[4];
+		uint32_t Version;
+		uint32_t HeaderSize;
+		uint32_t Reserved;
+		uint64_t GeometryHash;
+		float BoundsMin[3];
+		float BoundsMax[3];
+		float CellSize;
+		float CellHeight;
+		int32_t XNum;
+		int32_t YNum;
+		int32_t ZNum;
+		int32_t ColumnWords;
+		uint64_t WordNum;
+		uint8_t Padding[48];
+	};
+	static_assert(sizeof(FVoxelCacheHeader) == 128, "Voxel cache header must stay 128 bytes");
+
+	// 64-bit content hash of an indexed triangle soup (the exported vertex and index buffers)
+	uint64_t HashGeometry(const float* Verts, int NumVerts, const int32_t* Indices, int NumTris);
+
+	// Write Grid to Path (through a temporary file, replaced at the end so readers never see half a file)
+	bool SaveVoxelCache(const std::string& Path, const FVoxelGrid& Grid, uint64_t GeometryHash);
+
+	// Map the cache at Path copy-on-write and point OutGrid at its words without reading them. Returns false,
+	// leaving OutGrid untouched, if the file is missing, of another version, or was built from other geometry
+	// or another grid layout (bounds, cell size, cell height).
+	bool LoadVoxelCache(const std::string& Path, uint64_t GeometryHash, const FBounds3& Bounds, float CellSize, float CellHeight,
+						FVoxelGrid& OutGrid);
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "VoxelCore/InsightVoxelParallel.h"
+#include "VoxelCore/InsightVoxelTiling.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace InsightVoxel
+{
+	class FVoxelGrid;
+
+	// Horizontal clearance of every stayable voxel, one byte each, for agent size filters on path queries.
+	//
+	// The obstacles of a voxel at Z are the solid voxels of layers Z + 1 ... Z + BodyLayers (its own layer is left
+	// out, so the one voxel steps path search climbs do not count). Its clearance is the chamfer distance, in cells,
+	// from its column to the nearest column with such an obstacle: 0 below an overhang, 1 next to a wall (diagonals
+	// included), up to MaxClearance when nothing is closer. Steps alternate between the 8 and the 4 neighbours
+	// (octagonal distance, within 8% of the Euclidean one).
+	//
+	// Built with whole column words like BuildWalkableMask: the obstacle columns are grown one step at a time by
+	// separable ORs, and every stayable voxel gets the step that first covers it. Values are stored in the order of
+	// the set bits of the walkable mask, so lookups need that mask.
+	class FClearanceField
+	{
+	public:
+		// Smallest clearance an agent of Radius (world units) needs to stand on a voxel center without reaching
+		// into an obstacle column
+		static int GetRequiredClearance(float Radius, float CellSize);
+
+		// Walkable must be BuildWalkableMask of Grid. MaxClearance is clamped to [1, 255].
+		void Build(const FVoxelGrid& Grid, const FVoxelGrid& Walkable, int BodyLayers, int MaxClearance,
+				   const FParallelForFn& ParallelFor = SerialFor);
+
+		// Grid and Walkable changed in Columns only (e.g. the region UpdateWalkableMask redid): the columns within
+		// MaxClearance of it are recomputed, the others keep their values. No-op before Build; a grid of other
+		// dimensions is built from scratch.
+		void Update(const FVoxelGrid& Grid, const FVoxelGrid& Walkable, const FVoxelTile& Columns,
+					const FParallelForFn& ParallelFor = SerialFor);
+
+		void Reset();
+
+		bool IsBuilt() const { return !ColumnStart.empty(); }
+
+		// Clearance of voxel (X, Y, Z), 0 if it is not stayable. Walkable must be the mask the field was built or
+		// last updated from.
+		uint8_t GetClearance(const FVoxelGrid& Walkable, int X, int Y, int Z) const;
+
+		int GetBodyLayers() const { return BodyLayers; }
+		int GetMaxClearance() const { return MaxClearance; }
+
+		size_t GetAllocatedBytes() const;
+
+		// Same settings and values (used by the benchmark to check Update against Build)
+		bool HasSameValues(const FClearanceField& Other) const;
+
+	private:
+		int XNum = 0;
+		int YNum = 0;
+		int ZNum = 0;
+		int BodyLayers = 0;
+		int MaxClearance = 0;
+
+		// Index of the first value of every column (X major like the grid), one past the last: the value count
+		std::vector<uint32_t> ColumnStart;
+		std::vector<uint8_t> Values;
+
+		void CountColumns(const FVoxelGrid& Walkable);
+
+		// Recompute the values of the columns in Columns, looking for obstacles MaxClearance columns around them
+		void ComputeColumns(const FVoxelGrid& Grid, const FVoxelGrid& Walkable, const FVoxelTile& Columns,
+							const FParallelForFn& ParallelFor);
+	};
+}
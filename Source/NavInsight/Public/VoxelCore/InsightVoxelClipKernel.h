@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+
+namespace InsightVoxel
+{
+	// Row polygon (the triangle clipped to one Y row) in SoA form. Only X and Z matter for the column split.
+	struct FRowPolySoA
+	{
+		static const int MaxVerts = 8;
+
+		float X[MaxVerts];
+		float Z[MaxVerts];
+		int Num = 0;
+	};
+
+	enum class EClipKernel : uint8_t
+	{
+		Scalar,
+		SSE,
+		AVX,
+	};
+
+	// Most cells ClipRowSpans handles per call; callers split longer rows
+	static const int ClipKernelMaxCells = 64;
+
+	// What is left of a row polygon's edges after a ClipRowSpans call, so the next call over the same row
+	// resumes there instead of cutting the edges again from RowX0. Start every row with a fresh one.
+	struct FClipRowState
+	{
+		bool bStarted = false;
+
+		// First cell of the call that can resume; any other X0 starts over from RowX0
+		int NextX = 0;
+
+		float BX[FRowPolySoA::MaxVerts];
+		float BZ[FRowPolySoA::MaxVerts];
+		float OX[FRowPolySoA::MaxVerts];
+		float OZ[FRowPolySoA::MaxVerts];
+
+		// Crossings of the upper edge of cell NextX - 1
+		float LastMin;
+		float LastMax;
+		float LastCnt;
+	};
+
+	// Split a row polygon into the cells X0..X1 (inclusive) of its row in one pass and return the Z extent
+	// of every cell, as the chain of DividePoly calls in the scalar rasterizer would.
+	//
+	// Cell X covers (GridMinX + (X - 1) * CellSize + CellSize, GridMinX + X * CellSize + CellSize], except
+	// cell RowX0 (the first cell the row touches) which is open to the left. Rather than clipping the
+	// remaining polygon again at every boundary, each edge is walked across the boundaries it crosses, carrying
+	// the crossing along the way DividePoly's remaining polygon does; the SIMD kernels walk several edges in
+	// lanes. Spans are bit-identical to the sequential DividePoly chain, for any split of the row into calls
+	// (see InsightClipKernelBench).
+	//
+	// OutValid[i] is 0 when the clipped polygon of cell X0 + i is degenerate (< 3 corners).
+	// Requires RowX0 <= X0 <= X1 and X1 - X0 < ClipKernelMaxCells. Callers splitting a row pass the same
+	// State to its consecutive calls; without one, every call walks the edges from RowX0 again.
+	void ClipRowSpans(const FRowPolySoA& Poly, float GridMinX, float CellSize, int RowX0, int X0, int X1,
+					  float* OutMin, float* OutMax, uint8_t* OutValid, FClipRowState* State = nullptr);
+
+	// Same, forcing a specific kernel. Returns false if that kernel was not compiled in.
+	bool ClipRowSpansWith(EClipKernel Kernel, const FRowPolySoA& Poly, float GridMinX, float CellSize, int RowX0, int X0, int X1,
+						  float* OutMin, float* OutMax, uint8_t* OutValid, FClipRowState* State = nullptr);
+
+	// Kernel ClipRowSpans uses. Scalar for now: a row polygon has only 3-5 edges for the SIMD kernels to spread
+	// over their lanes, and InsightClipKernelBench has them no faster than the scalar walk.
+	EClipKernel GetDefaultClipKernel();
+	const char* GetClipKernelName(EClipKernel Kernel);
+}
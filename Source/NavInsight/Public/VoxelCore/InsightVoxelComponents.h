@@ -0,0 +1,98 @@
+#pragma once
+
+#include "VoxelCore/InsightVoxelParallel.h"
+#include "VoxelCore/InsightVoxelTiling.h"
+#include "VoxelCore/InsightVoxelTypes.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace InsightVoxel
+{
+	class FVoxelGrid;
+
+	// Connected components of the stayable voxels under the 6-neighbour moves of FPathSearch, so queries between
+	// two islands fail without flooding the start's one.
+	//
+	// Labels are kept per vertical run of stayable voxels (a run is connected by its Z moves). The columns are
+	// split into bands of BandColumns X rows: every band joins its own runs with a union-find on ParallelFor,
+	// then the band borders are joined and the components numbered serially. Update redoes the bands around the
+	// changed columns only and keeps the others' local results.
+	class FComponentLabels
+	{
+	public:
+		// Component of voxels that are not stayable
+		static const uint32_t NoComponent = 0xffffffffu;
+
+		void Build(const FVoxelGrid& Walkable, int BandColumns, const FParallelForFn& ParallelFor = SerialFor);
+
+		// Walkable changed in Columns only (e.g. the region UpdateWalkableMask redid). No-op before Build; a grid
+		// of other dimensions is built from scratch.
+		void Update(const FVoxelGrid& Walkable, const FVoxelTile& Columns, const FParallelForFn& ParallelFor = SerialFor);
+
+		void Reset();
+
+		bool IsBuilt() const { return !Bands.empty(); }
+
+		// Component of voxel (X, Y, Z), NoComponent if it is outside the grid or not stayable
+		uint32_t GetComponent(int X, int Y, int Z) const;
+
+		// False only if no path from StartIdx to EndIdx exists: either is invalid, the goal is not stayable, or no
+		// move from the start (which, as in FPathSearch, need not be stayable itself) enters the goal's component.
+		// True before Build.
+		bool CanConnect(const FIntVec3& StartIdx, const FIntVec3& EndIdx) const;
+
+		int GetComponentNum() const { return ComponentNum; }
+		int64_t GetRunNum() const { return static_cast<int64_t>(Labels.size()); }
+
+		// Bands labelled by the last Build or Update (used by the benchmark)
+		int GetRebuiltBandNum() const { return RebuiltBandNum; }
+
+		size_t GetAllocatedBytes() const;
+
+		// Same runs and labels (used by the benchmark to check Update against Build)
+		bool HasSameLabels(const FComponentLabels& Other) const;
+
+	private:
+		// Stayable voxels [ZMin, ZMax) of one column
+		struct FRun
+		{
+			int32_t ZMin;
+			int32_t ZMax;
+
+			bool operator==(const FRun& Other) const { return ZMin == Other.ZMin && ZMax == Other.ZMax; }
+		};
+
+		struct FBand
+		{
+			// Runs of every column of the band (X major like the grid), one past the last: the run count
+			std::vector<uint32_t> ColumnStart;
+			std::vector<FRun> Runs;
+			// Lowest run of the component every run belongs to within the band
+			std::vector<uint32_t> LocalRoots;
+		};
+
+		FVoxelTiling Tiling;
+		int XNum = 0;
+		int YNum = 0;
+		int ZNum = 0;
+		int BandColumns = 0;
+		int ComponentNum = 0;
+		int RebuiltBandNum = 0;
+
+		std::vector<FBand> Bands;
+		// Global index of the first run of every band
+		std::vector<uint32_t> BandRunBegin;
+		// Component of every run, bands one after the other
+		std::vector<uint32_t> Labels;
+
+		void BuildBand(const FVoxelGrid& Walkable, int BandIndex);
+
+		// Join the bands across their borders and number the components
+		void LabelComponents();
+
+		// Global index of the first run of column (X, Y), and its run count
+		uint32_t GetColumnRuns(int X, int Y, uint32_t& OutNum) const;
+	};
+}
@@ -0,0 +1,134 @@
+#pragma once
+
+#include "VoxelCore/InsightVoxelTiling.h"
+#include "VoxelCore/InsightVoxelTypes.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace InsightVoxel
+{
+	// Dense occupancy bitset over an axis-aligned box split into CellSize x CellSize x CellHeight cells.
+	//
+	// Storage is column-major: every (X, Y) column is ColumnWords consecutive 64-bit words with bit Z of
+	// the column at word Z / 64, bit Z % 64. Columns are padded to whole words (padding bits are always 0),
+	// so a vertical span is a couple of masked word ORs and workers owning disjoint sets of columns never
+	// write the same word.
+	class FVoxelGrid
+	{
+	public:
+		FVoxelGrid() = default;
+		// Copies always own their words, also when Other uses external storage
+		FVoxelGrid(const FVoxelGrid& Other);
+		FVoxelGrid& operator=(const FVoxelGrid& Other);
+		FVoxelGrid(FVoxelGrid&& Other) noexcept;
+		FVoxelGrid& operator=(FVoxelGrid&& Other) noexcept;
+
+		// Compute the grid dimensions from the bounds and clear every voxel
+		void Init(const FBounds3& InBounds, float InCellSize, float InCellHeight);
+
+		// Compute the grid dimensions and use InWords (XNum * YNum * ColumnWords words, in the layout above)
+		// as storage instead of allocating. InOwner keeps the memory alive as long as the grid uses it, e.g.
+		// a copy-on-write mapping of a voxel cache file (see LoadVoxelCache). Writes go to InWords.
+		void InitExternal(const FBounds3& InBounds, float InCellSize, float InCellHeight, uint64_t* InWords,
+						  std::shared_ptr<void> InOwner);
+
+		// Whether the words are owned by someone else (InitExternal)
+		bool IsExternal() const { return ExternalOwner != nullptr; }
+
+		// Storage size in words (XNum * YNum * ColumnWords)
+		size_t GetWordNum() const { return WordNum; }
+		const uint64_t* GetWords() const { return Data; }
+
+		void SetVoxelOccupied(int X, int Y, int Z, bool Flag);
+		bool GetVoxelOccupied(int X, int Y, int Z) const;
+
+		// Mark voxels [ZMin, ZMax) of column (X, Y) as occupied
+		void SetSpan(int X, int Y, int ZMin, int ZMax);
+
+		// Clear every voxel of the columns in Columns
+		void ClearColumns(const FVoxelTile& Columns);
+
+		// Columns whose cells overlap Box, grown by Margin columns on every side and clipped to the grid
+		// (empty if Box misses the grid)
+		FVoxelTile GetColumnRect(const FBounds3& Box, int Margin = 0) const;
+
+		// Word WordIndex of column (X, Y) (bits Z = WordIndex * 64 ... WordIndex * 64 + 63)
+		uint64_t GetColumnMask(int X, int Y, int WordIndex) const { return Data[ColumnOffset(X, Y) + WordIndex]; }
+		const uint64_t* GetColumn(int X, int Y) const { return &Data[ColumnOffset(X, Y)]; }
+		uint64_t* GetColumn(int X, int Y) { return &Data[ColumnOffset(X, Y)]; }
+
+		// Whether any voxel of [ZMin, ZMax) in column (X, Y) is occupied (range is clamped to the column)
+		bool IsAnyOccupied(int X, int Y, int ZMin, int ZMax) const;
+
+		// Highest occupied Z in [ZMin, ZMax) of column (X, Y), or -1
+		int FindHighestOccupied(int X, int Y, int ZMin, int ZMax) const;
+
+		bool IsVoxelInside(int X, int Y, int Z) const;
+
+		// Number of occupied voxels (used by the benchmark to report voxels/sec)
+		int64_t CountOccupied() const;
+
+		// Same dimensions and the same occupied voxels
+		bool HasSameOccupancy(const FVoxelGrid& Other) const;
+
+		const FBounds3& GetBounds() const { return Bounds; }
+		float GetCellSize() const { return CellSize; }
+		float GetCellHeight() const { return CellHeight; }
+
+		int GetXNum() const { return XNum; }
+		int GetYNum() const { return YNum; }
+		int GetZNum() const { return ZNum; }
+		int64_t GetVoxelNum() const { return static_cast<int64_t>(XNum) * YNum * ZNum; }
+		int GetColumnWords() const { return ColumnWords; }
+
+	private:
+		// Data points into Words, or into memory held by ExternalOwner
+		std::vector<uint64_t> Words;
+		std::shared_ptr<void> ExternalOwner;
+		uint64_t* Data = nullptr;
+		size_t WordNum = 0;
+
+		FBounds3 Bounds;
+		float CellSize = 20.0f;
+		float CellHeight = 50.0f;
+
+		int XNum = 0;
+		int YNum = 0;
+		int ZNum = 0;
+		int ColumnWords = 0;
+
+		void SetDimensions(const FBounds3& InBounds, float InCellSize, float InCellHeight);
+
+		size_t ColumnOffset(int X, int Y) const
+		{
+			return static_cast<size_t>(static_cast<int64_t>(X) * YNum + Y) * ColumnWords;
+		}
+	};
+
+	// Cell by cell difference of two grids, see CompareOccupancy
+	struct FOccupancyDiff
+	{
+		// Voxels occupied in both grids, in A only and in B only
+		int64_t BothNum = 0;
+		int64_t OnlyANum = 0;
+		int64_t OnlyBNum = 0;
+
+		// Columns with at least one differing voxel, and the first of them (X major), -1 if there is none
+		int64_t DiffColumnNum = 0;
+		int FirstDiffX = -1;
+		int FirstDiffY = -1;
+
+		bool IsIdentical() const { return OnlyANum == 0 && OnlyBNum == 0; }
+
+		// Intersection over union of the occupied voxels, 1 for two empty grids
+		double GetIoU() const;
+	};
+
+	// Compare grids covering the same columns with the same cells and the same bottom (e.g. a Recast heightfield
+	// converted to a grid against one rasterized here). Their heights may differ: voxels above the top of the
+	// lower grid count as missing from it. False, leaving OutDiff alone, if the layouts do not line up.
+	bool CompareOccupancy(const FVoxelGrid& A, const FVoxelGrid& B, FOccupancyDiff& OutDiff);
+}
@@ -0,0 +1,161 @@
+#pragma once
+
+#include "VoxelCore/InsightVoxelParallel.h"
+#include "VoxelCore/InsightVoxelStats.h"
+#include "VoxelCore/InsightVoxelTiling.h"
+#include "VoxelCore/InsightVoxelTypes.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace InsightVoxel
+{
+	class FVoxelGrid;
+	class FClusterFlood;
+
+	// Abstract graph over the stayable voxels for long range queries (HPA*).
+	//
+	// The XY columns are split into clusters of ClusterColumns x ClusterColumns full height columns. Every
+	// connected run of walkable voxel pairs straddling the border of two neighbouring clusters is an entrance:
+	// its middle pair (both ends for long runs) gives one node on each side, linked by a move of cost 1. The
+	// nodes of a cluster are linked by the length of the shortest path between them inside the cluster.
+	//
+	// A border only depends on the columns of the two clusters it separates, and a cluster on its own columns
+	// and borders, so Update redoes the borders and clusters around the changed columns only.
+	class FPathHierarchy
+	{
+	public:
+		// Cost of node pairs with no path between them inside their cluster
+		static const uint32_t NoPath = 0xffffffffu;
+
+		// Discard the graph and build it from the walkable mask, clusters on ParallelFor
+		void Build(const FVoxelGrid& Walkable, int ClusterColumns, const FParallelForFn& ParallelFor);
+
+		// Walkable changed in Columns only (e.g. the region UpdateWalkableMask redid). No-op before Build; a
+		// grid of other dimensions is built from scratch.
+		void Update(const FVoxelGrid& Walkable, const FVoxelTile& Columns, const FParallelForFn& ParallelFor);
+
+		void Reset();
+
+		bool IsBuilt() const { return !Clusters.empty(); }
+
+		const FVoxelTiling& GetTiling() const { return Tiling; }
+		int GetClusterNum() const { return static_cast<int>(Clusters.size()); }
+		int GetNodeNum() const { return ClusterNodeBegin.empty() ? 0 : ClusterNodeBegin.back(); }
+
+		// Node pairs connected inside their cluster
+		int64_t GetIntraEdgeNum() const;
+
+		// Clusters rebuilt by the last Build or Update (used by the benchmark)
+		int GetRebuiltClusterNum() const { return RebuiltClusterNum; }
+
+		size_t GetAllocatedBytes() const;
+
+		// Same clusters, entrances and costs (used by the benchmark to check Update against Build)
+		bool HasSameGraph(const FPathHierarchy& Other) const;
+
+	private:
+		friend class FHierarchySearch;
+
+		// Sides of a cluster, in the order their nodes are stored
+		enum ESide
+		{
+			SideNegX,
+			SidePosX,
+			SideNegY,
+			SidePosY,
+			SideNum,
+		};
+
+		struct FCluster
+		{
+			// Nodes of side S are [SideBegin[S], SideBegin[S + 1]), in the order of the border's entrances
+			std::vector<FIntVec3> Nodes;
+			int SideBegin[SideNum + 1] = {};
+			// Nodes.size()^2 path lengths inside the cluster, NoPath if disconnected
+			std::vector<uint32_t> Costs;
+		};
+
+		FVoxelTiling Tiling;
+		int XNum = 0;
+		int YNum = 0;
+		int ZNum = 0;
+		int ClusterColumns = 0;
+
+		// Entrances on the +X / +Y border of every cluster, as the voxel on the cluster's side; the voxel across
+		// is one step further along the axis. Empty on the last column / row of clusters.
+		std::vector<std::vector<FIntVec3>> XBorders;
+		std::vector<std::vector<FIntVec3>> YBorders;
+
+		std::vector<FCluster> Clusters;
+
+		// Global node index of the first node of every cluster (one past the last cluster: the node count), and
+		// the cluster of every global node
+		std::vector<int32_t> ClusterNodeBegin;
+		std::vector<int32_t> NodeClusters;
+
+		int RebuiltClusterNum = 0;
+
+		void FindBorderEntrances(const FVoxelGrid& Walkable, int ClusterIndex, int Axis, std::vector<FIntVec3>& OutEntrances) const;
+		void RebuildCluster(const FVoxelGrid& Walkable, int ClusterIndex, FClusterFlood& Flood);
+		void RebuildClusters(const FVoxelGrid& Walkable, const std::vector<int32_t>& ClusterIndices, const FParallelForFn& ParallelFor);
+		void UpdateNodeIndices();
+
+		// Global index of the node across the border from node Local of cluster ClusterIndex
+		int32_t GetPartner(int ClusterIndex, int Local) const;
+	};
+
+	// Query state for FPathHierarchy: the abstract graph is searched first, with the start and goal linked to
+	// the nodes of their clusters, then every cluster on the coarse path is refined by a search confined to it.
+	// Paths are not always shortest (they pass through entrance nodes), but one exists whenever FPathSearch finds
+	// one. Keep one instance around (per thread, or in an FHierarchySearchPool) to make repeated queries allocation free.
+	class FHierarchySearch
+	{
+	public:
+		FHierarchySearch();
+		~FHierarchySearch();
+
+		// Walkable must be the mask Hierarchy was built or last updated from. OutPath runs from StartIdx to EndIdx
+		// (both included) through adjacent voxels.
+		bool FindPath(const FPathHierarchy& Hierarchy, const FVoxelGrid& Walkable, const FIntVec3& StartIdx, const FIntVec3& EndIdx,
+					  std::vector<FIntVec3>& OutPath);
+
+		// Counters of the abstract search of the last query, and the state kept for the next one
+		FPathSearchStats GetStats() const;
+
+		// Abstract nodes taken from the open set, and searches inside a cluster run to refine the path, by the last query
+		int64_t GetExpandedNum() const { return Stats.ExpandedNum; }
+		int GetRefinedClusterNum() const { return RefinedClusterNum; }
+
+	private:
+		struct FNode;
+		struct FOpenEntry;
+
+		std::unique_ptr<FClusterFlood> Flood;
+		std::vector<FNode> Nodes;
+		std::vector<FOpenEntry> Open;
+		std::vector<uint32_t> GoalCosts;
+		std::vector<int32_t> AbstractPath;
+		uint32_t Generation = 0;
+		FPathSearchStats Stats;
+		int RefinedClusterNum = 0;
+
+		void PushOpen(int32_t Node, int32_t Parent, uint32_t G, uint32_t H);
+		bool Refine(const FVoxelGrid& Walkable, const FVoxelTile& Tile, const FIntVec3& From, const FIntVec3& To, std::vector<FIntVec3>& OutPath);
+	};
+
+	// Hierarchical search states shared by concurrent queries, like FPathSearchPool
+	class FHierarchySearchPool
+	{
+	public:
+		std::unique_ptr<FHierarchySearch> Acquire();
+		void Release(std::unique_ptr<FHierarchySearch> Search);
+
+	private:
+		std::mutex Mutex;
+		std::vector<std::unique_ptr<FHierarchySearch>> Free;
+	};
+}
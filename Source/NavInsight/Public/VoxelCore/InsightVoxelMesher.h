@@ -0,0 +1,32 @@
+#pragma once
+
+#include "VoxelCore/InsightVoxelTiling.h"
+#include "VoxelCore/InsightVoxelTypes.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace InsightVoxel
+{
+	class FVoxelGrid;
+
+	// Rectangle of coplanar voxel faces with the same facing. Dir is -X, +X, -Y, +Y, -Z, +Z (Dir / 2 is the
+	// normal axis, Dir & 1 its sign). The quad covers the faces of the voxels Min + (0..SizeU - 1) * U +
+	// (0..SizeV - 1) * V, where U, V are the two remaining axes in X, Y, Z order.
+	struct FVoxelQuad
+	{
+		FIntVec3 Min;
+		int SizeU = 0;
+		int SizeV = 0;
+		int Dir = 0;
+	};
+
+	// Greedy meshing of the columns in Tile: every exposed face (the neighbour across it is free or outside
+	// the grid) is merged with its coplanar neighbours into as few rectangles as a row-by-row sweep finds.
+	// Faces between Tile and the rest of the grid are culled like any other, so tiles mesh independently.
+	// Returns the number of unit faces covered by the appended quads.
+	int64_t BuildGreedyQuads(const FVoxelGrid& Grid, const FVoxelTile& Tile, std::vector<FVoxelQuad>& OutQuads);
+
+	// Corners of Quad in grid space, counter-clockwise seen from outside (the right hand normal points out)
+	void GetQuadCorners(const FVoxelGrid& Grid, const FVoxelQuad& Quad, FVec3 OutCorners[4]);
+}
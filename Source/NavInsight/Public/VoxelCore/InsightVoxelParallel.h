@@ -0,0 +1,20 @@
+#pragma once
+
+#include <functional>
+
+namespace InsightVoxel
+{
+	// Runs Body(Index) for every Index in [0, Num), possibly concurrently. The Unreal module plugs in
+	// ParallelFor, the standalone build uses ThreadedFor.
+	using FParallelForFn = std::function<void(int Num, const std::function<void(int Index)>& Body)>;
+
+	void SerialFor(int Num, const std::function<void(int Index)>& Body);
+
+	// std::thread based fallback. Workers pull the next index from a shared counter, so uneven
+	// iterations balance themselves.
+	void ThreadedFor(int Num, const std::function<void(int Index)>& Body);
+
+	// Number of workers used by ThreadedFor (defaults to the hardware concurrency)
+	int GetThreadedForWorkerNum();
+	void SetThreadedForWorkerNum(int WorkerNum);
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "VoxelCore/InsightVoxelParallel.h"
+#include "VoxelCore/InsightVoxelPathFinder.h"
+#include "VoxelCore/InsightVoxelTypes.h"
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace InsightVoxel
+{
+	class FClearanceField;
+	class FVoxelGrid;
+	class FVoxelSpanGrid;
+
+	// Start and goal voxel of one query (see ProbeVoxel); invalid voxels give an empty path
+	struct FPathQuery
+	{
+		FIntVec3 Start;
+		FIntVec3 Goal;
+	};
+
+	// Every path of a batch in one flat array: path i is Voxels[Offsets[i], Offsets[i + 1]), start and goal
+	// included, and empty if there is none
+	struct FPathBatchResult
+	{
+		std::vector<FIntVec3> Voxels;
+		std::vector<int32_t> Offsets;
+
+		int GetPathNum() const { return Offsets.empty() ? 0 : static_cast<int>(Offsets.size()) - 1; }
+		int GetPathLength(int Index) const { return Offsets[Index + 1] - Offsets[Index]; }
+		const FIntVec3* GetPath(int Index) const { return Voxels.data() + Offsets[Index]; }
+		bool HasPath(int Index) const { return GetPathLength(Index) > 0; }
+	};
+
+	// Search states for the workers of a batch. A worker takes one for a group of queries and puts it back, so
+	// there are never more than the number of concurrent workers and their pages are reused by later batches.
+	class FPathSearchPool
+	{
+	public:
+		std::unique_ptr<FPathSearch> Acquire();
+		void Release(std::unique_ptr<FPathSearch> Search);
+
+	private:
+		std::mutex Mutex;
+		std::vector<std::unique_ptr<FPathSearch>> Free;
+	};
+
+	struct FPathBatchSettings
+	{
+		// Search of starts with fewer than MinTreeGoals distinct goals
+		EPathAlgorithm Algorithm = EPathAlgorithm::AStar;
+
+		// Starts with at least this many distinct goals grow one shortest path tree for all of them
+		// (FPathSearch::BuildPathTree) instead of searching every goal on its own
+		int MinTreeGoals = 2;
+
+		// Skip voxels with less than MinClearance, as FPathSearch::FindPath does with a clearance field. Bitset
+		// grids only (the spans carry no clearance); every goal is then searched on its own, the tree has no filter.
+		const FClearanceField* Clearance = nullptr;
+		int MinClearance = 0;
+	};
+
+	// Queries sharing a start voxel form a group; groups run on ParallelFor. Every path has the length FindPath
+	// finds, but where several shortest paths exist, the tree and the point-to-point search may pick different ones.
+	void FindPathBatch(const FVoxelGrid& Walkable, const FPathQuery* Queries, int QueryNum, const FPathBatchSettings& Settings,
+					   FPathSearchPool& Pool, const FParallelForFn& ParallelFor, FPathBatchResult& OutResult);
+	void FindPathBatch(const FVoxelSpanGrid& Walkable, const FPathQuery* Queries, int QueryNum, const FPathBatchSettings& Settings,
+					   FPathSearchPool& Pool, const FParallelForFn& ParallelFor, FPathBatchResult& OutResult);
+
+	// Every start to every goal, path S * GoalNum + G of OutResult
+	void FindPathsManyToMany(const FVoxelGrid& Walkable, const FIntVec3* Starts, int StartNum, const FIntVec3* Goals, int GoalNum,
+							 const FPathBatchSettings& Settings, FPathSearchPool& Pool, const FParallelForFn& ParallelFor,
+							 FPathBatchResult& OutResult);
+	void FindPathsManyToMany(const FVoxelSpanGrid& Walkable, const FIntVec3* Starts, int StartNum, const FIntVec3* Goals, int GoalNum,
+							 const FPathBatchSettings& Settings, FPathSearchPool& Pool, const FParallelForFn& ParallelFor,
+							 FPathBatchResult& OutResult);
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include "VoxelCore/InsightVoxelStats.h"
+#include "VoxelCore/InsightVoxelTypes.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace InsightVoxel
+{
+	class FClearanceField;
+	class FVoxelGrid;
+	class FVoxelSpanGrid;
+
+	enum class EPathAlgorithm : uint8_t
+	{
+		// A* over the 6 neighbours with a Manhattan heuristic
+		AStar,
+		// Jump point search: straight runs are skipped until a forced neighbour, only jump points enter the open set
+		JumpPoint,
+	};
+
+	// A voxel is stayable if it is free and one of its 17 neighbours in the 3x3x2 block below/beside it is solid.
+	// Single voxel test; BuildWalkableMask evaluates it for the whole grid at once.
+	bool IsStayableVoxel(const FVoxelGrid& Grid, int X, int Y, int Z);
+
+	// Snap a world position to the free voxel resting on the ground below it (searching at most 3 cells down).
+	// Returns FIntVec3::Invalid() if the position is inside geometry or floating.
+	FIntVec3 ProbeVoxel(const FVoxelGrid& Grid, const FVec3& Position);
+
+	// Shortest path search over stayable voxels, 6-neighbour moves of cost 1. Queries read the walkable mask
+	// built by BuildWalkableMask (one bit per voxel) rather than the occupancy grid.
+	//
+	// Per-voxel search state lives in flat 8x8x8 pages indexed by voxel coordinates, allocated on first touch
+	// and kept across queries; every query bumps a generation counter instead of clearing them. Keep one
+	// instance around (per thread) to make repeated queries allocation free.
+	class FPathSearch
+	{
+	public:
+		FPathSearch();
+		~FPathSearch();
+
+		// OutPath runs from StartIdx to EndIdx (both included) through adjacent voxels, for every algorithm
+		bool FindPath(const FVoxelGrid& Walkable, const FIntVec3& StartIdx, const FIntVec3& EndIdx, EPathAlgorithm Algorithm,
+					  std::vector<FIntVec3>& OutPath);
+
+		// Same search over walkable spans (BuildWalkableSpans); paths are identical to the bitset ones
+		bool FindPath(const FVoxelSpanGrid& Walkable, const FIntVec3& StartIdx, const FIntVec3& EndIdx, EPathAlgorithm Algorithm,
+					  std::vector<FIntVec3>& OutPath);
+
+		// Bitset search that also skips voxels with less than MinClearance (FClearanceField built from Walkable);
+		// the start voxel is exempt, like it is from the walkable test
+		bool FindPath(const FVoxelGrid& Walkable, const FClearanceField& Clearance, int MinClearance, const FIntVec3& StartIdx,
+					  const FIntVec3& EndIdx, EPathAlgorithm Algorithm, std::vector<FIntVec3>& OutPath);
+
+		// One-to-many: grow one shortest path tree from StartIdx, A* towards the nearest goal not reached yet,
+		// until it holds every goal or nothing is left to reach. Returns the number of distinct goals reached;
+		// AppendTreePath reads their paths until the next query. Tree paths are as long as those FindPath returns.
+		int BuildPathTree(const FVoxelGrid& Walkable, const FIntVec3& StartIdx, const FIntVec3* Goals, int GoalNum);
+		int BuildPathTree(const FVoxelSpanGrid& Walkable, const FIntVec3& StartIdx, const FIntVec3* Goals, int GoalNum);
+
+		// Append the path from the tree root to Goal (both included) to OutPath. False, and nothing appended, if
+		// the last BuildPathTree did not reach Goal.
+		bool AppendTreePath(const FIntVec3& Goal, std::vector<FIntVec3>& OutPath);
+
+		// Counters of the last query, and the search state kept for the next one
+		FPathSearchStats GetStats() const;
+
+		// Nodes taken from the open set by the last query
+		int64_t GetExpandedNum() const { return Stats.ExpandedNum; }
+
+	private:
+		struct FNode;
+		struct FOpenEntry;
+
+		// Exactly one of them is set during a query
+		const FVoxelGrid* Walkable = nullptr;
+		const FVoxelSpanGrid* WalkableSpans = nullptr;
+		// Optional agent size filter on top of Walkable
+		const FClearanceField* Clearance = nullptr;
+		int MinClearance = 0;
+		FIntVec3 Goal;
+
+		int PagesX = 0;
+		int PagesY = 0;
+		int PagesZ = 0;
+		std::vector<std::unique_ptr<FNode[]>> Pages;
+		size_t PageNum = 0;
+		std::vector<FOpenEntry> Open;
+		// Goals of BuildPathTree not reached yet
+		std::vector<FIntVec3> TreeGoals;
+		FIntVec3 TreeRoot = FIntVec3::Invalid();
+		uint32_t Generation = 0;
+		FPathSearchStats Stats;
+
+		void Reset(int XNum, int YNum, int ZNum);
+		bool Search(const FIntVec3& StartIdx, const FIntVec3& EndIdx, EPathAlgorithm Algorithm, std::vector<FIntVec3>& OutPath);
+		int GrowTree(const FIntVec3& StartIdx, const FIntVec3* Goals, int GoalNum);
+		void RefreshOpenEstimates();
+		void AppendPath(const FIntVec3& StartIdx, const FIntVec3& EndIdx, std::vector<FIntVec3>& OutPath);
+		FNode& GetNode(const FIntVec3& Idx);
+		uint32_t Heuristic(const FIntVec3& Idx) const;
+		bool IsWalkable(const FIntVec3& Idx) const;
+
+		void PushOpen(const FIntVec3& Idx, const FIntVec3& Parent, uint32_t G, int Dir);
+		void ExpandAStar(const FIntVec3& Idx, uint32_t G);
+		void ExpandJumpPoint(const FIntVec3& Idx, uint32_t G, int Dir);
+		bool Jump(const FIntVec3& From, int Dir, FIntVec3& OutJumpPoint, uint32_t& OutDist) const;
+		bool HasForcedNeighbour(const FIntVec3& Idx, int Dir) const;
+	};
+
+	// One-off query with a temporary FPathSearch
+	bool FindPath(const FVoxelGrid& Walkable, const FIntVec3& StartIdx, const FIntVec3& EndIdx, std::vector<FIntVec3>& OutPath,
+				  EPathAlgorithm Algorithm = EPathAlgorithm::AStar);
+}
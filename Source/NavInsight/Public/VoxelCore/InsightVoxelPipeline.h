@@ -0,0 +1,61 @@
+#pragma once
+
+#include "VoxelCore/InsightVoxelParallel.h"
+#include "VoxelCore/InsightVoxelStats.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+
+namespace InsightVoxel
+{
+	class FTriangleBvh;
+	class FVoxelGrid;
+
+	// Indexed triangle soup produced by the export stage. The buffers belong to the exporter and must stay
+	// valid until the pipeline returns.
+	struct FTriangleBatch
+	{
+		const float* Verts = nullptr;
+		int NumVerts = 0;
+		const int32_t* Indices = nullptr;
+		int NumTris = 0;
+		// Optional hierarchy over the batch, to skip the triangles outside the grid
+		const FTriangleBvh* Bvh = nullptr;
+	};
+
+	// Bounded multi-producer / single-consumer queue of batches. Push blocks while the queue is full, so
+	// exporters cannot run arbitrarily far ahead of the rasterizer.
+	class FTriangleBatchQueue
+	{
+	public:
+		explicit FTriangleBatchQueue(int Capacity);
+
+		void Push(const FTriangleBatch& Batch);
+
+		// Blocks until a batch is available. Returns false once the queue is closed and drained.
+		bool Pop(FTriangleBatch& OutBatch);
+
+		// No more pushes; wakes the consumer
+		void Close();
+
+	private:
+		std::mutex Mutex;
+		std::condition_variable NotEmpty;
+		std::condition_variable NotFull;
+		std::deque<FTriangleBatch> Batches;
+		int Capacity;
+		bool bClosed = false;
+	};
+
+	// Returns false if item Index has nothing to rasterize
+	using FExportBatchFn = std::function<bool(int Index, FTriangleBatch& OutBatch)>;
+
+	// Run Export over [0, ItemNum) on ParallelFor and rasterize the batches on a dedicated thread as they arrive,
+	// so export and rasterization overlap. Rasterization only sets bits, so the grid is the same as rasterizing
+	// the batches serially in any order. The rasterizing thread counts into Stats if it is given.
+	void RasterizePipelined(FVoxelGrid& Grid, int ItemNum, const FExportBatchFn& Export, const FParallelForFn& ParallelFor,
+							int QueueCapacity = 64, FVoxelStats* Stats = nullptr);
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "VoxelCore/InsightVoxelParallel.h"
+#include "VoxelCore/InsightVoxelStats.h"
+#include "VoxelCore/InsightVoxelTiling.h"
+#include "VoxelCore/InsightVoxelTypes.h"
+
+#include <cstdint>
+
+namespace InsightVoxel
+{
+	class FSparseVoxelGrid;
+	class FTriangleBvh;
+	class FVoxelGrid;
+
+	// Split a convex polygon by the axis-aligned plane [Axis] = X.
+	// Left receives the part with [Axis] <= X, Right the part with [Axis] >= X.
+	// Output buffers must hold at least 7 vertices.
+	void DividePoly(const FVec3* InPoly, int NIn,
+					FVec3* OutPolyLeft, int& NOutLeft,
+					FVec3* OutPolyRight, int& NOutRight,
+					float X, int Axis);
+
+	// Mark every voxel touched by triangle ABC as occupied
+	void RasterizeTriangle(FVoxelGrid& Grid, const FVec3& A, const FVec3& B, const FVec3& C);
+
+	// Same as above, but only the columns inside Tile are written. Clipping still walks from the first
+	// row / column of the triangle, so the result is bit-identical to the untiled version for any tiling.
+	void RasterizeTriangle(FVoxelGrid& Grid, const FVec3& A, const FVec3& B, const FVec3& C, const FVoxelTile& Tile);
+
+	// Rasterize an indexed triangle soup. Verts holds NumVerts xyz triples, Indices holds NumTris * 3 entries.
+	// This and the batch functions below add their counters to Stats if it is given.
+	void RasterizeTriangles(FVoxelGrid& Grid, const float* Verts, int NumVerts, const int32_t* Indices, int NumTris,
+							FVoxelStats* Stats = nullptr);
+
+	// Same, writing only the columns inside Tile (for re-rasterizing a region after clearing it)
+	void RasterizeTriangles(FVoxelGrid& Grid, const float* Verts, int NumVerts, const int32_t* Indices, int NumTris, const FVoxelTile& Tile,
+							FVoxelStats* Stats = nullptr);
+
+	// Same, visiting only the triangles Bvh (built over this soup) finds around the grid or around Tile, for
+	// large meshes mostly outside the volume or the region being rebuilt. Writes the same voxels as the overloads above.
+	void RasterizeTriangles(FVoxelGrid& Grid, const float* Verts, int NumVerts, const int32_t* Indices, const FTriangleBvh& Bvh,
+							FVoxelStats* Stats = nullptr);
+	void RasterizeTriangles(FVoxelGrid& Grid, const float* Verts, int NumVerts, const int32_t* Indices, const FTriangleBvh& Bvh,
+							const FVoxelTile& Tile, FVoxelStats* Stats = nullptr);
+
+	// Same rasterization into sparse storage (serial only: bricks are allocated while writing)
+	void RasterizeTriangle(FSparseVoxelGrid& Grid, const FVec3& A, const FVec3& B, const FVec3& C);
+	void RasterizeTriangles(FSparseVoxelGrid& Grid, const float* Verts, int NumVerts, const int32_t* Indices, int NumTris,
+							FVoxelStats* Stats = nullptr);
+	void RasterizeTriangles(FSparseVoxelGrid& Grid, const float* Verts, int NumVerts, const int32_t* Indices, int NumTris,
+							const FVoxelTile& Tile, FVoxelStats* Stats = nullptr);
+
+	// Bin the triangles into the tiles they overlap and rasterize the tiles in parallel. Tiles own
+	// disjoint columns (and columns are word aligned in FVoxelGrid), so workers never share a word.
+	void RasterizeTrianglesTiled(FVoxelGrid& Grid, const float* Verts, int NumVerts, const int32_t* Indices, int NumTris,
+								 const FVoxelTiling& Tiling, const FParallelForFn& ParallelFor, FVoxelStats* Stats = nullptr);
+}
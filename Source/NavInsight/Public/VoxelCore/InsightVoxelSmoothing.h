@@ -0,0 +1,25 @@
+#pragma once
+
+#include "VoxelCore/InsightVoxelTypes.h"
+
+#include <vector>
+
+namespace InsightVoxel
+{
+	class FClearanceField;
+	class FVoxelGrid;
+
+	// Whether the segment between the centers of From and To only crosses stayable voxels (and, with a Clearance,
+	// only voxels of at least MinClearance). Where it passes exactly through an edge or corner, the voxels on
+	// both sides must be clear, so it never cuts a corner a 6-neighbour path could not take.
+	//
+	// Amanatides-Woo traversal over the XY columns: the Z range the segment spans inside a column is tested as
+	// one mask per column word rather than voxel by voxel.
+	bool HasLineOfSight(const FVoxelGrid& Walkable, const FIntVec3& From, const FIntVec3& To,
+						const FClearanceField* Clearance = nullptr, int MinClearance = 0);
+
+	// String pulling: keep the first voxel of Path, then every voxel past which the last kept one loses line of
+	// sight, then the last one. Straight moves between consecutive waypoints stay on stayable voxels.
+	void SmoothPath(const FVoxelGrid& Walkable, const std::vector<FIntVec3>& Path, std::vector<FIntVec3>& OutWaypoints,
+					const FClearanceField* Clearance = nullptr, int MinClearance = 0);
+}
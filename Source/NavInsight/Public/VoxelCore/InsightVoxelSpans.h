@@ -0,0 +1,103 @@
+#pragma once
+
+#include "VoxelCore/InsightVoxelTiling.h"
+#include "VoxelCore/InsightVoxelTypes.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace InsightVoxel
+{
+	class FVoxelGrid;
+
+	// Run of set voxels [ZMin, ZMax) in one column
+	struct FVoxelSpan
+	{
+		uint16_t ZMin = 0;
+		uint16_t ZMax = 0;
+	};
+
+	// Compacted span representation of a voxel set, laid out like rcCompactHeightfield: one offset per
+	// (X, Y) column (in the column order of FVoxelGrid) into a single contiguous array of sorted, disjoint,
+	// non-touching spans. A column costs 4 bytes plus 4 per span whatever its height, and scans over it are
+	// linear in memory.
+	//
+	// Built either from a FVoxelGrid (BuildFromGrid) or span by span from another span source such as a
+	// Recast heightfield (Init, AppendSpan in column order, FinishSpans).
+	class FVoxelSpanGrid
+	{
+	public:
+		// Heights are stored in 16 bits
+		static const int MaxZNum = 0xffff;
+
+		// Compute the grid dimensions from the bounds and drop every span. Returns false if the grid is
+		// taller than MaxZNum.
+		bool Init(const FBounds3& InBounds, float InCellSize, float InCellHeight);
+
+		// Append [ZMin, ZMax) to column (X, Y). Columns must come in increasing column order (X major, then
+		// Y) and spans of a column bottom up; overlapping or touching spans are merged. Range is clamped to
+		// the column.
+		void AppendSpan(int X, int Y, int ZMin, int ZMax);
+
+		// Close the columns after the last AppendSpan
+		void FinishSpans();
+
+		// Init with the dimensions of Grid and collect its runs of occupied voxels
+		bool BuildFromGrid(const FVoxelGrid& Grid);
+
+		// Collect the runs of Grid again for the columns in Columns only and splice them in: the spans from the
+		// first to the last column of Columns are replaced, the ones after are moved and their offsets shifted.
+		// Built from scratch if Grid has other dimensions.
+		bool UpdateFromGrid(const FVoxelGrid& Grid, const FVoxelTile& Columns);
+
+		int GetSpanNum(int X, int Y) const
+		{
+			const size_t Column = ColumnIndex(X, Y);
+			return static_cast<int>(ColumnStart[Column + 1] - ColumnStart[Column]);
+		}
+		const FVoxelSpan* GetSpans(int X, int Y) const { return Spans.data() + ColumnStart[ColumnIndex(X, Y)]; }
+
+		bool GetVoxelOccupied(int X, int Y, int Z) const;
+
+		bool IsVoxelInside(int X, int Y, int Z) const;
+
+		size_t GetTotalSpanNum() const { return Spans.size(); }
+
+		int64_t CountOccupied() const;
+
+		// Same dimensions and the same occupied voxels as a dense grid
+		bool HasSameOccupancy(const FVoxelGrid& Grid) const;
+
+		// Offsets plus spans
+		size_t GetAllocatedBytes() const;
+
+		const FBounds3& GetBounds() const { return Bounds; }
+		float GetCellSize() const { return CellSize; }
+		float GetCellHeight() const { return CellHeight; }
+
+		int GetXNum() const { return XNum; }
+		int GetYNum() const { return YNum; }
+		int GetZNum() const { return ZNum; }
+
+	private:
+		// Spans of column C are [ColumnStart[C], ColumnStart[C + 1])
+		std::vector<uint32_t> ColumnStart;
+		std::vector<FVoxelSpan> Spans;
+		// First column not closed yet while building
+		size_t BuildColumn = 0;
+
+		FBounds3 Bounds;
+		float CellSize = 20.0f;
+		float CellHeight = 50.0f;
+
+		int XNum = 0;
+		int YNum = 0;
+		int ZNum = 0;
+
+		size_t ColumnIndex(int X, int Y) const
+		{
+			return static_cast<size_t>(static_cast<int64_t>(X) * YNum + Y);
+		}
+	};
+}
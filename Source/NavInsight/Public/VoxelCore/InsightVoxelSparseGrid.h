@@ -0,0 +1,128 @@
+#pragma once
+
+#include "VoxelCore/InsightVoxelTiling.h"
+#include "VoxelCore/InsightVoxelTypes.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace InsightVoxel
+{
+	class FVoxelGrid;
+
+	// Occupancy bitset with the interface of FVoxelGrid, for volumes that are mostly empty.
+	//
+	// The grid is split into bricks of 8 x 8 columns by 64 voxels (4096 voxels, one 64-bit word per
+	// column, same bit order as FVoxelGrid) kept in a hash map on the brick coordinates. A brick is only
+	// allocated when a voxel in it is set; bricks found uniformly full by CollapseUniformBricks are stored
+	// as a marker without words. Memory therefore follows the surface of the geometry rather than the
+	// bounding volume, and dimensions are only limited by 21 bits of brick coordinates per axis.
+	//
+	// Not safe for concurrent writes (allocation touches the shared map), rasterize into it serially.
+	class FSparseVoxelGrid
+	{
+	public:
+		static const int BrickShift = 3;
+		static const int BrickColumns = 1 << BrickShift;
+		static const int BrickWords = BrickColumns * BrickColumns;
+
+		// Compute the grid dimensions from the bounds and release every brick
+		void Init(const FBounds3& InBounds, float InCellSize, float InCellHeight);
+
+		void SetVoxelOccupied(int X, int Y, int Z, bool Flag);
+		bool GetVoxelOccupied(int X, int Y, int Z) const;
+
+		// Mark voxels [ZMin, ZMax) of column (X, Y) as occupied
+		void SetSpan(int X, int Y, int ZMin, int ZMax);
+
+		// Clear every voxel of the columns in Columns, releasing the bricks that become empty
+		void ClearColumns(const FVoxelTile& Columns);
+
+		// Columns whose cells overlap Box, grown by Margin columns on every side and clipped to the grid
+		FVoxelTile GetColumnRect(const FBounds3& Box, int Margin = 0) const;
+
+		// Word WordIndex of column (X, Y), same layout as FVoxelGrid::GetColumnMask
+		uint64_t GetColumnMask(int X, int Y, int WordIndex) const;
+
+		bool IsAnyOccupied(int X, int Y, int ZMin, int ZMax) const;
+		int FindHighestOccupied(int X, int Y, int ZMin, int ZMax) const;
+
+		bool IsVoxelInside(int X, int Y, int Z) const;
+
+		int64_t CountOccupied() const;
+
+		// Same dimensions and the same occupied voxels as a dense grid
+		bool HasSameOccupancy(const FVoxelGrid& Dense) const;
+
+		// Set the occupied voxels in Dense, which must have the same dimensions. Only the words of the bricks
+		// are touched.
+		void WriteToDense(FVoxelGrid& Dense) const;
+
+		// Coordinates (in bricks) of the allocated and collapsed bricks, in no particular order
+		void GetBricks(std::vector<FIntVec3>& OutBricks) const;
+
+		// The BrickWords words of brick (BX, BY, BZ), column (X, Y) of the block at (X % BrickColumns) *
+		// BrickColumns + Y % BrickColumns; zeros if the brick is not allocated. One lookup for the whole brick.
+		void GetBrickWords(int BX, int BY, int BZ, uint64_t* OutWords) const;
+
+		// Replace bricks with every voxel set by a marker and release empty ones. Returns the bricks collapsed.
+		int64_t CollapseUniformBricks();
+
+		// Allocated bricks (with words) and collapsed full bricks
+		size_t GetBrickNum() const { return Bricks.size() - FullBrickNum; }
+		size_t GetFullBrickNum() const { return FullBrickNum; }
+
+		// Approximate heap footprint: brick words plus the hash map
+		size_t GetAllocatedBytes() const;
+
+		const FBounds3& GetBounds() const { return Bounds; }
+		float GetCellSize() const { return CellSize; }
+		float GetCellHeight() const { return CellHeight; }
+
+		int GetXNum() const { return XNum; }
+		int GetYNum() const { return YNum; }
+		int GetZNum() const { return ZNum; }
+		int64_t GetVoxelNum() const { return static_cast<int64_t>(XNum) * YNum * ZNum; }
+		int GetColumnWords() const { return ColumnWords; }
+
+	private:
+		// Value of a collapsed brick in Bricks
+		static const uint32_t FullBrick = UINT32_MAX;
+
+		// Brick key -> slot of its BrickWords words in BrickPool, or FullBrick
+		std::unordered_map<uint64_t, uint32_t> Bricks;
+		std::vector<uint64_t> BrickPool;
+		std::vector<uint32_t> FreeBricks;
+		size_t FullBrickNum = 0;
+
+		FBounds3 Bounds;
+		float CellSize = 20.0f;
+		float CellHeight = 50.0f;
+
+		int XNum = 0;
+		int YNum = 0;
+		int ZNum = 0;
+		int ColumnWords = 0;
+
+		static uint64_t BrickKey(int BX, int BY, int BZ)
+		{
+			return static_cast<uint64_t>(BX) | (static_cast<uint64_t>(BY) << 21) | (static_cast<uint64_t>(BZ) << 42);
+		}
+
+		static int BrickWordIndex(int X, int Y)
+		{
+			return ((X & (BrickColumns - 1)) << BrickShift) | (Y & (BrickColumns - 1));
+		}
+
+		// Bits of word WordIndex that lie inside the grid (all but the padding of the top word)
+		uint64_t GetValidMask(int WordIndex) const;
+
+		// Words of the brick holding word WordIndex of column (X, Y), allocating or expanding it
+		uint64_t* GetBrickForWrite(int X, int Y, int WordIndex);
+
+		uint32_t AllocBrick(uint64_t Fill);
+		void ReleaseBrick(uint32_t Slot);
+	};
+}
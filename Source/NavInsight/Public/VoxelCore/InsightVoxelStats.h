@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace InsightVoxel
+{
+	// Work done by the rasterizer. Functions taking a FVoxelStats* add to it (they never reset it) once per call
+	// and count in locals meanwhile, so the inner loops stay as they are. Not thread safe: rasterization on
+	// ParallelFor counts per tile and adds the tiles up when they are done.
+	struct FVoxelStats
+	{
+		// Triangles handed to the rasterizer, and those skipped before clipping: bad indices, outside the grid
+		// or the tile, or left out by a BVH query
+		int64_t TrianglesSubmitted = 0;
+		int64_t TrianglesCulled = 0;
+
+		// Grid rows triangles were clipped to, and row cells split off by ClipRowSpans
+		int64_t RowsClipped = 0;
+		int64_t CellsClipped = 0;
+
+		// SetSpan calls and the voxels they covered (a voxel covered by several triangles counts once per triangle)
+		int64_t SpansWritten = 0;
+		int64_t VoxelsWritten = 0;
+
+		FVoxelStats& operator+=(const FVoxelStats& Other)
+		{
+			TrianglesSubmitted += Other.TrianglesSubmitted;
+			TrianglesCulled += Other.TrianglesCulled;
+			RowsClipped += Other.RowsClipped;
+			CellsClipped += Other.CellsClipped;
+			SpansWritten += Other.SpansWritten;
+			VoxelsWritten += Other.VoxelsWritten;
+			return *this;
+		}
+	};
+
+	// Counters of one path query
+	struct FPathSearchStats
+	{
+		// Nodes taken from the open set, entries pushed onto it, and the most it held at once
+		int64_t ExpandedNum = 0;
+		int64_t PushedNum = 0;
+		int64_t PeakOpenNum = 0;
+
+		// Search state the searcher holds after the query (kept for the next one)
+		size_t AllocatedBytes = 0;
+	};
+}
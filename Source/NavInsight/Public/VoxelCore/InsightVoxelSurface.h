@@ -0,0 +1,16 @@
+#pragma once
+
+#include "VoxelCore/InsightVoxelTiling.h"
+#include "VoxelCore/InsightVoxelTypes.h"
+
+#include <vector>
+
+namespace InsightVoxel
+{
+	class FVoxelGrid;
+
+	// Append the occupied voxels of the columns in Tile that have at least one free 6-neighbour (voxels
+	// outside the grid count as free). Fully enclosed voxels can never be seen, so renderers skip them.
+	// Voxels come out column by column, bottom to top.
+	void CollectSurfaceVoxels(const FVoxelGrid& Grid, const FVoxelTile& Tile, std::vector<FIntVec3>& OutVoxels);
+}
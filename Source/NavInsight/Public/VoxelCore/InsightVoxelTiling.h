@@ -0,0 +1,65 @@
+#pragma once
+
+namespace InsightVoxel
+{
+	// Half-open rectangle of (X, Y) columns
+	struct FVoxelTile
+	{
+		int X0 = 0;
+		int Y0 = 0;
+		int X1 = 0;
+		int Y1 = 0;
+
+		FVoxelTile() {}
+		FVoxelTile(int InX0, int InY0, int InX1, int InY1) : X0(InX0), Y0(InY0), X1(InX1), Y1(InY1) {}
+
+		bool Contains(int X, int Y) const { return X >= X0 && X < X1 && Y >= Y0 && Y < Y1; }
+		bool IsEmpty() const { return X0 >= X1 || Y0 >= Y1; }
+	};
+
+	// Regular partition of the XY columns of a grid into TileX x TileY tiles (the last row / column of
+	// tiles may be smaller). A tile width equal to the grid width gives Y row bands.
+	class FVoxelTiling
+	{
+	public:
+		void Init(int InXNum, int InYNum, int InTileX, int InTileY)
+		{
+			XNum = InXNum;
+			YNum = InYNum;
+			TileX = InTileX > 0 ? InTileX : (XNum > 0 ? XNum : 1);
+			TileY = InTileY > 0 ? InTileY : (YNum > 0 ? YNum : 1);
+			TilesX = (XNum + TileX - 1) / TileX;
+			TilesY = (YNum + TileY - 1) / TileY;
+		}
+
+		int GetTileNum() const { return TilesX * TilesY; }
+		int GetTilesX() const { return TilesX; }
+		int GetTilesY() const { return TilesY; }
+		int GetTileX() const { return TileX; }
+		int GetTileY() const { return TileY; }
+
+		int GetTileIndex(int TX, int TY) const { return TY * TilesX + TX; }
+
+		int GetTileIndexOfColumn(int X, int Y) const { return GetTileIndex(X / TileX, Y / TileY); }
+
+		FVoxelTile GetTile(int TileIndex) const
+		{
+			const int TX = TileIndex % TilesX;
+			const int TY = TileIndex / TilesX;
+			return {
+				TX * TileX,
+				TY * TileY,
+				(TX + 1) * TileX < XNum ? (TX + 1) * TileX : XNum,
+				(TY + 1) * TileY < YNum ? (TY + 1) * TileY : YNum
+			};
+		}
+
+	private:
+		int XNum = 0;
+		int YNum = 0;
+		int TileX = 1;
+		int TileY = 1;
+		int TilesX = 0;
+		int TilesY = 0;
+	};
+}
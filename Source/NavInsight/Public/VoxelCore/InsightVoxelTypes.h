@@ -0,0 +1,71 @@
+// Engine-independent math types shared by the voxelization core.
+//
+// Everything under VoxelCore/ is plain C++ (no UObject, no FVector) so that it can be built both
+// inside the NavInsight module and by the standalone CMake target used for benchmarking.
+
+#pragma once
+
+#include <cstdint>
+
+namespace InsightVoxel
+{
+	struct FVec3
+	{
+		float X = 0.0f;
+		float Y = 0.0f;
+		float Z = 0.0f;
+
+		FVec3() {}
+		FVec3(float InX, float InY, float InZ) : X(InX), Y(InY), Z(InZ) {}
+
+		float operator[](int Axis) const { return (&X)[Axis]; }
+		float& operator[](int Axis) { return (&X)[Axis]; }
+
+		FVec3 operator+(const FVec3& Other) const { return {X + Other.X, Y + Other.Y, Z + Other.Z}; }
+		FVec3 operator-(const FVec3& Other) const { return {X - Other.X, Y - Other.Y, Z - Other.Z}; }
+		FVec3 operator*(float Scale) const { return {X * Scale, Y * Scale, Z * Scale}; }
+	};
+
+	struct FIntVec3
+	{
+		int X = 0;
+		int Y = 0;
+		int Z = 0;
+
+		FIntVec3() {}
+		FIntVec3(int InX, int InY, int InZ) : X(InX), Y(InY), Z(InZ) {}
+
+		bool operator==(const FIntVec3& Other) const { return X == Other.X && Y == Other.Y && Z == Other.Z; }
+		bool operator!=(const FIntVec3& Other) const { return !(*this == Other); }
+
+		static FIntVec3 Invalid() { return {-1, -1, -1}; }
+		bool IsValid() const { return X >= 0; }
+	};
+
+	struct FBounds3
+	{
+		FVec3 Min;
+		FVec3 Max;
+
+		FBounds3() {}
+		FBounds3(const FVec3& InMin, const FVec3& InMax) : Min(InMin), Max(InMax) {}
+
+		// Same semantic as FBox::Intersect (touching boxes intersect)
+		bool Intersect(const FBounds3& Other) const
+		{
+			if (Min.X > Other.Max.X || Other.Min.X > Max.X)
+			{
+				return false;
+			}
+			if (Min.Y > Other.Max.Y || Other.Min.Y > Max.Y)
+			{
+				return false;
+			}
+			if (Min.Z > Other.Max.Z || Other.Min.Z > Max.Z)
+			{
+				return false;
+			}
+			return true;
+		}
+	};
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "VoxelCore/InsightVoxelParallel.h"
+#include "VoxelCore/InsightVoxelTiling.h"
+
+namespace InsightVoxel
+{
+	class FSparseVoxelGrid;
+	class FVoxelGrid;
+	class FVoxelSpanGrid;
+
+	// Compute the stayable voxels of Grid (see IsStayableVoxel) into OutWalkable, which gets the same
+	// dimensions: a set bit means the voxel can be stood in.
+	//
+	// Works on whole column words: the 3x3 neighbourhood of a column is the OR of its neighbour columns
+	// (separably, first along X then along Y), the voxel below is covered by shifting that up one bit, and the
+	// result is masked with the free voxels. ParallelFor runs over X slices.
+	void BuildWalkableMask(const FVoxelGrid& Grid, FVoxelGrid& OutWalkable, const FParallelForFn& ParallelFor = SerialFor);
+
+	// Same mask read from sparse bricks. Only the words of the brick column blocks with a brick around them (at
+	// that word or the one below) can hold stayable voxels; those are computed block by block on ParallelFor, the
+	// rest of OutWalkable is left clear. Cost follows the bricks rather than the volume.
+	void BuildWalkableMask(const FSparseVoxelGrid& Grid, FVoxelGrid& OutWalkable, const FParallelForFn& ParallelFor = SerialFor);
+
+	// Recompute the mask for the columns in Columns only. Walkable must already have Grid's dimensions. A voxel
+	// change in column (X, Y) affects the mask of the 3x3 columns around it, so grow the changed rect by one.
+	void UpdateWalkableMask(const FVoxelGrid& Grid, FVoxelGrid& Walkable, const FVoxelTile& Columns,
+							const FParallelForFn& ParallelFor = SerialFor);
+
+	// Same stayable voxels computed on compacted spans: a voxel is stayable if it is free and lies in
+	// [ZMin, ZMax + 1) of a span of one of the 3x3 columns around it. Per column, the neighbour spans grown
+	// up by one are merged in Z order and the column's own spans are cut out of the result.
+	void BuildWalkableSpans(const FVoxelSpanGrid& Solid, FVoxelSpanGrid& OutWalkable);
+}